@@ -17,7 +17,11 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES += \
     MsgTask.cpp \
+    LocMsgStats.cpp \
+    LocMsgPool.cpp \
     LocApiBase.cpp \
+    LocApiTrace.cpp \
+    LocApiReplay.cpp \
     LocAdapterBase.cpp \
     ContextBase.cpp \
     LocDualContext.cpp \
@@ -27,13 +31,31 @@ LOCAL_CFLAGS += \
      -fno-short-enums \
      -D_ANDROID_
 
+# per LocMsg type latency histograms, see MsgTask::dumpMsgStats()
+ifeq ($(TARGET_LOC_MSG_STATS),true)
+    LOCAL_CFLAGS += -DLOC_MSG_STATS
+endif
+
+ifeq ($(TARGET_BUILD_VARIANT),user)
+    LOCAL_CFLAGS += -DTARGET_BUILD_VARIANT_USER
+endif
+
+# highest LOC_LOGx level built in, 1 (E) to 5 (V), see log_util.h
+LOC_LOG_LEVEL := $(or $(TARGET_LOC_LOG_LEVEL_CORE),$(TARGET_LOC_LOG_LEVEL))
+ifneq ($(LOC_LOG_LEVEL),)
+    LOCAL_CFLAGS += -DLOC_LOG_COMPILED_LEVEL=$(LOC_LOG_LEVEL)
+endif
+
 LOCAL_C_INCLUDES:= \
     $(TARGET_OUT_HEADERS)/gps.utils
 
 LOCAL_COPY_HEADERS_TO:= libloc_core/
 LOCAL_COPY_HEADERS:= \
     MsgTask.h \
+    LocMsgPool.h \
+    LocMsgStats.h \
     LocApiBase.h \
+    LocApiTrace.h \
     LocAdapterBase.h \
     ContextBase.h \
     LocDualContext.h \
@@ -47,4 +69,37 @@ LOCAL_PRELINK_MODULE := false
 
 include $(BUILD_SHARED_LIBRARY)
 
+# Static host build for the tools and tests under gps/test, see
+# libgps.utils_host. LocApiReplay stands in for the modem there.
+ifeq ($(HOST_OS),linux)
+LOC_CORE_SRC_FILES := $(LOCAL_SRC_FILES)
+LOC_CORE_CFLAGS := $(LOCAL_CFLAGS)
+
+include $(CLEAR_VARS)
+
+LOCAL_STATIC_LIBRARIES := \
+    libgps.utils_host \
+    libloc_host_shim
+
+LOCAL_SRC_FILES := $(LOC_CORE_SRC_FILES)
+
+LOCAL_CFLAGS := $(LOC_CORE_CFLAGS) \
+    -include $(LOCAL_PATH)/../test/shim/loc_host_shim.h
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)/../test/shim \
+    $(LOCAL_PATH)/../utils \
+    $(LOCAL_PATH)/../utils/platform_lib_abstractions \
+    hardware/libhardware/include
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := \
+    $(LOCAL_PATH)
+
+LOCAL_MODULE := libloc_core_host
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+endif # HOST_OS linux
+
 endif # not BUILD_TINY_ANDROID
@@ -37,9 +37,29 @@
 #include <loc_target.h>
 #include <log_util.h>
 #include <loc_log.h>
+#include <loc_cfg.h>
+#include <LocApiReplay.h>
+
+#ifndef GPS_CONF_FILE
+#define GPS_CONF_FILE            "/etc/gps.conf"
+#endif
 
 namespace loc_core {
 
+/* LocApi record / replay, see LocApiTrace.h */
+static char LOC_API_TRACE[LOC_MAX_PARAM_STRING + 1];
+static char LOC_API_REPLAY[LOC_MAX_PARAM_STRING + 1];
+static char LOC_API_REPLAY_RESULTS[LOC_MAX_PARAM_STRING + 1];
+static uint32_t LOC_API_REPLAY_REALTIME = 1;
+
+static loc_param_s_type loc_api_trace_table[] =
+{
+  {"LOC_API_TRACE",                  LOC_API_TRACE,            NULL, 's', 0, 0},
+  {"LOC_API_REPLAY",                 LOC_API_REPLAY,           NULL, 's', 0, 0},
+  {"LOC_API_REPLAY_REALTIME",        &LOC_API_REPLAY_REALTIME, NULL, 'n', 0, 1},
+  {"LOC_API_REPLAY_RESULTS",         LOC_API_REPLAY_RESULTS,   NULL, 's', 0, 0},
+};
+
 LBSProxyBase* ContextBase::getLBSProxy(const char* libName)
 {
     LBSProxyBase* proxy = NULL;
@@ -63,8 +83,17 @@ LocApiBase* ContextBase::createLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask)
 {
     LocApiBase* locApi = NULL;
 
+    UTIL_READ_CONF(GPS_CONF_FILE, loc_api_trace_table);
+
+    // a recorded trace stands in for the modem
+    if ('\0' != LOC_API_REPLAY[0]) {
+        locApi = LocApiReplay::create(mMsgTask, exMask, LOC_API_REPLAY,
+                                      LOC_API_REPLAY_REALTIME != 0,
+                                      LOC_API_REPLAY_RESULTS);
+    }
+
     // first if can not be MPQ
-    if (TARGET_MPQ != loc_get_target()) {
+    if (NULL == locApi && TARGET_MPQ != loc_get_target()) {
         if (NULL == (locApi = mLBSProxy->getLocApi(mMsgTask, exMask))) {
             // only RPC is the option now
             void* handle = dlopen("libloc_api-rpc-qc.so", RTLD_NOW);
@@ -83,6 +112,10 @@ LocApiBase* ContextBase::createLocApi(LOC_API_ADAPTER_EVENT_MASK_T exMask)
         locApi = new LocApiBase(mMsgTask, exMask);
     }
 
+    if ('\0' != LOC_API_TRACE[0]) {
+        locApi->setTrace(LocApiTrace::create(LOC_API_TRACE));
+    }
+
     return locApi;
 }
 
@@ -57,12 +57,12 @@ public:
         return mEvtMask;
     }
 
-    inline void sendMsg(const LocMsg* msg) const {
-        mMsgTask->sendMsg(msg);
+    inline bool sendMsg(const LocMsg* msg) const {
+        return mMsgTask->sendMsg(msg);
     }
 
-    inline void sendMsg(const LocMsg* msg) {
-        mMsgTask->sendMsg(msg);
+    inline bool sendMsg(const LocMsg* msg) {
+        return mMsgTask->sendMsg(msg);
     }
 
     // This will be overridden by the individual adapters
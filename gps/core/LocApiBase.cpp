@@ -30,6 +30,8 @@
 #define LOG_TAG "LocSvc_LocApiBase"
 
 #include <dlfcn.h>
+#include <stdio.h>
+#include <string.h>
 #include <LocApiBase.h>
 #include <LocAdapterBase.h>
 #include <log_util.h>
@@ -126,18 +128,47 @@ struct LocOpenMsg : public LocMsg {
 
 LocApiBase::LocApiBase(const MsgTask* msgTask,
                        LOC_API_ADAPTER_EVENT_MASK_T excludedMask) :
-    mExcludedMask(excludedMask), mMsgTask(msgTask), mMask(0)
+    mExcludedMask(excludedMask), mMsgTask(msgTask), mTrace(NULL), mMask(0)
 {
     memset(mLocAdapters, 0, sizeof(mLocAdapters));
+    memset(mEvtSubscribers, 0, sizeof(mEvtSubscribers));
+    mAdapterEvtMask = 0;
 }
 
 LOC_API_ADAPTER_EVENT_MASK_T LocApiBase::getEvtMask()
 {
-    LOC_API_ADAPTER_EVENT_MASK_T mask = 0;
+    return mAdapterEvtMask & ~mExcludedMask;
+}
 
-    TO_ALL_LOCADAPTERS(mask |= mLocAdapters[i]->getEvtMask());
+void LocApiBase::subscribeEvents(int slot, LOC_API_ADAPTER_EVENT_MASK_T mask)
+{
+    mask &= (1 << LOC_API_ADAPTER_EVENT_MAX) - 1;
+    mAdapterEvtMask |= mask;
+    for (; mask != 0; mask &= mask - 1) {
+        mEvtSubscribers[__builtin_ctz(mask)] |= 1 << slot;
+    }
+}
 
-    return mask & ~mExcludedMask;
+void LocApiBase::unsubscribeEvents(int slot, LOC_API_ADAPTER_EVENT_MASK_T mask)
+{
+    mask &= (1 << LOC_API_ADAPTER_EVENT_MAX) - 1;
+    for (; mask != 0; mask &= mask - 1) {
+        int evt = __builtin_ctz(mask);
+        mEvtSubscribers[evt] &= ~(1 << slot);
+        if (0 == mEvtSubscribers[evt]) {
+            // the last one interested in it
+            mAdapterEvtMask &= ~(1 << evt);
+        }
+    }
+}
+
+void LocApiBase::moveEvents(int from, int to, LOC_API_ADAPTER_EVENT_MASK_T mask)
+{
+    mask &= (1 << LOC_API_ADAPTER_EVENT_MAX) - 1;
+    for (; mask != 0; mask &= mask - 1) {
+        uint32_t& subscribers = mEvtSubscribers[__builtin_ctz(mask)];
+        subscribers = (subscribers & ~(1 << from)) | (1 << to);
+    }
 }
 
 bool LocApiBase::isInSession()
@@ -157,9 +188,13 @@ void LocApiBase::addAdapter(LocAdapterBase* adapter)
 {
     for (int i = 0; i < MAX_ADAPTERS && mLocAdapters[i] != adapter; i++) {
         if (mLocAdapters[i] == NULL) {
+            LOC_API_ADAPTER_EVENT_MASK_T oldMask = getEvtMask();
             mLocAdapters[i] = adapter;
-            mMsgTask->sendMsg(new LocOpenMsg(this,
-                                             (adapter->getEvtMask())));
+            subscribeEvents(i, adapter->getEvtMask());
+            // only (re)open if the first adapter or it adds events
+            if (0 == i || getEvtMask() != oldMask) {
+                mMsgTask->sendMsg(new LocOpenMsg(this, getEvtMask()));
+            }
             break;
         }
     }
@@ -171,6 +206,8 @@ void LocApiBase::removeAdapter(LocAdapterBase* adapter)
          i < MAX_ADAPTERS && NULL != mLocAdapters[i];
          i++) {
         if (mLocAdapters[i] == adapter) {
+            LOC_API_ADAPTER_EVENT_MASK_T oldMask = getEvtMask();
+            unsubscribeEvents(i, adapter->getEvtMask());
             mLocAdapters[i] = NULL;
 
             // shift the rest of the adapters up so that the pointers
@@ -187,14 +224,17 @@ void LocApiBase::removeAdapter(LocAdapterBase* adapter)
             // range although i could be equal to j, but it won't hurt.
             // No need to check it, as it gains nothing.
             mLocAdapters[j] = mLocAdapters[i];
+            if (i != j) {
+                moveEvents(i, j, mLocAdapters[j]->getEvtMask());
+            }
             // this makes sure that we exit the for loop
             mLocAdapters[i] = NULL;
 
             // if we have an empty list of adapters
             if (0 == i) {
                 close();
-            } else {
-                // else we need to remove the bit
+            } else if (getEvtMask() != oldMask) {
+                // else we need to remove the bits no one else wants
                 mMsgTask->sendMsg(new LocOpenMsg(this, getEvtMask()));
             }
         }
@@ -233,6 +273,16 @@ void LocApiBase::reportPosition(UlpLocation &location,
              location.gpsLocation.bearing, location.gpsLocation.accuracy,
              location.gpsLocation.timestamp, location.rawDataSize,
              location.rawData, status, loc_technology_mask);
+    if (NULL != mTrace) {
+        LocApiTracePosition rec;
+        rec.location = location;
+        rec.location.rawDataSize = 0;
+        rec.location.rawData = NULL;
+        rec.locationExtended = locationExtended;
+        rec.status = status;
+        rec.techMask = loc_technology_mask;
+        mTrace->record(LOC_API_TRACE_POSITION, &rec, sizeof(rec));
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(
         mLocAdapters[i]->reportPosition(location,
@@ -260,6 +310,18 @@ void LocApiBase::reportSv(GpsSvStatus &svStatus,
                  svStatus.sv_list[i].elevation,
                  svStatus.sv_list[i].azimuth);
     }
+    if (NULL != mTrace) {
+        LocApiTraceSv rec;
+        int numSvs = svStatus.num_svs < 0 ? 0 :
+            svStatus.num_svs > GPS_MAX_SVS ? GPS_MAX_SVS : svStatus.num_svs;
+        rec.locationExtended = locationExtended;
+        rec.ephemerisMask = svStatus.ephemeris_mask;
+        rec.almanacMask = svStatus.almanac_mask;
+        rec.usedInFixMask = svStatus.used_in_fix_mask;
+        rec.numSvs = numSvs;
+        memcpy(rec.svList, svStatus.sv_list, numSvs * sizeof(GpsSvInfo));
+        mTrace->record(LOC_API_TRACE_SV, &rec, LOC_API_TRACE_SV_SIZE(numSvs));
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(
         mLocAdapters[i]->reportSv(svStatus,
@@ -270,12 +332,19 @@ void LocApiBase::reportSv(GpsSvStatus &svStatus,
 
 void LocApiBase::reportStatus(GpsStatusValue status)
 {
+    if (NULL != mTrace) {
+        int32_t rec = status;
+        mTrace->record(LOC_API_TRACE_STATUS, &rec, sizeof(rec));
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportStatus(status));
 }
 
 void LocApiBase::reportNmea(const char* nmea, int length)
 {
+    if (NULL != mTrace && length > 0) {
+        mTrace->record(LOC_API_TRACE_NMEA, nmea, length);
+    }
     // loop through adapters, and deliver to all adapters.
     TO_ALL_LOCADAPTERS(mLocAdapters[i]->reportNmea(nmea, length));
 }
@@ -308,6 +377,12 @@ void LocApiBase::requestLocation()
 
 void LocApiBase::requestATL(int connHandle, AGpsType agps_type)
 {
+    if (NULL != mTrace) {
+        LocApiTraceAtl rec;
+        rec.connHandle = connHandle;
+        rec.agpsType = agps_type;
+        mTrace->record(LOC_API_TRACE_ATL, &rec, sizeof(rec));
+    }
     // loop through adapters, and deliver to the first handling adapter.
     TO_1ST_HANDLING_LOCADAPTERS(mLocAdapters[i]->requestATL(connHandle, agps_type));
 }
@@ -492,4 +567,9 @@ DEFAULT_IMPL(-1)
 int LocApiBase::
     getGpsLock()
 DEFAULT_IMPL(-1)
+
+enum loc_api_adapter_err LocApiBase::
+    setXtraDataPart(char* data, int length, int partNum,
+                    int totalParts, int totalLength)
+DEFAULT_IMPL(LOC_API_ADAPTER_ERR_UNSUPPORTED)
 } // namespace loc_core
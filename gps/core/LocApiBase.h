@@ -33,6 +33,7 @@
 #include <ctype.h>
 #include <gps_extended.h>
 #include <MsgTask.h>
+#include <LocApiTrace.h>
 #include <log_util.h>
 
 namespace loc_core {
@@ -72,6 +73,20 @@ class LocApiBase {
     const MsgTask* mMsgTask;
 
     LocAdapterBase* mLocAdapters[MAX_ADAPTERS];
+    // per event type, bit i is set if mLocAdapters[i] has the event in
+    // its mask, so that the union below can be kept as adapters come and
+    // go; MAX_ADAPTERS must stay within 32. Reports still go to all the
+    // adapters, as not all of them set the report bits in their masks.
+    uint32_t mEvtSubscribers[LOC_API_ADAPTER_EVENT_MAX];
+    // union of the adapters' event masks
+    LOC_API_ADAPTER_EVENT_MASK_T mAdapterEvtMask;
+
+    void subscribeEvents(int slot, LOC_API_ADAPTER_EVENT_MASK_T mask);
+    void unsubscribeEvents(int slot, LOC_API_ADAPTER_EVENT_MASK_T mask);
+    void moveEvents(int from, int to, LOC_API_ADAPTER_EVENT_MASK_T mask);
+
+    // records the upward calls when set, see ContextBase::createLocApi()
+    LocApiTrace* mTrace;
 
 protected:
     virtual enum loc_api_adapter_err
@@ -82,13 +97,15 @@ protected:
     LOC_API_ADAPTER_EVENT_MASK_T mMask;
     LocApiBase(const MsgTask* msgTask,
                LOC_API_ADAPTER_EVENT_MASK_T excludedMask);
-    inline virtual ~LocApiBase() { close(); }
+    inline virtual ~LocApiBase() { close(); delete mTrace; }
     bool isInSession();
     const LOC_API_ADAPTER_EVENT_MASK_T mExcludedMask;
 
 public:
     void addAdapter(LocAdapterBase* adapter);
     void removeAdapter(LocAdapterBase* adapter);
+    // takes ownership of trace
+    inline void setTrace(LocApiTrace* trace) { mTrace = trace; }
 
     // upward calls
     void handleEngineUpEvent();
@@ -207,6 +224,14 @@ public:
       -1 on failure
      */
     virtual int getGpsLock(void);
+
+    /* injects XTRA data one part at a time, partNum counting from 1 to
+       totalParts, so other msgs can run on the MsgTask between parts.
+       A LocApi that only takes the data whole, with setXtraData, returns
+       LOC_API_ADAPTER_ERR_UNSUPPORTED. */
+    virtual enum loc_api_adapter_err
+        setXtraDataPart(char* data, int length, int partNum,
+                        int totalParts, int totalLength);
 };
 
 typedef LocApiBase* (getLocApi_t)(const MsgTask* msgTask,
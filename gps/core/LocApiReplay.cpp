@@ -0,0 +1,348 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_ApiReplay"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <LocApiReplay.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+// longest NMEA payload played back, longer ones are skipped
+#define LOC_API_REPLAY_MAX_NMEA 4096
+// longest sleep between checks for the end of the replay
+#define LOC_API_REPLAY_SLEEP_NS 100000000LL
+// most msgs left waiting on the MsgTask before the replay holds off
+#define LOC_API_REPLAY_MAX_PENDING 256
+// sleep between checks of the MsgTask backlog
+#define LOC_API_REPLAY_THROTTLE_NS 200000LL
+
+struct LocReplayResult {
+    bool realTime;
+    uint64_t events;
+    uint64_t skipped;
+    int64_t startNs;
+    int64_t elapsedNs;
+    int64_t throttledNs;
+    uint64_t totalCallNs;
+    uint64_t maxCallNs;
+};
+
+static void writeResult(FILE* file, const LocReplayResult& result,
+                        int64_t endToEndNs, const MsgTaskLaneStats* lanes)
+{
+    fprintf(file, "{\"realtime\":%d,\"events\":%llu,\"skipped\":%llu,"
+            "\"replay_ms\":%.3f,\"throttled_ms\":%.3f,\"events_per_s\":%.0f,"
+            "\"call_ns_avg\":%llu,\"call_ns_max\":%llu,"
+            "\"end_to_end_ms\":%.3f,\"end_to_end_per_s\":%.0f,\"lanes\":[",
+            result.realTime ? 1 : 0, (unsigned long long)result.events,
+            (unsigned long long)result.skipped, result.elapsedNs / 1e6,
+            result.throttledNs / 1e6, result.elapsedNs > 0 ? result.events * 1e9 / result.elapsedNs : 0.0,
+            (unsigned long long)(result.events ?
+                result.totalCallNs / result.events : 0),
+            (unsigned long long)result.maxCallNs, endToEndNs / 1e6,
+            endToEndNs > 0 ? result.events * 1e9 / endToEndNs : 0.0);
+    for (int i = 0; i < LocMsg::LANE_MAX; i++) {
+        fprintf(file, "%s{\"msgs\":%llu,\"max_depth\":%u,"
+                "\"wait_us_avg\":%llu,\"wait_us_max\":%llu}",
+                i ? "," : "", (unsigned long long)lanes[i].count,
+                lanes[i].maxDepth,
+                (unsigned long long)(lanes[i].count ?
+                    lanes[i].totalWaitNs / lanes[i].count / 1000 : 0),
+                (unsigned long long)(lanes[i].maxWaitNs / 1000));
+    }
+    fprintf(file, "]}\n");
+    fflush(file);
+}
+
+// sent after the last event, so its proc() runs once the MsgTask has
+// gone through everything the replay caused. It may run after the
+// LocApiReplay is gone, so it keeps its own copy of the results path.
+struct LocReplayDoneMsg : public LocMsg {
+    const MsgTask* mTask;
+    const LocReplayResult mResult;
+    char* mResultsPath;
+    inline LocReplayDoneMsg(const MsgTask* task, const LocReplayResult& result,
+                            const char* resultsPath) :
+        LocMsg(), mTask(task), mResult(result),
+        mResultsPath(NULL != resultsPath ? strdup(resultsPath) : NULL) {}
+    inline virtual ~LocReplayDoneMsg() {
+        free(mResultsPath);
+    }
+    inline virtual void proc() const {
+        int64_t elapsedNs = LocApiTrace::now() - mResult.startNs;
+        LOC_LOGI("%s:%d]: %llu events through the MsgTask in %lld ms, %.0f/s",
+                 __func__, __LINE__, (unsigned long long)mResult.events,
+                 (long long)(elapsedNs / 1000000),
+                 elapsedNs > 0 ? mResult.events * 1e9 / elapsedNs : 0.0);
+        mTask->logLaneStats();
+        if (NULL != mResultsPath) {
+            FILE* results = fopen(mResultsPath, "a");
+            if (NULL == results) {
+                LOC_LOGE("%s:%d]: %s: %s", __func__, __LINE__, mResultsPath,
+                         strerror(errno));
+                return;
+            }
+            MsgTaskLaneStats lanes[LocMsg::LANE_MAX];
+            mTask->getLaneStats(lanes);
+            writeResult(results, mResult, elapsedNs, lanes);
+            fclose(results);
+        }
+    }
+};
+
+LocApiReplay::LocApiReplay(const MsgTask* msgTask,
+                           LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                           FILE* file, const char* resultsPath,
+                           bool realTime) :
+    LocApiBase(msgTask, exMask), mTask(msgTask), mFile(file),
+    mResultsPath(NULL != resultsPath ? strdup(resultsPath) : NULL),
+    mRealTime(realTime), mStarted(false), mStop(false)
+{
+}
+
+LocApiReplay* LocApiReplay::create(const MsgTask* msgTask,
+                                   LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                                   const char* path, bool realTime,
+                                   const char* resultsPath)
+{
+    FILE* file = fopen(path, "rb");
+    if (NULL == file) {
+        LOC_LOGE("%s:%d]: %s: %s", __func__, __LINE__, path, strerror(errno));
+        return NULL;
+    }
+
+    LocApiTraceHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 ||
+        memcmp(header.magic, LOC_API_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != LOC_API_TRACE_VERSION ||
+        header.positionSize != sizeof(LocApiTracePosition) ||
+        header.svSize != sizeof(LocApiTraceSv)) {
+        LOC_LOGE("%s:%d]: %s is not a trace this build can replay",
+                 __func__, __LINE__, path);
+        fclose(file);
+        return NULL;
+    }
+
+    // the results are written at the end, but say now if that will fail
+    if (NULL != resultsPath && '\0' != resultsPath[0]) {
+        FILE* results = fopen(resultsPath, "a");
+        if (NULL != results) {
+            fclose(results);
+        } else {
+            LOC_LOGE("%s:%d]: %s: %s", __func__, __LINE__, resultsPath,
+                     strerror(errno));
+            resultsPath = NULL;
+        }
+    } else {
+        resultsPath = NULL;
+    }
+
+    LOC_LOGI("%s:%d]: replaying %s %s", __func__, __LINE__, path,
+             realTime ? "at the recorded pace" : "as fast as possible");
+    return new LocApiReplay(msgTask, exMask, file, resultsPath, realTime);
+}
+
+LocApiReplay::~LocApiReplay()
+{
+    if (mStarted) {
+        mStop = true;
+        pthread_join(mThread, NULL);
+    }
+    free(mResultsPath);
+    fclose(mFile);
+}
+
+enum loc_api_adapter_err LocApiReplay::startFix(const LocPosMode& posMode)
+{
+    if (!mStarted) {
+        if (pthread_create(&mThread, NULL, replayMain, this) != 0) {
+            LOC_LOGE("%s:%d]: replay thread not started", __func__, __LINE__);
+            return LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+        }
+        mStarted = true;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+void* LocApiReplay::replayMain(void* arg)
+{
+    ((LocApiReplay*)arg)->replay();
+    return NULL;
+}
+
+void LocApiReplay::waitUntil(int64_t timeNs)
+{
+    int64_t nowNs;
+    while (!mStop && (nowNs = LocApiTrace::now()) < timeNs) {
+        int64_t sleepNs = timeNs - nowNs;
+        if (sleepNs > LOC_API_REPLAY_SLEEP_NS) {
+            sleepNs = LOC_API_REPLAY_SLEEP_NS;
+        }
+        struct timespec ts = { (time_t)(sleepNs / 1000000000LL),
+                               (long)(sleepNs % 1000000000LL) };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// how long it held off for the MsgTask to catch up
+int64_t LocApiReplay::waitForTask()
+{
+    int64_t startNs = 0;
+    while (!mStop && mTask->getPendingMsgs() > LOC_API_REPLAY_MAX_PENDING) {
+        if (0 == startNs) {
+            startNs = LocApiTrace::now();
+        }
+        struct timespec ts = { 0, (long)LOC_API_REPLAY_THROTTLE_NS };
+        nanosleep(&ts, NULL);
+    }
+    return 0 == startNs ? 0 : LocApiTrace::now() - startNs;
+}
+
+union LocApiReplayPayload {
+    LocApiTracePosition position;
+    LocApiTraceSv sv;
+    LocApiTraceAtl atl;
+    int32_t status;
+    char nmea[LOC_API_REPLAY_MAX_NMEA + 1];
+};
+
+// false if the record is of no known type or size
+static bool playRecord(LocApiBase* locApi, const LocApiTraceRecord& rec,
+                       LocApiReplayPayload& payload)
+{
+    switch (rec.type) {
+    case LOC_API_TRACE_POSITION:
+        if (rec.size != sizeof(payload.position)) {
+            return false;
+        }
+        locApi->reportPosition(payload.position.location,
+                               payload.position.locationExtended, NULL,
+                               (enum loc_sess_status)payload.position.status,
+                               payload.position.techMask);
+        return true;
+    case LOC_API_TRACE_SV: {
+        GpsSvStatus svStatus;
+        if (rec.size < LOC_API_TRACE_SV_SIZE(0) ||
+            payload.sv.numSvs < 0 || payload.sv.numSvs > GPS_MAX_SVS ||
+            rec.size != LOC_API_TRACE_SV_SIZE(payload.sv.numSvs)) {
+            return false;
+        }
+        memset(&svStatus, 0, sizeof(svStatus));
+        svStatus.size = sizeof(svStatus);
+        svStatus.num_svs = payload.sv.numSvs;
+        memcpy(svStatus.sv_list, payload.sv.svList, payload.sv.numSvs * sizeof(GpsSvInfo));
+        svStatus.ephemeris_mask = payload.sv.ephemerisMask;
+        svStatus.almanac_mask = payload.sv.almanacMask;
+        svStatus.used_in_fix_mask = payload.sv.usedInFixMask;
+        locApi->reportSv(svStatus, payload.sv.locationExtended, NULL);
+        return true;
+    }
+    case LOC_API_TRACE_STATUS:
+        if (rec.size != sizeof(payload.status)) {
+            return false;
+        }
+        locApi->reportStatus((GpsStatusValue)payload.status);
+        return true;
+    case LOC_API_TRACE_NMEA:
+        payload.nmea[rec.size] = '\0';
+        locApi->reportNmea(payload.nmea, rec.size);
+        return true;
+    case LOC_API_TRACE_ATL:
+        if (rec.size != sizeof(payload.atl)) {
+            return false;
+        }
+        locApi->requestATL(payload.atl.connHandle, (AGpsType)payload.atl.agpsType);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void LocApiReplay::replay()
+{
+    LocApiReplayPayload payload;
+    LocApiTraceRecord rec;
+    int64_t firstNs = 0, startNs = LocApiTrace::now(), throttledNs = 0;
+    uint64_t events = 0, skipped = 0, totalNs = 0, maxNs = 0;
+
+    while (!mStop && fread(&rec, sizeof(rec), 1, mFile) == 1) {
+        if (rec.size >= sizeof(payload)) {
+            fseek(mFile, rec.size, SEEK_CUR);
+            skipped++;
+            continue;
+        }
+        if (rec.size > 0 && fread(&payload, rec.size, 1, mFile) != 1) {
+            break;
+        }
+
+        if (0 == events + skipped) {
+            firstNs = rec.timeNs;
+        }
+        if (mRealTime) {
+            waitUntil(startNs + (rec.timeNs - firstNs));
+        }
+        throttledNs += waitForTask();
+
+        int64_t beginNs = LocApiTrace::now();
+        if (!playRecord(this, rec, payload)) {
+            skipped++;
+            continue;
+        }
+        uint64_t ns = LocApiTrace::now() - beginNs;
+        totalNs += ns;
+        if (ns > maxNs) {
+            maxNs = ns;
+        }
+        events++;
+    }
+
+    int64_t elapsedNs = LocApiTrace::now() - startNs;
+    LOC_LOGI("%s:%d]: replayed %llu events (%llu skipped) in %lld ms, %.0f/s, "
+             "%lld ms of it waiting for the MsgTask; report calls took %llu ns "
+             "on average, %llu ns at most",
+             __func__, __LINE__, (unsigned long long)events,
+             (unsigned long long)skipped, (long long)(elapsedNs / 1000000),
+             elapsedNs > 0 ? events * 1e9 / elapsedNs : 0.0,
+             (long long)(throttledNs / 1000000),
+             (unsigned long long)(events ? totalNs / events : 0),
+             (unsigned long long)maxNs);
+
+    if (!mStop) {
+        LocReplayResult result = { mRealTime, events, skipped, startNs,
+                                   elapsedNs, throttledNs, totalNs, maxNs };
+        mTask->sendMsg(new LocReplayDoneMsg(mTask, result, mResultsPath));
+    }
+}
+
+} // namespace loc_core
@@ -0,0 +1,82 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_API_REPLAY__
+#define __LOC_API_REPLAY__
+
+#include <stdio.h>
+#include <pthread.h>
+#include <LocApiBase.h>
+
+namespace loc_core {
+
+// LocApi that plays a LocApiTrace recording back into the adapters, in
+// place of the modem. Playback starts with the first startFix() and runs
+// once through the file, either at the recorded pace or as fast as the
+// adapters take the events. Either way it holds off while the MsgTask
+// has more than LOC_API_REPLAY_MAX_PENDING msgs waiting, so a fast replay
+// measures the pipeline rather than how deep its Q can grow. When done
+// it logs the replay rate, and once the MsgTask has handled everything
+// sent until then, the end to end rate and the MsgTask lane stats. Given
+// a results file, it also appends these numbers to it as one JSON object
+// per line, so that runs can be compared over time. All downward calls
+// other than startFix() are the LocApiBase no-ops.
+class LocApiReplay : public LocApiBase {
+    const MsgTask* mTask;
+    FILE* mFile;
+    // only read after construction; the done msg has its own copy
+    char* mResultsPath;
+    const bool mRealTime;
+    bool mStarted;
+    volatile bool mStop;
+    pthread_t mThread;
+
+    LocApiReplay(const MsgTask* msgTask, LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                 FILE* file, const char* resultsPath, bool realTime);
+    static void* replayMain(void* arg);
+    void replay();
+    void waitUntil(int64_t timeNs);
+    int64_t waitForTask();
+
+protected:
+    virtual ~LocApiReplay();
+
+public:
+    // NULL if the trace cannot be read or was recorded with another ABI;
+    // resultsPath may be NULL or empty
+    static LocApiReplay* create(const MsgTask* msgTask,
+                                LOC_API_ADAPTER_EVENT_MASK_T exMask,
+                                const char* path, bool realTime,
+                                const char* resultsPath);
+    virtual enum loc_api_adapter_err
+        startFix(const LocPosMode& posMode);
+};
+
+} // namespace loc_core
+
+#endif //__LOC_API_REPLAY__
@@ -0,0 +1,98 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_ApiTrace"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <LocApiTrace.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+LocApiTrace* LocApiTrace::create(const char* path)
+{
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0640);
+    if (fd < 0) {
+        LOC_LOGE("%s:%d]: %s: %s", __func__, __LINE__, path, strerror(errno));
+        return NULL;
+    }
+
+    LocApiTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LOC_API_TRACE_MAGIC, sizeof(header.magic));
+    header.version = LOC_API_TRACE_VERSION;
+    header.positionSize = sizeof(LocApiTracePosition);
+    header.svSize = sizeof(LocApiTraceSv);
+    if (write(fd, &header, sizeof(header)) != (ssize_t)sizeof(header)) {
+        LOC_LOGE("%s:%d]: %s: %s", __func__, __LINE__, path, strerror(errno));
+        ::close(fd);
+        return NULL;
+    }
+
+    LOC_LOGI("%s:%d]: recording LocApi events to %s", __func__, __LINE__, path);
+    return new LocApiTrace(fd);
+}
+
+LocApiTrace::~LocApiTrace()
+{
+    ::close(mFd);
+}
+
+int64_t LocApiTrace::now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void LocApiTrace::record(LocApiTraceType type, const void* payload, uint32_t size)
+{
+    LocApiTraceRecord rec;
+    rec.type = type;
+    rec.reserved = 0;
+    rec.size = size;
+    rec.timeNs = now();
+
+    struct iovec iov[2];
+    iov[0].iov_base = &rec;
+    iov[0].iov_len = sizeof(rec);
+    iov[1].iov_base = (void*)payload;
+    iov[1].iov_len = size;
+
+    if (writev(mFd, iov, 2) != (ssize_t)(sizeof(rec) + size)) {
+        LOC_LOGW("%s:%d]: record %d lost: %s", __func__, __LINE__, type, strerror(errno));
+    }
+}
+
+} // namespace loc_core
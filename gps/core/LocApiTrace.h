@@ -0,0 +1,109 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_API_TRACE__
+#define __LOC_API_TRACE__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <gps_extended.h>
+
+namespace loc_core {
+
+// Binary trace of the events a LocApi reports upward, as written by
+// LocApiTrace and played back by LocApiReplay. The file starts with a
+// LocApiTraceHeader, then holds one LocApiTraceRecord per event, each
+// followed by its payload. Payloads are the HAL structs as they are in
+// memory, so a trace replays only on the ABI it was recorded on; the
+// header keeps their sizes to catch that.
+#define LOC_API_TRACE_MAGIC "LOCTRACE"
+#define LOC_API_TRACE_VERSION 1
+
+enum LocApiTraceType {
+    LOC_API_TRACE_POSITION = 1,   // LocApiTracePosition
+    LOC_API_TRACE_SV,             // LocApiTraceSv
+    LOC_API_TRACE_STATUS,         // int32_t GpsStatusValue
+    LOC_API_TRACE_NMEA,           // the sentences, not NUL terminated
+    LOC_API_TRACE_ATL             // LocApiTraceAtl
+};
+
+struct LocApiTraceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t positionSize;
+    uint32_t svSize;
+    uint32_t reserved;
+};
+
+struct LocApiTraceRecord {
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t size;       // payload bytes after this record
+    int64_t timeNs;      // CLOCK_MONOTONIC
+};
+
+struct LocApiTracePosition {
+    UlpLocation location;           // rawData is not kept
+    GpsLocationExtended locationExtended;
+    int32_t status;
+    uint32_t techMask;
+};
+
+// only the first numSvs entries of svList are written
+struct LocApiTraceSv {
+    GpsLocationExtended locationExtended;
+    uint32_t ephemerisMask;
+    uint32_t almanacMask;
+    uint32_t usedInFixMask;
+    int32_t numSvs;
+    GpsSvInfo svList[GPS_MAX_SVS];
+};
+#define LOC_API_TRACE_SV_SIZE(numSvs) \
+    (offsetof(LocApiTraceSv, svList) + (numSvs) * sizeof(GpsSvInfo))
+
+struct LocApiTraceAtl {
+    int32_t connHandle;
+    int32_t agpsType;
+};
+
+// Appends records to a trace file. Any thread may record; each record
+// goes out in one writev() on an O_APPEND fd, so records never interleave.
+class LocApiTrace {
+    const int mFd;
+    inline LocApiTrace(int fd) : mFd(fd) {}
+public:
+    // NULL if the file cannot be created
+    static LocApiTrace* create(const char* path);
+    ~LocApiTrace();
+    void record(LocApiTraceType type, const void* payload, uint32_t size);
+    static int64_t now();
+};
+
+} // namespace loc_core
+
+#endif //__LOC_API_TRACE__
@@ -0,0 +1,104 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_MsgPool"
+
+#include <stdlib.h>
+#include <new>
+#include <LocMsgPool.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+LocMsgPool::LocMsgPool(size_t blockSize, unsigned int slabCnt) :
+    mFree(NULL),
+    // keep every block pointer aligned
+    mBlockSize((blockSize + sizeof(void*) - 1) & ~(sizeof(void*) - 1)),
+    mSlabCnt(slabCnt ? slabCnt : 1),
+    mBlocks(0) {
+    pthread_mutex_init(&mLock, NULL);
+}
+
+LocMsgPool::~LocMsgPool() {
+    // slabs may still be referenced by msgs in flight; leave them be
+    pthread_mutex_destroy(&mLock);
+}
+
+// caller holds mLock
+bool LocMsgPool::grow() {
+    char* slab = (char*)malloc(mBlockSize * mSlabCnt);
+    if (NULL == slab) {
+        LOC_LOGE("%s:%d] out of memory", __func__, __LINE__);
+        return false;
+    }
+    for (unsigned int i = 0; i < mSlabCnt; i++) {
+        Block* block = (Block*)(slab + i * mBlockSize);
+        block->mNext = mFree;
+        mFree = block;
+    }
+    mBlocks += mSlabCnt;
+    LOC_LOGV("%s:%d] %u blocks of %u bytes", __func__, __LINE__,
+             mBlocks, (unsigned int)mBlockSize);
+    return true;
+}
+
+void* LocMsgPool::alloc(size_t size) {
+    if (size > mBlockSize) {
+        return ::operator new(size);
+    }
+
+    Block* block = NULL;
+    pthread_mutex_lock(&mLock);
+    if (NULL != mFree || grow()) {
+        block = mFree;
+        mFree = block->mNext;
+    }
+    pthread_mutex_unlock(&mLock);
+
+    // a full block, as it may well end up on the free list later
+    return (NULL != block) ? (void*)block : ::operator new(mBlockSize);
+}
+
+void LocMsgPool::free(void* p, size_t size) {
+    if (NULL == p) {
+        return;
+    }
+    if (size > mBlockSize) {
+        ::operator delete(p);
+        return;
+    }
+
+    Block* block = (Block*)p;
+    pthread_mutex_lock(&mLock);
+    block->mNext = mFree;
+    mFree = block;
+    pthread_mutex_unlock(&mLock);
+}
+
+} // namespace loc_core
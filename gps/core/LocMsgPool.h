@@ -0,0 +1,79 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_MSG_POOL__
+#define __LOC_MSG_POOL__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+namespace loc_core {
+
+// Free list of fixed size blocks for a hot LocMsg subclass, so sending
+// it does not hit the heap once the pool has grown to the peak number
+// of msgs in flight. Blocks are carved out of slabs that are never
+// given back. Any thread may alloc or free.
+class LocMsgPool {
+    struct Block {
+        Block* mNext;
+    };
+    pthread_mutex_t mLock;
+    Block* mFree;
+    const size_t mBlockSize;
+    const unsigned int mSlabCnt;
+    uint32_t mBlocks;
+    bool grow();
+public:
+    LocMsgPool(size_t blockSize, unsigned int slabCnt);
+    ~LocMsgPool();
+    void* alloc(size_t size);
+    // size must be what was passed to alloc()
+    void free(void* p, size_t size);
+    inline uint32_t getBlockCount() const { return mBlocks; }
+};
+
+} // namespace loc_core
+
+// Routes new / delete of a LocMsg subclass through a LocMsgPool. Put
+// LOC_MSG_POOLED() in the class and LOC_MSG_POOL_DEFINE() in its .cpp.
+// Subclasses of a pooled class fall through to the heap.
+#define LOC_MSG_POOLED()                                                 \
+    static void* operator new(size_t size);                              \
+    static void operator delete(void* p, size_t size)
+
+#define LOC_MSG_POOL_DEFINE(T, slabCnt)                                  \
+    static loc_core::LocMsgPool s##T##Pool(sizeof(T), (slabCnt));        \
+    void* T::operator new(size_t size) {                                 \
+        return s##T##Pool.alloc(size);                                   \
+    }                                                                    \
+    void T::operator delete(void* p, size_t size) {                      \
+        s##T##Pool.free(p, size);                                        \
+    }
+
+#endif //__LOC_MSG_POOL__
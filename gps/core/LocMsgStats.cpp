@@ -0,0 +1,176 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_MsgStats"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <LocMsgStats.h>
+#include <log_util.h>
+
+namespace loc_core {
+
+unsigned int LocHistogram::bucketOf(uint32_t us) {
+    if (us < LOC_HIST_SUB_CNT) {
+        return us;
+    }
+    unsigned int shift = (31 - __builtin_clz(us)) - LOC_HIST_SUB_BITS;
+    return ((shift + 1) << LOC_HIST_SUB_BITS) +
+        ((us >> shift) & (LOC_HIST_SUB_CNT - 1));
+}
+
+uint32_t LocHistogram::lowerBoundOf(unsigned int bucket) {
+    if (bucket < LOC_HIST_SUB_CNT) {
+        return bucket;
+    }
+    unsigned int shift = (bucket >> LOC_HIST_SUB_BITS) - 1;
+    return (uint32_t)(LOC_HIST_SUB_CNT + (bucket & (LOC_HIST_SUB_CNT - 1)))
+        << shift;
+}
+
+void LocHistogram::record(uint32_t us) {
+    mCounts[bucketOf(us)]++;
+    mTotal++;
+    mSum += us;
+    if (us > mMax) {
+        mMax = us;
+    }
+}
+
+uint32_t LocHistogram::percentile(unsigned int pct) const {
+    uint64_t want = (mTotal * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < LOC_HIST_BUCKETS; i++) {
+        seen += mCounts[i];
+        if (seen >= want && seen > 0) {
+            return lowerBoundOf(i);
+        }
+    }
+    return mMax;
+}
+
+LocMsgStats::LocMsgStats() : mDropped(0) {
+    memset(mTypes, 0, sizeof(mTypes));
+}
+
+LocMsgStats::~LocMsgStats() {
+    reset();
+}
+
+LocMsgStats::TypeStats* LocMsgStats::find(const void* type) {
+    unsigned int h = (unsigned int)(((uintptr_t)type >> 3) * 2654435761u);
+    for (unsigned int i = 0; i < mMaxTypes; i++) {
+        unsigned int slot = (h + i) & (mMaxTypes - 1);
+        if (NULL == mTypes[slot]) {
+            // first of its kind; the only allocation this does
+            mTypes[slot] = (TypeStats*)calloc(1, sizeof(TypeStats));
+            if (NULL != mTypes[slot]) {
+                mTypes[slot]->mType = type;
+            }
+            return mTypes[slot];
+        }
+        if (type == mTypes[slot]->mType) {
+            return mTypes[slot];
+        }
+    }
+    return NULL;
+}
+
+static inline uint32_t toUs(int64_t ns) {
+    if (ns <= 0) {
+        return 0;
+    }
+    int64_t us = ns / 1000;
+    return (us > 0xffffffffLL) ? 0xffffffffu : (uint32_t)us;
+}
+
+void LocMsgStats::record(const LocMsg* msg, int64_t sentNs,
+                         int64_t procStartNs, int64_t procEndNs) {
+    // the vtable pointer tells the msg types apart without RTTI
+    TypeStats* stats = find(*(const void* const*)msg);
+    if (NULL == stats) {
+        mDropped++;
+        return;
+    }
+    stats->mWait.record(toUs(procStartNs - sentNs));
+    stats->mProc.record(toUs(procEndNs - procStartNs));
+}
+
+void LocMsgStats::reset() {
+    for (unsigned int i = 0; i < mMaxTypes; i++) {
+        free(mTypes[i]);
+        mTypes[i] = NULL;
+    }
+    mDropped = 0;
+}
+
+// best effort type name, from the vtable symbol: _ZTV20LocEngReportSv
+static const char* typeName(const void* vptr, char* buf, size_t len) {
+    Dl_info info;
+    if (dladdr(vptr, &info) && NULL != info.dli_sname &&
+        0 == strncmp(info.dli_sname, "_ZTV", 4)) {
+        const char* name = info.dli_sname + 4;
+        while (*name >= '0' && *name <= '9') {
+            name++;
+        }
+        if ('\0' != *name) {
+            return name;
+        }
+    }
+    snprintf(buf, len, "%p", vptr);
+    return buf;
+}
+
+static void dumpHist(const char* name, const char* what,
+                     const LocHistogram& h) {
+    LOC_LOGI("%s %s: n %llu avg %llu us p50 %u p90 %u p99 %u max %u us",
+             name, what, (unsigned long long)h.mTotal,
+             (unsigned long long)(h.mTotal ? h.mSum / h.mTotal : 0),
+             h.percentile(50), h.percentile(90), h.percentile(99), h.mMax);
+}
+
+void LocMsgStats::dump() const {
+    char buf[24];
+    for (unsigned int i = 0; i < mMaxTypes; i++) {
+        const TypeStats* stats = mTypes[i];
+        if (NULL != stats) {
+            const char* name = typeName(stats->mType, buf, sizeof(buf));
+            dumpHist(name, "wait", stats->mWait);
+            dumpHist(name, "proc", stats->mProc);
+        }
+    }
+    if (mDropped) {
+        LOC_LOGW("%s:%d] %llu msgs of untracked types", __func__, __LINE__,
+                 (unsigned long long)mDropped);
+    }
+}
+
+} // namespace loc_core
@@ -0,0 +1,82 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_MSG_STATS__
+#define __LOC_MSG_STATS__
+
+#include <stdint.h>
+#include <MsgTask.h>
+
+namespace loc_core {
+
+// Log-linear histogram of microsecond values, HDR style: 4 sub buckets
+// per power of 2, so a bucket is never off by more than 25%.
+#define LOC_HIST_SUB_BITS 2
+#define LOC_HIST_SUB_CNT  (1 << LOC_HIST_SUB_BITS)
+#define LOC_HIST_BUCKETS  ((32 - LOC_HIST_SUB_BITS + 1) << LOC_HIST_SUB_BITS)
+
+struct LocHistogram {
+    uint32_t mCounts[LOC_HIST_BUCKETS];
+    uint64_t mTotal;
+    uint64_t mSum;
+    uint32_t mMax;
+
+    void record(uint32_t us);
+    // lower bound of the bucket holding the pct'th percentile
+    uint32_t percentile(unsigned int pct) const;
+    static unsigned int bucketOf(uint32_t us);
+    static uint32_t lowerBoundOf(unsigned int bucket);
+};
+
+// Per LocMsg type queue wait (sendMsg to proc) and proc time. Only the
+// MsgTask thread that owns it may touch it, dump() included.
+class LocMsgStats {
+public:
+    LocMsgStats();
+    ~LocMsgStats();
+    void record(const LocMsg* msg, int64_t sentNs,
+                int64_t procStartNs, int64_t procEndNs);
+    void dump() const;
+    void reset();
+
+private:
+    struct TypeStats {
+        const void* mType;
+        LocHistogram mWait;
+        LocHistogram mProc;
+    };
+    // open addressed, keyed by the msg's vtable
+    static const unsigned int mMaxTypes = 64;
+    TypeStats* mTypes[mMaxTypes];
+    uint64_t mDropped;
+    TypeStats* find(const void* type);
+};
+
+} // namespace loc_core
+
+#endif //__LOC_MSG_STATS__
@@ -31,7 +31,9 @@
 
 #include <cutils/sched_policy.h>
 #include <unistd.h>
+#include <time.h>
 #include <MsgTask.h>
+#include <LocMsgStats.h>
 #include <msg_q.h>
 #include <log_util.h>
 #include <loc_log.h>
@@ -39,29 +41,55 @@
 namespace loc_core {
 
 #define MAX_TASK_COMM_LEN 15
+// most msgs taken off the Q per lock
+#define MSG_TASK_BATCH 32
 
 static void LocMsgDestroy(void* msg) {
     delete (LocMsg*)msg;
 }
 
+// LocMsg::log() implementations only log at verbose level; 0xff leaves it
+// to the Android log level, which we can't see from here
+static inline bool verboseLogOn() {
+    return 5 == loc_logger.DEBUG_LEVEL || 0xff == loc_logger.DEBUG_LEVEL;
+}
+
+#ifdef LOC_MSG_STATS
+#define NEW_MSG_STATS() new LocMsgStats()
+#else
+#define NEW_MSG_STATS() NULL
+#endif
+
+static inline int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 MsgTask::MsgTask(tCreate tCreator, const char* threadName) :
-    mQ(msg_q_init2()), mAssociator(NULL){
+    mQ(msg_q_init2()), mAssociator(NULL),
+    mLaneStats(new MsgTaskLaneStats[LocMsg::LANE_MAX]()),
+    mMsgStats(NEW_MSG_STATS()) {
     if (tCreator) {
         tCreator(threadName, loopMain,
-                 (void*)new MsgTask(mQ, mAssociator));
+                 (void*)new MsgTask(mQ, mAssociator, mLaneStats, mMsgStats));
     } else {
         createPThread(threadName);
     }
 }
 
 MsgTask::MsgTask(tAssociate tAssociator, const char* threadName) :
-    mQ(msg_q_init2()), mAssociator(tAssociator){
+    mQ(msg_q_init2()), mAssociator(tAssociator),
+    mLaneStats(new MsgTaskLaneStats[LocMsg::LANE_MAX]()),
+    mMsgStats(NEW_MSG_STATS()) {
     createPThread(threadName);
 }
 
 inline
-MsgTask::MsgTask(const void* q, tAssociate associator) :
-    mQ(q), mAssociator(associator){
+MsgTask::MsgTask(const void* q, tAssociate associator,
+                 MsgTaskLaneStats* laneStats, LocMsgStats* msgStats) :
+    mQ(q), mAssociator(associator), mLaneStats(laneStats),
+    mMsgStats(msgStats) {
 }
 
 MsgTask::~MsgTask() {
@@ -77,7 +105,8 @@ void MsgTask::createPThread(const char* threadName) {
     // create the thread here, then if successful
     // and a name is given, we set the thread name
     if (!pthread_create(&tid, &attr, loopMain,
-                        (void*)new MsgTask(mQ, mAssociator)) &&
+                        (void*)new MsgTask(mQ, mAssociator,
+                                           mLaneStats, mMsgStats)) &&
         NULL != threadName) {
         char lname[MAX_TASK_COMM_LEN+1];
         memcpy(lname, threadName, MAX_TASK_COMM_LEN);
@@ -86,12 +115,89 @@ void MsgTask::createPThread(const char* threadName) {
     }
 }
 
-void MsgTask::sendMsg(const LocMsg* msg) const {
-    msg_q_snd((void*)mQ, (void*)msg, LocMsgDestroy);
+bool MsgTask::sendMsg(const LocMsg* msg) const {
+    // counted before it can be handled, so sent never trails count
+    int lane = (msg->mLane < LocMsg::LANE_MAX) ?
+        msg->mLane : LocMsg::LANE_DEFAULT;
+    uint64_t* sent = &mLaneStats[lane].sent;
+    __atomic_add_fetch(sent, 1, __ATOMIC_RELAXED);
+
+    msg->mSentTimeNs = nowNs();
+    msq_q_err_type result = msg_q_snd((void*)mQ, (void*)msg, LocMsgDestroy);
+
+    if (eMSG_Q_SUCCESS != result) {
+        __atomic_sub_fetch(sent, 1, __ATOMIC_RELAXED);
+        // an unblocked Q leaves the msg with us
+        LOC_LOGE("%s:%d] fail sending msg: %s\n", __func__, __LINE__,
+                 loc_get_msg_q_status(result));
+        delete msg;
+        return false;
+    }
+    return true;
+}
+
+void MsgTask::getLaneStats(MsgTaskLaneStats* stats) const {
+    // only the MsgTask thread writes these; a snapshot may be torn
+    // across fields, but never within one
+    for (int i = 0; i < LocMsg::LANE_MAX; i++) {
+        const MsgTaskLaneStats* s = &mLaneStats[i];
+        stats[i].depth = __atomic_load_n(&s->depth, __ATOMIC_RELAXED);
+        stats[i].maxDepth = __atomic_load_n(&s->maxDepth, __ATOMIC_RELAXED);
+        stats[i].sent = __atomic_load_n(&s->sent, __ATOMIC_RELAXED);
+        stats[i].count = __atomic_load_n(&s->count, __ATOMIC_RELAXED);
+        stats[i].totalWaitNs = __atomic_load_n(&s->totalWaitNs, __ATOMIC_RELAXED);
+        stats[i].maxWaitNs = __atomic_load_n(&s->maxWaitNs, __ATOMIC_RELAXED);
+    }
+}
+
+uint32_t MsgTask::getPendingMsgs() const {
+    uint64_t pending = 0;
+    for (int i = 0; i < LocMsg::LANE_MAX; i++) {
+        // count first: whatever it covers was already counted in sent
+        uint64_t count = __atomic_load_n(&mLaneStats[i].count, __ATOMIC_ACQUIRE);
+        pending += __atomic_load_n(&mLaneStats[i].sent, __ATOMIC_ACQUIRE) - count;
+    }
+    return (uint32_t)pending;
+}
+
+void MsgTask::logLaneStats() const {
+    MsgTaskLaneStats stats[LocMsg::LANE_MAX];
+    getLaneStats(stats);
+    for (int i = 0; i < LocMsg::LANE_MAX; i++) {
+        LOC_LOGI("%s:%d] lane %d: depth %u (max %u), %llu msgs, "
+                 "wait avg %llu us max %llu us", __func__, __LINE__, i,
+                 stats[i].depth, stats[i].maxDepth,
+                 (unsigned long long)stats[i].count,
+                 (unsigned long long)(stats[i].count ?
+                     stats[i].totalWaitNs / stats[i].count / 1000 : 0),
+                 (unsigned long long)(stats[i].maxWaitNs / 1000));
+    }
+}
+
+void MsgTask::dumpMsgStats() const {
+    struct LocMsgStatsDump : public LocMsg {
+        LocMsgStats* mStats;
+        inline LocMsgStatsDump(LocMsgStats* stats) :
+            LocMsg(), mStats(stats) {}
+        inline virtual void proc() const {
+            mStats->dump();
+        }
+    };
+
+    if (NULL == mMsgStats) {
+        LOC_LOGV("%s:%d] built without LOC_MSG_STATS", __func__, __LINE__);
+        return;
+    }
+    // the stats belong to the MsgTask thread, so dump them from there
+    sendMsg(new LocMsgStatsDump(mMsgStats));
 }
 
 void* MsgTask::loopMain(void* arg) {
     MsgTask* copy = (MsgTask*)arg;
+    MsgTaskLaneStats* laneStats = copy->mLaneStats;
+#ifdef LOC_MSG_STATS
+    LocMsgStats* msgStats = copy->mMsgStats;
+#endif
 
     // make sure we do not run in background scheduling group
     set_sched_policy(gettid(), SP_FOREGROUND);
@@ -100,28 +206,101 @@ void* MsgTask::loopMain(void* arg) {
         copy->mAssociator();
     }
 
-    LocMsg* msg;
+    linked_list_intr lanes[LocMsg::LANE_MAX];
+    for (int i = 0; i < LocMsg::LANE_MAX; i++) {
+        linked_list_intr_init(&lanes[i]);
+    }
+
+    void* batch[MSG_TASK_BATCH];
+    unsigned int pending = 0;
     int cnt = 0;
 
     while (1) {
-        LOC_LOGD("MsgTask::loop() %d listening ...\n", cnt++);
+        unsigned int rcvd = 0;
 
-        msq_q_err_type result = msg_q_rcv((void*)copy->mQ, (void **)&msg);
+        // only block when there is nothing left to handle; otherwise just
+        // pick up whatever came in, so new reports can jump the queue
+        if (0 == pending) {
+            LOC_LOGV("MsgTask::loop() %d listening ...\n", cnt++);
+        }
+        msq_q_err_type result = msg_q_rcv_batch((void*)copy->mQ, batch,
+                                                MSG_TASK_BATCH, &rcvd,
+                                                0 == pending);
 
         if (eMSG_Q_SUCCESS != result) {
             LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
                      loc_get_msg_q_status(result));
-            // destroy the Q and exit
+            // drop what we still hold, destroy the Q and exit
+            for (int i = 0; i < LocMsg::LANE_MAX; i++) {
+                linked_list_node* node;
+                while (eLINKED_LIST_SUCCESS ==
+                       linked_list_intr_remove(&lanes[i], &node)) {
+                    delete ((LocMsgLink*)node)->msg;
+                }
+            }
             msg_q_destroy((void**)&(copy->mQ));
+            delete[] laneStats;
+            delete copy->mMsgStats;
             delete copy;
             return NULL;
         }
 
-        msg->log();
-        // there is where each individual msg handling is invoked
-        msg->proc();
+        for (unsigned int i = 0; i < rcvd; i++) {
+            const LocMsg* msg = (const LocMsg*)batch[i];
+            int lane = (msg->mLane < LocMsg::LANE_MAX) ?
+                msg->mLane : LocMsg::LANE_DEFAULT;
+            MsgTaskLaneStats* s = &laneStats[lane];
+            linked_list_intr_add(&lanes[lane], &msg->mLink.node);
+            __atomic_store_n(&s->depth, s->depth + 1, __ATOMIC_RELAXED);
+            if (s->depth > s->maxDepth) {
+                __atomic_store_n(&s->maxDepth, s->depth, __ATOMIC_RELAXED);
+            }
+        }
+        pending += rcvd;
 
-        delete msg;
+        // the report lane is handled in full; below that one msg at a
+        // time, going back to the Q after each in case reports came in
+        for (int i = 0; i < LocMsg::LANE_MAX; i++) {
+            MsgTaskLaneStats* s = &laneStats[i];
+            linked_list_node* node;
+            bool handled = false;
+
+            while (eLINKED_LIST_SUCCESS ==
+                   linked_list_intr_remove(&lanes[i], &node)) {
+                const LocMsg* msg = ((LocMsgLink*)node)->msg;
+                int64_t procStart = nowNs();
+                uint64_t wait = (uint64_t)(procStart - msg->mSentTimeNs);
+
+                __atomic_store_n(&s->depth, s->depth - 1, __ATOMIC_RELAXED);
+                __atomic_store_n(&s->count, s->count + 1, __ATOMIC_RELAXED);
+                __atomic_store_n(&s->totalWaitNs, s->totalWaitNs + wait,
+                                 __ATOMIC_RELAXED);
+                if (wait > s->maxWaitNs) {
+                    __atomic_store_n(&s->maxWaitNs, wait, __ATOMIC_RELAXED);
+                }
+                pending--;
+                handled = true;
+
+                if (verboseLogOn()) {
+                    msg->log();
+                }
+                // there is where each individual msg handling is invoked
+                msg->proc();
+
+#ifdef LOC_MSG_STATS
+                msgStats->record(msg, msg->mSentTimeNs, procStart, nowNs());
+#endif
+                delete msg;
+
+                if (LocMsg::LANE_REPORT != i) {
+                    break;
+                }
+            }
+
+            if (handled && LocMsg::LANE_REPORT != i) {
+                break;
+            }
+        }
     }
 
     delete copy;
@@ -30,17 +30,56 @@
 #define __MSG_TASK__
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <string.h>
 #include <pthread.h>
+#include <linked_list.h>
 
 namespace loc_core {
 
+struct LocMsg;
+class LocMsgStats;
+
+// hook MsgTask uses to hold a msg in its lane without allocating
+struct LocMsgLink {
+    linked_list_node node;  // must stay first
+    const LocMsg* msg;
+};
+
 struct LocMsg {
-    inline LocMsg() {}
+    // MsgTask handles everything pending in a lower lane before the
+    // next msg of a higher lane, so reports are never stuck behind
+    // slow AGPS / XTRA work. Order is kept within a lane only.
+    enum Lane {
+        LANE_REPORT = 0,    // position / sv / status / nmea reports
+        LANE_DEFAULT,
+        LANE_MAX
+    };
+    inline LocMsg(Lane lane = LANE_DEFAULT) :
+        mLane(lane), mSentTimeNs(0) {
+        mLink.msg = this;
+    }
     inline virtual ~LocMsg() {}
     virtual void proc() const = 0;
     inline virtual void log() const {}
+
+    const Lane mLane;
+    // owned by MsgTask
+    mutable int64_t mSentTimeNs;
+    mutable LocMsgLink mLink;
+};
+
+// lane diagnostics, as seen by the MsgTask thread. Depth is what is
+// drained off the Q but not yet handled; wait is sendMsg to proc().
+// sent is bumped by sendMsg on any thread, count once a msg is handled.
+struct MsgTaskLaneStats {
+    uint32_t depth;
+    uint32_t maxDepth;
+    uint64_t sent;
+    uint64_t count;
+    uint64_t totalWaitNs;
+    uint64_t maxWaitNs;
 };
 
 class MsgTask {
@@ -51,12 +90,27 @@ public:
     MsgTask(tCreate tCreator, const char* threadName);
     MsgTask(tAssociate tAssociator, const char* threadName);
     ~MsgTask();
-    void sendMsg(const LocMsg* msg) const;
+    // false if the Q refused msg (the task is going away); msg has been
+    // deleted then
+    bool sendMsg(const LocMsg* msg) const;
+    // snapshot of the per lane counters; stats must hold LANE_MAX entries
+    void getLaneStats(MsgTaskLaneStats* stats) const;
+    // msgs sent that the MsgTask thread has not started on yet
+    uint32_t getPendingMsgs() const;
+    void logLaneStats() const;
+    // logs per msg type wait / proc time histograms from the MsgTask
+    // thread; only collected if built with LOC_MSG_STATS
+    void dumpMsgStats() const;
 
 private:
     const void* mQ;
     tAssociate mAssociator;
-    MsgTask(const void* q, tAssociate associator);
+    // shared with the thread's copy, which frees it along with mQ
+    MsgTaskLaneStats* mLaneStats;
+    // NULL unless built with LOC_MSG_STATS; owned by the thread's copy
+    LocMsgStats* mMsgStats;
+    MsgTask(const void* q, tAssociate associator,
+            MsgTaskLaneStats* laneStats, LocMsgStats* msgStats);
     static void* loopMain(void* copy);
     void createPThread(const char* name);
 };
@@ -25,6 +25,11 @@ LOCAL_SRC_FILES += \
     loc_eng_ni.cpp \
     loc_eng_log.cpp \
     loc_eng_nmea.cpp \
+    loc_eng_nmea_bus.cpp \
+    loc_eng_cfg_watch.cpp \
+    loc_eng_fix_filter.cpp \
+    loc_eng_batch.cpp \
+    loc_eng_dns.cpp \
     LocEngAdapter.cpp
 
 LOCAL_SRC_FILES += \
@@ -32,12 +37,23 @@ LOCAL_SRC_FILES += \
     loc_eng_dmn_conn_handler.cpp \
     loc_eng_dmn_conn_thread_helper.c \
     loc_eng_dmn_conn_glue_msg.c \
-    loc_eng_dmn_conn_glue_pipe.c
+    loc_eng_dmn_conn_glue_pipe.c \
+    loc_eng_dmn_conn_glue_sock.c
 
 LOCAL_CFLAGS += \
      -fno-short-enums \
      -D_ANDROID_
 
+ifeq ($(TARGET_BUILD_VARIANT),user)
+    LOCAL_CFLAGS += -DTARGET_BUILD_VARIANT_USER
+endif
+
+# highest LOC_LOGx level built in, 1 (E) to 5 (V), see log_util.h
+LOC_LOG_LEVEL := $(or $(TARGET_LOC_LOG_LEVEL_ENG),$(TARGET_LOC_LOG_LEVEL))
+ifneq ($(LOC_LOG_LEVEL),)
+    LOCAL_CFLAGS += -DLOC_LOG_COMPILED_LEVEL=$(LOC_LOG_LEVEL)
+endif
+
 LOCAL_C_INCLUDES:= \
     $(TARGET_OUT_HEADERS)/gps.utils \
     $(TARGET_OUT_HEADERS)/libloc_core \
@@ -52,12 +68,51 @@ LOCAL_COPY_HEADERS:= \
    loc_eng_ni.h \
    loc_eng_agps.h \
    loc_eng_msg.h \
-   loc_eng_log.h
+   loc_eng_log.h \
+   loc_eng_fix_filter.h \
+   loc_eng_batch.h \
+   loc_eng_dns.h
 
 LOCAL_PRELINK_MODULE := false
 
 include $(BUILD_SHARED_LIBRARY)
 
+# Static host build for the tools and tests under gps/test, see
+# libgps.utils_host.
+ifeq ($(HOST_OS),linux)
+LOC_ENG_SRC_FILES := $(LOCAL_SRC_FILES)
+LOC_ENG_CFLAGS := $(LOCAL_CFLAGS)
+
+include $(CLEAR_VARS)
+
+LOCAL_STATIC_LIBRARIES := \
+    libloc_core_host \
+    libgps.utils_host \
+    libloc_host_shim
+
+LOCAL_SRC_FILES := $(LOC_ENG_SRC_FILES)
+
+LOCAL_CFLAGS := $(LOC_ENG_CFLAGS) \
+    -include $(LOCAL_PATH)/../../test/shim/loc_host_shim.h
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)/../../test/shim \
+    $(LOCAL_PATH)/../../utils \
+    $(LOCAL_PATH)/../../utils/platform_lib_abstractions \
+    $(LOCAL_PATH)/../../core \
+    $(LOCAL_PATH) \
+    hardware/libhardware/include
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := \
+    $(LOCAL_PATH)
+
+LOCAL_MODULE := libloc_eng_host
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+endif # HOST_OS linux
+
 include $(CLEAR_VARS)
 
 LOCAL_MODULE := gps.msm8960
@@ -88,6 +143,16 @@ ifeq ($(TARGET_USES_QCOM_BSP), true)
 LOCAL_CFLAGS += -DTARGET_USES_QCOM_BSP
 endif
 
+ifeq ($(TARGET_BUILD_VARIANT),user)
+    LOCAL_CFLAGS += -DTARGET_BUILD_VARIANT_USER
+endif
+
+# highest LOC_LOGx level built in, 1 (E) to 5 (V), see log_util.h
+LOC_LOG_LEVEL := $(or $(TARGET_LOC_LOG_LEVEL_ENG),$(TARGET_LOC_LOG_LEVEL))
+ifneq ($(LOC_LOG_LEVEL),)
+    LOCAL_CFLAGS += -DLOC_LOG_COMPILED_LEVEL=$(LOC_LOG_LEVEL)
+endif
+
 ## Includes
 LOCAL_C_INCLUDES:= \
     $(TARGET_OUT_HEADERS)/gps.utils \
@@ -134,6 +134,13 @@ public:
     {
         return mLocApi->setXtraData(data, length);
     }
+    inline enum loc_api_adapter_err
+        setXtraDataPart(char* data, int length, int partNum,
+                        int totalParts, int totalLength)
+    {
+        return mLocApi->setXtraDataPart(data, length, partNum,
+                                        totalParts, totalLength);
+    }
     inline enum loc_api_adapter_err
         requestXtraServer()
     {
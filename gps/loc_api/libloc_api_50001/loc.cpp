@@ -139,6 +139,31 @@ static const AGpsRilInterface sLocEngAGpsRilInterface =
    loc_agps_ril_update_network_availability
 };
 
+static int loc_batching_init(GpsBatchingCallbacks* callbacks);
+static int loc_batching_start(int batch_size, uint32_t max_age_ms);
+static int loc_batching_stop();
+static int loc_batching_flush();
+
+static const GpsBatchingInterface sLocEngBatchingInterface =
+{
+   sizeof(GpsBatchingInterface),
+   loc_batching_init,
+   loc_batching_start,
+   loc_batching_stop,
+   loc_batching_flush
+};
+
+static int loc_xtra_inject_file(const char* path);
+static int loc_xtra_inject_buffer(const char* data, int length,
+                                  gps_xtra_release release, void* context);
+
+static const GpsXtraStreamInterface sLocEngXtraStreamInterface =
+{
+   sizeof(GpsXtraStreamInterface),
+   loc_xtra_inject_file,
+   loc_xtra_inject_buffer
+};
+
 static loc_eng_data_s_type loc_afw_data;
 static int gss_fd = -1;
 
@@ -597,6 +622,14 @@ const void* loc_get_extension(const char* name)
            ret_val = &sLocEngAGpsRilInterface;
        }
    }
+   else if (strcmp(name, GPS_BATCHING_INTERFACE) == 0)
+   {
+       ret_val = &sLocEngBatchingInterface;
+   }
+   else if (strcmp(name, GPS_XTRA_STREAM_INTERFACE) == 0)
+   {
+       ret_val = &sLocEngXtraStreamInterface;
+   }
    else if (strcmp(name, GPS_GEOFENCING_INTERFACE) == 0)
    {
        if ((gps_conf.CAPABILITIES | GPS_CAPABILITY_GEOFENCING) == gps_conf.CAPABILITIES ){
@@ -806,6 +839,58 @@ static int loc_xtra_inject_data(char* data, int length)
     return ret_val;
 }
 
+/*===========================================================================
+FUNCTION    loc_xtra_inject_file
+
+DESCRIPTION
+   Injects the XTRA file at path, mapped rather than read.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_xtra_inject_file(const char* path)
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_xtra_inject_file(loc_afw_data, path);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_xtra_inject_buffer
+
+DESCRIPTION
+   Injects XTRA data in place; release is called once it is done with.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_xtra_inject_buffer(const char* data, int length,
+                                  gps_xtra_release release, void* context)
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_xtra_inject_buffer(loc_afw_data, data, length,
+                                             release, context);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
 /*===========================================================================
 FUNCTION    loc_ni_init
 
@@ -852,6 +937,108 @@ void loc_ni_respond(int notif_id, GpsUserResponseType user_response)
     EXIT_LOG(%s, VOID_RET);
 }
 
+/*===========================================================================
+FUNCTION    loc_batching_init
+
+DESCRIPTION
+   Initialize the batching interface.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_batching_init(GpsBatchingCallbacks* callbacks)
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_batching_init(loc_afw_data, callbacks);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_batching_start
+
+DESCRIPTION
+   Sends the fixes of tracking sessions to location_batch_cb, batch_size
+   at a time or once the oldest is max_age_ms old.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_batching_start(int batch_size, uint32_t max_age_ms)
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_batching_start(loc_afw_data, batch_size, max_age_ms);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_batching_stop
+
+DESCRIPTION
+   Delivers the fixes held and goes back to reporting each fix through
+   location_cb.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_batching_stop()
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_batching_stop(loc_afw_data);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_batching_flush
+
+DESCRIPTION
+   Delivers the fixes held.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_batching_flush()
+{
+    ENTRY_LOG();
+    int ret_val = loc_eng_batching_flush(loc_afw_data);
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
 // Below stub functions are members of sLocEngAGpsRilInterface
 static void loc_agps_ril_init( AGpsRilCallbacks* callbacks ) {}
 static void loc_agps_ril_set_ref_location(const AGpsRefLocation *agps_reflocation, size_t sz_struct) {}
@@ -59,6 +59,53 @@ typedef struct {
     gps_request_utc_time request_utc_time_cb;
 } LocCallbacks;
 
+#define GPS_BATCHING_INTERFACE "gps-batching"
+
+/* locations is only valid during the call */
+typedef void (*gps_location_batch_callback)(GpsLocation* locations, int num);
+
+typedef struct {
+    /** set to sizeof(GpsBatchingCallbacks) */
+    size_t size;
+    gps_location_batch_callback location_batch_cb;
+} GpsBatchingCallbacks;
+
+/** Extended interface for fix batching. While batching is on, the
+ *  fixes of a tracking session go to location_batch_cb, batch_size at a
+ *  time or once the oldest of them is max_age_ms old (0: no limit),
+ *  instead of one by one to location_cb. */
+typedef struct {
+    /** set to sizeof(GpsBatchingInterface) */
+    size_t size;
+    int (*init)(GpsBatchingCallbacks* callbacks);
+    int (*start)(int batch_size, uint32_t max_age_ms);
+    /** delivers the fixes held, and goes back to location_cb */
+    int (*stop)();
+    /** delivers the fixes held */
+    int (*flush)();
+} GpsBatchingInterface;
+
+#define GPS_XTRA_STREAM_INTERFACE "gps-xtra-stream"
+
+/* called once the engine no longer needs data, possibly before
+   inject_buffer returns and on any thread; not called if it fails */
+typedef void (*gps_xtra_release)(const char* data, int length, void* context);
+
+/** Extended interface for injecting XTRA data without a copy. Both
+ *  calls only queue the injection and return. The data is read in off
+ *  the thread that delivers the fixes, then injected on it a part at a
+ *  time, with fixes delivered between parts. A LocApi without
+ *  setXtraDataPart takes it in one call, which holds the fixes up. */
+typedef struct {
+    /** set to sizeof(GpsXtraStreamInterface) */
+    size_t size;
+    /** maps the file at path and injects it */
+    int (*inject_file)(const char* path);
+    /** injects data in place; it must stay valid until release */
+    int (*inject_buffer)(const char* data, int length,
+                         gps_xtra_release release, void* context);
+} GpsXtraStreamInterface;
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
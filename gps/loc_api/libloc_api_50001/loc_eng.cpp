@@ -66,7 +66,10 @@
 #include <loc_eng_dmn_conn_handler.h>
 #include <loc_eng_msg.h>
 #include <loc_eng_nmea.h>
+#include <loc_eng_nmea_bus.h>
+#include <loc_eng_cfg_watch.h>
 #include <msg_q.h>
+#include <loc_timer.h>
 #include <loc.h>
 #include "log_util.h"
 #include "platform_lib_includes.h"
@@ -94,77 +97,101 @@ loc_sap_cfg_s_type sap_conf;
 /* Parameter spec table */
 static loc_param_s_type loc_parameter_table[] =
 {
-  {"INTERMEDIATE_POS",               &gps_conf.INTERMEDIATE_POS,               NULL, 'n'},
-  {"ACCURACY_THRES",                 &gps_conf.ACCURACY_THRES,                 NULL, 'n'},
-  {"NMEA_PROVIDER",                  &gps_conf.NMEA_PROVIDER,                  NULL, 'n'},
-  {"SUPL_VER",                       &gps_conf.SUPL_VER,                       NULL, 'n'},
-  {"CAPABILITIES",                   &gps_conf.CAPABILITIES,                   NULL, 'n'},
-  {"GYRO_BIAS_RANDOM_WALK",          &sap_conf.GYRO_BIAS_RANDOM_WALK,          &sap_conf.GYRO_BIAS_RANDOM_WALK_VALID, 'f'},
-  {"ACCEL_RANDOM_WALK_SPECTRAL_DENSITY",     &sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,    &sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f'},
-  {"ANGLE_RANDOM_WALK_SPECTRAL_DENSITY",     &sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,    &sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f'},
-  {"RATE_RANDOM_WALK_SPECTRAL_DENSITY",      &sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY,     &sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f'},
-  {"VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY",  &sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY, &sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f'},
-  {"SENSOR_ACCEL_BATCHES_PER_SEC",   &sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC,   NULL, 'n'},
-  {"SENSOR_ACCEL_SAMPLES_PER_BATCH", &sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH, NULL, 'n'},
-  {"SENSOR_GYRO_BATCHES_PER_SEC",    &sap_conf.SENSOR_GYRO_BATCHES_PER_SEC,    NULL, 'n'},
-  {"SENSOR_GYRO_SAMPLES_PER_BATCH",  &sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH,  NULL, 'n'},
-  {"SENSOR_ACCEL_BATCHES_PER_SEC_HIGH",   &sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,   NULL, 'n'},
-  {"SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH", &sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH, NULL, 'n'},
-  {"SENSOR_GYRO_BATCHES_PER_SEC_HIGH",    &sap_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,    NULL, 'n'},
-  {"SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH",  &sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,  NULL, 'n'},
-  {"SENSOR_CONTROL_MODE",            &sap_conf.SENSOR_CONTROL_MODE,            NULL, 'n'},
-  {"SENSOR_USAGE",                   &sap_conf.SENSOR_USAGE,                   NULL, 'n'},
-  {"SENSOR_ALGORITHM_CONFIG_MASK",   &sap_conf.SENSOR_ALGORITHM_CONFIG_MASK,   NULL, 'n'},
-  {"QUIPC_ENABLED",                  &gps_conf.QUIPC_ENABLED,                  NULL, 'n'},
-  {"LPP_PROFILE",                    &gps_conf.LPP_PROFILE,                    NULL, 'n'},
-  {"A_GLONASS_POS_PROTOCOL_SELECT",  &gps_conf.A_GLONASS_POS_PROTOCOL_SELECT,  NULL, 'n'},
+  {"INTERMEDIATE_POS",               &gps_conf.INTERMEDIATE_POS,               NULL, 'n', 0, 1},
+  {"ACCURACY_THRES",                 &gps_conf.ACCURACY_THRES,                 NULL, 'n', 0, 0},
+  {"NMEA_PROVIDER",                  &gps_conf.NMEA_PROVIDER,                  NULL, 'n', 0, 1},
+  {"NMEA_MULTI_GNSS",                &gps_conf.NMEA_MULTI_GNSS,                NULL, 'n', 0, 1},
+  {"NMEA_TAP",                       &gps_conf.NMEA_TAP,                       NULL, 'n', 0, 1},
+  {"CONFIG_WATCH",                   &gps_conf.CONFIG_WATCH,                   NULL, 'n', 0, 1},
+  {"FIX_MIN_INTERVAL",               &gps_conf.FIX_MIN_INTERVAL,               NULL, 'n', 0, 3600000},
+  {"FIX_MIN_DISTANCE",               &gps_conf.FIX_MIN_DISTANCE,               NULL, 'f', 0, 100000},
+  {"FIX_COALESCE_INTERMEDIATE",      &gps_conf.FIX_COALESCE_INTERMEDIATE,      NULL, 'n', 0, 1},
+  {"DNS_CACHE_TTL",                  &gps_conf.DNS_CACHE_TTL,                  NULL, 'n', 0, 604800},
+  {"AGPS_PREWARM",                   &gps_conf.AGPS_PREWARM,                   NULL, 'n', 0, 1},
+  {"AGPS_LINGER",                    &gps_conf.AGPS_LINGER,                    NULL, 'n', 0, 600000},
+  {"DMN_CONN_TRANSPORT",             &gps_conf.DMN_CONN_TRANSPORT,             NULL, 'n', 0, 2},
+  {"SUPL_VER",                       &gps_conf.SUPL_VER,                       NULL, 'n', 0, 0},
+  {"CAPABILITIES",                   &gps_conf.CAPABILITIES,                   NULL, 'n', 0, 0},
+  {"GYRO_BIAS_RANDOM_WALK",          &sap_conf.GYRO_BIAS_RANDOM_WALK,          &sap_conf.GYRO_BIAS_RANDOM_WALK_VALID, 'f', 0, 0},
+  {"ACCEL_RANDOM_WALK_SPECTRAL_DENSITY",     &sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,    &sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f', 0, 0},
+  {"ANGLE_RANDOM_WALK_SPECTRAL_DENSITY",     &sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,    &sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f', 0, 0},
+  {"RATE_RANDOM_WALK_SPECTRAL_DENSITY",      &sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY,     &sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f', 0, 0},
+  {"VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY",  &sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY, &sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID, 'f', 0, 0},
+  {"SENSOR_ACCEL_BATCHES_PER_SEC",   &sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC,   NULL, 'n', 1, 65535},
+  {"SENSOR_ACCEL_SAMPLES_PER_BATCH", &sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH, NULL, 'n', 1, 65535},
+  {"SENSOR_GYRO_BATCHES_PER_SEC",    &sap_conf.SENSOR_GYRO_BATCHES_PER_SEC,    NULL, 'n', 1, 65535},
+  {"SENSOR_GYRO_SAMPLES_PER_BATCH",  &sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH,  NULL, 'n', 1, 65535},
+  {"SENSOR_ACCEL_BATCHES_PER_SEC_HIGH",   &sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,   NULL, 'n', 1, 65535},
+  {"SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH", &sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH, NULL, 'n', 1, 65535},
+  {"SENSOR_GYRO_BATCHES_PER_SEC_HIGH",    &sap_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,    NULL, 'n', 1, 65535},
+  {"SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH",  &sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,  NULL, 'n', 1, 65535},
+  {"SENSOR_CONTROL_MODE",            &sap_conf.SENSOR_CONTROL_MODE,            NULL, 'n', 0, 1},
+  {"SENSOR_USAGE",                   &sap_conf.SENSOR_USAGE,                   NULL, 'n', 0, 1},
+  {"SENSOR_ALGORITHM_CONFIG_MASK",   &sap_conf.SENSOR_ALGORITHM_CONFIG_MASK,   NULL, 'n', 0, 1},
+  {"QUIPC_ENABLED",                  &gps_conf.QUIPC_ENABLED,                  NULL, 'n', 0, 1},
+  {"LPP_PROFILE",                    &gps_conf.LPP_PROFILE,                    NULL, 'n', 0, 3},
+  {"A_GLONASS_POS_PROTOCOL_SELECT",  &gps_conf.A_GLONASS_POS_PROTOCOL_SELECT,  NULL, 'n', 0, 7},
 };
 
-static void loc_default_parameters(void)
+static void loc_default_parameters(loc_gps_cfg_s_type &gps, loc_sap_cfg_s_type &sap)
 {
    /* defaults */
-   gps_conf.INTERMEDIATE_POS = 0;
-   gps_conf.ACCURACY_THRES = 0;
-   gps_conf.NMEA_PROVIDER = 0;
-   gps_conf.SUPL_VER = 0x10000;
-   gps_conf.CAPABILITIES = 0x7;
-
-   sap_conf.GYRO_BIAS_RANDOM_WALK = 0;
-   sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC = 2;
-   sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH = 5;
-   sap_conf.SENSOR_GYRO_BATCHES_PER_SEC = 2;
-   sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH = 5;
-   sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH = 4;
-   sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH = 25;
-   sap_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH = 4;
-   sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH = 25;
-   sap_conf.SENSOR_CONTROL_MODE = 0; /* AUTO */
-   sap_conf.SENSOR_USAGE = 0; /* Enabled */
-   sap_conf.SENSOR_ALGORITHM_CONFIG_MASK = 0; /* INS Disabled = FALSE*/
+   gps.INTERMEDIATE_POS = 0;
+   gps.ACCURACY_THRES = 0;
+   gps.NMEA_PROVIDER = 0;
+   gps.NMEA_MULTI_GNSS = 0;
+   gps.NMEA_TAP = 0;
+   gps.CONFIG_WATCH = 0;
+   gps.FIX_MIN_INTERVAL = 0;
+   gps.FIX_MIN_DISTANCE = 0;
+   gps.FIX_COALESCE_INTERMEDIATE = 0;
+   gps.DNS_CACHE_TTL = 3600;
+   gps.AGPS_PREWARM = 0;
+   gps.AGPS_LINGER = 0;
+   gps.DMN_CONN_TRANSPORT = LOC_ENG_DMN_CONN_FIFO;
+   gps.SUPL_VER = 0x10000;
+   gps.CAPABILITIES = 0x7;
+
+   sap.GYRO_BIAS_RANDOM_WALK = 0;
+   sap.SENSOR_ACCEL_BATCHES_PER_SEC = 2;
+   sap.SENSOR_ACCEL_SAMPLES_PER_BATCH = 5;
+   sap.SENSOR_GYRO_BATCHES_PER_SEC = 2;
+   sap.SENSOR_GYRO_SAMPLES_PER_BATCH = 5;
+   sap.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH = 4;
+   sap.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH = 25;
+   sap.SENSOR_GYRO_BATCHES_PER_SEC_HIGH = 4;
+   sap.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH = 25;
+   sap.SENSOR_CONTROL_MODE = 0; /* AUTO */
+   sap.SENSOR_USAGE = 0; /* Enabled */
+   sap.SENSOR_ALGORITHM_CONFIG_MASK = 0; /* INS Disabled = FALSE*/
 
    /* Values MUST be set by OEMs in configuration for sensor-assisted
       navigation to work. There are NO default values */
-   sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
-   sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY = 0;
+   sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY = 0;
+   sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
+   sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY = 0;
+   sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY = 0;
 
-   sap_conf.GYRO_BIAS_RANDOM_WALK_VALID = 0;
-   sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
-   sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
+   sap.GYRO_BIAS_RANDOM_WALK_VALID = 0;
+   sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
+   sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
+   sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
+   sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID = 0;
 
       /* LTE Positioning Profile configuration is disable by default*/
-   gps_conf.LPP_PROFILE = 0;
+   gps.LPP_PROFILE = 0;
 
    /*By default no positioning protocol is selected on A-GLONASS system*/
-   gps_conf.A_GLONASS_POS_PROTOCOL_SELECT = 0;
+   gps.A_GLONASS_POS_PROTOCOL_SELECT = 0;
 }
 
 // 2nd half of init(), singled out for
 // modem restart to use.
 static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data);
+static void loc_eng_reload_config(loc_eng_data_s_type &loc_eng_data);
+static void loc_eng_cfg_watch_notify(void* data);
+static void loc_eng_cfg_watch_start(loc_eng_data_s_type &loc_eng_data,
+                                    gps_create_thread create_thread_cb);
 static void loc_eng_agps_reinit(loc_eng_data_s_type &loc_eng_data);
 
 static int loc_eng_set_server(loc_eng_data_s_type &loc_eng_data,
@@ -182,6 +209,10 @@ static void loc_eng_handle_engine_up(loc_eng_data_s_type &loc_eng_data) ;
 
 static int loc_eng_start_handler(loc_eng_data_s_type &loc_eng_data);
 static int loc_eng_stop_handler(loc_eng_data_s_type &loc_eng_data);
+static void loc_eng_batch_fix(loc_eng_data_s_type &loc_eng_data,
+                              const GpsLocation &location);
+static void loc_eng_batch_deliver(loc_eng_data_s_type &loc_eng_data);
+static void loc_eng_agps_hold(loc_eng_data_s_type &loc_eng_data, const char* why);
 
 static void deleteAidingData(loc_eng_data_s_type &logEng);
 static AgpsStateMachine*
@@ -213,8 +244,12 @@ LocEngRequestNi::LocEngRequestNi(void* locEng,
     locallog();
 }
 void LocEngRequestNi::proc() const {
-    loc_eng_ni_request_handler(*((loc_eng_data_s_type*)mLocEng),
-                               &mNotify, mPayload);
+    loc_eng_data_s_type* locEng = (loc_eng_data_s_type*)mLocEng;
+    // the SUPL session that follows will want the data call
+    if (GPS_NI_TYPE_UMTS_SUPL == mNotify.ni_type && gps_conf.AGPS_PREWARM) {
+        loc_eng_agps_hold(*locEng, "SUPL NI");
+    }
+    loc_eng_ni_request_handler(*locEng, &mNotify, mPayload);
 }
 void LocEngRequestNi::locallog() const
 {
@@ -352,25 +387,33 @@ struct LocEngInjectLocation : public LocMsg {
 
 //        case LOC_ENG_MSG_SET_SERVER_IPV4:
 struct LocEngSetServerIpv4 : public LocMsg {
-    LocEngAdapter* mAdapter;
+    loc_eng_data_s_type* mLocEng;
     const unsigned int mNlAddr;
     const int mPort;
     const LocServerType mServerType;
-    inline LocEngSetServerIpv4(LocEngAdapter* adapter,
+    const uint32_t mSeq;
+    inline LocEngSetServerIpv4(loc_eng_data_s_type* locEng,
                                unsigned int ip,
                                int port,
-                               LocServerType type) :
-        LocMsg(), mAdapter(adapter),
-        mNlAddr(ip), mPort(port), mServerType(type)
+                               LocServerType type,
+                               uint32_t seq) :
+        LocMsg(), mLocEng(locEng),
+        mNlAddr(ip), mPort(port), mServerType(type), mSeq(seq)
     {
         locallog();
     }
     inline virtual void proc() const {
-        mAdapter->setServer(mNlAddr, mPort, mServerType);
+        // names resolve asynchronously, so a newer address may be set
+        if (mSeq != mLocEng->server_seq[mServerType]) {
+            LOC_LOGD("LocEngSetServerIpv4 - superseded, type: %s",
+                     loc_get_server_type_name(mServerType));
+            return;
+        }
+        mLocEng->adapter->setServer(mNlAddr, mPort, mServerType);
     }
     inline void locallog() const {
-        LOC_LOGV("LocEngSetServerIpv4 - addr: %x, port: %d, type: %s",
-                 mNlAddr, mPort, loc_get_server_type_name(mServerType));
+        LOC_LOGV("LocEngSetServerIpv4 - addr: %x, port: %d, type: %s, seq: %u",
+                 mNlAddr, mPort, loc_get_server_type_name(mServerType), mSeq);
     }
     inline virtual void log() const {
         locallog();
@@ -660,6 +703,13 @@ struct LocEngExtPowerConfig : public LocMsg {
     }
 };
 
+// Reports come in with every fix; keep them off the heap. A slab is
+// about one second worth at 1Hz.
+LOC_MSG_POOL_DEFINE(LocEngReportPosition, 4)
+LOC_MSG_POOL_DEFINE(LocEngReportSv, 4)
+LOC_MSG_POOL_DEFINE(LocEngReportStatus, 4)
+LOC_MSG_POOL_DEFINE(LocEngReportNmea, 16)
+
 //        case LOC_ENG_MSG_REPORT_POSITION:
 LocEngReportPosition::LocEngReportPosition(LocAdapterBase* adapter,
                                            UlpLocation &loc,
@@ -667,7 +717,7 @@ LocEngReportPosition::LocEngReportPosition(LocAdapterBase* adapter,
                                            void* locExt,
                                            enum loc_sess_status st,
                                            LocPosTechMask technology) :
-    LocMsg(), mAdapter(adapter), mLocation(loc),
+    LocMsg(LANE_REPORT), mAdapter(adapter), mLocation(loc),
     mLocationExtended(locExtended),
     mLocationExt(((loc_eng_data_s_type*)
                   ((LocEngAdapter*)
@@ -709,6 +759,21 @@ void LocEngReportPosition::proc() const {
                         (gps_conf.ACCURACY_THRES != 0) &&
                         (mLocation.gpsLocation.accuracy >
                          gps_conf.ACCURACY_THRES)))) {
+                // a fix the client does not want costs neither the
+                // callback nor the NMEA
+                if (!loc_eng_fix_filter_pass(&locEng->fix_filter,
+                                             mLocation.gpsLocation,
+                                             LOC_SESS_INTERMEDIATE == mStatus)) {
+                    return;
+                }
+                // one that goes into a batch gets no NMEA at all, which
+                // would otherwise be 4-5 nmea_cb upcalls for each fix
+                if (locEng->batch.active &&
+                    GPS_POSITION_RECURRENCE_PERIODIC ==
+                    locEng->adapter->getPositionMode().recurrence) {
+                    loc_eng_batch_fix(*locEng, mLocation.gpsLocation);
+                    return;
+                }
                 locEng->location_cb((UlpLocation*)&(mLocation),
                                     (void*)mLocationExt);
                 reported = true;
@@ -738,14 +803,12 @@ void LocEngReportPosition::proc() const {
                                       generate_nmea);
         }
 
-        // Free the allocated memory for rawData
-        UlpLocation* gp = (UlpLocation*)&(mLocation);
-        if (gp != NULL && gp->rawData != NULL)
-        {
-            delete (char*)gp->rawData;
-            gp->rawData = NULL;
-            gp->rawDataSize = 0;
-        }
+    }
+}
+LocEngReportPosition::~LocEngReportPosition() {
+    // Free the allocated memory for rawData, even if the fix was muted
+    if (NULL != mLocation.rawData) {
+        delete (char*)mLocation.rawData;
     }
 }
 void LocEngReportPosition::locallog() const {
@@ -764,7 +827,7 @@ LocEngReportSv::LocEngReportSv(LocAdapterBase* adapter,
                                GpsSvStatus &sv,
                                GpsLocationExtended &locExtended,
                                void* svExt) :
-    LocMsg(), mAdapter(adapter), mSvStatus(sv),
+    LocMsg(LANE_REPORT), mAdapter(adapter), mSvStatus(sv),
     mLocationExtended(locExtended),
     mSvExt(((loc_eng_data_s_type*)
             ((LocEngAdapter*)
@@ -802,7 +865,7 @@ void LocEngReportSv::send() const {
 //        case LOC_ENG_MSG_REPORT_STATUS:
 LocEngReportStatus::LocEngReportStatus(LocAdapterBase* adapter,
                                        GpsStatusValue engineStatus) :
-    LocMsg(),  mAdapter(adapter), mStatus(engineStatus)
+    LocMsg(LANE_REPORT),  mAdapter(adapter), mStatus(engineStatus)
 {
     locallog();
 }
@@ -824,7 +887,8 @@ inline void LocEngReportStatus::log() const {
 //        case LOC_ENG_MSG_REPORT_NMEA:
 LocEngReportNmea::LocEngReportNmea(void* locEng,
                                    const char* data, int len) :
-    LocMsg(), mLocEng(locEng), mNmea(new char[len]), mLen(len)
+    LocMsg(LANE_REPORT), mLocEng(locEng),
+    mNmea(len <= (int)sizeof(mBuf) ? mBuf : new char[len]), mLen(len)
 {
     memcpy((void*)mNmea, (void*)data, len);
     locallog();
@@ -835,6 +899,10 @@ void LocEngReportNmea::proc() const {
     struct timeval tv;
     gettimeofday(&tv, (struct timezone *) NULL);
     int64_t now = tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+    if (locEng->nmea_bus != NULL) {
+        loc_eng_nmea_bus_publish(locEng->nmea_bus, now, mNmea, mLen, mLen);
+        return;
+    }
     CALLBACK_LOG_CALLFLOW("nmea_cb", %d, mLen);
 
     if (locEng->nmea_cb != NULL)
@@ -1053,6 +1121,10 @@ void LocEngReleaseATL::proc() const {
 
    if (locEng->agnss_nif) {
         ATLSubscriber s1(mID, locEng->agnss_nif, locEng->adapter, false);
+        // hold the data call first, or it goes down with the last ATL
+        if (locEng->agnss_nif->isSubscribed((Subscriber*)&s1)) {
+            loc_eng_agps_hold(*locEng, "linger");
+        }
         if (locEng->agnss_nif->unsubscribeRsrc((Subscriber*)&s1)) {
             LOC_LOGD("%s:%d]: Unsubscribed from agnss_nif",
                      __func__, __LINE__);
@@ -1090,6 +1162,96 @@ inline void LocEngReleaseATL::log() const {
     locallog();
 }
 
+// sent by the hold timer of mGeneration
+struct LocEngAgpsHoldExpired : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const uint32_t mGeneration;
+    inline LocEngAgpsHoldExpired(loc_eng_data_s_type* locEng,
+                                 uint32_t generation) :
+        LocMsg(), mLocEng(locEng), mGeneration(generation)
+    {
+        locallog();
+    }
+    inline virtual void proc() const {
+        AgpsStateMachine* sm = mLocEng->agnss_nif;
+        if (NULL != sm && mGeneration == mLocEng->agps_hold_generation) {
+            HoldSubscriber hold(sm);
+            if (sm->unsubscribeRsrc((Subscriber*)&hold)) {
+                LOC_LOGD("%s:%d]: released the hold on agnss_nif",
+                         __func__, __LINE__);
+            }
+        }
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngAgpsHoldExpired - generation: %u", mGeneration);
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+// as with the batch timers, a hold extended just leaves its old timer
+// to fire into a stale generation
+struct loc_eng_agps_hold_timer_s {
+    loc_eng_data_s_type* locEng;
+    uint32_t generation;
+};
+
+static void loc_eng_agps_hold_cb(void* user_data, int result)
+{
+    loc_eng_agps_hold_timer_s* timer = (loc_eng_agps_hold_timer_s*)user_data;
+    timer->locEng->adapter->sendMsg(new LocEngAgpsHoldExpired(timer->locEng,
+                                                              timer->generation));
+    delete timer;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_agps_hold
+
+DESCRIPTION
+   Keeps the SUPL data call up for the next AGPS_LINGER ms, bringing it
+   up if need be, so that ATL connections in that time are granted at
+   once. Taken when an ATL connection is released (linger) and, with
+   AGPS_PREWARM, when an assisted session starts or a SUPL NI request
+   comes in (prewarm). Taking it again while held only extends it.
+   Nothing is held while AGPS_LINGER is 0, with or without AGPS_PREWARM.
+
+DEPENDENCIES
+   Runs on the MsgTask
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_agps_hold(loc_eng_data_s_type &loc_eng_data, const char* why)
+{
+    AgpsStateMachine* sm = loc_eng_data.agnss_nif;
+    if (NULL == sm || 0 == gps_conf.AGPS_LINGER) {
+        return;
+    }
+
+    HoldSubscriber hold(sm);
+    if (!sm->isSubscribed((Subscriber*)&hold)) {
+        LOC_LOGD("%s:%d]: %s, holding agnss_nif for %lu ms",
+                 __func__, __LINE__, why, gps_conf.AGPS_LINGER);
+        sm->subscribeRsrc((Subscriber*)&hold);
+    }
+
+    loc_eng_agps_hold_timer_s* timer = new loc_eng_agps_hold_timer_s;
+    timer->locEng = &loc_eng_data;
+    timer->generation = ++loc_eng_data.agps_hold_generation;
+    if (NULL == loc_timer_start(gps_conf.AGPS_LINGER, loc_eng_agps_hold_cb, timer)) {
+        LOC_LOGE("%s: no hold timer, releasing agnss_nif now", __func__);
+        delete timer;
+        sm->unsubscribeRsrc((Subscriber*)&hold);
+    }
+}
+
 //        case LOC_ENG_MSG_REQUEST_WIFI:
 //        case LOC_ENG_MSG_RELEASE_WIFI:
 LocEngReqRelWifi::LocEngReqRelWifi(void* locEng, AGpsExtType type,
@@ -1272,6 +1434,56 @@ struct LocEngInit : public LocMsg {
     }
 };
 
+// the NMEA bus is published to on the MsgTask, so it is started and
+// stopped there too
+struct LocEngNmeaBus : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const gps_create_thread mCreateThread;
+    inline LocEngNmeaBus(loc_eng_data_s_type* locEng,
+                         gps_create_thread createThread) :
+        LocMsg(), mLocEng(locEng), mCreateThread(createThread)
+    {
+        locallog();
+    }
+    inline virtual void proc() const {
+        if (NULL != mCreateThread) {
+            if (NULL == mLocEng->nmea_bus) {
+                loc_eng_nmea_init(mLocEng, mCreateThread);
+            }
+        } else {
+            loc_eng_nmea_cleanup(mLocEng);
+        }
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngNmeaBus: %s", NULL != mCreateThread ? "start" : "stop");
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+struct LocEngReloadConfig : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    inline LocEngReloadConfig(loc_eng_data_s_type* locEng) :
+        LocMsg(), mLocEng(locEng)
+    {
+        locallog();
+    }
+    inline virtual void proc() const {
+        loc_eng_reload_config(*mLocEng);
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngReloadConfig");
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
 //        case LOC_ENG_MSG_REQUEST_XTRA_SERVER:
 // loc_eng_xtra.cpp
 
@@ -1449,8 +1661,16 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
         return ret_val;
     }
 
-    STATE_CHECK((NULL == loc_eng_data.adapter),
-                "instance already initialized", return 0);
+    if (NULL != loc_eng_data.adapter) {
+        // back after loc_eng_cleanup, which kept the adapter but stopped
+        // the NMEA bus and the config watch
+        LOC_LOGD("loc_eng_init: instance already initialized");
+        loc_eng_data.adapter->sendMsg(
+            new LocEngNmeaBus(&loc_eng_data, callbacks->create_thread_cb));
+        loc_eng_cfg_watch_start(loc_eng_data, callbacks->create_thread_cb);
+        EXIT_LOG(%d, ret_val);
+        return ret_val;
+    }
 
     memset(&loc_eng_data, 0, sizeof (loc_eng_data));
 
@@ -1471,6 +1691,15 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
     loc_eng_data.sv_ext_parser = callbacks->sv_ext_parser ?
         callbacks->sv_ext_parser : noProc;
     loc_eng_data.intermediateFix = gps_conf.INTERMEDIATE_POS;
+    loc_eng_fix_filter_config(&loc_eng_data.fix_filter, gps_conf.FIX_MIN_INTERVAL,
+                              gps_conf.FIX_MIN_DISTANCE,
+                              gps_conf.FIX_COALESCE_INTERMEDIATE != 0);
+
+    loc_eng_nmea_init(&loc_eng_data, callbacks->create_thread_cb);
+    loc_eng_xtra_start_inject_task(loc_eng_data, callbacks->create_thread_cb);
+    loc_eng_data.dns = loc_eng_dns_create(callbacks->create_thread_cb,
+                                          LOC_ENG_DNS_CACHE_PATH,
+                                          gps_conf.DNS_CACHE_TTL);
 
     // initial states taken care of by the memset above
     // loc_eng_data.engine_status -- GPS_STATUS_NONE;
@@ -1496,10 +1725,25 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
 
     loc_eng_data.adapter->sendMsg(new LocEngInit(&loc_eng_data));
 
+    loc_eng_cfg_watch_start(loc_eng_data, callbacks->create_thread_cb);
+
     EXIT_LOG(%d, ret_val);
     return ret_val;
 }
 
+// the config watch thread runs from loc_eng_init to loc_eng_cleanup
+static void loc_eng_cfg_watch_start(loc_eng_data_s_type &loc_eng_data,
+                                    gps_create_thread create_thread_cb)
+{
+    if (gps_conf.CONFIG_WATCH && NULL == loc_eng_data.cfg_watch) {
+        static const char* const conf_files[] = { GPS_CONF_FILE, SAP_CONF_FILE };
+        loc_eng_data.cfg_watch =
+            loc_eng_cfg_watch_create(conf_files, sizeof(conf_files) / sizeof(conf_files[0]),
+                                     loc_eng_cfg_watch_notify, &loc_eng_data,
+                                     (thelper_create_thread)create_thread_cb);
+    }
+}
+
 static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data)
 {
     ENTRY_LOG();
@@ -1574,7 +1818,9 @@ void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data)
     ENTRY_LOG_CALLFLOW();
     INIT_CHECK(loc_eng_data.adapter, return);
 
-    // XTRA has no state, so we are fine with it.
+    // XTRA has no state, so we are fine with it. Its inject task is
+    // kept, like the adapter's MsgTask and the resolver's; they only
+    // wait on their Qs while there is nothing to do.
 
     // we need to check and clear NI
 #if 0
@@ -1594,6 +1840,12 @@ void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data)
         loc_eng_stop(loc_eng_data);
     }
 
+    // the threads of the NMEA bus consumers and the config watch are
+    // stopped and joined; the next loc_eng_init starts them again
+    loc_eng_cfg_watch_destroy(loc_eng_data.cfg_watch);
+    loc_eng_data.cfg_watch = NULL;
+    loc_eng_data.adapter->sendMsg(new LocEngNmeaBus(&loc_eng_data, NULL));
+
 #if 0 // can't afford to actually clean up, for many reason.
 
     LOC_LOGD("loc_eng_init: client opened. close it now.");
@@ -1651,7 +1903,14 @@ static int loc_eng_start_handler(loc_eng_data_s_type &loc_eng_data)
            ret_val == LOC_API_ADAPTER_ERR_ENGINE_DOWN)
        {
            loc_eng_data.adapter->setInSession(TRUE);
+           loc_eng_fix_filter_reset(&loc_eng_data.fix_filter);
            loc_inform_gps_status(loc_eng_data, GPS_STATUS_SESSION_BEGIN);
+
+           if (gps_conf.AGPS_PREWARM &&
+               LOC_POSITION_MODE_STANDALONE !=
+               loc_eng_data.adapter->getPositionMode().mode) {
+               loc_eng_agps_hold(loc_eng_data, "session start");
+           }
        }
    }
 
@@ -1703,6 +1962,12 @@ static int loc_eng_stop_handler(loc_eng_data_s_type &loc_eng_data)
        }
 
        loc_eng_data.adapter->setInSession(FALSE);
+       loc_eng_fix_filter_log(&loc_eng_data.fix_filter);
+       // what is left of the session's batch
+       loc_eng_batch_deliver(loc_eng_data);
+
+       // a no-op unless libloc_core is built with LOC_MSG_STATS
+       loc_eng_data.adapter->getMsgTask()->dumpMsgStats();
    }
 
     EXIT_LOG(%d, ret_val);
@@ -1732,6 +1997,284 @@ void loc_eng_mute_one_session(loc_eng_data_s_type &loc_eng_data)
     EXIT_LOG(%s, VOID_RET);
 }
 
+struct LocEngBatchStart : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const int mBatchSize;
+    const uint32_t mMaxAgeMs;
+    inline LocEngBatchStart(loc_eng_data_s_type* locEng, int batchSize,
+                            uint32_t maxAgeMs) :
+        LocMsg(), mLocEng(locEng), mBatchSize(batchSize), mMaxAgeMs(maxAgeMs)
+    {
+        locallog();
+    }
+    inline virtual void proc() const {
+        // fixes held under the old limits go out first
+        loc_eng_batch_deliver(*mLocEng);
+        loc_eng_batch_start(&mLocEng->batch, mBatchSize, mMaxAgeMs);
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngBatchStart - size: %d, max age: %u ms",
+                 mBatchSize, mMaxAgeMs);
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+struct LocEngBatchStop : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    inline LocEngBatchStop(loc_eng_data_s_type* locEng) :
+        LocMsg(), mLocEng(locEng)
+    {
+        locallog();
+    }
+    inline virtual void proc() const {
+        loc_eng_batch_deliver(*mLocEng);
+        if (mLocEng->batch.active) {
+            loc_eng_batch_log(&mLocEng->batch);
+            mLocEng->batch.active = false;
+        }
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngBatchStop");
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+// sent on request, or by the age timer of the batch of mGeneration
+struct LocEngBatchFlush : public LocMsg {
+    loc_eng_data_s_type* mLocEng;
+    const bool mAged;
+    const uint32_t mGeneration;
+    inline LocEngBatchFlush(loc_eng_data_s_type* locEng, bool aged,
+                            uint32_t generation) :
+        LocMsg(), mLocEng(locEng), mAged(aged), mGeneration(generation)
+    {
+        locallog();
+    }
+    inline virtual void proc() const {
+        if (!mAged || mGeneration == mLocEng->batch.generation) {
+            loc_eng_batch_deliver(*mLocEng);
+        }
+    }
+    inline void locallog() const
+    {
+        LOC_LOGV("LocEngBatchFlush - aged: %d, generation: %u",
+                 mAged, mGeneration);
+    }
+    inline virtual void log() const
+    {
+        locallog();
+    }
+};
+
+// the timers are never stopped, a batch flushed early just leaves its
+// timer to fire into a stale generation
+struct loc_eng_batch_timer_s {
+    loc_eng_data_s_type* locEng;
+    uint32_t generation;
+};
+
+static void loc_eng_batch_age_cb(void* user_data, int result)
+{
+    loc_eng_batch_timer_s* timer = (loc_eng_batch_timer_s*)user_data;
+    timer->locEng->adapter->sendMsg(new LocEngBatchFlush(timer->locEng, true,
+                                                         timer->generation));
+    delete timer;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_fix
+
+DESCRIPTION
+   Adds a fix to the batch, and delivers the batch if that fills it. The
+   first fix of a batch arms the age timer.
+
+DEPENDENCIES
+   Runs on the MsgTask
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_batch_fix(loc_eng_data_s_type &loc_eng_data,
+                              const GpsLocation &location)
+{
+    loc_eng_batch_s_type* batch = &loc_eng_data.batch;
+
+    if (loc_eng_batch_add(batch, location)) {
+        loc_eng_batch_deliver(loc_eng_data);
+    } else if (1 == batch->count && 0 != batch->max_age_ms) {
+        loc_eng_batch_timer_s* timer = new loc_eng_batch_timer_s;
+        timer->locEng = &loc_eng_data;
+        timer->generation = batch->generation;
+        if (NULL == loc_timer_start(batch->max_age_ms, loc_eng_batch_age_cb, timer)) {
+            LOC_LOGE("%s: no age timer, the batch waits for its size", __func__);
+            delete timer;
+        }
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_deliver
+
+DESCRIPTION
+   Hands the fixes in the batch, if any, to location_batch_cb and empties
+   the batch. Batched fixes get no NMEA: replaying it here would cost the
+   upcalls batching saves, with GSA/GSV built from the SVs of now rather
+   than of each fix.
+
+DEPENDENCIES
+   Runs on the MsgTask
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_batch_deliver(loc_eng_data_s_type &loc_eng_data)
+{
+    loc_eng_batch_s_type* batch = &loc_eng_data.batch;
+
+    if (batch->count > 0 && NULL != loc_eng_data.location_batch_cb) {
+        loc_eng_data.location_batch_cb(batch->fixes, batch->count);
+    }
+    loc_eng_batch_take(batch);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batching_init
+
+DESCRIPTION
+   Initialize the batching interface.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+   -1: failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_batching_init(loc_eng_data_s_type &loc_eng_data,
+                          GpsBatchingCallbacks* callbacks)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return -1);
+
+    if (NULL == callbacks) {
+        LOC_LOGE("%s: failed, cb is NULL", __func__);
+        EXIT_LOG(%d, -1);
+        return -1;
+    }
+    loc_eng_data.location_batch_cb = callbacks->location_batch_cb;
+
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batching_start
+
+DESCRIPTION
+   Sends the fixes of tracking sessions to location_batch_cb in batches
+   of batch_size, or once the oldest is max_age_ms old, from now on.
+
+DEPENDENCIES
+   loc_eng_batching_init()
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_batching_start(loc_eng_data_s_type &loc_eng_data,
+                           int batch_size, uint32_t max_age_ms)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return -1);
+    int ret_val = -1;
+
+    if (NULL != loc_eng_data.location_batch_cb) {
+        loc_eng_data.adapter->sendMsg(new LocEngBatchStart(&loc_eng_data, batch_size,
+                                                           max_age_ms));
+        ret_val = 0;
+    }
+
+    EXIT_LOG(%d, ret_val);
+    return ret_val;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batching_stop
+
+DESCRIPTION
+   Delivers the fixes held, and sends fixes to location_cb again.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_batching_stop(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return -1);
+
+    loc_eng_data.adapter->sendMsg(new LocEngBatchStop(&loc_eng_data));
+
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batching_flush
+
+DESCRIPTION
+   Delivers the fixes held, without waiting for the batch to fill.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_batching_flush(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG_CALLFLOW();
+    INIT_CHECK(loc_eng_data.adapter, return -1);
+
+    loc_eng_data.adapter->sendMsg(new LocEngBatchFlush(&loc_eng_data, false, 0));
+
+    EXIT_LOG(%d, 0);
+    return 0;
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_set_position_mode
 
@@ -2021,7 +2564,9 @@ void loc_eng_agps_init(loc_eng_data_s_type &loc_eng_data, AGpsExtCallbacks* call
             loc_eng_data.adapter->sendMsg(new LocEngDataClientInit(&loc_eng_data));
 
             loc_eng_dmn_conn_loc_api_server_launch(callbacks->create_thread_cb,
-                                                   NULL, NULL, &loc_eng_data);
+                                                   NULL, NULL, &loc_eng_data,
+                                                   (loc_eng_dmn_conn_transport_e_type)
+                                                   gps_conf.DMN_CONN_TRANSPORT);
         }
         loc_eng_agps_reinit(loc_eng_data);
     }
@@ -2162,47 +2707,49 @@ int loc_eng_agps_open_failed(loc_eng_data_s_type &loc_eng_data, AGpsExtType agps
     return 0;
 }
 
-/*===========================================================================
+// a PDE / MPC server being looked up by loc_eng_dns
+typedef struct
+{
+    loc_eng_data_s_type* locEng;
+    LocServerType        type;
+    int                  port;
+    uint32_t             seq;
+} loc_eng_server_lookup_s_type;
 
-FUNCTION resolve_in_addr
+/*===========================================================================
+FUNCTION    loc_eng_server_resolved
 
 DESCRIPTION
-   Translates a hostname to in_addr struct
+   Called on the resolver thread once the name of a PDE / MPC server has
+   been looked up. Unless the server was set again since, takes the next
+   sequence number for the address, so that it also supersedes the
+   expired one loc_eng_set_server() may still be sending from the cache.
 
 DEPENDENCIES
-   n/a
+   NONE
 
 RETURN VALUE
-   TRUE if successful
+   None
 
 SIDE EFFECTS
-   n/a
+   N/A
 
 ===========================================================================*/
-static boolean resolve_in_addr(const char *host_addr, struct in_addr *in_addr_ptr)
+static void loc_eng_server_resolved(void* data, const char* host,
+                                    const loc_eng_dns_addr_s_type* addr)
 {
-    ENTRY_LOG();
-    boolean ret_val = TRUE;
+    loc_eng_server_lookup_s_type* lookup = (loc_eng_server_lookup_s_type*)data;
 
-    struct hostent             *hp;
-    hp = gethostbyname(host_addr);
-    if (hp != NULL) /* DNS OK */
-    {
-        memcpy(in_addr_ptr, hp->h_addr_list[0], hp->h_length);
-    }
-    else
-    {
-        /* Try IP representation */
-        if (inet_aton(host_addr, in_addr_ptr) == 0)
-        {
-            /* IP not valid */
-            LOC_LOGE("DNS query on '%s' failed\n", host_addr);
-            ret_val = FALSE;
-        }
+    if (NULL == addr) {
+        LOC_LOGE("loc_eng_set_server, hostname %s cannot be resolved.\n", host);
+    } else if (__sync_bool_compare_and_swap(&lookup->locEng->server_seq[lookup->type],
+                                            lookup->seq, lookup->seq + 1)) {
+        unsigned int ip = ntohl(*(const uint32_t*)addr->addr);
+        lookup->locEng->adapter->sendMsg(
+            new LocEngSetServerIpv4(lookup->locEng, ip, lookup->port,
+                                    lookup->type, lookup->seq + 1));
     }
-
-    EXIT_LOG(%s, loc_logger_boolStr[ret_val!=0]);
-    return ret_val;
+    delete lookup;
 }
 
 /*===========================================================================
@@ -2210,13 +2757,16 @@ FUNCTION    loc_eng_set_server
 
 DESCRIPTION
    This is used to set the default AGPS server. Server address is obtained
-   from gps.conf.
+   from gps.conf. The SUPL server goes to the modem by name; the name of
+   any other server is resolved through loc_eng_dns, and its address is
+   set once known, without waiting for it here.
 
 DEPENDENCIES
    NONE
 
 RETURN VALUE
    0
+   -2: the name can have no IPv4 address
 
 SIDE EFFECTS
    N/A
@@ -2239,14 +2789,33 @@ static int loc_eng_set_server(loc_eng_data_s_type &loc_eng_data,
     } else if (LOC_AGPS_CDMA_PDE_SERVER == type ||
                LOC_AGPS_CUSTOM_PDE_SERVER == type ||
                LOC_AGPS_MPC_SERVER == type) {
-        struct in_addr addr;
-        if (!resolve_in_addr(hostname, &addr))
-        {
+        // the modem only takes IPv4 addresses for these
+        loc_eng_dns_addr_s_type addr;
+        loc_eng_server_lookup_s_type* lookup = new loc_eng_server_lookup_s_type;
+        lookup->locEng = &loc_eng_data;
+        lookup->type = type;
+        lookup->port = port;
+        lookup->seq = __sync_add_and_fetch(&loc_eng_data.server_seq[type], 1);
+        uint32_t seq = lookup->seq;
+
+        switch (loc_eng_dns_resolve(loc_eng_data.dns, hostname, AF_INET, &addr,
+                                    loc_eng_server_resolved, lookup)) {
+        case LOC_ENG_DNS_FAILED:
             LOC_LOGE("loc_eng_set_server, hostname %s cannot be resolved.\n", hostname);
+            delete lookup;
             ret = -2;
-        } else {
-            unsigned int ip = htonl(addr.s_addr);
-            adapter->sendMsg(new LocEngSetServerIpv4(adapter, ip, port, type));
+            break;
+        case LOC_ENG_DNS_DONE:
+            delete lookup;
+            // fall through
+        case LOC_ENG_DNS_STALE:
+            // for LOC_ENG_DNS_STALE lookup now belongs to the resolver
+            adapter->sendMsg(new LocEngSetServerIpv4(&loc_eng_data,
+                                                     ntohl(*(const uint32_t*)addr.addr),
+                                                     port, type, seq));
+            break;
+        default:
+            break;
         }
     } else {
         LOC_LOGE("loc_eng_set_server, type %d cannot be resolved.\n", type);
@@ -2515,7 +3084,7 @@ int loc_eng_read_config(void)
     if(configAlreadyRead == false)
     {
       // Initialize our defaults before reading of configuration file overwrites them.
-      loc_default_parameters();
+      loc_default_parameters(gps_conf, sap_conf);
       // We only want to parse the conf file once. This is a good place to ensure that.
       // In fact one day the conf file should go into context.
       UTIL_READ_CONF(GPS_CONF_FILE, loc_parameter_table);
@@ -2528,3 +3097,238 @@ int loc_eng_read_config(void)
     EXIT_LOG(%d, 0);
     return 0;
 }
+
+/*===========================================================================
+FUNCTION    loc_eng_load_config
+
+DESCRIPTION
+   Reads the gps and sap config files over the defaults into the given
+   structs rather than gps_conf and sap_conf. It goes through a copy of
+   loc_parameter_table with every pointer into gps_conf or sap_conf moved
+   to the same field of gps or sap.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void* loc_eng_config_field(void* field, loc_gps_cfg_s_type &gps,
+                                  loc_sap_cfg_s_type &sap)
+{
+    char* p = (char*)field;
+    if (p >= (char*)&gps_conf && p < (char*)(&gps_conf + 1)) {
+        return (char*)&gps + (p - (char*)&gps_conf);
+    }
+    if (p >= (char*)&sap_conf && p < (char*)(&sap_conf + 1)) {
+        return (char*)&sap + (p - (char*)&sap_conf);
+    }
+    return field;
+}
+
+static void loc_eng_load_config(loc_gps_cfg_s_type &gps, loc_sap_cfg_s_type &sap)
+{
+    loc_param_s_type table[sizeof(loc_parameter_table) / sizeof(loc_parameter_table[0])];
+
+    for (unsigned int i = 0; i < sizeof(table) / sizeof(table[0]); i++) {
+        table[i] = loc_parameter_table[i];
+        table[i].param_ptr = loc_eng_config_field(table[i].param_ptr, gps, sap);
+        if (NULL != table[i].param_set) {
+            table[i].param_set =
+                (uint8_t*)loc_eng_config_field(table[i].param_set, gps, sap);
+        }
+    }
+
+    loc_default_parameters(gps, sap);
+    UTIL_READ_CONF(GPS_CONF_FILE, table);
+    UTIL_READ_CONF(SAP_CONF_FILE, table);
+}
+
+static bool loc_eng_config_changed(const char* name, unsigned long was,
+                                   unsigned long now)
+{
+    if (was != now) {
+        LOC_LOGI("%s: %s %lu -> %lu", __func__, name, was, now);
+    }
+    return was != now;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_reload_config
+
+DESCRIPTION
+   Runs on the MsgTask when the config watcher saw gps.conf or sap.conf
+   change. Reads both files again, and for every setting that differs
+   from the running one updates it and sends the engine the message that
+   applies it, as loc_eng_reinit() does at start. CAPABILITIES,
+   NMEA_PROVIDER, NMEA_TAP, QUIPC_ENABLED, CONFIG_WATCH and
+   DMN_CONN_TRANSPORT are only read when the HAL starts and are left
+   alone. DEBUG_LEVEL and the other
+   logging settings are picked up by loc_read_conf() itself.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_reload_config(loc_eng_data_s_type &loc_eng_data)
+{
+    ENTRY_LOG();
+    LocEngAdapter* adapter = loc_eng_data.adapter;
+    loc_gps_cfg_s_type gps = gps_conf;
+    loc_sap_cfg_s_type sap = sap_conf;
+
+    loc_flush_conf(GPS_CONF_FILE);
+    loc_flush_conf(SAP_CONF_FILE);
+    loc_eng_load_config(gps, sap);
+
+    // read where they are used, nothing to send
+    if (loc_eng_config_changed("INTERMEDIATE_POS", gps_conf.INTERMEDIATE_POS,
+                               gps.INTERMEDIATE_POS)) {
+        gps_conf.INTERMEDIATE_POS = gps.INTERMEDIATE_POS;
+        loc_eng_data.intermediateFix = gps.INTERMEDIATE_POS;
+    }
+    if (loc_eng_config_changed("ACCURACY_THRES", gps_conf.ACCURACY_THRES,
+                               gps.ACCURACY_THRES)) {
+        gps_conf.ACCURACY_THRES = gps.ACCURACY_THRES;
+    }
+    if (loc_eng_config_changed("NMEA_MULTI_GNSS", gps_conf.NMEA_MULTI_GNSS,
+                               gps.NMEA_MULTI_GNSS)) {
+        gps_conf.NMEA_MULTI_GNSS = gps.NMEA_MULTI_GNSS;
+    }
+    if (loc_eng_config_changed("FIX_MIN_INTERVAL", gps_conf.FIX_MIN_INTERVAL,
+                               gps.FIX_MIN_INTERVAL) |
+        loc_eng_config_changed("FIX_COALESCE_INTERMEDIATE",
+                               gps_conf.FIX_COALESCE_INTERMEDIATE,
+                               gps.FIX_COALESCE_INTERMEDIATE) |
+        (gps.FIX_MIN_DISTANCE != gps_conf.FIX_MIN_DISTANCE)) {
+        gps_conf.FIX_MIN_INTERVAL = gps.FIX_MIN_INTERVAL;
+        gps_conf.FIX_MIN_DISTANCE = gps.FIX_MIN_DISTANCE;
+        gps_conf.FIX_COALESCE_INTERMEDIATE = gps.FIX_COALESCE_INTERMEDIATE;
+        loc_eng_fix_filter_log(&loc_eng_data.fix_filter);
+        loc_eng_fix_filter_config(&loc_eng_data.fix_filter, gps_conf.FIX_MIN_INTERVAL,
+                                  gps_conf.FIX_MIN_DISTANCE,
+                                  gps_conf.FIX_COALESCE_INTERMEDIATE != 0);
+    }
+    if (loc_eng_config_changed("DNS_CACHE_TTL", gps_conf.DNS_CACHE_TTL,
+                               gps.DNS_CACHE_TTL)) {
+        gps_conf.DNS_CACHE_TTL = gps.DNS_CACHE_TTL;
+        loc_eng_dns_set_ttl(loc_eng_data.dns, gps_conf.DNS_CACHE_TTL);
+    }
+    // a hold already taken keeps its timer
+    if (loc_eng_config_changed("AGPS_PREWARM", gps_conf.AGPS_PREWARM,
+                               gps.AGPS_PREWARM)) {
+        gps_conf.AGPS_PREWARM = gps.AGPS_PREWARM;
+    }
+    if (loc_eng_config_changed("AGPS_LINGER", gps_conf.AGPS_LINGER,
+                               gps.AGPS_LINGER)) {
+        gps_conf.AGPS_LINGER = gps.AGPS_LINGER;
+    }
+
+    // set on the modem
+    if (loc_eng_config_changed("SUPL_VER", gps_conf.SUPL_VER, gps.SUPL_VER)) {
+        gps_conf.SUPL_VER = gps.SUPL_VER;
+        adapter->sendMsg(new LocEngSuplVer(adapter, gps_conf.SUPL_VER));
+    }
+    if (loc_eng_config_changed("LPP_PROFILE", gps_conf.LPP_PROFILE, gps.LPP_PROFILE)) {
+        gps_conf.LPP_PROFILE = gps.LPP_PROFILE;
+        adapter->sendMsg(new LocEngLppConfig(adapter, gps_conf.LPP_PROFILE));
+    }
+    if (loc_eng_config_changed("A_GLONASS_POS_PROTOCOL_SELECT",
+                               gps_conf.A_GLONASS_POS_PROTOCOL_SELECT,
+                               gps.A_GLONASS_POS_PROTOCOL_SELECT)) {
+        gps_conf.A_GLONASS_POS_PROTOCOL_SELECT = gps.A_GLONASS_POS_PROTOCOL_SELECT;
+        adapter->sendMsg(new LocEngAGlonassProtocol(adapter,
+                                                    gps_conf.A_GLONASS_POS_PROTOCOL_SELECT));
+    }
+    if (loc_eng_config_changed("SENSOR_USAGE", sap_conf.SENSOR_USAGE, sap.SENSOR_USAGE)) {
+        adapter->sendMsg(new LocEngSensorControlConfig(adapter, sap.SENSOR_USAGE));
+    }
+
+    if (sap.GYRO_BIAS_RANDOM_WALK_VALID != sap_conf.GYRO_BIAS_RANDOM_WALK_VALID ||
+        sap.GYRO_BIAS_RANDOM_WALK != sap_conf.GYRO_BIAS_RANDOM_WALK ||
+        sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID != sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY != sap_conf.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY ||
+        sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID != sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY != sap_conf.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY ||
+        sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID != sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY != sap_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY ||
+        sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID != sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID ||
+        sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY != sap_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY)
+    {
+        LOC_LOGI("%s: sensor properties changed", __func__);
+        adapter->sendMsg(new LocEngSensorProperties(adapter,
+                                                    sap.GYRO_BIAS_RANDOM_WALK_VALID,
+                                                    sap.GYRO_BIAS_RANDOM_WALK,
+                                                    sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                    sap.ACCEL_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                    sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                    sap.ANGLE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                    sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                    sap.RATE_RANDOM_WALK_SPECTRAL_DENSITY,
+                                                    sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
+                                                    sap.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY));
+    }
+
+    if (sap.SENSOR_CONTROL_MODE != sap_conf.SENSOR_CONTROL_MODE ||
+        sap.SENSOR_ACCEL_SAMPLES_PER_BATCH != sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH ||
+        sap.SENSOR_ACCEL_BATCHES_PER_SEC != sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC ||
+        sap.SENSOR_GYRO_SAMPLES_PER_BATCH != sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH ||
+        sap.SENSOR_GYRO_BATCHES_PER_SEC != sap_conf.SENSOR_GYRO_BATCHES_PER_SEC ||
+        sap.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH != sap_conf.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH ||
+        sap.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH != sap_conf.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH ||
+        sap.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH != sap_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH ||
+        sap.SENSOR_GYRO_BATCHES_PER_SEC_HIGH != sap_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH ||
+        sap.SENSOR_ALGORITHM_CONFIG_MASK != sap_conf.SENSOR_ALGORITHM_CONFIG_MASK)
+    {
+        LOC_LOGI("%s: sensor performance control changed", __func__);
+        adapter->sendMsg(new LocEngSensorPerfControlConfig(adapter,
+                                                           sap.SENSOR_CONTROL_MODE,
+                                                           sap.SENSOR_ACCEL_SAMPLES_PER_BATCH,
+                                                           sap.SENSOR_ACCEL_BATCHES_PER_SEC,
+                                                           sap.SENSOR_GYRO_SAMPLES_PER_BATCH,
+                                                           sap.SENSOR_GYRO_BATCHES_PER_SEC,
+                                                           sap.SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH,
+                                                           sap.SENSOR_ACCEL_BATCHES_PER_SEC_HIGH,
+                                                           sap.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
+                                                           sap.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
+                                                           sap.SENSOR_ALGORITHM_CONFIG_MASK));
+    }
+
+    // only this thread reads sap_conf after init
+    sap_conf = sap;
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_cfg_watch_notify
+
+DESCRIPTION
+   Called on the config watcher thread when gps.conf or sap.conf changed;
+   hands the reload to the MsgTask.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_cfg_watch_notify(void* data)
+{
+    loc_eng_data_s_type* loc_eng_data_p = (loc_eng_data_s_type*)data;
+    loc_eng_data_p->adapter->sendMsg(new LocEngReloadConfig(loc_eng_data_p));
+}
@@ -57,6 +57,9 @@ typedef unsigned char boolean;
 #include <log_util.h>
 #include <loc_eng_agps.h>
 #include <LocEngAdapter.h>
+#include <loc_eng_fix_filter.h>
+#include <loc_eng_batch.h>
+#include <loc_eng_dns.h>
 
 // The data connection minimal open time
 #define DATA_OPEN_MIN_TIME        1  /* sec */
@@ -74,6 +77,25 @@ enum loc_nmea_provider_e_type {
     NMEA_PROVIDER_MP // Modem Processor Provider of NMEA
 };
 
+// Constellations NMEA is generated for
+enum loc_eng_gnss_e_type {
+    LOC_ENG_GNSS_GPS = 0,
+    LOC_ENG_GNSS_GLONASS,
+    LOC_ENG_GNSS_MAX
+};
+
+// SVs of the last sv report grouped by constellation, in report order
+// within each. Built once per sv report and reused until the next.
+typedef struct loc_eng_sv_index_s
+{
+    uint8_t  num_in_view[LOC_ENG_GNSS_MAX];
+    uint8_t  first[LOC_ENG_GNSS_MAX];      // into sv_order
+    uint8_t  sv_order[GPS_MAX_SVS];        // sv_list indices
+    // bit n set: PRN (first PRN of the constellation + n) used in fix;
+    // the HAL only reports this for GPS
+    uint32_t used_mask[LOC_ENG_GNSS_MAX];
+} loc_eng_sv_index_s_type;
+
 enum loc_mute_session_e_type {
    LOC_MUTE_SESS_NONE = 0,
    LOC_MUTE_SESS_WAIT,
@@ -94,6 +116,7 @@ typedef struct loc_eng_data_s
     gps_release_wakelock           release_wakelock_cb;
     gps_request_utc_time           request_utc_time_cb;
     boolean                        intermediateFix;
+    loc_eng_fix_filter_s_type      fix_filter;
     AGpsStatusValue                agps_status;
     loc_eng_xtra_data_s_type       xtra_module_data;
     loc_eng_ni_data_s_type         loc_eng_ni_data;
@@ -117,7 +140,8 @@ typedef struct loc_eng_data_s
 
     // For nmea generation
     boolean generateNmea;
-    uint32_t sv_used_mask;
+    loc_eng_sv_index_s_type sv_index;
+    struct loc_eng_nmea_bus_s* nmea_bus;
     float hdop;
     float pdop;
     float vdop;
@@ -135,6 +159,22 @@ typedef struct loc_eng_data_s
 
     loc_ext_parser location_ext_parser;
     loc_ext_parser sv_ext_parser;
+
+    // gps.conf/sap.conf watcher, when CONFIG_WATCH is set
+    struct loc_eng_cfg_watch_s* cfg_watch;
+
+    // fix batching, see loc_eng_batch.h
+    gps_location_batch_callback    location_batch_cb;
+    loc_eng_batch_s_type           batch;
+
+    // server name resolution, see loc_eng_dns.h; a resolved address is
+    // only applied if no newer one was set for its server type since
+    struct loc_eng_dns_s*          dns;
+    volatile uint32_t              server_seq[LOC_AGPS_SUPL_SERVER + 1];
+
+    // bumped each time the hold on agnss_nif is taken or extended, so
+    // an older linger timer knows it has been overtaken
+    uint32_t                       agps_hold_generation;
 } loc_eng_data_s_type;
 
 /* GPS.conf support */
@@ -146,7 +186,17 @@ typedef struct loc_gps_cfg_s
     unsigned long  CAPABILITIES;
     unsigned long  QUIPC_ENABLED;
     unsigned long  LPP_PROFILE;
-    uint8_t        NMEA_PROVIDER;
+    unsigned long  NMEA_PROVIDER;
+    unsigned long  NMEA_MULTI_GNSS;
+    unsigned long  NMEA_TAP;
+    unsigned long  CONFIG_WATCH;
+    unsigned long  FIX_MIN_INTERVAL;
+    double         FIX_MIN_DISTANCE;
+    unsigned long  FIX_COALESCE_INTERMEDIATE;
+    unsigned long  DNS_CACHE_TTL;
+    unsigned long  AGPS_PREWARM;
+    unsigned long  AGPS_LINGER;
+    unsigned long  DMN_CONN_TRANSPORT;
     unsigned long  A_GLONASS_POS_PROTOCOL_SELECT;
     char           XTRA_SERVER_1[MAX_XTRA_SERVER_URL_LENGTH];
     char           XTRA_SERVER_2[MAX_XTRA_SERVER_URL_LENGTH];
@@ -220,14 +270,31 @@ bool loc_eng_inject_raw_command(loc_eng_data_s_type &loc_eng_data,
 
 void loc_eng_mute_one_session(loc_eng_data_s_type &loc_eng_data);
 
+int  loc_eng_batching_init(loc_eng_data_s_type &loc_eng_data,
+                           GpsBatchingCallbacks* callbacks);
+int  loc_eng_batching_start(loc_eng_data_s_type &loc_eng_data,
+                            int batch_size, uint32_t max_age_ms);
+int  loc_eng_batching_stop(loc_eng_data_s_type &loc_eng_data);
+int  loc_eng_batching_flush(loc_eng_data_s_type &loc_eng_data);
+
 int loc_eng_xtra_init (loc_eng_data_s_type &loc_eng_data,
                        GpsXtraExtCallbacks* callbacks);
 
 int loc_eng_xtra_inject_data(loc_eng_data_s_type &loc_eng_data,
                              char* data, int length);
 
+int loc_eng_xtra_inject_file(loc_eng_data_s_type &loc_eng_data,
+                             const char* path);
+
+int loc_eng_xtra_inject_buffer(loc_eng_data_s_type &loc_eng_data,
+                               const char* data, int length,
+                               gps_xtra_release release, void* context);
+
 int loc_eng_xtra_request_server(loc_eng_data_s_type &loc_eng_data);
 
+void loc_eng_xtra_start_inject_task(loc_eng_data_s_type &loc_eng_data,
+                                    gps_create_thread create_thread_cb);
+
 extern void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data,
                             GpsNiExtCallbacks *callbacks);
 extern void loc_eng_ni_respond(loc_eng_data_s_type &loc_eng_data,
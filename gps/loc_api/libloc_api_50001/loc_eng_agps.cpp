@@ -37,35 +37,17 @@
 #include <loc_eng_dmn_conn_handler.h>
 #include <loc_eng_dmn_conn.h>
 #include <sys/time.h>
+#include <time.h>
 
 //======================================================================
 // C callbacks
 //======================================================================
 
-// This is given to linked_list_add as the dealloc callback
-// data -- an instance of Subscriber
-static void deleteObj(void* data)
-{
-    delete (Subscriber*)data;
-}
-
-// This is given to linked_list_search() as the comparison callback
-// when the state manchine needs to process for particular subscriber
-// fromCaller -- caller provides this obj
-// fromList -- linked_list_search() function take this one from list
-static bool hasSubscriber(void* fromCaller, void* fromList)
-{
-    Notification* notification = (Notification*)fromCaller;
-    Subscriber* s1 = (Subscriber*)fromList;
-
-    return s1->forMe(*notification);
-}
-
-// This is gvien to linked_list_search() to notify subscriber objs
-// when the state machine needs to inform all subscribers of resource
-// status changes, e.g. when resource is GRANTED.
+// notifies subscriber objs when the state machine needs to inform
+// subscribers of resource status changes, e.g. when resource is GRANTED.
+// returns true if the subscriber is to be deleted afterwards.
 // fromCaller -- caller provides this ptr to a Notification obj.
-// fromList -- linked_list_search() function take this one from list
+// fromList -- the subscriber
 static bool notifySubscriber(void* fromCaller, void* fromList)
 {
     Notification* notification = (Notification*)fromCaller;
@@ -75,11 +57,129 @@ static bool notifySubscriber(void* fromCaller, void* fromList)
     // each subscriber decides if this notification is interesting.
     return s1->notifyRsrcStatus(*notification) &&
            // if we do not want to delete the subscriber from the
-           // the list, we must set this to false so this function
+           // the registry, we must set this to false so this function
            // returns false
            notification->postNotifyDelete;
 }
 
+static inline int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline uint32_t elapsedUs(int64_t sinceNs, int64_t now) {
+    int64_t us = (now - sinceNs) / 1000;
+    return us > (int64_t)UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
+
+//======================================================================
+// SubscriberRegistry
+//======================================================================
+SubscriberRegistry::SubscriberRegistry() :
+    mHead(NULL), mCount(0), mInactive(0)
+{
+    memset(mBuckets, 0, sizeof(mBuckets));
+}
+
+unsigned int SubscriberRegistry::bucket(const Subscriber* s)
+{
+    // Fibonacci hashing; the top bits are the well mixed ones
+    uint32_t h = (s->ID ^ ((uint32_t)s->mType << 24)) * 2654435761u;
+    return h >> (32 - __builtin_ctz(BUCKETS));
+}
+
+Subscriber* SubscriberRegistry::find(const Subscriber* s) const
+{
+    Subscriber* found = mBuckets[bucket(s)];
+    while (NULL != found &&
+           (found->mType != s->mType || !found->equals(s))) {
+        found = found->mHashNext;
+    }
+    return found;
+}
+
+void SubscriberRegistry::add(Subscriber* s)
+{
+    unsigned int b = bucket(s);
+    s->mHashNext = mBuckets[b];
+    mBuckets[b] = s;
+
+    s->mPrev = NULL;
+    s->mNext = mHead;
+    if (NULL != mHead) {
+        mHead->mPrev = s;
+    }
+    mHead = s;
+    s->mAddedNs = nowNs();
+
+    mCount++;
+    if (s->isInactive()) {
+        mInactive++;
+    }
+}
+
+void SubscriberRegistry::remove(Subscriber* s)
+{
+    Subscriber** link = &mBuckets[bucket(s)];
+    while (NULL != *link && s != *link) {
+        link = &(*link)->mHashNext;
+    }
+    if (NULL == *link) {
+        LOC_LOGE("%s:%d]: subscriber %u is not registered", __func__, __LINE__, s->ID);
+        return;
+    }
+    *link = s->mHashNext;
+
+    if (NULL == s->mPrev) {
+        mHead = s->mNext;
+    } else {
+        s->mPrev->mNext = s->mNext;
+    }
+    if (NULL != s->mNext) {
+        s->mNext->mPrev = s->mPrev;
+    }
+    s->mHashNext = s->mPrev = s->mNext = NULL;
+
+    mCount--;
+    if (s->isInactive()) {
+        mInactive--;
+    }
+}
+
+void SubscriberRegistry::setInactive(Subscriber* s)
+{
+    if (!s->isInactive()) {
+        s->setInactive();
+        // BIT and ATL subscribers never go inactive
+        if (s->isInactive()) {
+            mInactive++;
+        }
+    }
+}
+
+void SubscriberRegistry::clear()
+{
+    Subscriber* s = mHead;
+    while (NULL != s) {
+        Subscriber* next = s->mNext;
+        delete s;
+        s = next;
+    }
+    memset(mBuckets, 0, sizeof(mBuckets));
+    mHead = NULL;
+    mCount = mInactive = 0;
+}
+
+Subscriber* SubscriberRegistry::firstActive() const
+{
+    Subscriber* s = mHead;
+    while (NULL != s && s->isInactive()) {
+        s = s->mNext;
+    }
+    return s;
+}
+
 //======================================================================
 // Notification
 //======================================================================
@@ -231,6 +331,27 @@ bool DSSubscriber::notifyRsrcStatus(Notification &notification)
     }
     return notify;
 }
+bool HoldSubscriber::notifyRsrcStatus(Notification &notification)
+{
+    bool notify = forMe(notification);
+
+    if (notify) {
+        switch(notification.rsrcStatus)
+        {
+        case RSRC_UNSUBSCRIBE:
+        case RSRC_RELEASED:
+        case RSRC_DENIED:
+        case RSRC_GRANTED:
+            // nobody to tell; only here to hold the NIF
+            break;
+        default:
+            notify = false;
+        }
+    }
+
+    return notify;
+}
+
 void DSSubscriber :: setInactive()
 {
     mIsInactive = true;
@@ -279,6 +400,7 @@ AgpsState* AgpsReleasedState::onRsrcEvent(AgpsRsrcStatus event, void* data)
         if(!mStateMachine->sendRsrcRequest(GPS_REQUEST_AGPS_DATA_CONN)) {
             // move the state to PENDING
             nextState = mPendingState;
+            mStateMachine->onBearerRequested();
         }
     }
     break;
@@ -342,7 +464,7 @@ AgpsState* AgpsPendingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -369,6 +491,7 @@ AgpsState* AgpsPendingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     case RSRC_GRANTED:
     {
         nextState = mAcquiredState;
+        mStateMachine->onBearerUp();
         Notification notification(Notification::BROADCAST_ACTIVE, event, false);
         // notify all subscribers NIF resource GRANTED
         // by setting false, we keep subscribers on the linked list
@@ -385,6 +508,7 @@ AgpsState* AgpsPendingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     case RSRC_DENIED:
     {
         nextState = mReleasedState;
+        mStateMachine->onBearerDenied();
         Notification notification(Notification::BROADCAST_ALL, event, true);
         // notify all subscribers NIF resource RELEASED or DENIED
         // by setting true, we remove subscribers from the linked list
@@ -431,6 +555,7 @@ AgpsState* AgpsAcquiredState::onRsrcEvent(AgpsRsrcStatus event, void* data)
         // we have rsrc in hand, so grant it right away
         Notification notification(subscriber, RSRC_GRANTED, false);
         subscriber->notifyRsrcStatus(notification);
+        mStateMachine->onGrantedAtOnce(subscriber);
         // add subscriber to the list
         mStateMachine->addSubscriber(subscriber);
         // no state change.
@@ -441,7 +566,7 @@ AgpsState* AgpsAcquiredState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -532,7 +657,7 @@ AgpsState* AgpsReleasingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
     {
         Subscriber* subscriber = (Subscriber*) data;
         if (subscriber->waitForCloseComplete()) {
-            subscriber->setInactive();
+            mStateMachine->deactivateSubscriber(subscriber);
         } else {
             // auto notify this subscriber of the unsubscribe
             Notification notification(subscriber, event, true);
@@ -561,6 +686,7 @@ AgpsState* AgpsReleasingState::onRsrcEvent(AgpsRsrcStatus event, void* data)
             nextState = mPendingState;
             // request from connecivity service for NIF
             mStateMachine->sendRsrcRequest(GPS_REQUEST_AGPS_DATA_CONN);
+            mStateMachine->onBearerRequested();
         } else {
             nextState = mReleasedState;
         }
@@ -629,9 +755,11 @@ AgpsStateMachine::AgpsStateMachine(servicerType servType,
     mAPNLen(0),
     mBearer(AGPS_APN_BEARER_INVALID),
     mEnforceSingleSubscriber(enforceSingleSubscriber),
-    mServicer(Servicer :: getServicer(servType, (void *)cb_func))
+    mServicer(Servicer :: getServicer(servType, (void *)cb_func)),
+    mRequestNs(0)
 {
-    linked_list_init(&mSubscribers);
+    memset(&mBearerUpHist, 0, sizeof(mBearerUpHist));
+    memset(&mGrantWaitHist, 0, sizeof(mGrantWaitHist));
 
     // setting up mReleasedState
     mStatePtr->mPendingState = new AgpsPendingState(this);
@@ -671,7 +799,6 @@ AgpsStateMachine::~AgpsStateMachine()
     delete pendindState;
     delete releasingState;
     delete mServicer;
-    linked_list_destroy(&mSubscribers);
 
     if (NULL != mAPN) {
         delete[] mAPN;
@@ -714,45 +841,94 @@ void AgpsStateMachine::onRsrcEvent(AgpsRsrcStatus event)
 
 void AgpsStateMachine::notifySubscribers(Notification& notification) const
 {
-    if (notification.postNotifyDelete) {
-        // just any non NULL value to get started
-        Subscriber* s = (Subscriber*)~0;
-        while (NULL != s) {
-            s = NULL;
-            // if the last param sets to true, _search will delete
-            // the node from the list for us.  But the problem is
-            // once that is done, _search returns, leaving the
-            // rest of the list unprocessed.  So we need a loop.
-            linked_list_search(mSubscribers, (void**)&s, notifySubscriber,
-                               (void*)&notification, true);
+    if (NULL != notification.rcver) {
+        // only the one it is for, found by its key
+        Subscriber* s = mSubscribers.find(notification.rcver);
+        if (NULL != s && notifySubscriber((void*)&notification, s)) {
+            mSubscribers.remove(s);
             delete s;
         }
     } else {
-        // no loop needed if it the last param sets to false, which
-        // mean nothing gets deleted from the list.
-        linked_list_search(mSubscribers, NULL, notifySubscriber,
-                           (void*)&notification, false);
+        // BIT / WIFI subscribers answer gpsone_daemon / QuIPC / MSAP
+        // here; let those answers go out together
+        loc_eng_dmn_conn_loc_api_server_cork();
+        Subscriber* s = mSubscribers.first();
+        while (NULL != s) {
+            // s may go away
+            Subscriber* next = s->mNext;
+            if (notifySubscriber((void*)&notification, s)) {
+                mSubscribers.remove(s);
+                delete s;
+            }
+            s = next;
+        }
+        loc_eng_dmn_conn_loc_api_server_uncork();
     }
 }
 
 void AgpsStateMachine::addSubscriber(Subscriber* subscriber) const
 {
-    Subscriber* s = NULL;
-    Notification notification((const Subscriber*)subscriber);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
+    if (NULL == mSubscribers.find(subscriber)) {
+        mSubscribers.add(subscriber->clone());
+    }
+}
 
-    if (NULL == s) {
-        linked_list_add(mSubscribers, subscriber->clone(), deleteObj);
+void AgpsStateMachine::onBearerRequested() const
+{
+    mRequestNs = nowNs();
+}
+
+void AgpsStateMachine::onBearerUp() const
+{
+    if (0 == mRequestNs) {
+        return;
+    }
+    int64_t now = nowNs();
+    mBearerUpHist.record(elapsedUs(mRequestNs, now));
+    mRequestNs = 0;
+
+    // everyone that has been waiting for this grant
+    for (Subscriber* s = mSubscribers.first(); NULL != s; s = s->mNext) {
+        if (SUBSCRIBER_HOLD != s->mType && !s->isInactive()) {
+            mGrantWaitHist.record(elapsedUs(s->mAddedNs, now));
+        }
+    }
+}
+
+void AgpsStateMachine::onBearerDenied() const
+{
+    mRequestNs = 0;
+}
+
+void AgpsStateMachine::onGrantedAtOnce(const Subscriber* subscriber) const
+{
+    if (SUBSCRIBER_HOLD != subscriber->mType) {
+        mGrantWaitHist.record(0);
+    }
+}
+
+static void logHist(AGpsExtType type, const char* what,
+                    const loc_core::LocHistogram& h)
+{
+    LOC_LOGI("agps type %d %s: n %llu avg %llu us p50 %u p90 %u max %u us",
+             (int)type, what, (unsigned long long)h.mTotal,
+             (unsigned long long)(h.mTotal ? h.mSum / h.mTotal : 0),
+             h.percentile(50), h.percentile(90), h.mMax);
+}
+
+void AgpsStateMachine::logBearerStats() const
+{
+    if (mBearerUpHist.mTotal) {
+        logHist(mType, "bearer up", mBearerUpHist);
+    }
+    if (mGrantWaitHist.mTotal) {
+        logHist(mType, "grant wait", mGrantWaitHist);
     }
 }
 
 int AgpsStateMachine::sendRsrcRequest(AGpsStatusValue action) const
 {
-    Subscriber* s = NULL;
-    Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&s, hasSubscriber,
-                       (void*)&notification, false);
+    Subscriber* s = mSubscribers.firstActive();
 
     if ((NULL == s) == (GPS_RELEASE_AGPS_DATA_CONN == action)) {
         AGpsExtStatus nifRequest;
@@ -772,6 +948,10 @@ int AgpsStateMachine::sendRsrcRequest(AGpsStatusValue action) const
 
         CALLBACK_LOG_CALLFLOW("agps_cb", %s, loc_get_agps_status_name(action));
         mServicer->requestRsrc((void *)&nifRequest);
+
+        if (GPS_RELEASE_AGPS_DATA_CONN == action) {
+            logBearerStats();
+        }
     }
     return 0;
 }
@@ -788,10 +968,7 @@ void AgpsStateMachine::subscribeRsrc(Subscriber *subscriber)
 
 bool AgpsStateMachine::unsubscribeRsrc(Subscriber *subscriber)
 {
-    Subscriber* s = NULL;
-    Notification notification((const Subscriber*)subscriber);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
+    Subscriber* s = mSubscribers.find(subscriber);
 
     if (NULL != s) {
         mStatePtr = mStatePtr->onRsrcEvent(RSRC_UNSUBSCRIBE, (void*)s);
@@ -800,15 +977,6 @@ bool AgpsStateMachine::unsubscribeRsrc(Subscriber *subscriber)
     return false;
 }
 
-bool AgpsStateMachine::hasActiveSubscribers() const
-{
-    Subscriber* s = NULL;
-    Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
-    return NULL != s;
-}
-
 //======================================================================
 // DSStateMachine
 //======================================================================
@@ -837,10 +1005,7 @@ DSStateMachine :: DSStateMachine(servicerType type, void *cb_func,
 
 void DSStateMachine :: retryCallback(void)
 {
-    DSSubscriber *subscriber = NULL;
-    Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&subscriber, hasSubscriber,
-                       (void*)&notification, false);
+    DSSubscriber *subscriber = (DSSubscriber*)mSubscribers.firstActive();
     if(subscriber)
         mLocAdapter->requestSuplES(subscriber->ID);
     else
@@ -851,14 +1016,11 @@ void DSStateMachine :: retryCallback(void)
 
 int DSStateMachine :: sendRsrcRequest(AGpsStatusValue action) const
 {
-    DSSubscriber* s = NULL;
+    DSSubscriber* s = (DSSubscriber*)mSubscribers.firstActive();
     dsCbData cbData;
     int ret=-1;
     int connHandle=-1;
     LOC_LOGD("Enter DSStateMachine :: sendRsrcRequest\n");
-    Notification notification(Notification::BROADCAST_ACTIVE);
-    linked_list_search(mSubscribers, (void**)&s, hasSubscriber,
-                       (void*)&notification, false);
     if(s) {
         connHandle = s->ID;
         LOC_LOGD("DSStateMachine :: sendRsrcRequest - subscriber found\n");
@@ -882,8 +1044,8 @@ int DSStateMachine :: sendRsrcRequest(AGpsStatusValue action) const
             informStatus(RSRC_DENIED, connHandle);
         }
         else {
-            if(loc_timer_start(DATA_CALL_RETRY_DELAY_MSEC, delay_callback, (void *)this)) {
-                LOC_LOGE("Error: Could not start delay thread\n");
+            if(NULL == loc_timer_start(DATA_CALL_RETRY_DELAY_MSEC, delay_callback, (void *)this)) {
+                LOC_LOGE("Error: Could not start delay timer\n");
                 ret = -1;
                 goto err;
             }
@@ -37,8 +37,8 @@
 #include <hardware/gps.h>
 #include <gps_extended.h>
 #include <loc_core_log.h>
-#include <linked_list.h>
 #include <loc_timer.h>
+#include <LocMsgStats.h>
 #include <LocEngAdapter.h>
 
 // forward declaration
@@ -110,6 +110,47 @@ struct Notification {
         postNotifyDelete(false) {}
 };
 
+// what a subscriber is, the other half of its key besides its ID
+typedef enum {
+    SUBSCRIBER_BIT,
+    SUBSCRIBER_ATL,
+    SUBSCRIBER_WIFI,
+    SUBSCRIBER_DS,
+    SUBSCRIBER_HOLD
+} SubscriberType;
+
+// The subscribers of a state machine, hashed on (type, ID) for lookups
+// and threaded on a list, newest first, for notifications. The links
+// are in the subscribers themselves, so the only allocation is the
+// subscriber's own, when it is added.
+class SubscriberRegistry {
+    static const unsigned int BUCKETS = 32;   // power of 2
+    Subscriber* mBuckets[BUCKETS];
+    Subscriber* mHead;
+    unsigned int mCount;
+    unsigned int mInactive;
+    static unsigned int bucket(const Subscriber* s);
+public:
+    SubscriberRegistry();
+    inline ~SubscriberRegistry() { clear(); }
+
+    // the registered subscriber equal to s, or NULL
+    Subscriber* find(const Subscriber* s) const;
+    // takes ownership of s, which must not be equal to one registered
+    void add(Subscriber* s);
+    // gives the ownership of s back
+    void remove(Subscriber* s);
+    // the only way a registered subscriber is to be made inactive
+    void setInactive(Subscriber* s);
+    // deletes all
+    void clear();
+
+    inline bool empty() const { return NULL == mHead; }
+    inline bool hasActive() const { return mCount > mInactive; }
+    inline Subscriber* first() const { return mHead; }
+    Subscriber* firstActive() const;
+};
+
 class AgpsState {
     // allows AgpsStateMachine to access private data
     // no class members are public.  We don't want
@@ -179,8 +220,8 @@ public:
 
 class AgpsStateMachine {
 protected:
-    // a linked list of subscribers.
-    void* mSubscribers;
+    // the subscribers; const methods add and drop them as well
+    mutable SubscriberRegistry mSubscribers;
     //handle to whoever provides the service
     Servicer *mServicer;
     // allows AgpsState to access private data
@@ -203,6 +244,12 @@ private:
     AGpsBearerType mBearer;
     // ipv4 address for routing
     bool mEnforceSingleSubscriber;
+    // bearer up latency, from the request to the grant, and how long
+    // subscribers waited for a grant, 0 if the bearer was already up;
+    // both in us
+    mutable loc_core::LocHistogram mBearerUpHist;
+    mutable loc_core::LocHistogram mGrantWaitHist;
+    mutable int64_t mRequestNs;
 
 public:
     AgpsStateMachine(servicerType servType, void *cb_func,
@@ -222,25 +269,36 @@ public:
     // someone, a ATL client or BIT, is done with NIF
     bool unsubscribeRsrc(Subscriber *subscriber);
 
-    // add a subscriber in the linked list, if not already there.
+    // add a subscriber in the registry, if not already there.
     void addSubscriber(Subscriber* subscriber) const;
 
+    // a registered subscriber waits for its close to complete
+    inline void deactivateSubscriber(Subscriber* subscriber) const
+    { mSubscribers.setInactive(subscriber); }
+
     virtual void onRsrcEvent(AgpsRsrcStatus event);
 
     // put the data together and send the FW
     virtual int sendRsrcRequest(AGpsStatusValue action) const;
 
-    //if list is empty, linked_list_empty returns 1
-    //else if list is not empty, returns 0
-    //so hasSubscribers() returns 1 if list is not empty
-    //and returns 0 if list is empty
     inline bool hasSubscribers() const
-    { return !linked_list_empty(mSubscribers); }
+    { return !mSubscribers.empty(); }
 
-    bool hasActiveSubscribers() const;
+    inline bool hasActiveSubscribers() const
+    { return mSubscribers.hasActive(); }
 
     inline void dropAllSubscribers() const
-    { linked_list_flush(mSubscribers); }
+    { mSubscribers.clear(); }
+
+    inline bool isSubscribed(const Subscriber* subscriber) const
+    { return NULL != mSubscribers.find(subscriber); }
+
+    // latency bookkeeping, called by the states
+    void onBearerRequested() const;
+    void onBearerUp() const;
+    void onBearerDenied() const;
+    void onGrantedAtOnce(const Subscriber* subscriber) const;
+    void logBearerStats() const;
 
     // private. Only a state gets to call this.
     void notifySubscribers(Notification& notification) const;
@@ -269,10 +327,18 @@ public:
 // cilent from BIT daemon.
 struct Subscriber {
     const uint32_t ID;
+    const SubscriberType mType;
     const AgpsStateMachine* mStateMachine;
+    // owned by SubscriberRegistry
+    Subscriber* mHashNext;
+    Subscriber* mPrev;
+    Subscriber* mNext;
+    int64_t mAddedNs;
     inline Subscriber(const int id,
+                      const SubscriberType type,
                       const AgpsStateMachine* stateMachine) :
-        ID(id), mStateMachine(stateMachine) {}
+        ID(id), mType(type), mStateMachine(stateMachine),
+        mHashNext(NULL), mPrev(NULL), mNext(NULL), mAddedNs(0) {}
     inline virtual ~Subscriber() {}
 
     virtual void setIPAddresses(uint32_t &v4, char* v6) = 0;
@@ -302,7 +368,7 @@ struct BITSubscriber : public Subscriber {
 
     inline BITSubscriber(const AgpsStateMachine* stateMachine,
                          unsigned int ipv4, char* ipv6) :
-        Subscriber(ipv4, stateMachine)
+        Subscriber(ipv4, SUBSCRIBER_BIT, stateMachine)
     {
         if (NULL == ipv6) {
             mIPv6Addr[0] = 0;
@@ -333,7 +399,7 @@ struct ATLSubscriber : public Subscriber {
                          const AgpsStateMachine* stateMachine,
                          const LocEngAdapter* adapter,
                          const bool compatibleMode) :
-        Subscriber(id, stateMachine), mLocAdapter(adapter),
+        Subscriber(id, SUBSCRIBER_ATL, stateMachine), mLocAdapter(adapter),
         mBackwardCompatibleMode(compatibleMode){}
     virtual bool notifyRsrcStatus(Notification &notification);
 
@@ -356,7 +422,7 @@ struct WIFISubscriber : public Subscriber {
     bool mIsInactive;
     inline WIFISubscriber(const AgpsStateMachine* stateMachine,
                          char * ssid, char * password, loc_if_req_sender_id_e_type sender_id) :
-        Subscriber(sender_id, stateMachine),
+        Subscriber(sender_id, SUBSCRIBER_WIFI, stateMachine),
         mSSID(NULL == ssid ? NULL : new char[SSID_BUF_SIZE]),
         mPassword(NULL == password ? NULL : new char[SSID_BUF_SIZE]),
         senderId(sender_id)
@@ -400,7 +466,7 @@ struct DSSubscriber : public Subscriber {
     bool mIsInactive;
     inline DSSubscriber(const AgpsStateMachine *stateMachine,
                          const int id) :
-        Subscriber(id, stateMachine)
+        Subscriber(id, SUBSCRIBER_DS, stateMachine)
     {
         mIsInactive = false;
     }
@@ -416,4 +482,20 @@ struct DSSubscriber : public Subscriber {
     inline virtual char *whoami() {return (char*)"DSSubscriber";}
 };
 
+// HoldSubscriber keeps the NIF of a state machine up without an ATL
+// connection: ahead of the first one, when a session starts or a SUPL
+// NI comes in (prewarm), and past the last one (linger), so that ATL
+// requests close together share one bearer. There is at most one per
+// state machine.
+struct HoldSubscriber : public Subscriber {
+    inline HoldSubscriber(const AgpsStateMachine *stateMachine) :
+        Subscriber(0, SUBSCRIBER_HOLD, stateMachine) {}
+    inline virtual void setIPAddresses(uint32_t &v4, char* v6)
+    { v4 = INADDR_NONE; v6[0] = 0; }
+    virtual bool notifyRsrcStatus(Notification &notification);
+    inline virtual Subscriber* clone()
+    { return new HoldSubscriber(mStateMachine); }
+    inline virtual ~HoldSubscriber(){}
+};
+
 #endif //__LOC_ENG_AGPS_H__
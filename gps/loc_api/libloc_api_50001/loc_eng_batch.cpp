@@ -0,0 +1,140 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+#include <loc_eng_batch.h>
+#include "log_util.h"
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_start
+
+DESCRIPTION
+   Turns batching on with the given limits, which are clamped to what the
+   array holds, and starts the counters over. Fixes already in the array
+   are kept.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_batch_start(loc_eng_batch_s_type* batch, int batch_size, uint32_t max_age_ms)
+{
+   if (batch_size < 1) {
+      batch_size = 1;
+   } else if (batch_size > LOC_ENG_BATCH_MAX_SIZE) {
+      batch_size = LOC_ENG_BATCH_MAX_SIZE;
+   }
+   batch->active = true;
+   batch->batch_size = batch_size;
+   batch->max_age_ms = max_age_ms;
+   batch->num_fixes = 0;
+   batch->num_batches = 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_add
+
+DESCRIPTION
+   Appends a fix to the batch.
+
+DEPENDENCIES
+   The batch is not full, which holds as long as it is flushed whenever
+   this returns true.
+
+RETURN VALUE
+   true if the batch is now due
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+bool loc_eng_batch_add(loc_eng_batch_s_type* batch, const GpsLocation& location)
+{
+   batch->fixes[batch->count++] = location;
+   batch->num_fixes++;
+   return batch->count >= batch->batch_size;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_take
+
+DESCRIPTION
+   Empties the batch after its fixes were delivered from batch->fixes.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of fixes that were in batch->fixes
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_batch_take(loc_eng_batch_s_type* batch)
+{
+   int count = batch->count;
+   batch->count = 0;
+   batch->generation++;
+   if (count > 0) {
+      batch->num_batches++;
+   }
+   return count;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_batch_log
+
+DESCRIPTION
+   Logs how many fixes went out in how many callbacks.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_batch_log(const loc_eng_batch_s_type* batch)
+{
+   LOC_LOGI("%s: batch size %d, max age %u ms: %llu fixes in %llu callbacks",
+            __func__, batch->batch_size, batch->max_age_ms,
+            (unsigned long long)batch->num_fixes,
+            (unsigned long long)batch->num_batches);
+}
@@ -0,0 +1,75 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_BATCH_H
+#define LOC_ENG_BATCH_H
+
+#include <stdint.h>
+#include <hardware/gps.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Fix batching
+
+   While batching is on, fixes that would go to location_cb are kept in a
+   fixed array and handed to the batch callback all at once: when
+   batch_size of them are in, when the oldest is max_age_ms old, or on
+   an explicit flush. Only the GpsLocation of each fix is kept, and
+   batched fixes get no NMEA. Owned by the MsgTask thread. */
+
+#define LOC_ENG_BATCH_MAX_SIZE 128
+
+typedef struct loc_eng_batch_s
+{
+    bool        active;
+    int         batch_size;
+    uint32_t    max_age_ms;     // 0: no age limit
+    int         count;
+    // bumped on every flush, so that an age timer armed for an earlier
+    // batch can tell it is stale
+    uint32_t    generation;
+    GpsLocation fixes[LOC_ENG_BATCH_MAX_SIZE];
+
+    // since batching was last started
+    uint64_t    num_fixes;
+    uint64_t    num_batches;
+} loc_eng_batch_s_type;
+
+void loc_eng_batch_start(loc_eng_batch_s_type* batch, int batch_size, uint32_t max_age_ms);
+bool loc_eng_batch_add(loc_eng_batch_s_type* batch, const GpsLocation& location);
+int  loc_eng_batch_take(loc_eng_batch_s_type* batch);
+void loc_eng_batch_log(const loc_eng_batch_s_type* batch);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // LOC_ENG_BATCH_H
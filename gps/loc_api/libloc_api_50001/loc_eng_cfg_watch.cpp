@@ -0,0 +1,288 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <loc_eng_cfg_watch.h>
+#include "log_util.h"
+#include "platform_lib_includes.h"
+
+#define CFG_WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+typedef struct cfg_watch_file_s
+{
+    int wd;
+    char dir[PATH_MAX];
+    const char* name;   // points into dir's copy of the path
+} cfg_watch_file_s_type;
+
+struct loc_eng_cfg_watch_s
+{
+    int inotify_fd;
+    int wake_fd[2];     // written to by loc_eng_cfg_watch_destroy()
+    int num_files;
+    cfg_watch_file_s_type files[LOC_ENG_CFG_WATCH_MAX_FILES];
+    loc_eng_cfg_watch_cb cb;
+    void* data;
+    struct loc_eng_dmn_conn_thelper thelper;
+};
+
+/*===========================================================================
+FUNCTION    cfg_watch_drain
+
+DESCRIPTION
+   Reads the pending inotify events and tells whether any of them is for
+   one of the watched files.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   1 if a watched file changed, 0 if not, -1 on a read error
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int cfg_watch_drain(loc_eng_cfg_watch_s_type* watch)
+{
+    char buf[sizeof(struct inotify_event) + NAME_MAX + 1]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    int changed = 0;
+    ssize_t len;
+
+    while ((len = read(watch->inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char* p = buf; p < buf + len; ) {
+            const struct inotify_event* event = (const struct inotify_event*)p;
+            for (int i = 0; event->len > 0 && i < watch->num_files; i++) {
+                if (event->wd == watch->files[i].wd &&
+                    strcmp(event->name, watch->files[i].name) == 0) {
+                    LOC_LOGD("%s:%d] %s/%s changed", __func__, __LINE__,
+                             watch->files[i].dir, event->name);
+                    changed = 1;
+                }
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (len < 0 && errno != EAGAIN && errno != EINTR) {
+        LOC_LOGE("%s:%d] read failed, %s", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+    return changed;
+}
+
+/*===========================================================================
+FUNCTION    cfg_watch_proc
+
+DESCRIPTION
+   Watcher thread loop body. Waits for a change to a watched file, then
+   keeps draining events until none came for LOC_ENG_CFG_WATCH_SETTLE_MS,
+   so an editor's several writes make for a single callback.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   0, -1 to stop the thread
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int cfg_watch_proc(void* context)
+{
+    loc_eng_cfg_watch_s_type* watch = (loc_eng_cfg_watch_s_type*)context;
+    struct pollfd fds[2];
+    int changed = 0;
+
+    fds[0].fd = watch->inotify_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = watch->wake_fd[0];
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        fds[0].revents = fds[1].revents = 0;
+        int ret = poll(fds, 2, changed ? LOC_ENG_CFG_WATCH_SETTLE_MS : -1);
+        if (ret < 0 && errno != EINTR) {
+            LOC_LOGE("%s:%d] poll failed, %s", __func__, __LINE__, strerror(errno));
+            return -1;
+        }
+        if (fds[1].revents) {
+            return 0;
+        }
+        if (ret == 0) {
+            // quiet long enough, the files are settled
+            break;
+        }
+        if (fds[0].revents) {
+            int drained = cfg_watch_drain(watch);
+            if (drained < 0) {
+                return -1;
+            }
+            changed |= drained;
+        }
+    }
+
+    watch->cb(watch->data);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_cfg_watch_create
+
+DESCRIPTION
+   Starts watching up to LOC_ENG_CFG_WATCH_MAX_FILES files. The thread is
+   started with create_thread_cb, or pthread_create if it is NULL.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   the watcher, NULL on failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+loc_eng_cfg_watch_s_type* loc_eng_cfg_watch_create(const char* const* files, int num_files,
+                                                   loc_eng_cfg_watch_cb cb, void* data,
+                                                   thelper_create_thread create_thread_cb)
+{
+    loc_eng_cfg_watch_s_type* watch =
+        (loc_eng_cfg_watch_s_type*)calloc(1, sizeof(loc_eng_cfg_watch_s_type));
+    if (NULL == watch) {
+        LOC_LOGE("%s:%d] out of memory", __func__, __LINE__);
+        return NULL;
+    }
+
+    watch->cb = cb;
+    watch->data = data;
+    watch->wake_fd[0] = watch->wake_fd[1] = -1;
+
+    watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->inotify_fd < 0 || pipe2(watch->wake_fd, O_CLOEXEC) < 0) {
+        LOC_LOGE("%s:%d] %s", __func__, __LINE__, strerror(errno));
+        goto err;
+    }
+
+    for (int i = 0; i < num_files && i < LOC_ENG_CFG_WATCH_MAX_FILES; i++) {
+        cfg_watch_file_s_type* file = &watch->files[watch->num_files];
+        char* slash;
+
+        // watch the directory, so that files replaced by rename are seen too
+        strlcpy(file->dir, files[i], sizeof(file->dir));
+        if (NULL == (slash = strrchr(file->dir, '/'))) {
+            LOC_LOGE("%s:%d] %s is not an absolute path", __func__, __LINE__, files[i]);
+            continue;
+        }
+        *slash = '\0';
+        file->name = slash + 1;
+
+        file->wd = inotify_add_watch(watch->inotify_fd,
+                                     file->dir[0] ? file->dir : "/", CFG_WATCH_EVENTS);
+        if (file->wd < 0) {
+            LOC_LOGW("%s:%d] cannot watch %s, %s", __func__, __LINE__,
+                     files[i], strerror(errno));
+            continue;
+        }
+        watch->num_files++;
+    }
+
+    if (0 == watch->num_files) {
+        LOC_LOGE("%s:%d] no file to watch", __func__, __LINE__);
+        goto err;
+    }
+
+    if (loc_eng_dmn_conn_launch_thelper(&watch->thelper, NULL, NULL,
+                                        cfg_watch_proc, NULL,
+                                        create_thread_cb, watch) != 0) {
+        LOC_LOGE("%s:%d] failed to start the watcher", __func__, __LINE__);
+        thelper_signal_destroy(&watch->thelper);
+        goto err;
+    }
+
+    LOC_LOGD("%s:%d] watching %d files", __func__, __LINE__, watch->num_files);
+    return watch;
+
+err:
+    if (watch->inotify_fd >= 0) {
+        close(watch->inotify_fd);
+    }
+    if (watch->wake_fd[0] >= 0) {
+        close(watch->wake_fd[0]);
+        close(watch->wake_fd[1]);
+    }
+    free(watch);
+    return NULL;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_cfg_watch_destroy
+
+DESCRIPTION
+   Stops the watcher thread and frees the watcher. A callback already
+   running is waited for.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_cfg_watch_destroy(loc_eng_cfg_watch_s_type* watch)
+{
+    if (NULL == watch) {
+        return;
+    }
+
+    loc_eng_dmn_conn_unblock_thelper(&watch->thelper);
+    if (write(watch->wake_fd[1], "x", 1) < 0) {
+        LOC_LOGE("%s:%d] %s", __func__, __LINE__, strerror(errno));
+    }
+    loc_eng_dmn_conn_join_thelper(&watch->thelper);
+
+    close(watch->inotify_fd);
+    close(watch->wake_fd[0]);
+    close(watch->wake_fd[1]);
+    free(watch);
+}
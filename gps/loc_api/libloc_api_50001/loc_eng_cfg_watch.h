@@ -0,0 +1,54 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_CFG_WATCH_H
+#define LOC_ENG_CFG_WATCH_H
+
+#include <loc_eng_dmn_conn_thread_helper.h>
+
+/* Configuration file watcher
+
+   One thread waits on inotify for the directories of the watched files.
+   When one of the files is rewritten or renamed into place, it waits for
+   LOC_ENG_CFG_WATCH_SETTLE_MS of quiet and then calls the callback once,
+   on its own thread, for the whole burst of changes. */
+
+#define LOC_ENG_CFG_WATCH_MAX_FILES 4
+#define LOC_ENG_CFG_WATCH_SETTLE_MS 200
+
+typedef void (*loc_eng_cfg_watch_cb)(void* data);
+
+typedef struct loc_eng_cfg_watch_s loc_eng_cfg_watch_s_type;
+
+loc_eng_cfg_watch_s_type* loc_eng_cfg_watch_create(const char* const* files, int num_files,
+                                                   loc_eng_cfg_watch_cb cb, void* data,
+                                                   thelper_create_thread create_thread_cb);
+void loc_eng_cfg_watch_destroy(loc_eng_cfg_watch_s_type* watch);
+
+#endif // LOC_ENG_CFG_WATCH_H
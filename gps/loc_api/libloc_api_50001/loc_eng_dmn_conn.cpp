@@ -36,14 +36,20 @@
 #include <errno.h>
 #include <grp.h>
 #include <sys/stat.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include "log_util.h"
 #include "platform_lib_includes.h"
 #include "loc_eng_dmn_conn_glue_msg.h"
+#include "loc_eng_dmn_conn_glue_sock.h"
 #include "loc_eng_dmn_conn_handler.h"
 #include "loc_eng_dmn_conn.h"
 #include "loc_eng_msg.h"
 
+static loc_eng_dmn_conn_transport_e_type dmn_conn_transport = LOC_ENG_DMN_CONN_FIFO;
+
 static int loc_api_server_msgqid;
 static int loc_api_resp_msgqid;
 static int quipc_msgqid;
@@ -56,50 +62,68 @@ static const char * global_quipc_ctrl_q_path = QUIPC_CTRL_Q_PATH;
 static const char * global_msapm_ctrl_q_path = MSAPM_CTRL_Q_PATH;
 static const char * global_msapu_ctrl_q_path = MSAPU_CTRL_Q_PATH;
 
-static int loc_api_server_proc_init(void *context)
+// LOC_ENG_DMN_CONN_SOCKET: the request socket, which responses are also
+// sent from, and an eventfd to unblock the epoll loop with
+static int loc_api_server_sockfd = -1;
+static int loc_api_server_epollfd = -1;
+static int loc_api_server_unblockfd = -1;
+// responses given up on because a client did not take them in time
+static volatile uint32_t loc_api_server_sock_drops = 0;
+
+// only ever touched by the server thread, whichever the transport
+static union {
+    struct ctrl_msgbuf cmsgbuf;
+    uint8_t bytes[sizeof(struct ctrl_msgbuf) + 256];
+} loc_api_server_rcv_buf;
+
+// LOC_ENG_DMN_CONN_FIFO_BATCHED: what was read past the last whole
+// message, and the responses held for each client while corked
+static struct loc_eng_dmn_conn_glue_msgring loc_api_server_rcv_ring;
+
+#define DMN_CONN_OUTQ_SIZE 16
+struct dmn_conn_outq {
+    struct ctrl_msgbuf msgs[DMN_CONN_OUTQ_SIZE];
+    int count;
+};
+static pthread_mutex_t dmn_conn_out_lock = PTHREAD_MUTEX_INITIALIZER;
+static int dmn_conn_corked;
+static struct dmn_conn_outq dmn_conn_outqs[LOC_ENG_IF_REQUEST_SENDER_ID_MODEM];
+
+static void loc_api_server_set_group(const char * path, struct group * gps_group)
 {
-    loc_api_server_msgqid = loc_eng_dmn_conn_glue_msgget(global_loc_api_q_path, O_RDWR);
-    //change mode/group for the global_loc_api_q_path pipe
-    int result = chmod (global_loc_api_q_path, 0660);
+    int result = chmod (path, 0660);
     if (result != 0)
     {
-        LOC_LOGE("failed to change mode for %s, error = %s\n", global_loc_api_q_path, strerror(errno));
+        LOC_LOGE("failed to change mode for %s, error = %s\n", path, strerror(errno));
     }
 
-    struct group * gps_group = getgrnam("gps");
     if (gps_group != NULL)
     {
-       result = chown (global_loc_api_q_path, -1, gps_group->gr_gid);
+       result = chown (path, -1, gps_group->gr_gid);
        if (result != 0)
        {
           LOC_LOGE("chown for pipe failed, pipe %s, gid = %d, result = %d, error = %s\n",
-                   global_loc_api_q_path, gps_group->gr_gid, result, strerror(errno));
+                   path, gps_group->gr_gid, result, strerror(errno));
        }
     }
-    else
+}
+
+static int loc_api_server_proc_init(void *context)
+{
+    loc_api_server_msgqid = loc_eng_dmn_conn_glue_msgget(global_loc_api_q_path, O_RDWR);
+
+    struct group * gps_group = getgrnam("gps");
+    if (gps_group == NULL)
     {
        LOC_LOGE("getgrnam for gps failed, error code = %d\n",  errno);
     }
+    //change mode/group for the global_loc_api_q_path pipe
+    loc_api_server_set_group(global_loc_api_q_path, gps_group);
 
     loc_api_resp_msgqid = loc_eng_dmn_conn_glue_msgget(global_loc_api_resp_q_path, O_RDWR);
 
     //change mode/group for the global_loc_api_resp_q_path pipe
-    result = chmod (global_loc_api_resp_q_path, 0660);
-    if (result != 0)
-    {
-        LOC_LOGE("failed to change mode for %s, error = %s\n", global_loc_api_resp_q_path, strerror(errno));
-    }
-
-    if (gps_group != NULL)
-    {
-       result = chown (global_loc_api_resp_q_path, -1, gps_group->gr_gid);
-       if (result != 0)
-       {
-          LOC_LOGE("chown for pipe failed, pipe %s, gid = %d, result = %d, error = %s\n",
-                   global_loc_api_resp_q_path,
-                   gps_group->gr_gid, result, strerror(errno));
-       }
-    }
+    loc_api_server_set_group(global_loc_api_resp_q_path, gps_group);
 
     quipc_msgqid = loc_eng_dmn_conn_glue_msgget(global_quipc_ctrl_q_path, O_RDWR);
     msapm_msgqid = loc_eng_dmn_conn_glue_msgget(global_msapm_ctrl_q_path , O_RDWR);
@@ -114,40 +138,16 @@ static int loc_api_server_proc_pre(void *context)
     return 0;
 }
 
-static int loc_api_server_proc(void *context)
+static void loc_api_server_dispatch(struct ctrl_msgbuf * p_cmsgbuf, int length)
 {
-    int length, sz;
-    int result = 0;
-    static int cnt = 0;
-    struct ctrl_msgbuf * p_cmsgbuf;
-    struct ctrl_msgbuf cmsg_resp;
-
-    sz = sizeof(struct ctrl_msgbuf) + 256;
-    p_cmsgbuf = (struct ctrl_msgbuf *) malloc(sz);
-
-    if (!p_cmsgbuf) {
-        LOC_LOGE("%s:%d] Out of memory\n", __func__, __LINE__);
-        return -1;
-    }
-
-    cnt ++;
-    LOC_LOGD("%s:%d] %d listening on %s...\n", __func__, __LINE__, cnt, (char *) context);
-    length = loc_eng_dmn_conn_glue_msgrcv(loc_api_server_msgqid, p_cmsgbuf, sz);
-    if (length <= 0) {
-        free(p_cmsgbuf);
-        LOC_LOGE("%s:%d] fail receiving msg from gpsone_daemon, retry later\n", __func__, __LINE__);
-        usleep(1000);
-        return 0;
-    }
-
     LOC_LOGD("%s:%d] received ctrl_type = %d\n", __func__, __LINE__, p_cmsgbuf->ctrl_type);
     switch(p_cmsgbuf->ctrl_type) {
         case GPSONE_LOC_API_IF_REQUEST:
-            result = loc_eng_dmn_conn_loc_api_server_if_request_handler(p_cmsgbuf, length);
+            loc_eng_dmn_conn_loc_api_server_if_request_handler(p_cmsgbuf, length);
             break;
 
         case GPSONE_LOC_API_IF_RELEASE:
-            result = loc_eng_dmn_conn_loc_api_server_if_release_handler(p_cmsgbuf, length);
+            loc_eng_dmn_conn_loc_api_server_if_release_handler(p_cmsgbuf, length);
             break;
 
         case GPSONE_UNBLOCK:
@@ -159,8 +159,55 @@ static int loc_api_server_proc(void *context)
                 __func__, __LINE__, p_cmsgbuf->ctrl_type);
             break;
     }
+}
+
+static int loc_api_server_proc(void *context)
+{
+    int length;
+    static int cnt = 0;
+    struct ctrl_msgbuf * p_cmsgbuf = &loc_api_server_rcv_buf.cmsgbuf;
+
+    cnt ++;
+    LOC_LOGD("%s:%d] %d listening on %s...\n", __func__, __LINE__, cnt, (char *) context);
+    length = loc_eng_dmn_conn_glue_msgrcv(loc_api_server_msgqid, p_cmsgbuf,
+                                          sizeof(loc_api_server_rcv_buf));
+    if (length <= 0) {
+        LOC_LOGE("%s:%d] fail receiving msg from gpsone_daemon, retry later\n", __func__, __LINE__);
+        usleep(1000);
+        return 0;
+    }
 
-    free(p_cmsgbuf);
+    loc_api_server_dispatch(p_cmsgbuf, length);
+    return 0;
+}
+
+static void loc_api_server_dispatch_cb(void * msgp, int length)
+{
+    loc_api_server_dispatch((struct ctrl_msgbuf *) msgp, length);
+}
+
+static int loc_api_server_batch_proc_init(void *context)
+{
+    loc_eng_dmn_conn_glue_msgring_init(&loc_api_server_rcv_ring);
+    return loc_api_server_proc_init(context);
+}
+
+static int loc_api_server_batch_proc(void *context)
+{
+    int count;
+
+    count = loc_eng_dmn_conn_glue_msgrcv_batch(loc_api_server_msgqid,
+                                               &loc_api_server_rcv_ring,
+                                               &loc_api_server_rcv_buf,
+                                               sizeof(loc_api_server_rcv_buf),
+                                               loc_api_server_dispatch_cb);
+    if (count < 0) {
+        LOC_LOGE("%s:%d] fail receiving msg from gpsone_daemon, retry later\n", __func__, __LINE__);
+        usleep(1000);
+        return 0;
+    }
+
+    LOC_LOGD("%s:%d] %d msgs on %s\n", __func__, __LINE__, count, (char *) context);
     return 0;
 }
 
@@ -184,25 +231,143 @@ static int loc_eng_dmn_conn_unblock_proc(void)
     return 0;
 }
 
+static int loc_api_server_sock_proc_init(void *context)
+{
+    struct epoll_event ev;
+
+    loc_api_server_sockfd = loc_eng_dmn_conn_glue_sockget(GPSONE_LOC_API_SOCK_PATH);
+    if (loc_api_server_sockfd < 0) {
+        return -1;
+    }
+
+    struct group * gps_group = getgrnam("gps");
+    if (gps_group == NULL)
+    {
+       LOC_LOGE("getgrnam for gps failed, error code = %d\n",  errno);
+    }
+    loc_api_server_set_group(GPSONE_LOC_API_SOCK_PATH, gps_group);
+
+    loc_api_server_epollfd = epoll_create1(EPOLL_CLOEXEC);
+    loc_api_server_unblockfd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (loc_api_server_epollfd < 0 || loc_api_server_unblockfd < 0) {
+        LOC_LOGE("%s:%d] epoll / eventfd failed: %s\n", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = loc_api_server_sockfd;
+    if (epoll_ctl(loc_api_server_epollfd, EPOLL_CTL_ADD, loc_api_server_sockfd, &ev) < 0) {
+        LOC_LOGE("%s:%d] epoll_ctl failed: %s\n", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+    ev.data.fd = loc_api_server_unblockfd;
+    if (epoll_ctl(loc_api_server_epollfd, EPOLL_CTL_ADD, loc_api_server_unblockfd, &ev) < 0) {
+        LOC_LOGE("%s:%d] epoll_ctl failed: %s\n", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+
+    LOC_LOGD("%s:%d] loc_api_server_sockfd = %d\n", __func__, __LINE__, loc_api_server_sockfd);
+    return 0;
+}
+
+// waits for either socket to be readable, then takes in every datagram
+// queued on the request socket before it waits again
+static int loc_api_server_sock_proc(void *context)
+{
+    struct epoll_event events[2];
+    struct ctrl_msgbuf * p_cmsgbuf = &loc_api_server_rcv_buf.cmsgbuf;
+    int n, i, length;
+
+    n = epoll_wait(loc_api_server_epollfd, events, 2, -1);
+    if (n < 0) {
+        if (EINTR == errno) {
+            return 0;
+        }
+        LOC_LOGE("%s:%d] epoll_wait failed: %s\n", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (events[i].data.fd == loc_api_server_unblockfd) {
+            uint64_t count;
+            if (read(loc_api_server_unblockfd, &count, sizeof(count)) < 0) {
+                LOC_LOGD("%s:%d] unblock read: %s\n", __func__, __LINE__, strerror(errno));
+            }
+            LOC_LOGD("%s:%d] GPSONE_UNBLOCK\n", __func__, __LINE__);
+            continue;
+        }
+
+        // a bad datagram is dropped by sockrcv, the next one still counts
+        while ((length = loc_eng_dmn_conn_glue_sockrcv(loc_api_server_sockfd, p_cmsgbuf,
+                                                       sizeof(loc_api_server_rcv_buf))) != 0) {
+            if (length > 0) {
+                loc_api_server_dispatch(p_cmsgbuf, length);
+            }
+        }
+    }
+    return 0;
+}
+
+static int loc_api_server_sock_proc_post(void *context)
+{
+    LOC_LOGD("%s:%d]\n", __func__, __LINE__);
+    loc_eng_dmn_conn_glue_sockremove(GPSONE_LOC_API_SOCK_PATH, loc_api_server_sockfd);
+    loc_api_server_sockfd = -1;
+    if (loc_api_server_epollfd >= 0) {
+        close(loc_api_server_epollfd);
+        loc_api_server_epollfd = -1;
+    }
+    if (loc_api_server_unblockfd >= 0) {
+        close(loc_api_server_unblockfd);
+        loc_api_server_unblockfd = -1;
+    }
+    return 0;
+}
+
+static int loc_eng_dmn_conn_sock_unblock_proc(void)
+{
+    uint64_t one = 1;
+    LOC_LOGD("%s:%d]\n", __func__, __LINE__);
+    if (write(loc_api_server_unblockfd, &one, sizeof(one)) < 0) {
+        LOC_LOGE("%s:%d] failed: %s\n", __func__, __LINE__, strerror(errno));
+    }
+    return 0;
+}
+
 static struct loc_eng_dmn_conn_thelper thelper;
 
 int loc_eng_dmn_conn_loc_api_server_launch(thelper_create_thread   create_thread_cb,
-    const char * loc_api_q_path, const char * resp_q_path, void *agps_handle)
+    const char * loc_api_q_path, const char * resp_q_path, void *agps_handle,
+    loc_eng_dmn_conn_transport_e_type transport)
 {
     int result;
 
     loc_api_handle = agps_handle;
-
-    if (loc_api_q_path) global_loc_api_q_path = loc_api_q_path;
-    if (resp_q_path)    global_loc_api_resp_q_path = resp_q_path;
-
-    result = loc_eng_dmn_conn_launch_thelper( &thelper,
-        loc_api_server_proc_init,
-        loc_api_server_proc_pre,
-        loc_api_server_proc,
-        loc_api_server_proc_post,
-        create_thread_cb,
-        (char *) global_loc_api_q_path);
+    dmn_conn_transport = transport;
+
+    if (LOC_ENG_DMN_CONN_SOCKET == transport) {
+        result = loc_eng_dmn_conn_launch_thelper( &thelper,
+            loc_api_server_sock_proc_init,
+            loc_api_server_proc_pre,
+            loc_api_server_sock_proc,
+            loc_api_server_sock_proc_post,
+            create_thread_cb,
+            (char *) GPSONE_LOC_API_SOCK_PATH);
+    } else {
+        bool batched = (LOC_ENG_DMN_CONN_FIFO_BATCHED == transport);
+
+        if (loc_api_q_path) global_loc_api_q_path = loc_api_q_path;
+        if (resp_q_path)    global_loc_api_resp_q_path = resp_q_path;
+
+        result = loc_eng_dmn_conn_launch_thelper( &thelper,
+            batched ? loc_api_server_batch_proc_init : loc_api_server_proc_init,
+            loc_api_server_proc_pre,
+            batched ? loc_api_server_batch_proc : loc_api_server_proc,
+            loc_api_server_proc_post,
+            create_thread_cb,
+            (char *) global_loc_api_q_path);
+    }
     if (result != 0) {
         LOC_LOGE("%s:%d]\n", __func__, __LINE__);
         return -1;
@@ -213,7 +378,11 @@ int loc_eng_dmn_conn_loc_api_server_launch(thelper_create_thread   create_thread
 int loc_eng_dmn_conn_loc_api_server_unblock(void)
 {
     loc_eng_dmn_conn_unblock_thelper(&thelper);
-    loc_eng_dmn_conn_unblock_proc();
+    if (LOC_ENG_DMN_CONN_SOCKET == dmn_conn_transport) {
+        loc_eng_dmn_conn_sock_unblock_proc();
+    } else {
+        loc_eng_dmn_conn_unblock_proc();
+    }
     return 0;
 }
 
@@ -223,11 +392,134 @@ int loc_eng_dmn_conn_loc_api_server_join(void)
     return 0;
 }
 
+static int loc_eng_dmn_conn_sock_data_conn(int sender_id, struct ctrl_msgbuf * cmsgbuf) {
+  const char * peer_path;
+  switch (sender_id) {
+    case LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC:
+      peer_path = QUIPC_CTRL_SOCK_PATH;
+      break;
+    case LOC_ENG_IF_REQUEST_SENDER_ID_MSAPM:
+      peer_path = MSAPM_CTRL_SOCK_PATH;
+      break;
+    case LOC_ENG_IF_REQUEST_SENDER_ID_MSAPU:
+      peer_path = MSAPU_CTRL_SOCK_PATH;
+      break;
+    case LOC_ENG_IF_REQUEST_SENDER_ID_GPSONE_DAEMON:
+      peer_path = GPSONE_LOC_API_RESP_SOCK_PATH;
+      break;
+    default:
+      LOC_LOGD("%s:%d] invalid sender ID!", __func__, __LINE__);
+      return 0;
+  }
+  if (loc_eng_dmn_conn_glue_socksnd(loc_api_server_sockfd, peer_path,
+                                    cmsgbuf, sizeof(struct ctrl_msgbuf)) < 0) {
+    uint32_t drops = __sync_add_and_fetch(&loc_api_server_sock_drops, 1);
+    LOC_LOGE("%s:%d] response %d to sender_id %d dropped, %u so far\n",
+             __func__, __LINE__, cmsgbuf->cmsg.cmsg_response.result, sender_id, drops);
+    return -1;
+  }
+  return 0;
+}
+
+static int loc_eng_dmn_conn_sender_msgqid(int sender_id) {
+  switch (sender_id) {
+    case LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC:
+      return quipc_msgqid;
+    case LOC_ENG_IF_REQUEST_SENDER_ID_MSAPM:
+      return msapm_msgqid;
+    case LOC_ENG_IF_REQUEST_SENDER_ID_MSAPU:
+      return msapu_msgqid;
+    case LOC_ENG_IF_REQUEST_SENDER_ID_GPSONE_DAEMON:
+      return loc_api_resp_msgqid;
+    default:
+      return -1;
+  }
+}
+
+// dmn_conn_out_lock held
+static int loc_eng_dmn_conn_outq_flush(int sender_id) {
+  struct dmn_conn_outq * q = &dmn_conn_outqs[sender_id];
+  void * msgps[DMN_CONN_OUTQ_SIZE];
+  size_t msgszs[DMN_CONN_OUTQ_SIZE];
+  int i, result = 0;
+
+  if (q->count > 0) {
+    for (i = 0; i < q->count; i++) {
+      msgps[i] = &q->msgs[i];
+      msgszs[i] = sizeof(struct ctrl_msgbuf);
+    }
+    LOC_LOGD("%s:%d] sender_id = %d, %d msgs\n", __func__, __LINE__, sender_id, q->count);
+    result = loc_eng_dmn_conn_glue_msgsnd_batch(loc_eng_dmn_conn_sender_msgqid(sender_id),
+                                                msgps, msgszs, q->count);
+    q->count = 0;
+  }
+  return result < 0 ? -1 : 0;
+}
+
+static int loc_eng_dmn_conn_batch_data_conn(int sender_id, struct ctrl_msgbuf * cmsgbuf) {
+  int result = 0;
+
+  if (loc_eng_dmn_conn_sender_msgqid(sender_id) < 0) {
+    LOC_LOGD("%s:%d] invalid sender ID!", __func__, __LINE__);
+    return 0;
+  }
+
+  pthread_mutex_lock(&dmn_conn_out_lock);
+  struct dmn_conn_outq * q = &dmn_conn_outqs[sender_id];
+  if (DMN_CONN_OUTQ_SIZE == q->count) {
+    result = loc_eng_dmn_conn_outq_flush(sender_id);
+  }
+  q->msgs[q->count++] = *cmsgbuf;
+  if (0 == dmn_conn_corked) {
+    // keep the error of the flush that made room, if it failed
+    int flushed = loc_eng_dmn_conn_outq_flush(sender_id);
+    if (0 == result) {
+      result = flushed;
+    }
+  }
+  pthread_mutex_unlock(&dmn_conn_out_lock);
+
+  if (result < 0) {
+    LOC_LOGE("%s:%d] error! conn_glue_msgsnd_batch failed for sender_id %d\n",
+             __func__, __LINE__, sender_id);
+  }
+  return result;
+}
+
+void loc_eng_dmn_conn_loc_api_server_cork(void) {
+  if (LOC_ENG_DMN_CONN_FIFO_BATCHED == dmn_conn_transport) {
+    pthread_mutex_lock(&dmn_conn_out_lock);
+    dmn_conn_corked++;
+    pthread_mutex_unlock(&dmn_conn_out_lock);
+  }
+}
+
+void loc_eng_dmn_conn_loc_api_server_uncork(void) {
+  if (LOC_ENG_DMN_CONN_FIFO_BATCHED == dmn_conn_transport) {
+    pthread_mutex_lock(&dmn_conn_out_lock);
+    if (dmn_conn_corked > 0 && 0 == --dmn_conn_corked) {
+      for (int i = 0; i < LOC_ENG_IF_REQUEST_SENDER_ID_MODEM; i++) {
+        if (loc_eng_dmn_conn_outq_flush(i) < 0) {
+          LOC_LOGE("%s:%d] error! conn_glue_msgsnd_batch failed for sender_id %d\n",
+                   __func__, __LINE__, i);
+        }
+      }
+    }
+    pthread_mutex_unlock(&dmn_conn_out_lock);
+  }
+}
+
 int loc_eng_dmn_conn_loc_api_server_data_conn(int sender_id, int status) {
   struct ctrl_msgbuf cmsgbuf;
   LOC_LOGD("%s:%d] quipc_msgqid = %d\n", __func__, __LINE__, quipc_msgqid);
   cmsgbuf.ctrl_type = GPSONE_LOC_API_RESPONSE;
   cmsgbuf.cmsg.cmsg_response.result = status;
+  if (LOC_ENG_DMN_CONN_SOCKET == dmn_conn_transport) {
+    return loc_eng_dmn_conn_sock_data_conn(sender_id, &cmsgbuf);
+  }
+  if (LOC_ENG_DMN_CONN_FIFO_BATCHED == dmn_conn_transport) {
+    return loc_eng_dmn_conn_batch_data_conn(sender_id, &cmsgbuf);
+  }
   switch (sender_id) {
     case LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC: {
       LOC_LOGD("%s:%d] sender_id = LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC", __func__, __LINE__);
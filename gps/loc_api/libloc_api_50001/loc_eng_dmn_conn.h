@@ -39,6 +39,12 @@
 #define MSAPM_CTRL_Q_PATH "/data/misc/gpsone_d/msapm_ctrl_q"
 #define MSAPU_CTRL_Q_PATH "/data/misc/gpsone_d/msapu_ctrl_q"
 
+#define GPSONE_LOC_API_SOCK_PATH "/data/misc/gpsone_d/gpsone_loc_api_s"
+#define GPSONE_LOC_API_RESP_SOCK_PATH "/data/misc/gpsone_d/gpsone_loc_api_resp_s"
+#define QUIPC_CTRL_SOCK_PATH "/data/misc/gpsone_d/quipc_ctrl_s"
+#define MSAPM_CTRL_SOCK_PATH "/data/misc/gpsone_d/msapm_ctrl_s"
+#define MSAPU_CTRL_SOCK_PATH "/data/misc/gpsone_d/msapu_ctrl_s"
+
 #else
 
 #define GPSONE_LOC_API_Q_PATH "/tmp/gpsone_loc_api_q"
@@ -47,13 +53,37 @@
 #define MSAPM_CTRL_Q_PATH "/tmp/msapm_ctrl_q"
 #define MSAPU_CTRL_Q_PATH "/tmp/msapu_ctrl_q"
 
+#define GPSONE_LOC_API_SOCK_PATH "/tmp/gpsone_loc_api_s"
+#define GPSONE_LOC_API_RESP_SOCK_PATH "/tmp/gpsone_loc_api_resp_s"
+#define QUIPC_CTRL_SOCK_PATH "/tmp/quipc_ctrl_s"
+#define MSAPM_CTRL_SOCK_PATH "/tmp/msapm_ctrl_s"
+#define MSAPU_CTRL_SOCK_PATH "/tmp/msapu_ctrl_s"
+
 #endif
 
+/* How the HAL and gpsone_daemon, QuIPC and MSAP talk; both ends must
+   agree. Either way a message is one ctrl_msgbuf.
+   FIFO: a named pipe per direction and per client, all made here.
+   SOCKET: UNIX datagram sockets. The HAL binds only its request socket
+   and sends each response to the socket its client has bound.
+   FIFO_BATCHED: the FIFO pipes, read with readv as many messages at a
+   time as there are, and written with writev as many responses at a
+   time as are held between cork and uncork. */
+typedef enum {
+    LOC_ENG_DMN_CONN_FIFO = 0,
+    LOC_ENG_DMN_CONN_SOCKET,
+    LOC_ENG_DMN_CONN_FIFO_BATCHED
+} loc_eng_dmn_conn_transport_e_type;
+
 int loc_eng_dmn_conn_loc_api_server_launch(thelper_create_thread   create_thread_cb,
-    const char * loc_api_q_path, const char * ctrl_q_path, void *agps_handle);
+    const char * loc_api_q_path, const char * ctrl_q_path, void *agps_handle,
+    loc_eng_dmn_conn_transport_e_type transport);
 int loc_eng_dmn_conn_loc_api_server_unblock(void);
 int loc_eng_dmn_conn_loc_api_server_join(void);
 int loc_eng_dmn_conn_loc_api_server_data_conn(int, int);
+/* nestable; a no-op but with LOC_ENG_DMN_CONN_FIFO_BATCHED */
+void loc_eng_dmn_conn_loc_api_server_cork(void);
+void loc_eng_dmn_conn_loc_api_server_uncork(void);
 
 #endif /* LOC_ENG_DATA_SERVER_H */
 
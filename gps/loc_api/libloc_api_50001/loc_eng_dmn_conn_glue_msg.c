@@ -28,6 +28,7 @@
  */
 #include <linux/stat.h>
 #include <fcntl.h>
+#include <string.h>
 
 #include <linux/types.h>
 
@@ -221,3 +222,173 @@ int loc_eng_dmn_conn_glue_msgflush(int msgqid)
     return length;
 }
 
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_msgring_init
+
+DESCRIPTION
+   empty a ring for loc_eng_dmn_conn_glue_msgrcv_batch
+
+   ring - the ring
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_dmn_conn_glue_msgring_init(struct loc_eng_dmn_conn_glue_msgring * ring)
+{
+    ring->head = 0;
+    ring->fill = 0;
+}
+
+/* messages per writev in loc_eng_dmn_conn_glue_msgsnd_batch */
+#define GLUE_MSG_IOV_MAX 16
+
+// copies the first len bytes of the ring, which may wrap around
+static void msgring_peek(const struct loc_eng_dmn_conn_glue_msgring * ring,
+                         void * dst, size_t len)
+{
+    unsigned int start = ring->head;
+    size_t first = LOC_ENG_DMN_CONN_GLUE_RING_SIZE - start;
+
+    if (first > len) first = len;
+    memcpy(dst, ring->ring + start, first);
+    memcpy((uint8_t *) dst + first, ring->ring, len - first);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_msgrcv_batch
+
+DESCRIPTION
+   receive every message there is, with one readv, and hand each
+   complete one to cb. A message cut short by the read stays in the
+   ring until the rest of it is read. A msgsz that cannot be right means
+   the framing is lost, and all that is buffered is dropped.
+
+   msgqid - message queue id
+   ring - buffer for what is read, kept from one call to the next
+   msgp - buffer to hand each message to cb in
+   msgbufsz - size of msgp, at most LOC_ENG_DMN_CONN_GLUE_RING_SIZE
+   cb - called for each message
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of messages handed to cb or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_msgrcv_batch(int msgqid,
+                                       struct loc_eng_dmn_conn_glue_msgring * ring,
+                                       void * msgp, size_t msgbufsz,
+                                       loc_eng_dmn_conn_glue_msg_cb cb)
+{
+    const unsigned int mask = LOC_ENG_DMN_CONN_GLUE_RING_SIZE - 1;
+    unsigned int tail = (ring->head + ring->fill) & mask;
+    unsigned int space = LOC_ENG_DMN_CONN_GLUE_RING_SIZE - ring->fill;
+    struct iovec iov[2];
+    size_t msgsz;
+    int len, count = 0;
+
+    if (msgbufsz > LOC_ENG_DMN_CONN_GLUE_RING_SIZE) {
+        LOC_LOGE("%s:%d] msgbuf is larger than the ring %d\n", __func__, __LINE__, (int) msgbufsz);
+        return -1;
+    }
+
+    // the free space, in one piece or wrapped around in two
+    iov[0].iov_base = ring->ring + tail;
+    iov[0].iov_len = (tail + space <= LOC_ENG_DMN_CONN_GLUE_RING_SIZE) ?
+                     space : LOC_ENG_DMN_CONN_GLUE_RING_SIZE - tail;
+    iov[1].iov_base = ring->ring;
+    iov[1].iov_len = space - iov[0].iov_len;
+
+    len = loc_eng_dmn_conn_glue_pipereadv(msgqid, iov, iov[1].iov_len ? 2 : 1);
+    if (len <= 0) {
+        LOC_LOGE("%s:%d] pipe broken %d\n", __func__, __LINE__, len);
+        return -1;
+    }
+    ring->fill += len;
+
+    while (ring->fill >= sizeof(msgsz)) {
+        msgring_peek(ring, &msgsz, sizeof(msgsz));
+        if (msgsz < sizeof(msgsz) || msgsz > msgbufsz) {
+            LOC_LOGE("%s:%d] bad msgsz = %d, dropping %d bytes\n", __func__, __LINE__,
+                     (int) msgsz, (int) ring->fill);
+            loc_eng_dmn_conn_glue_msgring_init(ring);
+            return -1;
+        }
+        if (ring->fill < msgsz) {
+            break;
+        }
+
+        msgring_peek(ring, msgp, msgsz);
+        ring->head = (ring->head + msgsz) & mask;
+        ring->fill -= msgsz;
+        cb(msgp, msgsz);
+        count++;
+    }
+
+    if (0 == ring->fill) {
+        ring->head = 0;
+    }
+    return count;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_msgsnd_batch
+
+DESCRIPTION
+   send messages, in order, with one writev for up to GLUE_MSG_IOV_MAX
+   of them
+
+   msgqid - message queue id
+   msgps - pointers to the messages to be sent
+   msgszs - sizes of the messages
+   count - number of messages
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of bytes sent out or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_msgsnd_batch(int msgqid, void * const * msgps,
+                                       const size_t * msgszs, int count)
+{
+    struct iovec iov[GLUE_MSG_IOV_MAX];
+    int i, j, n, result, total = 0;
+
+    for (i = 0; i < count; i += n) {
+        n = count - i;
+        if (n > GLUE_MSG_IOV_MAX) n = GLUE_MSG_IOV_MAX;
+
+        for (j = 0; j < n; j++) {
+            struct ctrl_msgbuf *pmsg = (struct ctrl_msgbuf *) msgps[i + j];
+            pmsg->msgsz = msgszs[i + j];
+            iov[j].iov_base = pmsg;
+            iov[j].iov_len = msgszs[i + j];
+        }
+
+        result = loc_eng_dmn_conn_glue_pipewritev(msgqid, iov, n);
+        if (result < 0) {
+            LOC_LOGE("%s:%d] pipe broken %d, %d msgs not sent\n", __func__, __LINE__,
+                     result, count - i);
+            return -1;
+        }
+        total += result;
+    }
+
+    return total;
+}
@@ -34,6 +34,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 
+#include <stdint.h>
 #include <linux/types.h>
 #include "loc_eng_dmn_conn_glue_pipe.h"
 
@@ -44,6 +45,28 @@ int loc_eng_dmn_conn_glue_msgrcv(int msgqid, void *msgp, size_t msgsz);
 int loc_eng_dmn_conn_glue_msgflush(int msgqid);
 int loc_eng_dmn_conn_glue_msgunblock(int msgqid);
 
+/* Batched mode, same pipes and framing. The reader takes in as many
+   messages per readv as its ring holds and hands each complete one to
+   a callback, keeping a partial one for the next read. The writer puts
+   any number of messages out with one writev. */
+#define LOC_ENG_DMN_CONN_GLUE_RING_SIZE 4096   /* power of 2 */
+
+struct loc_eng_dmn_conn_glue_msgring {
+    uint8_t ring[LOC_ENG_DMN_CONN_GLUE_RING_SIZE];
+    unsigned int head;     /* offset of the first byte not handed out */
+    unsigned int fill;     /* bytes buffered from head on */
+};
+
+typedef void (*loc_eng_dmn_conn_glue_msg_cb)(void * msgp, int len);
+
+void loc_eng_dmn_conn_glue_msgring_init(struct loc_eng_dmn_conn_glue_msgring * ring);
+int loc_eng_dmn_conn_glue_msgrcv_batch(int msgqid,
+                                       struct loc_eng_dmn_conn_glue_msgring * ring,
+                                       void * msgp, size_t msgbufsz,
+                                       loc_eng_dmn_conn_glue_msg_cb cb);
+int loc_eng_dmn_conn_glue_msgsnd_batch(int msgqid, void * const * msgps,
+                                       const size_t * msgszs, int count);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -179,6 +179,88 @@ int loc_eng_dmn_conn_glue_piperead(int fd, void * buf, size_t sz)
     return len;
 }
 
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_pipewritev
+
+DESCRIPTION
+   write the buffers of iov to a pipe, in order, with as few writev as
+   the pipe allows. iov is used up in the process.
+
+   fd - fd of a pipe
+   iov - buffers to write
+   iovcnt - number of buffers, at most IOV_MAX
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of bytes written or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_pipewritev(int fd, struct iovec * iov, int iovcnt)
+{
+    int total = 0;
+
+    while (iovcnt > 0) {
+        ssize_t result = writev(fd, iov, iovcnt);
+        if (result < 0) {
+            if (EINTR == errno) {
+                continue;
+            }
+            LOC_LOGE("%s:%d] failed: %s\n", __func__, __LINE__, strerror(errno));
+            return -1;
+        }
+        total += result;
+
+        // a short write leaves the rest of iov for the next round
+        while (iovcnt > 0 && (size_t) result >= iov->iov_len) {
+            result -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + result;
+            iov->iov_len -= result;
+        }
+    }
+    return total;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_pipereadv
+
+DESCRIPTION
+   read from a pipe into the buffers of iov, in order. Blocks until there
+   is something to read, then takes in as much of it as fits.
+
+   fd - fd for the pipe
+   iov - buffers to fill
+   iovcnt - number of buffers
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of bytes read from pipe or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_pipereadv(int fd, const struct iovec * iov, int iovcnt)
+{
+    ssize_t len;
+
+    do {
+        len = readv(fd, iov, iovcnt);
+    } while (len < 0 && EINTR == errno);
+
+    return len;
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_dmn_conn_glue_pipeunblock
 
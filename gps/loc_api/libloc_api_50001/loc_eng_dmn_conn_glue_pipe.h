@@ -34,11 +34,14 @@ extern "C" {
 #endif /* __cplusplus */
 
 #include <linux/types.h>
+#include <sys/uio.h>
 
 int loc_eng_dmn_conn_glue_pipeget(const char * pipe_name, int mode);
 int loc_eng_dmn_conn_glue_piperemove(const char * pipe_name, int fd);
 int loc_eng_dmn_conn_glue_pipewrite(int fd, const void * buf, size_t sz);
 int loc_eng_dmn_conn_glue_piperead(int fd, void * buf, size_t sz);
+int loc_eng_dmn_conn_glue_pipewritev(int fd, struct iovec * iov, int iovcnt);
+int loc_eng_dmn_conn_glue_pipereadv(int fd, const struct iovec * iov, int iovcnt);
 
 int loc_eng_dmn_conn_glue_pipeflush(int fd);
 int loc_eng_dmn_conn_glue_pipeunblock(int fd);
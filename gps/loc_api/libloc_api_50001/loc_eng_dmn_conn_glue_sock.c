@@ -0,0 +1,232 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "loc_eng_dmn_conn_glue_sock.h"
+#include "loc_eng_dmn_conn_handler.h"
+#include "log_util.h"
+#include "platform_lib_includes.h"
+
+static int sock_addr(struct sockaddr_un * addr, const char * sock_path)
+{
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(sock_path) >= sizeof(addr->sun_path)) {
+        LOC_LOGE("%s:%d] path too long: %s\n", __func__, __LINE__, sock_path);
+        return -1;
+    }
+    strlcpy(addr->sun_path, sock_path, sizeof(addr->sun_path));
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockget
+
+DESCRIPTION
+   create a non blocking UNIX datagram socket bound to sock_path, in
+   place of whatever was there
+
+   sock_path - socket path
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   socket fd or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockget(const char * sock_path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (sock_addr(&addr, sock_path) < 0) {
+        return -1;
+    }
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOC_LOGE("%s:%d] socket failed: %s\n", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+
+    unlink(sock_path);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        LOC_LOGE("%s:%d] bind %s failed: %s\n", __func__, __LINE__,
+                 sock_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (chmod(sock_path, 0660) != 0) {
+        LOC_LOGE("%s:%d] failed to change mode for %s, error = %s\n", __func__, __LINE__,
+                 sock_path, strerror(errno));
+    }
+
+    LOC_LOGD("fd = %d, %s\n", fd, sock_path);
+    return fd;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockremove
+
+DESCRIPTION
+   close a socket and remove its path
+
+   sock_path - socket path
+   fd - socket fd
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   0: success
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockremove(const char * sock_path, int fd)
+{
+    if (fd >= 0) close(fd);
+    if (sock_path) unlink(sock_path);
+    LOC_LOGD("fd = %d, %s\n", fd, sock_path);
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_socksnd
+
+DESCRIPTION
+   send a message to the socket bound to peer_path, without blocking.
+   A peer whose receive queue is full, or that is not there, fails it
+   at once; this runs on the MsgTask, which cannot wait for a peer.
+
+   fd - socket fd to send from
+   peer_path - path the peer socket is bound to
+   msgp - pointer to the message to be sent
+   msgsz - size of the message
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of bytes sent out or negative value for failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_socksnd(int fd, const char * peer_path,
+                                  const void * msgp, size_t msgsz)
+{
+    struct sockaddr_un addr;
+    struct ctrl_msgbuf *pmsg = (struct ctrl_msgbuf *) msgp;
+    int result;
+
+    if (sock_addr(&addr, peer_path) < 0) {
+        return -1;
+    }
+    pmsg->msgsz = msgsz;
+
+    do {
+        result = sendto(fd, msgp, msgsz, MSG_DONTWAIT,
+                        (struct sockaddr *) &addr, sizeof(addr));
+    } while (result < 0 && EINTR == errno);
+
+    if (result != (int) msgsz) {
+        LOC_LOGE("%s:%d] send to %s failed %d, %s\n", __func__, __LINE__,
+                 peer_path, result, strerror(errno));
+        return -1;
+    }
+    return result;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dmn_conn_glue_sockrcv
+
+DESCRIPTION
+   receive a message, if there is one. A datagram larger than the buffer,
+   or whose msgsz is not its length, is dropped.
+
+   fd - socket fd
+   msgp - pointer to the buffer to hold the message
+   msgbufsz - size of the buffer
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   number of bytes received, 0 if there is nothing to receive, or
+   negative value for a dropped message or a failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dmn_conn_glue_sockrcv(int fd, void * msgp, size_t msgbufsz)
+{
+    struct ctrl_msgbuf *pmsg = (struct ctrl_msgbuf *) msgp;
+    int len;
+
+    do {
+        len = recv(fd, msgp, msgbufsz, MSG_DONTWAIT | MSG_TRUNC);
+    } while (len < 0 && EINTR == errno);
+
+    if (len < 0) {
+        if (EAGAIN == errno || EWOULDBLOCK == errno) {
+            return 0;
+        }
+        LOC_LOGE("%s:%d] recv failed: %s\n", __func__, __LINE__, strerror(errno));
+        return -1;
+    }
+
+    if ((size_t) len > msgbufsz) {
+        LOC_LOGE("%s:%d] msgbuf is too small %d < %d\n", __func__, __LINE__,
+                 (int) msgbufsz, len);
+        return -1;
+    }
+
+    if ((size_t) len < sizeof(pmsg->msgsz) || pmsg->msgsz != (size_t) len) {
+        LOC_LOGE("%s:%d] bad msg, length %d\n", __func__, __LINE__, len);
+        return -1;
+    }
+
+    return len;
+}
@@ -0,0 +1,447 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+
+#include <arpa/inet.h>
+#include <limits.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <MsgTask.h>
+#include <loc_eng_dns.h>
+#include "log_util.h"
+#include "platform_lib_includes.h"
+
+using namespace loc_core;
+
+static inline int64_t nowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+typedef struct
+{
+    char     host[LOC_ENG_DNS_HOST_LEN];  // "" if the slot is free
+    time_t   expires;                     // wall clock, as it is persisted
+    bool     has4;
+    bool     has6;
+    uint8_t  in4[4];
+    uint8_t  in6[16];
+} loc_eng_dns_entry_s_type;
+
+struct loc_eng_dns_s
+{
+    pthread_mutex_t lock;
+    uint32_t ttl_sec;                     // 0: no caching
+    const MsgTask* task;
+    char path[PATH_MAX];
+    loc_eng_dns_entry_s_type cache[LOC_ENG_DNS_CACHE_SIZE];
+};
+
+// lock held
+static loc_eng_dns_entry_s_type* dns_find(loc_eng_dns_s_type* dns, const char* host)
+{
+    for (int i = 0; i < LOC_ENG_DNS_CACHE_SIZE; i++) {
+        if (0 == strcmp(dns->cache[i].host, host)) {
+            return &dns->cache[i];
+        }
+    }
+    return NULL;
+}
+
+// lock held; a free slot, or else the one that expires first
+static loc_eng_dns_entry_s_type* dns_slot(loc_eng_dns_s_type* dns)
+{
+    loc_eng_dns_entry_s_type* slot = &dns->cache[0];
+    for (int i = 0; i < LOC_ENG_DNS_CACHE_SIZE; i++) {
+        if ('\0' == dns->cache[i].host[0]) {
+            return &dns->cache[i];
+        }
+        if (dns->cache[i].expires < slot->expires) {
+            slot = &dns->cache[i];
+        }
+    }
+    return slot;
+}
+
+static bool dns_entry_addr(const loc_eng_dns_entry_s_type* entry, int family,
+                           loc_eng_dns_addr_s_type* addr)
+{
+    if (AF_INET == family && entry->has4) {
+        addr->family = AF_INET;
+        memcpy(addr->addr, entry->in4, sizeof(entry->in4));
+        return true;
+    }
+    if (AF_INET6 == family && entry->has6) {
+        addr->family = AF_INET6;
+        memcpy(addr->addr, entry->in6, sizeof(entry->in6));
+        return true;
+    }
+    return false;
+}
+
+/*===========================================================================
+FUNCTION    dns_load
+
+DESCRIPTION
+   Fills the cache from the file dns_save wrote, one entry per line:
+   <expires> <host> <IPv4 address or -> <IPv6 address or ->
+   Expired entries are kept, to be served while they are looked up
+   again.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void dns_load(loc_eng_dns_s_type* dns)
+{
+    FILE* file = fopen(dns->path, "r");
+    if (NULL == file) {
+        return;
+    }
+
+    char line[LOC_ENG_DNS_HOST_LEN + 2 * INET6_ADDRSTRLEN + 32];
+    int count = 0;
+    while (count < LOC_ENG_DNS_CACHE_SIZE && NULL != fgets(line, sizeof(line), file)) {
+        loc_eng_dns_entry_s_type* entry = &dns->cache[count];
+        long long expires;
+        char v4[INET6_ADDRSTRLEN], v6[INET6_ADDRSTRLEN];
+
+        if (4 != sscanf(line, "%lld %255s %45s %45s", &expires, entry->host, v4, v6)) {
+            entry->host[0] = '\0';
+            continue;
+        }
+        entry->expires = (time_t)expires;
+        entry->has4 = (1 == inet_pton(AF_INET, v4, entry->in4));
+        entry->has6 = (1 == inet_pton(AF_INET6, v6, entry->in6));
+        if (entry->has4 || entry->has6) {
+            count++;
+        } else {
+            entry->host[0] = '\0';
+        }
+    }
+    fclose(file);
+    LOC_LOGD("%s:%d]: %d entries from %s", __func__, __LINE__, count, dns->path);
+}
+
+/*===========================================================================
+FUNCTION    dns_save
+
+DESCRIPTION
+   Writes the cache out for the next HAL start, through a temporary file
+   so that a crash never leaves half a cache behind.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void dns_save(loc_eng_dns_s_type* dns)
+{
+    loc_eng_dns_entry_s_type cache[LOC_ENG_DNS_CACHE_SIZE];
+    char tmp[PATH_MAX + 4];
+
+    pthread_mutex_lock(&dns->lock);
+    memcpy(cache, dns->cache, sizeof(cache));
+    pthread_mutex_unlock(&dns->lock);
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", dns->path);
+    FILE* file = fopen(tmp, "w");
+    if (NULL == file) {
+        LOC_LOGW("%s:%d]: cannot write %s", __func__, __LINE__, tmp);
+        return;
+    }
+    for (int i = 0; i < LOC_ENG_DNS_CACHE_SIZE; i++) {
+        char v4[INET6_ADDRSTRLEN] = "-", v6[INET6_ADDRSTRLEN] = "-";
+        if ('\0' == cache[i].host[0]) {
+            continue;
+        }
+        if (cache[i].has4) {
+            inet_ntop(AF_INET, cache[i].in4, v4, sizeof(v4));
+        }
+        if (cache[i].has6) {
+            inet_ntop(AF_INET6, cache[i].in6, v6, sizeof(v6));
+        }
+        fprintf(file, "%lld %s %s %s\n", (long long)cache[i].expires,
+                cache[i].host, v4, v6);
+    }
+    if (0 != fclose(file) || 0 != rename(tmp, dns->path)) {
+        LOC_LOGW("%s:%d]: cannot write %s", __func__, __LINE__, dns->path);
+        unlink(tmp);
+    }
+}
+
+struct LocDnsResolve : public LocMsg {
+    loc_eng_dns_s_type* mDns;
+    char mHost[LOC_ENG_DNS_HOST_LEN];
+    const int mFamily;
+    const loc_eng_dns_cb mCb;
+    void* const mData;
+    inline LocDnsResolve(loc_eng_dns_s_type* dns, const char* host, int family,
+                         loc_eng_dns_cb cb, void* data) :
+        LocMsg(), mDns(dns), mFamily(family), mCb(cb), mData(data)
+    {
+        strlcpy(mHost, host, sizeof(mHost));
+        locallog();
+    }
+    virtual void proc() const;
+    inline void locallog() const {
+        LOC_LOGV("LocDnsResolve - host: %s, family: %d", mHost, mFamily);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+void LocDnsResolve::proc() const {
+    struct addrinfo hints;
+    struct addrinfo* res = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    loc_eng_dns_entry_s_type entry;
+    memset(&entry, 0, sizeof(entry));
+    int64_t start = nowMs();
+    int err = getaddrinfo(mHost, NULL, &hints, &res);
+    if (0 != err) {
+        LOC_LOGE("%s:%d]: %s: %s", __func__, __LINE__, mHost, gai_strerror(err));
+        mCb(mData, mHost, NULL);
+        return;
+    }
+
+    for (struct addrinfo* ai = res; NULL != ai; ai = ai->ai_next) {
+        if (AF_INET == ai->ai_family && !entry.has4) {
+            memcpy(entry.in4, &((struct sockaddr_in*)ai->ai_addr)->sin_addr,
+                   sizeof(entry.in4));
+            entry.has4 = true;
+        } else if (AF_INET6 == ai->ai_family && !entry.has6) {
+            memcpy(entry.in6, &((struct sockaddr_in6*)ai->ai_addr)->sin6_addr,
+                   sizeof(entry.in6));
+            entry.has6 = true;
+        }
+    }
+    freeaddrinfo(res);
+    LOC_LOGD("%s:%d]: %s resolved in %lld ms, IPv4 %d, IPv6 %d", __func__, __LINE__,
+             mHost, (long long)(nowMs() - start), entry.has4, entry.has6);
+
+    bool cached = false;
+    pthread_mutex_lock(&mDns->lock);
+    if (0 != mDns->ttl_sec && (entry.has4 || entry.has6)) {
+        loc_eng_dns_entry_s_type* slot = dns_find(mDns, mHost);
+        if (NULL == slot) {
+            slot = dns_slot(mDns);
+        }
+        strlcpy(entry.host, mHost, sizeof(entry.host));
+        entry.expires = time(NULL) + mDns->ttl_sec;
+        *slot = entry;
+        cached = true;
+    }
+    pthread_mutex_unlock(&mDns->lock);
+    if (cached) {
+        dns_save(mDns);
+    }
+
+    loc_eng_dns_addr_s_type addr;
+    if (dns_entry_addr(&entry, mFamily, &addr)) {
+        mCb(mData, mHost, &addr);
+    } else {
+        LOC_LOGE("%s:%d]: %s has no address of family %d", __func__, __LINE__,
+                 mHost, mFamily);
+        mCb(mData, mHost, NULL);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dns_create
+
+DESCRIPTION
+   Starts the resolver thread and loads the cache kept at cache_path.
+   With a ttl_sec of 0 nothing is cached.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   the resolver, never freed
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+loc_eng_dns_s_type* loc_eng_dns_create(gps_create_thread create_thread_cb,
+                                       const char* cache_path, uint32_t ttl_sec)
+{
+    loc_eng_dns_s_type* dns = new loc_eng_dns_s_type;
+
+    memset(dns->cache, 0, sizeof(dns->cache));
+    pthread_mutex_init(&dns->lock, NULL);
+    dns->ttl_sec = ttl_sec;
+    strlcpy(dns->path, cache_path, sizeof(dns->path));
+    if (0 != ttl_sec) {
+        dns_load(dns);
+    }
+    dns->task = new MsgTask((MsgTask::tCreate)create_thread_cb, "Loc_dns_resolve");
+
+    return dns;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dns_set_ttl
+
+DESCRIPTION
+   Changes how long names are cached for. Entries already cached keep
+   the expiry they have.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_dns_set_ttl(loc_eng_dns_s_type* dns, uint32_t ttl_sec)
+{
+    pthread_mutex_lock(&dns->lock);
+    dns->ttl_sec = ttl_sec;
+    pthread_mutex_unlock(&dns->lock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dns_resolve
+
+DESCRIPTION
+   Finds an address of the given family for host without blocking.
+   A numeric address, or a name cached and not yet expired, is set in
+   addr right away. Otherwise host is looked up on the resolver thread
+   and cb gets the outcome; if the cache had an expired address for it,
+   that address is set in addr in the meantime.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   LOC_ENG_DNS_DONE, LOC_ENG_DNS_STALE, LOC_ENG_DNS_PENDING, or
+   LOC_ENG_DNS_FAILED if host cannot have such an address
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_dns_resolve(loc_eng_dns_s_type* dns, const char* host, int family,
+                        loc_eng_dns_addr_s_type* addr,
+                        loc_eng_dns_cb cb, void* data)
+{
+    if (NULL == host || '\0' == host[0] || strlen(host) >= LOC_ENG_DNS_HOST_LEN ||
+        (AF_INET != family && AF_INET6 != family)) {
+        LOC_LOGE("%s:%d]: bad host %s, family %d", __func__, __LINE__,
+                 host ? host : "(null)", family);
+        return LOC_ENG_DNS_FAILED;
+    }
+
+    uint8_t numeric[16];
+    if (1 == inet_pton(family, host, numeric)) {
+        addr->family = family;
+        memcpy(addr->addr, numeric, AF_INET == family ? 4 : 16);
+        return LOC_ENG_DNS_DONE;
+    }
+    if (1 == inet_pton(AF_INET == family ? AF_INET6 : AF_INET, host, numeric)) {
+        LOC_LOGE("%s:%d]: %s is not of family %d", __func__, __LINE__, host, family);
+        return LOC_ENG_DNS_FAILED;
+    }
+
+    int ret = LOC_ENG_DNS_PENDING;
+    pthread_mutex_lock(&dns->lock);
+    if (0 != dns->ttl_sec) {
+        loc_eng_dns_entry_s_type* entry = dns_find(dns, host);
+        if (NULL != entry) {
+            bool fresh = time(NULL) < entry->expires;
+            if (dns_entry_addr(entry, family, addr)) {
+                ret = fresh ? LOC_ENG_DNS_DONE : LOC_ENG_DNS_STALE;
+            } else if (fresh) {
+                ret = LOC_ENG_DNS_FAILED;
+            }
+        }
+    }
+    pthread_mutex_unlock(&dns->lock);
+
+    if (LOC_ENG_DNS_FAILED == ret) {
+        LOC_LOGE("%s:%d]: %s has no address of family %d", __func__, __LINE__,
+                 host, family);
+    } else if (LOC_ENG_DNS_DONE != ret) {
+        dns->task->sendMsg(new LocDnsResolve(dns, host, family, cb, data));
+    }
+    LOC_LOGD("%s:%d]: %s: %d", __func__, __LINE__, host, ret);
+    return ret;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_dns_addr_str
+
+DESCRIPTION
+   Formats addr for the logs.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   buf
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+const char* loc_eng_dns_addr_str(const loc_eng_dns_addr_s_type* addr,
+                                 char* buf, int size)
+{
+    if (NULL == inet_ntop(addr->family, addr->addr, buf, size)) {
+        strlcpy(buf, "?", size);
+    }
+    return buf;
+}
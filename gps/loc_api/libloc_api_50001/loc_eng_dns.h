@@ -0,0 +1,90 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_DNS_H
+#define LOC_ENG_DNS_H
+
+#include <stdint.h>
+#include <hardware/gps.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Server name resolution
+
+   getaddrinfo() runs on a resolver thread of its own, so whoever sets a
+   server never waits on the network. Resolved names are kept for
+   ttl_sec, in memory and in a file, so that after a HAL restart a
+   server is usually known before any lookup is done. A name whose entry
+   has expired is still served from the cache while it is looked up
+   again. IPv4 and IPv6 addresses are both kept. */
+
+#define LOC_ENG_DNS_HOST_LEN 256
+#define LOC_ENG_DNS_CACHE_SIZE 16
+
+#ifdef _ANDROID_
+#define LOC_ENG_DNS_CACHE_PATH "/data/misc/gpsone_d/dns_cache"
+#else
+#define LOC_ENG_DNS_CACHE_PATH "/tmp/loc_dns_cache"
+#endif
+
+typedef struct
+{
+    int     family;     // AF_INET or AF_INET6
+    uint8_t addr[16];   // network order, 4 bytes used for AF_INET
+} loc_eng_dns_addr_s_type;
+
+enum {
+    LOC_ENG_DNS_FAILED = -1,
+    LOC_ENG_DNS_DONE,       // addr set, cb will not be called
+    LOC_ENG_DNS_STALE,      // addr set from an expired entry, cb will be called
+    LOC_ENG_DNS_PENDING     // cb will be called
+};
+
+/* runs on the resolver thread; addr is NULL if host has no address of
+   the family asked for */
+typedef void (*loc_eng_dns_cb)(void* data, const char* host,
+                               const loc_eng_dns_addr_s_type* addr);
+
+typedef struct loc_eng_dns_s loc_eng_dns_s_type;
+
+loc_eng_dns_s_type* loc_eng_dns_create(gps_create_thread create_thread_cb,
+                                       const char* cache_path, uint32_t ttl_sec);
+void loc_eng_dns_set_ttl(loc_eng_dns_s_type* dns, uint32_t ttl_sec);
+int  loc_eng_dns_resolve(loc_eng_dns_s_type* dns, const char* host, int family,
+                         loc_eng_dns_addr_s_type* addr,
+                         loc_eng_dns_cb cb, void* data);
+const char* loc_eng_dns_addr_str(const loc_eng_dns_addr_s_type* addr,
+                                 char* buf, int size);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // LOC_ENG_DNS_H
@@ -0,0 +1,206 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng"
+#include <math.h>
+#include <loc_eng_fix_filter.h>
+#include "log_util.h"
+
+#define EARTH_RADIUS_M 6371000.0
+#define DEG_TO_RAD (M_PI / 180.0)
+
+/*===========================================================================
+FUNCTION    fix_filter_distance
+
+DESCRIPTION
+   Distance in meters between two points, on a flat earth around the
+   first one. Good to well under a meter at the distances the filter
+   compares, and cheaper than the haversine.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   meters
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static double fix_filter_distance(double lat1, double lon1, double lat2, double lon2)
+{
+   double dlon = lon2 - lon1;
+   // the short way around the antimeridian
+   if (dlon > 180.0) {
+      dlon -= 360.0;
+   } else if (dlon < -180.0) {
+      dlon += 360.0;
+   }
+   double x = dlon * DEG_TO_RAD * cos(lat1 * DEG_TO_RAD);
+   double y = (lat2 - lat1) * DEG_TO_RAD;
+   return EARTH_RADIUS_M * sqrt(x * x + y * y);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_fix_filter_config
+
+DESCRIPTION
+   Sets the filter up with new settings, and starts the counters and the
+   session over.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_fix_filter_config(loc_eng_fix_filter_s_type* filter, uint32_t min_interval_ms,
+                               double min_distance_m, bool coalesce)
+{
+   filter->min_interval_ms = min_interval_ms;
+   filter->min_distance_m = min_distance_m;
+   filter->coalesce = coalesce;
+   filter->delivered = 0;
+   filter->suppressed = 0;
+   loc_eng_fix_filter_reset(filter);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_fix_filter_reset
+
+DESCRIPTION
+   Forgets the last delivered fix, so that the next one goes through.
+   Called when a session starts.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_fix_filter_reset(loc_eng_fix_filter_s_type* filter)
+{
+   filter->has_last = false;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_fix_filter_pass
+
+DESCRIPTION
+   Decides whether a successful or intermediate fix is delivered, and
+   counts it either way. A fix without a position only goes through the
+   interval check, and one stamped before the last delivered fix passes
+   it, so that a time correction cannot hold fixes back.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   true if the fix is to be reported
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+bool loc_eng_fix_filter_pass(loc_eng_fix_filter_s_type* filter,
+                             const GpsLocation& location, bool intermediate)
+{
+   bool has_position = (location.flags & GPS_LOCATION_HAS_LAT_LONG) != 0;
+   float accuracy = (location.flags & GPS_LOCATION_HAS_ACCURACY) ? location.accuracy : 0;
+
+   if (filter->has_last) {
+      bool pass = true;
+
+      if (filter->coalesce && intermediate &&
+          (0 == accuracy ||
+           (0 != filter->last_accuracy && accuracy >= filter->last_accuracy))) {
+         pass = false;
+      }
+      if (pass && 0 != filter->min_interval_ms &&
+          location.timestamp >= filter->last_timestamp &&
+          location.timestamp - filter->last_timestamp < filter->min_interval_ms) {
+         pass = false;
+      }
+      if (pass && 0 != filter->min_distance_m &&
+          has_position && filter->last_has_position &&
+          fix_filter_distance(filter->last_latitude, filter->last_longitude,
+                              location.latitude, location.longitude) <
+          filter->min_distance_m) {
+         pass = false;
+      }
+
+      if (!pass) {
+         filter->suppressed++;
+         return false;
+      }
+   }
+
+   filter->has_last = true;
+   filter->last_timestamp = location.timestamp;
+   filter->last_has_position = has_position;
+   filter->last_latitude = location.latitude;
+   filter->last_longitude = location.longitude;
+   filter->last_accuracy = accuracy;
+   filter->delivered++;
+   return true;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_fix_filter_log
+
+DESCRIPTION
+   Logs the settings and the counters, for tuning the settings.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_fix_filter_log(const loc_eng_fix_filter_s_type* filter)
+{
+   LOC_LOGI("%s: interval %u ms, distance %.1f m, coalesce %d: "
+            "%llu fixes delivered, %llu suppressed", __func__,
+            filter->min_interval_ms, filter->min_distance_m, filter->coalesce,
+            (unsigned long long)filter->delivered,
+            (unsigned long long)filter->suppressed);
+}
@@ -0,0 +1,80 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_FIX_FILTER_H
+#define LOC_ENG_FIX_FILTER_H
+
+#include <stdint.h>
+#include <hardware/gps.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Fix delivery filter
+
+   Sits in front of location_cb and the NMEA generated for a fix. A fix
+   is dropped when it comes less than min_interval_ms after, or less than
+   min_distance_m away from, the last fix delivered in the session. With
+   coalesce set, an intermediate fix is also dropped unless it is more
+   accurate than the last one delivered. The first fix of a session
+   always goes through. Each loc_eng client has its own filter. */
+
+typedef struct loc_eng_fix_filter_s
+{
+    // settings, 0 is off
+    uint32_t   min_interval_ms;
+    double     min_distance_m;
+    bool       coalesce;
+
+    // last fix delivered in this session
+    bool       has_last;
+    GpsUtcTime last_timestamp;
+    bool       last_has_position;
+    double     last_latitude;
+    double     last_longitude;
+    float      last_accuracy;   // 0 if the fix had none
+
+    // since the filter was configured
+    uint64_t   delivered;
+    uint64_t   suppressed;
+} loc_eng_fix_filter_s_type;
+
+void loc_eng_fix_filter_config(loc_eng_fix_filter_s_type* filter, uint32_t min_interval_ms,
+                               double min_distance_m, bool coalesce);
+void loc_eng_fix_filter_reset(loc_eng_fix_filter_s_type* filter);
+bool loc_eng_fix_filter_pass(loc_eng_fix_filter_s_type* filter,
+                             const GpsLocation& location, bool intermediate);
+void loc_eng_fix_filter_log(const loc_eng_fix_filter_s_type* filter);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif // LOC_ENG_FIX_FILTER_H
@@ -38,6 +38,7 @@
 #include <loc_eng_log.h>
 #include <loc_eng.h>
 #include <MsgTask.h>
+#include <LocMsgPool.h>
 #include <LocEngAdapter.h>
 
 #ifndef SSID_BUF_SIZE
@@ -97,6 +98,9 @@ struct LocEngReportPosition : public LocMsg {
                          void* locExt,
                          enum loc_sess_status st,
                          LocPosTechMask technology);
+    // releases mLocation.rawData, which we own once constructed
+    virtual ~LocEngReportPosition();
+    LOC_MSG_POOLED();
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -112,6 +116,7 @@ struct LocEngReportSv : public LocMsg {
                    GpsSvStatus &sv,
                    GpsLocationExtended &locExtended,
                    void* svExtended);
+    LOC_MSG_POOLED();
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -123,6 +128,7 @@ struct LocEngReportStatus : public LocMsg {
     const GpsStatusValue mStatus;
     LocEngReportStatus(LocAdapterBase* adapter,
                        GpsStatusValue engineStatus);
+    LOC_MSG_POOLED();
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
@@ -132,12 +138,18 @@ struct LocEngReportNmea : public LocMsg {
     void* mLocEng;
     char* const mNmea;
     const int mLen;
+    // a single sentence (NMEA_SENTENCE_MAX_LENGTH) fits here; only
+    // longer reports go to the heap
+    char mBuf[200];
     LocEngReportNmea(void* locEng,
                      const char* data, int len);
     inline virtual ~LocEngReportNmea()
     {
-        delete[] mNmea;
+        if (mNmea != mBuf) {
+            delete[] mNmea;
+        }
     }
+    LOC_MSG_POOLED();
     virtual void proc() const;
     void locallog() const;
     virtual void log() const;
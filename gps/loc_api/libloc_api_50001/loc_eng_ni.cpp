@@ -32,14 +32,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/time.h>
 #include <pthread.h>
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
 #include <time.h>
+#include <limits.h>
 #include <MsgTask.h>
+#include <loc_timer.h>
 
 #include <loc_eng.h>
 
@@ -59,7 +60,7 @@ using namespace loc_core;
  *                             FUNCTION DECLARATIONS
  *
  *============================================================================*/
-static void* ni_thread_proc(void *args);
+static void ni_timeout_cb(void* user_data, int result);
 
 struct LocEngInformNiResponse : public LocMsg {
     LocEngAdapter* mAdapter;
@@ -99,11 +100,35 @@ struct LocEngInformNiResponse : public LocMsg {
 
 /*===========================================================================
 
+FUNCTION ni_close_request
+
+DESCRIPTION
+   Takes a pending request out of service. Its 'no response' timer is
+   stopped; if the timer has already fired, the slot is left CLOSING and
+   its callback frees it. Called with tLock held.
+
+RETURN VALUE
+   none
+
+===========================================================================*/
+static void ni_close_request(loc_eng_ni_request_s_type* req)
+{
+    req->rawRequest = NULL;
+    if (NULL != req->timer && loc_timer_stop(req->timer)) {
+        req->state = LOC_NI_CLOSING;
+    } else {
+        req->state = LOC_NI_FREE;
+    }
+    req->timer = NULL;
+}
+
+/*===========================================================================
+
 FUNCTION loc_eng_ni_request_handler
 
 DESCRIPTION
-   Displays the NI request and awaits user input. If a previous request is
-   in session, it is ignored.
+   Displays the NI request and awaits user input, for up to
+   LOC_NI_MAX_REQUESTS requests at once. Requests beyond that are ignored.
 
 RETURN VALUE
    none
@@ -116,28 +141,57 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
     ENTRY_LOG();
     char lcs_addr[32]; // Decoded LCS address for UMTS CP NI
     loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
+    loc_eng_ni_request_s_type* req = NULL;
 
     if (NULL == loc_eng_data.ni_notify_cb) {
         EXIT_LOG(%s, "loc_eng_ni_init hasn't happened yet.");
         return;
     }
 
+    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
+    for (int i = 0; i < LOC_NI_MAX_REQUESTS; i++) {
+        if (LOC_NI_FREE == loc_eng_ni_data_p->requests[i].state) {
+            req = &loc_eng_ni_data_p->requests[i];
+            req->id = (loc_eng_ni_data_p->seq++ % (INT_MAX / LOC_NI_MAX_REQUESTS)) *
+                      LOC_NI_MAX_REQUESTS + i;
+            break;
+        }
+    }
+
     /* If busy, use default or deny */
-    if (NULL != loc_eng_ni_data_p->rawRequest)
+    if (NULL == req)
     {
+        pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
         /* XXX Consider sending a NO RESPONSE reply or queue the request */
-        LOC_LOGW("loc_eng_ni_request_handler, notification in progress, new NI request ignored, type: %d",
-                 notif->ni_type);
+        LOC_LOGW("loc_eng_ni_request_handler, %d notifications in progress, new NI request ignored, type: %d",
+                 LOC_NI_MAX_REQUESTS, notif->ni_type);
         if (NULL != passThrough) {
             free((void*)passThrough);
         }
     }
     else {
         /* Save request */
-        loc_eng_ni_data_p->rawRequest = (void*)passThrough;
+        req->owner = &loc_eng_data;
+        req->state = LOC_NI_PENDING;
+        req->rawRequest = (void*)passThrough;
 
         /* Fill in notification */
-        ((GpsNiNotification*)notif)->notification_id = loc_eng_ni_data_p->reqID;
+        ((GpsNiNotification*)notif)->notification_id = req->id;
+
+        /* For robustness, time out to clear up the notification status, even though
+         * the OEM layer in java does not do so.
+         **/
+        int timeout = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
+        void* timer = loc_timer_start(timeout * 1000, ni_timeout_cb, req);
+        req->timer = timer;
+        pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
+
+        if (NULL == timer) {
+            LOC_LOGE("Loc NI timer is not started, notification %d waits for the user\n",
+                     notif->notification_id);
+        } else {
+            LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", timeout);
+        }
 
         if (notif->notify_flags == GPS_NI_PRIVACY_OVERRIDE)
         {
@@ -153,24 +207,6 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
             LOC_LOGI("              extras: %s", notif->extras);
         }
 
-        /* For robustness, spawn a thread at this point to timeout to clear up the notification status, even though
-         * the OEM layer in java does not do so.
-         **/
-        loc_eng_ni_data_p->respTimeLeft = 5 + (notif->timeout != 0 ? notif->timeout : LOC_NI_NO_RESPONSE_TIME);
-        LOC_LOGI("Automatically sends 'no response' in %d seconds (to clear status)\n", loc_eng_ni_data_p->respTimeLeft);
-
-        int rc = 0;
-        rc = pthread_create(&loc_eng_ni_data_p->thread, NULL, ni_thread_proc, &loc_eng_data);
-        if (rc)
-        {
-            LOC_LOGE("Loc NI thread is not created.\n");
-        }
-        rc = pthread_detach(loc_eng_ni_data_p->thread);
-        if (rc)
-        {
-            LOC_LOGE("Loc NI thread is not detached.\n");
-        }
-
         CALLBACK_LOG_CALLFLOW("ni_notify_cb - id", %d, notif->notification_id);
         loc_eng_data.ni_notify_cb((GpsNiNotification*)notif);
     }
@@ -179,68 +215,41 @@ void loc_eng_ni_request_handler(loc_eng_data_s_type &loc_eng_data,
 
 /*===========================================================================
 
-FUNCTION ni_thread_proc
+FUNCTION ni_timeout_cb
+
+DESCRIPTION
+   Runs on the loc_timer thread when a request got no user response in
+   time, and answers it with 'no response'.
 
 ===========================================================================*/
-static void* ni_thread_proc(void *args)
+static void ni_timeout_cb(void* user_data, int result)
 {
     ENTRY_LOG();
 
-    loc_eng_data_s_type* loc_eng_data_p = (loc_eng_data_s_type*)args;
+    loc_eng_ni_request_s_type* req = (loc_eng_ni_request_s_type*)user_data;
+    loc_eng_data_s_type* loc_eng_data_p = req->owner;
     loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data_p->loc_eng_ni_data;
-    int rc = 0;          /* return code from pthread calls */
-
-    struct timeval present_time;
-    struct timespec expire_time;
-
-    LOC_LOGD("Starting Loc NI thread...\n");
-    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
-    /* Calculate absolute expire time */
-    gettimeofday(&present_time, NULL);
-    expire_time.tv_sec  = present_time.tv_sec + loc_eng_ni_data_p->respTimeLeft;
-    expire_time.tv_nsec = present_time.tv_usec * 1000;
-    LOC_LOGD("ni_thread_proc-Time out set for abs time %ld with delay %d sec\n",
-             (long) expire_time.tv_sec, loc_eng_ni_data_p->respTimeLeft );
-
-    while (!loc_eng_ni_data_p->respRecvd)
-    {
-        rc = pthread_cond_timedwait(&loc_eng_ni_data_p->tCond,
-                                    &loc_eng_ni_data_p->tLock,
-                                    &expire_time);
-        if (rc == ETIMEDOUT)
-        {
-            loc_eng_ni_data_p->resp = GPS_NI_RESPONSE_NORESP;
-            LOC_LOGD("ni_thread_proc-Thread time out after valting for specified time. Ret Val %d\n",rc );
-            break;
-        }
-    }
-    LOC_LOGD("ni_thread_proc-Java layer has sent us a user response and return value from "
-             "pthread_cond_timedwait = %d\n",rc );
-    loc_eng_ni_data_p->respRecvd = FALSE; /* Reset the user response flag for the next session*/
-
-    // adding this check to support modem restart, in which case, we need the thread
-    // to exit without calling sending data. We made sure that rawRequest is NULL in
-    // loc_eng_ni_reset_on_engine_restart()
     LocEngAdapter* adapter = loc_eng_data_p->adapter;
     LocEngInformNiResponse *msg = NULL;
 
-    if (NULL != loc_eng_ni_data_p->rawRequest) {
-        msg = new LocEngInformNiResponse(adapter,
-                                         loc_eng_ni_data_p->resp,
-                                         loc_eng_ni_data_p->rawRequest);
-        loc_eng_ni_data_p->rawRequest = NULL;
+    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
+    // CLOSING if the user answered, or the modem restarted, while this
+    // was getting called
+    if (LOC_NI_PENDING == req->state) {
+        LOC_LOGD("ni_timeout_cb-no user response to notification %d\n", req->id);
+        msg = new LocEngInformNiResponse(adapter, GPS_NI_RESPONSE_NORESP,
+                                         req->rawRequest);
     }
+    req->rawRequest = NULL;
+    req->timer = NULL;
+    req->state = LOC_NI_FREE;
     pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
 
-    loc_eng_ni_data_p->respTimeLeft = 0;
-    loc_eng_ni_data_p->reqID++;
-
     if (NULL != msg) {
         adapter->sendMsg(msg);
     }
 
     EXIT_LOG(%s, VOID_RET);
-    return NULL;
 }
 
 void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
@@ -254,17 +263,15 @@ void loc_eng_ni_reset_on_engine_restart(loc_eng_data_s_type &loc_eng_data)
     }
 
     // only if modem has requested but then died.
-    if (NULL != loc_eng_ni_data_p->rawRequest) {
-        free(loc_eng_ni_data_p->rawRequest);
-        loc_eng_ni_data_p->rawRequest = NULL;
-
-        pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
-        // the goal is to wake up ni_thread_proc
-        // and let it exit.
-        loc_eng_ni_data_p->respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
+    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
+    for (int i = 0; i < LOC_NI_MAX_REQUESTS; i++) {
+        loc_eng_ni_request_s_type* req = &loc_eng_ni_data_p->requests[i];
+        if (LOC_NI_PENDING == req->state) {
+            free(req->rawRequest);
+            ni_close_request(req);
+        }
     }
+    pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
 
     EXIT_LOG(%s, VOID_RET);
 }
@@ -297,11 +304,8 @@ void loc_eng_ni_init(loc_eng_data_s_type &loc_eng_data, GpsNiExtCallbacks *callb
         EXIT_LOG(%s, "loc_eng_ni_init: already inited.");
     } else {
         loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
-        loc_eng_ni_data_p->respTimeLeft = 0;
-        loc_eng_ni_data_p->respRecvd = FALSE;
-        loc_eng_ni_data_p->rawRequest = NULL;
-        loc_eng_ni_data_p->reqID = 0;
-        pthread_cond_init(&loc_eng_ni_data_p->tCond, NULL);
+        memset(loc_eng_ni_data_p->requests, 0, sizeof(loc_eng_ni_data_p->requests));
+        loc_eng_ni_data_p->seq = 0;
         pthread_mutex_init(&loc_eng_ni_data_p->tLock, NULL);
 
         loc_eng_data.ni_notify_cb = callbacks->notify_cb;
@@ -330,25 +334,33 @@ void loc_eng_ni_respond(loc_eng_data_s_type &loc_eng_data,
 {
     ENTRY_LOG_CALLFLOW();
     loc_eng_ni_data_s_type* loc_eng_ni_data_p = &loc_eng_data.loc_eng_ni_data;
+    LocEngInformNiResponse *msg = NULL;
 
     if (NULL == loc_eng_data.ni_notify_cb) {
         EXIT_LOG(%s, "loc_eng_ni_init hasn't happened yet.");
         return;
     }
 
-    if (notif_id == loc_eng_ni_data_p->reqID &&
-        NULL != loc_eng_ni_data_p->rawRequest)
-    {
+    pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
+    if (notif_id >= 0) {
+        // the slot is part of the id
+        loc_eng_ni_request_s_type* req =
+            &loc_eng_ni_data_p->requests[notif_id % LOC_NI_MAX_REQUESTS];
+        if (LOC_NI_PENDING == req->state && notif_id == req->id) {
+            msg = new LocEngInformNiResponse(loc_eng_data.adapter, user_response,
+                                             req->rawRequest);
+            ni_close_request(req);
+        }
+    }
+    pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
+
+    if (NULL != msg) {
         LOC_LOGI("loc_eng_ni_respond: send user response %d for notif %d", user_response, notif_id);
-        pthread_mutex_lock(&loc_eng_ni_data_p->tLock);
-        loc_eng_ni_data_p->resp = user_response;
-        loc_eng_ni_data_p->respRecvd = TRUE;
-        pthread_cond_signal(&loc_eng_ni_data_p->tCond);
-        pthread_mutex_unlock(&loc_eng_ni_data_p->tLock);
+        loc_eng_data.adapter->sendMsg(msg);
     }
     else {
-        LOC_LOGE("loc_eng_ni_respond: reqID %d and notif_id %d mismatch or rawRequest %p, response: %d",
-                 loc_eng_ni_data_p->reqID, notif_id, loc_eng_ni_data_p->rawRequest, user_response);
+        LOC_LOGE("loc_eng_ni_respond: notif_id %d is not pending, response: %d",
+                 notif_id, user_response);
     }
 
     EXIT_LOG(%s, VOID_RET);
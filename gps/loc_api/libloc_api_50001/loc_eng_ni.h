@@ -34,15 +34,25 @@
 
 #define LOC_NI_NO_RESPONSE_TIME            20                      /* secs */
 #define LOC_NI_NOTIF_KEY_ADDRESS           "Address"
+#define LOC_NI_MAX_REQUESTS                4   /* outstanding at once */
+
+enum loc_eng_ni_state_e_type {
+    LOC_NI_FREE = 0,
+    LOC_NI_PENDING,        /* waiting for the user, timer armed */
+    LOC_NI_CLOSING         /* answered while the timer fired, waiting for its callback */
+};
 
 typedef struct {
-    pthread_t               thread;            /* NI thread */
-    int                     respTimeLeft;       /* examine time for NI response */
-    bool                    respRecvd;   /* NI User reponse received or not from Java layer*/
+    struct loc_eng_data_s*  owner;
+    loc_eng_ni_state_e_type state;
+    int                     id;            /* notification_id, slot + n * LOC_NI_MAX_REQUESTS */
     void*                   rawRequest;
-    int                     reqID;         /* ID to check against response */
-    GpsUserResponseType     resp;
-    pthread_cond_t          tCond;
+    void*                   timer;         /* loc_timer sending 'no response' */
+} loc_eng_ni_request_s_type;
+
+typedef struct {
+    loc_eng_ni_request_s_type requests[LOC_NI_MAX_REQUESTS];
+    unsigned int            seq;           /* makes the next notification_id */
     pthread_mutex_t         tLock;
 } loc_eng_ni_data_s_type;
 
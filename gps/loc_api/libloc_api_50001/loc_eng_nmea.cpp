@@ -35,9 +35,534 @@
 #define GLONASS_PRN_END   96
 #include <loc_eng.h>
 #include <loc_eng_nmea.h>
+#include <loc_eng_nmea_bus.h>
 #include <math.h>
+#include <stdio.h>
+#include <time.h>
 #include "log_util.h"
 
+// room kept at the end of every sentence for "*XX\r\n" and the NUL
+#define NMEA_TRAILER_LENGTH 6
+#define SECONDS_PER_DAY 86400
+
+// One sentence being written in place. The checksum is XOR-ed in as the
+// characters go out, so it never has to be rescanned.
+typedef struct loc_eng_nmea_writer
+{
+    char* pStart;
+    char* pMarker;
+    char* pEnd;
+    uint8_t checksum;
+    bool overflow;
+} loc_eng_nmea_writer;
+
+// UTC fields of the fix being reported
+typedef struct loc_eng_nmea_utc
+{
+    int day;
+    int month;
+    int year;       // 2 digit year
+    int hours;
+    int minutes;
+    int seconds;
+} loc_eng_nmea_utc;
+
+// Date fields only change once a day; only the generators' thread
+// (MsgTask) touches this.
+static struct
+{
+    bool valid;
+    int64_t epochDay;
+    int day;
+    int month;
+    int year;
+} nmea_date_cache;
+
+// Sentences sent in place of GSA / VTG / RMC / GGA when there is no
+// fix, after the talker ID
+static const char* const nmea_no_fix_sentences[] =
+{
+    "GSA,A,1,,,,,,,,,,,,,,,",
+    "VTG,,T,,M,,N,,K,N",
+    "RMC,,V,,,,,,,,,,N",
+    "GGA,,,,,,0,,,,,,,,"
+};
+
+// Per constellation, indexed by loc_eng_gnss_e_type. GSV always goes
+// out under the constellation's own talker ID.
+static const struct
+{
+    const char* talker;
+    int prnStart;
+    int prnEnd;
+} nmea_gnss_table[LOC_ENG_GNSS_MAX] =
+{
+    { "GP", GPS_PRN_START,     GPS_PRN_END },
+    { "GL", GLONASS_PRN_START, GLONASS_PRN_END },
+};
+
+static const double nmea_pow10[] = { 1.0, 10.0, 100.0, 1000.0, 10000.0,
+                                     100000.0, 1000000.0 };
+
+static inline void nmea_begin(loc_eng_nmea_writer* w, char* buf, int size,
+                              const char* talker, const char* address);
+static inline void nmea_putc(loc_eng_nmea_writer* w, char c);
+static inline void nmea_puts(loc_eng_nmea_writer* w, const char* s);
+
+/*===========================================================================
+FUNCTION    nmea_begin
+
+DESCRIPTION
+   Starts a new sentence in buf: writes the '$', the talker ID, e.g.
+   "GP", and the rest of the address field, e.g. "GGA,". The '$' is not
+   part of the checksum.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static inline void nmea_begin(loc_eng_nmea_writer* w, char* buf, int size,
+                              const char* talker, const char* address)
+{
+    w->pStart = buf;
+    w->pMarker = buf;
+    w->pEnd = buf + size - NMEA_TRAILER_LENGTH;
+    w->checksum = 0;
+    w->overflow = false;
+    *w->pMarker++ = '$';
+    nmea_puts(w, talker);
+    nmea_puts(w, address);
+}
+
+static inline void nmea_putc(loc_eng_nmea_writer* w, char c)
+{
+    if (w->pMarker < w->pEnd) {
+        *w->pMarker++ = c;
+        w->checksum ^= (uint8_t)c;
+    } else {
+        w->overflow = true;
+    }
+}
+
+static inline void nmea_puts(loc_eng_nmea_writer* w, const char* s)
+{
+    while (*s != '\0') {
+        nmea_putc(w, *s++);
+    }
+}
+
+/*===========================================================================
+FUNCTION    nmea_put_uint
+
+DESCRIPTION
+   Writes v in decimal, zero padded to at least width digits.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void nmea_put_uint(loc_eng_nmea_writer* w, uint64_t v, int width)
+{
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    while (width-- > n) {
+        nmea_putc(w, '0');
+    }
+    while (n > 0) {
+        nmea_putc(w, digits[--n]);
+    }
+}
+
+/*===========================================================================
+FUNCTION    nmea_put_int
+
+DESCRIPTION
+   Same output as printf("%0<width>d", v).
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void nmea_put_int(loc_eng_nmea_writer* w, int v, int width)
+{
+    if (v < 0) {
+        nmea_putc(w, '-');
+        nmea_put_uint(w, (uint64_t)(-(int64_t)v), width - 1);
+    } else {
+        nmea_put_uint(w, (uint64_t)v, width);
+    }
+}
+
+/*===========================================================================
+FUNCTION    nmea_put_fixed
+
+DESCRIPTION
+   Same output as printf("%0<width>.<decimals>f", v), decimals <= 6, in
+   fixed point. Like printf, exact ties round to even; fma() recovers
+   what the scaling multiply rounded off, so values just off a tie go
+   the right way too. Values out of range fall back to snprintf.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void nmea_put_fixed(loc_eng_nmea_writer* w, double v, int decimals,
+                           int width)
+{
+    bool negative = signbit(v);
+    double mag = negative ? -v : v;
+    double scale = nmea_pow10[decimals];
+    double scaled = mag * scale;
+
+    if (!(scaled < 1e15)) {
+        // inf, nan or just too big for the fast path
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%0*.*f", width, decimals, v);
+        nmea_puts(w, buf);
+        return;
+    }
+
+    double whole = floor(scaled);
+    uint64_t n = (uint64_t)whole;
+    double frac = scaled - whole;
+    if (frac > 0.5) {
+        n++;
+    } else if (frac == 0.5) {
+        double err = fma(mag, scale, -scaled);
+        if (err > 0 || (err == 0 && (n & 1))) {
+            n++;
+        }
+    }
+
+    uint64_t unit = (uint64_t)scale;
+    int intWidth = width - (negative ? 1 : 0) - (decimals ? decimals + 1 : 0);
+    if (negative) {
+        nmea_putc(w, '-');
+    }
+    nmea_put_uint(w, n / unit, intWidth > 1 ? intWidth : 1);
+    if (decimals) {
+        nmea_putc(w, '.');
+        nmea_put_uint(w, n % unit, decimals);
+    }
+}
+
+/*===========================================================================
+FUNCTION    nmea_send
+
+DESCRIPTION
+   Closes the sentence with its checksum and sends it out.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false if the sentence did not fit the buffer, nothing is sent then
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool nmea_send(loc_eng_nmea_writer* w, loc_eng_data_s_type *loc_eng_data_p)
+{
+    static const char hexDigits[] = "0123456789ABCDEF";
+
+    if (w->overflow) {
+        LOC_LOGE("NMEA Error in string formatting");
+        return false;
+    }
+
+    char* p = w->pMarker;
+    *p++ = '*';
+    *p++ = hexDigits[w->checksum >> 4];
+    *p++ = hexDigits[w->checksum & 0xF];
+    *p++ = '\r';
+    *p++ = '\n';
+    *p = '\0';
+
+    // one short of the full length, as loc_eng_nmea_put_checksum()
+    // has always reported it
+    loc_eng_nmea_send(w->pStart, (int)(p - w->pStart) - 1, loc_eng_data_p);
+    return true;
+}
+
+/*===========================================================================
+FUNCTION    nmea_get_utc
+
+DESCRIPTION
+   Breaks a UTC timestamp (msec) down into the fields NMEA needs. Time of
+   day is plain arithmetic; gmtime_r only runs when the day changes.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   false if the date can not be worked out
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static bool nmea_get_utc(GpsUtcTime timestamp, loc_eng_nmea_utc* utc)
+{
+    int64_t utcTime = timestamp / 1000;
+    int64_t epochDay = utcTime / SECONDS_PER_DAY;
+    int64_t secOfDay = utcTime % SECONDS_PER_DAY;
+    if (secOfDay < 0) {
+        secOfDay += SECONDS_PER_DAY;
+        epochDay--;
+    }
+
+    if (!nmea_date_cache.valid || nmea_date_cache.epochDay != epochDay) {
+        time_t dayStart = (time_t)(epochDay * SECONDS_PER_DAY);
+        struct tm tmDay;
+        if (NULL == gmtime_r(&dayStart, &tmDay)) {
+            return false;
+        }
+        nmea_date_cache.valid = true;
+        nmea_date_cache.epochDay = epochDay;
+        nmea_date_cache.day = tmDay.tm_mday;
+        nmea_date_cache.month = tmDay.tm_mon + 1; // tm_mon starts at zero
+        nmea_date_cache.year = tmDay.tm_year % 100; // 2 digit year
+    }
+
+    utc->day = nmea_date_cache.day;
+    utc->month = nmea_date_cache.month;
+    utc->year = nmea_date_cache.year;
+    utc->hours = (int)(secOfDay / 3600);
+    utc->minutes = (int)(secOfDay / 60 % 60);
+    utc->seconds = (int)(secOfDay % 60);
+    return true;
+}
+
+/*===========================================================================
+FUNCTION    nmea_put_lat_long
+
+DESCRIPTION
+   Writes the "ddmm.mmmmmm,N,dddmm.mmmmmm,E," fields, or ",,,," if there
+   is no position.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void nmea_put_lat_long(loc_eng_nmea_writer* w, const UlpLocation &location)
+{
+    if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG)) {
+        nmea_puts(w, ",,,,");
+        return;
+    }
+
+    double latitude = location.gpsLocation.latitude;
+    double longitude = location.gpsLocation.longitude;
+    char latHemisphere;
+    char lonHemisphere;
+
+    if (latitude > 0)
+    {
+        latHemisphere = 'N';
+    }
+    else
+    {
+        latHemisphere = 'S';
+        latitude *= -1.0;
+    }
+
+    if (longitude < 0)
+    {
+        lonHemisphere = 'W';
+        longitude *= -1.0;
+    }
+    else
+    {
+        lonHemisphere = 'E';
+    }
+
+    nmea_put_int(w, (uint8_t)floor(latitude), 2);
+    nmea_put_fixed(w, fmod(latitude * 60.0 , 60.0), 6, 9);
+    nmea_putc(w, ',');
+    nmea_putc(w, latHemisphere);
+    nmea_putc(w, ',');
+    nmea_put_int(w, (uint8_t)floor(longitude), 3);
+    nmea_put_fixed(w, fmod(longitude * 60.0 , 60.0), 6, 9);
+    nmea_putc(w, ',');
+    nmea_putc(w, lonHemisphere);
+    nmea_putc(w, ',');
+}
+
+/*===========================================================================
+FUNCTION    nmea_put_hhmmss
+
+DESCRIPTION
+   Writes the UTC time of day as "hhmmss".
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static inline void nmea_put_hhmmss(loc_eng_nmea_writer* w, const loc_eng_nmea_utc &utc)
+{
+    nmea_put_int(w, utc.hours, 2);
+    nmea_put_int(w, utc.minutes, 2);
+    nmea_put_int(w, utc.seconds, 2);
+}
+
+/*===========================================================================
+FUNCTION    nmea_send_no_fix
+
+DESCRIPTION
+   Sends the blank GSA / VTG / RMC / GGA sentences.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void nmea_send_no_fix(loc_eng_data_s_type *loc_eng_data_p,
+                             const char* talker)
+{
+    char sentence[NMEA_SENTENCE_MAX_LENGTH];
+    loc_eng_nmea_writer w;
+
+    for (unsigned int i = 0;
+         i < sizeof(nmea_no_fix_sentences) / sizeof(nmea_no_fix_sentences[0]);
+         i++) {
+        nmea_begin(&w, sentence, sizeof(sentence), talker,
+                   nmea_no_fix_sentences[i]);
+        nmea_send(&w, loc_eng_data_p);
+    }
+}
+
+/*===========================================================================
+FUNCTION    nmea_build_sv_index
+
+DESCRIPTION
+   Groups the SVs of an sv report by constellation (a counting sort that
+   keeps report order within each). SVs of other constellations are left
+   out.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void nmea_build_sv_index(const GpsSvStatus &svStatus,
+                                loc_eng_sv_index_s_type* index)
+{
+    uint8_t system[GPS_MAX_SVS];
+    uint8_t next[LOC_ENG_GNSS_MAX];
+    int svCount = svStatus.num_svs;
+    if (svCount > GPS_MAX_SVS)
+        svCount = GPS_MAX_SVS;
+
+    memset(index->num_in_view, 0, sizeof(index->num_in_view));
+    for (int i = 0; i < svCount; i++) {
+        int prn = svStatus.sv_list[i].prn;
+        system[i] = LOC_ENG_GNSS_MAX;
+        for (int g = 0; g < LOC_ENG_GNSS_MAX; g++) {
+            if (prn >= nmea_gnss_table[g].prnStart &&
+                prn <= nmea_gnss_table[g].prnEnd) {
+                system[i] = g;
+                index->num_in_view[g]++;
+                break;
+            }
+        }
+    }
+
+    uint8_t first = 0;
+    for (int g = 0; g < LOC_ENG_GNSS_MAX; g++) {
+        index->first[g] = first;
+        next[g] = first;
+        first += index->num_in_view[g];
+    }
+    for (int i = 0; i < svCount; i++) {
+        if (system[i] < LOC_ENG_GNSS_MAX) {
+            index->sv_order[next[system[i]]++] = i;
+        }
+    }
+}
+
+/*===========================================================================
+FUNCTION    nmea_fix_talker
+
+DESCRIPTION
+   Talker ID for the fix sentences: "GN" if NMEA_MULTI_GNSS is set and
+   more than one constellation was in view in the last sv report, "GP"
+   otherwise.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   talker ID
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static const char* nmea_fix_talker(const loc_eng_data_s_type *loc_eng_data_p)
+{
+    if (gps_conf.NMEA_MULTI_GNSS) {
+        int systems = 0;
+        for (int g = 0; g < LOC_ENG_GNSS_MAX; g++) {
+            if (loc_eng_data_p->sv_index.num_in_view[g] > 0)
+                systems++;
+        }
+        if (systems > 1)
+            return "GN";
+    }
+    return "GP";
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_nmea_send
 
@@ -59,12 +584,94 @@ void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_dat
     struct timeval tv;
     gettimeofday(&tv, (struct timezone *) NULL);
     int64_t now = tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+    if (loc_eng_data_p->nmea_bus != NULL)
+    {
+        loc_eng_nmea_bus_publish(loc_eng_data_p->nmea_bus, now,
+                                 pNmea, strlen(pNmea), length);
+        return;
+    }
     CALLBACK_LOG_CALLFLOW("nmea_cb", %p, pNmea);
     if (loc_eng_data_p->nmea_cb != NULL)
         loc_eng_data_p->nmea_cb(now, pNmea, length);
     LOC_LOGD("NMEA <%s", pNmea);
 }
 
+// NMEA bus consumer feeding the framework's nmea_cb
+static void nmea_framework_send(void* data, int64_t timestamp,
+                                const char* nmea, int length)
+{
+    loc_eng_data_s_type *loc_eng_data_p = (loc_eng_data_s_type*)data;
+    CALLBACK_LOG_CALLFLOW("nmea_cb", %p, nmea);
+    loc_eng_data_p->nmea_cb(timestamp, nmea, length);
+    LOC_LOGD("NMEA <%s", nmea);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_init
+
+DESCRIPTION
+   Sets up the NMEA bus with the framework's nmea_cb as a consumer and,
+   if NMEA_TAP is set, the UNIX socket consumer at LOC_ENG_NMEA_TAP_PATH.
+   Without a bus NMEA goes straight to nmea_cb on the caller's thread.
+
+DEPENDENCIES
+   nmea_cb already saved in loc_eng_data_p
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_init(loc_eng_data_s_type *loc_eng_data_p,
+                       gps_create_thread create_thread_cb)
+{
+    if (loc_eng_data_p->nmea_cb == NULL && !gps_conf.NMEA_TAP)
+        return;
+
+    loc_eng_nmea_bus_s_type* bus =
+        loc_eng_nmea_bus_create((thelper_create_thread)create_thread_cb);
+    if (bus == NULL)
+        return;
+
+    // nmea_cb has to come from a thread made by create_thread_cb
+    if (loc_eng_data_p->nmea_cb != NULL &&
+        loc_eng_nmea_bus_subscribe(bus, "nmea_cb", nmea_framework_send,
+                                   loc_eng_data_p, NULL) == NULL)
+    {
+        loc_eng_nmea_bus_destroy(bus);
+        return;
+    }
+
+    if (gps_conf.NMEA_TAP)
+        loc_eng_nmea_bus_add_socket(bus, LOC_ENG_NMEA_TAP_PATH);
+
+    loc_eng_data_p->nmea_bus = bus;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_cleanup
+
+DESCRIPTION
+   Stops all NMEA bus consumers and frees the bus.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_cleanup(loc_eng_data_s_type *loc_eng_data_p)
+{
+    loc_eng_nmea_bus_destroy(loc_eng_data_p->nmea_bus);
+    loc_eng_data_p->nmea_bus = NULL;
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_nmea_put_checksum
 
@@ -119,40 +726,33 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
                                unsigned char generate_nmea)
 {
     ENTRY_LOG();
-    time_t utcTime(location.gpsLocation.timestamp/1000);
-    tm * pTm = gmtime(&utcTime);
-    if (NULL == pTm) {
+    loc_eng_nmea_utc utc;
+    if (!nmea_get_utc(location.gpsLocation.timestamp, &utc)) {
         LOC_LOGE("gmtime failed");
         return;
     }
 
-    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
-    int length = 0;
-    int utcYear = pTm->tm_year % 100; // 2 digit year
-    int utcMonth = pTm->tm_mon + 1; // tm_mon starts at zero
-    int utcDay = pTm->tm_mday;
-    int utcHours = pTm->tm_hour;
-    int utcMinutes = pTm->tm_min;
-    int utcSeconds = pTm->tm_sec;
+    char sentence[NMEA_SENTENCE_MAX_LENGTH];
+    loc_eng_nmea_writer w;
+    const char* talker = nmea_fix_talker(loc_eng_data_p);
 
     if (generate_nmea) {
+        bool hasFix = location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG;
+        bool standalone = LOC_POSITION_MODE_STANDALONE ==
+            loc_eng_data_p->adapter->getPositionMode().mode;
+        bool hasDop = locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP;
+        // dop was cached from sv report (RPC)
+        bool hasCachedDop = loc_eng_data_p->pdop > 0 &&
+            loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0;
+
         // ------------------
         // ------$GPGSA------
         // ------------------
 
+        uint32_t* usedMask = loc_eng_data_p->sv_index.used_mask;
         uint32_t svUsedCount = 0;
-        uint32_t svUsedList[32] = {0};
-        uint32_t mask = loc_eng_data_p->sv_used_mask;
-        for (uint8_t i = 1; mask > 0 && svUsedCount < 32; i++)
-        {
-            if (mask & 1)
-                svUsedList[svUsedCount++] = i;
-            mask = mask >> 1;
-        }
-        // clear the cache so they can't be used again
-        loc_eng_data_p->sv_used_mask = 0;
+        for (int g = 0; g < LOC_ENG_GNSS_MAX; g++)
+            svUsedCount += __builtin_popcount(usedMask[g]);
 
         char fixType;
         if (svUsedCount == 0)
@@ -162,60 +762,44 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
         else
             fixType = '3'; // 3D fix
 
-        length = snprintf(pMarker, lengthRemaining, "$GPGSA,A,%c,", fixType);
+        nmea_begin(&w, sentence, sizeof(sentence), talker, "GSA,A,");
+        nmea_putc(&w, fixType);
+        nmea_putc(&w, ',');
 
-        if (length < 0 || length >= lengthRemaining)
+        // GPS PRNs in ascending order; only the first 12 sv go in sentence
+        uint32_t mask = usedMask[LOC_ENG_GNSS_GPS];
+        for (uint8_t i = 0; i < 12; i++)
         {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        for (uint8_t i = 0; i < 12; i++) // only the first 12 sv go in sentence
-        {
-            if (i < svUsedCount)
-                length = snprintf(pMarker, lengthRemaining, "%02d,", svUsedList[i]);
-            else
-                length = snprintf(pMarker, lengthRemaining, ",");
-
-            if (length < 0 || length >= lengthRemaining)
-            {
-                LOC_LOGE("NMEA Error in string formatting");
-                return;
+            if (mask != 0) {
+                nmea_put_int(&w, GPS_PRN_START + __builtin_ctz(mask), 2);
+                mask &= mask - 1;
             }
-            pMarker += length;
-            lengthRemaining -= length;
-        }
-
-        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-        {   // dop is in locationExtended, (QMI)
-            length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                              locationExtended.pdop,
-                              locationExtended.hdop,
-                              locationExtended.vdop);
+            nmea_putc(&w, ',');
         }
-        else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
-        {   // dop was cached from sv report (RPC)
-            length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                              loc_eng_data_p->pdop,
-                              loc_eng_data_p->hdop,
-                              loc_eng_data_p->vdop);
+        // clear the cache so they can't be used again
+        memset(usedMask, 0, sizeof(loc_eng_data_p->sv_index.used_mask));
+
+        if (hasDop || hasCachedDop)
+        {   // dop is in locationExtended (QMI), or cached (RPC)
+            nmea_put_fixed(&w, hasDop ? locationExtended.pdop : loc_eng_data_p->pdop, 1, 0);
+            nmea_putc(&w, ',');
+            nmea_put_fixed(&w, hasDop ? locationExtended.hdop : loc_eng_data_p->hdop, 1, 0);
+            nmea_putc(&w, ',');
+            nmea_put_fixed(&w, hasDop ? locationExtended.vdop : loc_eng_data_p->vdop, 1, 0);
         }
         else
         {   // no dop
-            length = snprintf(pMarker, lengthRemaining, ",,");
+            nmea_puts(&w, ",,");
         }
 
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        if (!nmea_send(&w, loc_eng_data_p))
+            return;
 
         // ------------------
         // ------$GPVTG------
         // ------------------
 
-        pMarker = sentence;
-        lengthRemaining = sizeof(sentence);
+        nmea_begin(&w, sentence, sizeof(sentence), talker, "VTG,");
 
         if (location.gpsLocation.flags & GPS_LOCATION_HAS_BEARING)
         {
@@ -229,163 +813,68 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
                     magTrack -= 360.0;
             }
 
-            length = snprintf(pMarker, lengthRemaining, "$GPVTG,%.1lf,T,%.1lf,M,", location.gpsLocation.bearing, magTrack);
+            nmea_put_fixed(&w, location.gpsLocation.bearing, 1, 0);
+            nmea_puts(&w, ",T,");
+            nmea_put_fixed(&w, magTrack, 1, 0);
+            nmea_puts(&w, ",M,");
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining, "$GPVTG,,T,,M,");
+            nmea_puts(&w, ",T,,M,");
         }
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
         if (location.gpsLocation.flags & GPS_LOCATION_HAS_SPEED)
         {
             float speedKnots = location.gpsLocation.speed * (3600.0/1852.0);
             float speedKmPerHour = location.gpsLocation.speed * 3.6;
 
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,N,%.1lf,K,", speedKnots, speedKmPerHour);
+            nmea_put_fixed(&w, speedKnots, 1, 0);
+            nmea_puts(&w, ",N,");
+            nmea_put_fixed(&w, speedKmPerHour, 1, 0);
+            nmea_puts(&w, ",K,");
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining, ",N,,K,");
+            nmea_puts(&w, ",N,,K,");
         }
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
-            length = snprintf(pMarker, lengthRemaining, "%c", 'N'); // N means no fix
-        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
-            length = snprintf(pMarker, lengthRemaining, "%c", 'A'); // A means autonomous
+        if (!hasFix)
+            nmea_putc(&w, 'N'); // N means no fix
+        else if (standalone)
+            nmea_putc(&w, 'A'); // A means autonomous
         else
-            length = snprintf(pMarker, lengthRemaining, "%c", 'D'); // D means differential
+            nmea_putc(&w, 'D'); // D means differential
 
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        if (!nmea_send(&w, loc_eng_data_p))
+            return;
 
         // ------------------
         // ------$GPRMC------
         // ------------------
 
-        pMarker = sentence;
-        lengthRemaining = sizeof(sentence);
-
-        length = snprintf(pMarker, lengthRemaining, "$GPRMC,%02d%02d%02d,A," ,
-                          utcHours, utcMinutes, utcSeconds);
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG)
-        {
-            double latitude = location.gpsLocation.latitude;
-            double longitude = location.gpsLocation.longitude;
-            char latHemisphere;
-            char lonHemisphere;
-            double latMinutes;
-            double lonMinutes;
-
-            if (latitude > 0)
-            {
-                latHemisphere = 'N';
-            }
-            else
-            {
-                latHemisphere = 'S';
-                latitude *= -1.0;
-            }
-
-            if (longitude < 0)
-            {
-                lonHemisphere = 'W';
-                longitude *= -1.0;
-            }
-            else
-            {
-                lonHemisphere = 'E';
-            }
+        nmea_begin(&w, sentence, sizeof(sentence), talker, "RMC,");
+        nmea_put_hhmmss(&w, utc);
+        nmea_puts(&w, ",A,");
 
-            latMinutes = fmod(latitude * 60.0 , 60.0);
-            lonMinutes = fmod(longitude * 60.0 , 60.0);
-
-            length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                              (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                              (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,,,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        nmea_put_lat_long(&w, location);
 
         if (location.gpsLocation.flags & GPS_LOCATION_HAS_SPEED)
         {
             float speedKnots = location.gpsLocation.speed * (3600.0/1852.0);
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,", speedKnots);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, ",");
+            nmea_put_fixed(&w, speedKnots, 1, 0);
         }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        nmea_putc(&w, ',');
 
         if (location.gpsLocation.flags & GPS_LOCATION_HAS_BEARING)
         {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,", location.gpsLocation.bearing);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining, ",");
+            nmea_put_fixed(&w, location.gpsLocation.bearing, 1, 0);
         }
+        nmea_putc(&w, ',');
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        length = snprintf(pMarker, lengthRemaining, "%2.2d%2.2d%2.2d,",
-                          utcDay, utcMonth, utcYear);
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        nmea_put_int(&w, utc.day, 2);
+        nmea_put_int(&w, utc.month, 2);
+        nmea_put_int(&w, utc.year, 2);
+        nmea_putc(&w, ',');
 
         if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
         {
@@ -401,181 +890,80 @@ void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
                 direction = 'E';
             }
 
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,%c,",
-                              magneticVariation, direction);
+            nmea_put_fixed(&w, magneticVariation, 1, 0);
+            nmea_putc(&w, ',');
+            nmea_putc(&w, direction);
+            nmea_putc(&w, ',');
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining, ",,");
+            nmea_puts(&w, ",,");
         }
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
-            length = snprintf(pMarker, lengthRemaining, "%c", 'N'); // N means no fix
-        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
-            length = snprintf(pMarker, lengthRemaining, "%c", 'A'); // A means autonomous
+        if (!hasFix)
+            nmea_putc(&w, 'N'); // N means no fix
+        else if (standalone)
+            nmea_putc(&w, 'A'); // A means autonomous
         else
-            length = snprintf(pMarker, lengthRemaining, "%c", 'D'); // D means differential
+            nmea_putc(&w, 'D'); // D means differential
 
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        if (!nmea_send(&w, loc_eng_data_p))
+            return;
 
         // ------------------
         // ------$GPGGA------
         // ------------------
 
-        pMarker = sentence;
-        lengthRemaining = sizeof(sentence);
+        nmea_begin(&w, sentence, sizeof(sentence), talker, "GGA,");
+        nmea_put_hhmmss(&w, utc);
+        nmea_putc(&w, ',');
 
-        length = snprintf(pMarker, lengthRemaining, "$GPGGA,%02d%02d%02d," ,
-                          utcHours, utcMinutes, utcSeconds);
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
-        if (location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG)
-        {
-            double latitude = location.gpsLocation.latitude;
-            double longitude = location.gpsLocation.longitude;
-            char latHemisphere;
-            char lonHemisphere;
-            double latMinutes;
-            double lonMinutes;
-
-            if (latitude > 0)
-            {
-                latHemisphere = 'N';
-            }
-            else
-            {
-                latHemisphere = 'S';
-                latitude *= -1.0;
-            }
-
-            if (longitude < 0)
-            {
-                lonHemisphere = 'W';
-                longitude *= -1.0;
-            }
-            else
-            {
-                lonHemisphere = 'E';
-            }
-
-            latMinutes = fmod(latitude * 60.0 , 60.0);
-            lonMinutes = fmod(longitude * 60.0 , 60.0);
-
-            length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                              (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                              (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-        }
-        else
-        {
-            length = snprintf(pMarker, lengthRemaining,",,,,");
-        }
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+        nmea_put_lat_long(&w, location);
 
         char gpsQuality;
-        if (!(location.gpsLocation.flags & GPS_LOCATION_HAS_LAT_LONG))
+        if (!hasFix)
             gpsQuality = '0'; // 0 means no fix
-        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->adapter->getPositionMode().mode)
+        else if (standalone)
             gpsQuality = '1'; // 1 means GPS fix
         else
             gpsQuality = '2'; // 2 means DGPS fix
 
-        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-        {   // dop is in locationExtended, (QMI)
-            length = snprintf(pMarker, lengthRemaining, "%c,%02d,%.1f,",
-                              gpsQuality, svUsedCount, locationExtended.hdop);
-        }
-        else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
-        {   // dop was cached from sv report (RPC)
-            length = snprintf(pMarker, lengthRemaining, "%c,%02d,%.1f,",
-                              gpsQuality, svUsedCount, loc_eng_data_p->hdop);
-        }
-        else
-        {   // no hdop
-            length = snprintf(pMarker, lengthRemaining, "%c,%02d,,",
-                              gpsQuality, svUsedCount);
-        }
-
-        if (length < 0 || length >= lengthRemaining)
+        nmea_putc(&w, gpsQuality);
+        nmea_putc(&w, ',');
+        nmea_put_int(&w, svUsedCount, 2);
+        nmea_putc(&w, ',');
+        if (hasDop || hasCachedDop)
         {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
+            nmea_put_fixed(&w, hasDop ? locationExtended.hdop : loc_eng_data_p->hdop, 1, 0);
         }
-        pMarker += length;
-        lengthRemaining -= length;
+        nmea_putc(&w, ',');
 
         if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL)
         {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,M,",
-                              locationExtended.altitudeMeanSeaLevel);
+            nmea_put_fixed(&w, locationExtended.altitudeMeanSeaLevel, 1, 0);
+            nmea_puts(&w, ",M,");
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining,",,");
+            nmea_puts(&w, ",,");
         }
 
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
-
         if ((location.gpsLocation.flags & GPS_LOCATION_HAS_ALTITUDE) &&
             (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL))
         {
-            length = snprintf(pMarker, lengthRemaining, "%.1lf,M,,",
-                              location.gpsLocation.altitude - locationExtended.altitudeMeanSeaLevel);
+            nmea_put_fixed(&w, location.gpsLocation.altitude - locationExtended.altitudeMeanSeaLevel, 1, 0);
+            nmea_puts(&w, ",M,,");
         }
         else
         {
-            length = snprintf(pMarker, lengthRemaining,",,,");
+            nmea_puts(&w, ",,,");
         }
 
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
+        nmea_send(&w, loc_eng_data_p);
     }
     //Send blank NMEA reports for non-final fixes
     else {
-        strlcpy(sentence, "$GPGSA,A,1,,,,,,,,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPVTG,,T,,M,,N,,K,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPRMC,,V,,,,,,,,,,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPGGA,,,,,,0,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        nmea_send_no_fix(loc_eng_data_p, talker);
     }
     // clear the dop cache so they can't be used again
     loc_eng_data_p->pdop = 0;
@@ -608,211 +996,75 @@ void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
 {
     ENTRY_LOG();
 
-    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
-    int length = 0;
+    char sentence[NMEA_SENTENCE_MAX_LENGTH];
+    loc_eng_nmea_writer w;
     int svCount = svStatus.num_svs;
-    int sentenceCount = 0;
-    int sentenceNumber = 1;
-    int svNumber = 1;
-    int gpsCount = 0;
-    int glnCount = 0;
+    loc_eng_sv_index_s_type* index = &loc_eng_data_p->sv_index;
 
-    //Count GPS SVs for saparating GPS from GLONASS and throw others
+    nmea_build_sv_index(svStatus, index);
 
-    for(svNumber=1; svNumber <= svCount; svNumber++) {
-        if( (svStatus.sv_list[svNumber-1].prn >= GPS_PRN_START)&&
-            (svStatus.sv_list[svNumber-1].prn <= GPS_PRN_END) )
-        {
-            gpsCount++;
-        }
-        else if( (svStatus.sv_list[svNumber-1].prn >= GLONASS_PRN_START) &&
-                 (svStatus.sv_list[svNumber-1].prn <= GLONASS_PRN_END) )
-        {
-            glnCount++;
-        }
-    }
+    // ------------------------
+    // ------$GPGSV/$GLGSV------
+    // ------------------------
 
-    // ------------------
-    // ------$GPGSV------
-    // ------------------
-
-    if (gpsCount <= 0)
-    {
-        // no svs in view, so just send a blank $GPGSV sentence
-        strlcpy(sentence, "$GPGSV,1,1,0,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-    }
-    else
+    for (int g = 0; g < LOC_ENG_GNSS_MAX; g++)
     {
-        svNumber = 1;
-        sentenceNumber = 1;
-        sentenceCount = gpsCount/4 + (gpsCount % 4 != 0);
-
-        while (sentenceNumber <= sentenceCount)
+        int inView = index->num_in_view[g];
+        if (inView <= 0)
         {
-            pMarker = sentence;
-            lengthRemaining = sizeof(sentence);
-
-            length = snprintf(pMarker, lengthRemaining, "$GPGSV,%d,%d,%02d",
-                          sentenceCount, sentenceNumber, svCount);
+            // no svs in view, so just send a blank GSV sentence
+            nmea_begin(&w, sentence, sizeof(sentence),
+                       nmea_gnss_table[g].talker, "GSV,1,1,0,");
+            nmea_send(&w, loc_eng_data_p);
+            continue;
+        }
 
-            if (length < 0 || length >= lengthRemaining)
-            {
-                LOC_LOGE("NMEA Error in string formatting");
-                return;
-            }
-            pMarker += length;
-            lengthRemaining -= length;
+        const uint8_t* order = &index->sv_order[index->first[g]];
+        int sentenceCount = inView/4 + (inView % 4 != 0);
 
-            for (int i=0; (svNumber <= svCount) && (i < 4);  svNumber++)
+        for (int sentenceNumber = 1; sentenceNumber <= sentenceCount; sentenceNumber++)
+        {
+            nmea_begin(&w, sentence, sizeof(sentence),
+                       nmea_gnss_table[g].talker, "GSV,");
+            nmea_put_int(&w, sentenceCount, 0);
+            nmea_putc(&w, ',');
+            nmea_put_int(&w, sentenceNumber, 0);
+            nmea_putc(&w, ',');
+            nmea_put_int(&w, svCount, 2);
+
+            int last = sentenceNumber * 4 < inView ? sentenceNumber * 4 : inView;
+            for (int i = (sentenceNumber - 1) * 4; i < last; i++)
             {
-                if( (svStatus.sv_list[svNumber-1].prn >= GPS_PRN_START) &&
-                    (svStatus.sv_list[svNumber-1].prn <= GPS_PRN_END) )
+                const GpsSvInfo &sv = svStatus.sv_list[order[i]];
+                nmea_putc(&w, ',');
+                nmea_put_int(&w, sv.prn, 2);
+                nmea_putc(&w, ',');
+                nmea_put_int(&w, (int)(0.5 + sv.elevation), 2); //float to int
+                nmea_putc(&w, ',');
+                nmea_put_int(&w, (int)(0.5 + sv.azimuth), 3); //float to int
+                nmea_putc(&w, ',');
+
+                if (sv.snr > 0)
                 {
-                    length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                                  svStatus.sv_list[svNumber-1].prn,
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].elevation), //float to int
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].azimuth)); //float to int
-
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-
-                    if (svStatus.sv_list[svNumber-1].snr > 0)
-                    {
-                        length = snprintf(pMarker, lengthRemaining,"%02d",
-                                         (int)(0.5 + svStatus.sv_list[svNumber-1].snr)); //float to int
-
-                        if (length < 0 || length >= lengthRemaining)
-                        {
-                            LOC_LOGE("NMEA Error in string formatting");
-                            return;
-                        }
-                        pMarker += length;
-                        lengthRemaining -= length;
-                    }
-
-                    i++;
-               }
-
+                    nmea_put_int(&w, (int)(0.5 + sv.snr), 2); //float to int
+                }
             }
 
-            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-            sentenceNumber++;
-
-        }  //while
-
-    } //if
-
-    // ------------------
-    // ------$GLGSV------
-    // ------------------
-
-    if (glnCount <= 0)
-    {
-        // no svs in view, so just send a blank $GLGSV sentence
-        strlcpy(sentence, "$GLGSV,1,1,0,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-    }
-    else
-    {
-        svNumber = 1;
-        sentenceNumber = 1;
-        sentenceCount = glnCount/4 + (glnCount % 4 != 0);
-
-        while (sentenceNumber <= sentenceCount)
-        {
-            pMarker = sentence;
-            lengthRemaining = sizeof(sentence);
-
-            length = snprintf(pMarker, lengthRemaining, "$GLGSV,%d,%d,%02d",
-                          sentenceCount, sentenceNumber, svCount);
-
-            if (length < 0 || length >= lengthRemaining)
-            {
-                LOC_LOGE("NMEA Error in string formatting");
+            if (!nmea_send(&w, loc_eng_data_p))
                 return;
-            }
-            pMarker += length;
-            lengthRemaining -= length;
-
-            for (int i=0; (svNumber <= svCount) && (i < 4);  svNumber++)
-            {
-                if( (svStatus.sv_list[svNumber-1].prn >= GLONASS_PRN_START) &&
-                    (svStatus.sv_list[svNumber-1].prn <= GLONASS_PRN_END) )      {
-
-                    length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                                  svStatus.sv_list[svNumber-1].prn,
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].elevation), //float to int
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].azimuth)); //float to int
-
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-
-                    if (svStatus.sv_list[svNumber-1].snr > 0)
-                    {
-                        length = snprintf(pMarker, lengthRemaining,"%02d",
-                                         (int)(0.5 + svStatus.sv_list[svNumber-1].snr)); //float to int
-
-                        if (length < 0 || length >= lengthRemaining)
-                        {
-                            LOC_LOGE("NMEA Error in string formatting");
-                            return;
-                        }
-                        pMarker += length;
-                        lengthRemaining -= length;
-                    }
-
-                    i++;
-               }
-
-            }
-
-            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-            sentenceNumber++;
-
-        }  //while
-
-    }//if
+        }
+    }
 
     if (svStatus.used_in_fix_mask == 0)
     {   // No sv used, so there will be no position report, so send
         // blank NMEA sentences
-        strlcpy(sentence, "$GPGSA,A,1,,,,,,,,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPVTG,,T,,M,,N,,K,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPRMC,,V,,,,,,,,,,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-
-        strlcpy(sentence, "$GPGGA,,,,,,0,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        nmea_send_no_fix(loc_eng_data_p, nmea_fix_talker(loc_eng_data_p));
     }
     else
     {   // cache the used in fix mask, as it will be needed to send $GPGSA
-        // during the position report
-        loc_eng_data_p->sv_used_mask = svStatus.used_in_fix_mask;
+        // during the position report. GpsSvStatus only has one for GPS.
+        loc_eng_data_p->sv_index.used_mask[LOC_ENG_GNSS_GPS] =
+            svStatus.used_in_fix_mask;
 
         // For RPC, the DOP are sent during sv report, so cache them
         // now to be sent during position report.
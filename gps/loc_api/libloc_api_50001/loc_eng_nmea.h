@@ -34,6 +34,8 @@
 
 #define NMEA_SENTENCE_MAX_LENGTH 200
 
+void loc_eng_nmea_init(loc_eng_data_s_type *loc_eng_data_p, gps_create_thread create_thread_cb);
+void loc_eng_nmea_cleanup(loc_eng_data_s_type *loc_eng_data_p);
 void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_data_p);
 int loc_eng_nmea_put_checksum(char *pNmea, int maxSize);
 void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p, const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended);
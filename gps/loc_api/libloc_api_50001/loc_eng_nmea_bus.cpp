@@ -0,0 +1,498 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng_nmea"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <loc_eng_nmea_bus.h>
+#include "log_util.h"
+#include "platform_lib_includes.h"
+
+// records a consumer takes out of the ring per lock
+#define NMEA_BUS_BATCH 8
+#define NMEA_TAP_MAX_CLIENTS 4
+
+typedef struct loc_eng_nmea_record_s
+{
+    int64_t timestamp;
+    int length;  // as reported to the consumers
+    int size;    // bytes in nmea, not counting the NUL
+    char nmea[LOC_ENG_NMEA_BUS_RECORD_SIZE];
+} loc_eng_nmea_record_s_type;
+
+struct loc_eng_nmea_consumer_s
+{
+    const char* name;
+    loc_eng_nmea_consumer_cb cb;
+    void* data;
+    void (*release)(void* data);
+    loc_eng_nmea_bus_s_type* bus;
+    uint64_t cursor;   // sequence number of the next record to read
+    uint64_t dropped;
+    struct loc_eng_dmn_conn_thelper thelper;
+    loc_eng_nmea_consumer_s_type* next;
+};
+
+struct loc_eng_nmea_bus_s
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint64_t head;     // sequence number of the next record to write
+    thelper_create_thread create_thread_cb;
+    loc_eng_nmea_consumer_s_type* consumers;
+    loc_eng_nmea_record_s_type ring[LOC_ENG_NMEA_BUS_SLOTS];
+};
+
+// UNIX socket consumer state
+typedef struct nmea_tap_s
+{
+    int listen_fd;
+    int clients[NMEA_TAP_MAX_CLIENTS];
+    char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+} nmea_tap_s_type;
+
+/*===========================================================================
+FUNCTION    nmea_bus_consumer_proc
+
+DESCRIPTION
+   Consumer thread loop body. Waits for records past the consumer's
+   cursor, copies up to NMEA_BUS_BATCH of them out of the ring and hands
+   them to the consumer outside of the lock. If the publisher lapped the
+   consumer, the cursor skips to the oldest record still in the ring.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   0
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int nmea_bus_consumer_proc(void* context)
+{
+    loc_eng_nmea_consumer_s_type* consumer = (loc_eng_nmea_consumer_s_type*)context;
+    loc_eng_nmea_bus_s_type* bus = consumer->bus;
+    loc_eng_nmea_record_s_type batch[NMEA_BUS_BATCH];
+    uint64_t lost = 0;
+    int count = 0;
+
+    pthread_mutex_lock(&bus->lock);
+    while (consumer->cursor == bus->head && !consumer->thelper.thread_exit) {
+        pthread_cond_wait(&bus->cond, &bus->lock);
+    }
+
+    if (bus->head - consumer->cursor > LOC_ENG_NMEA_BUS_SLOTS) {
+        lost = bus->head - consumer->cursor - LOC_ENG_NMEA_BUS_SLOTS;
+        consumer->cursor += lost;
+        consumer->dropped += lost;
+    }
+
+    while (count < NMEA_BUS_BATCH && consumer->cursor != bus->head) {
+        const loc_eng_nmea_record_s_type* rec =
+            &bus->ring[consumer->cursor & (LOC_ENG_NMEA_BUS_SLOTS - 1)];
+        batch[count].timestamp = rec->timestamp;
+        batch[count].length = rec->length;
+        batch[count].size = rec->size;
+        memcpy(batch[count].nmea, rec->nmea, rec->size + 1);
+        consumer->cursor++;
+        count++;
+    }
+    pthread_mutex_unlock(&bus->lock);
+
+    if (lost > 0) {
+        LOC_LOGW("%s:%d] %s fell behind, dropped %llu records",
+                 __func__, __LINE__, consumer->name, (unsigned long long)lost);
+    }
+
+    for (int i = 0; i < count; i++) {
+        consumer->cb(consumer->data, batch[i].timestamp,
+                     batch[i].nmea, batch[i].length);
+    }
+
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_bus_create
+
+DESCRIPTION
+   Creates an NMEA bus with no consumers. Consumer threads will be
+   started with create_thread_cb, or pthread_create if it is NULL.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   the bus, NULL on failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+loc_eng_nmea_bus_s_type* loc_eng_nmea_bus_create(thelper_create_thread create_thread_cb)
+{
+    loc_eng_nmea_bus_s_type* bus =
+        (loc_eng_nmea_bus_s_type*)calloc(1, sizeof(loc_eng_nmea_bus_s_type));
+    if (NULL == bus) {
+        LOC_LOGE("%s:%d] out of memory", __func__, __LINE__);
+        return NULL;
+    }
+
+    pthread_mutex_init(&bus->lock, NULL);
+    pthread_cond_init(&bus->cond, NULL);
+    bus->create_thread_cb = create_thread_cb;
+    return bus;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_bus_destroy
+
+DESCRIPTION
+   Stops and releases all consumers, then frees the bus.
+
+DEPENDENCIES
+   No more loc_eng_nmea_bus_publish() calls on the bus.
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_bus_destroy(loc_eng_nmea_bus_s_type* bus)
+{
+    if (NULL == bus) {
+        return;
+    }
+
+    while (NULL != bus->consumers) {
+        loc_eng_nmea_bus_unsubscribe(bus, bus->consumers);
+    }
+
+    pthread_cond_destroy(&bus->cond);
+    pthread_mutex_destroy(&bus->lock);
+    free(bus);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_bus_publish
+
+DESCRIPTION
+   Copies an NMEA report into the ring and wakes up the consumers.
+   size is the number of bytes to copy; length is what the consumers are
+   told, which loc_eng_nmea_send() has always reported one short.
+   Reports that do not fit a record are split after the last complete
+   sentence that does.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   The oldest records are overwritten, whether read yet or not.
+
+===========================================================================*/
+void loc_eng_nmea_bus_publish(loc_eng_nmea_bus_s_type* bus, int64_t timestamp,
+                              const char* nmea, int size, int length)
+{
+    pthread_mutex_lock(&bus->lock);
+    if (NULL == bus->consumers) {
+        pthread_mutex_unlock(&bus->lock);
+        return;
+    }
+
+    while (size > 0) {
+        int chunk = size;
+        if (chunk > LOC_ENG_NMEA_BUS_RECORD_SIZE - 1) {
+            chunk = LOC_ENG_NMEA_BUS_RECORD_SIZE - 1;
+            while (chunk > 0 && nmea[chunk - 1] != '\n') {
+                chunk--;
+            }
+            if (0 == chunk) {
+                chunk = LOC_ENG_NMEA_BUS_RECORD_SIZE - 1;
+            }
+        }
+
+        loc_eng_nmea_record_s_type* rec =
+            &bus->ring[bus->head & (LOC_ENG_NMEA_BUS_SLOTS - 1)];
+        rec->timestamp = timestamp;
+        rec->size = chunk;
+        rec->length = (chunk == size) ? length : chunk;
+        memcpy(rec->nmea, nmea, chunk);
+        rec->nmea[chunk] = '\0';
+        bus->head++;
+
+        nmea += chunk;
+        size -= chunk;
+        length -= chunk;
+    }
+
+    pthread_cond_broadcast(&bus->cond);
+    pthread_mutex_unlock(&bus->lock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_bus_subscribe
+
+DESCRIPTION
+   Adds a consumer and starts its thread. cb gets every record published
+   from now on, in order, unless the consumer falls more than
+   LOC_ENG_NMEA_BUS_SLOTS records behind. release, if not NULL, is called
+   with data once the consumer is stopped.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   the consumer, NULL on failure
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+loc_eng_nmea_consumer_s_type* loc_eng_nmea_bus_subscribe(loc_eng_nmea_bus_s_type* bus,
+                                                         const char* name,
+                                                         loc_eng_nmea_consumer_cb cb,
+                                                         void* data,
+                                                         void (*release)(void* data))
+{
+    loc_eng_nmea_consumer_s_type* consumer =
+        (loc_eng_nmea_consumer_s_type*)calloc(1, sizeof(loc_eng_nmea_consumer_s_type));
+    if (NULL == consumer) {
+        LOC_LOGE("%s:%d] out of memory", __func__, __LINE__);
+        return NULL;
+    }
+
+    consumer->name = name;
+    consumer->cb = cb;
+    consumer->data = data;
+    consumer->release = release;
+    consumer->bus = bus;
+
+    pthread_mutex_lock(&bus->lock);
+    consumer->cursor = bus->head;
+    consumer->next = bus->consumers;
+    bus->consumers = consumer;
+    pthread_mutex_unlock(&bus->lock);
+
+    if (loc_eng_dmn_conn_launch_thelper(&consumer->thelper, NULL, NULL,
+                                        nmea_bus_consumer_proc, NULL,
+                                        bus->create_thread_cb, consumer) != 0) {
+        LOC_LOGE("%s:%d] failed to start %s", __func__, __LINE__, name);
+        pthread_mutex_lock(&bus->lock);
+        bus->consumers = consumer->next;
+        pthread_mutex_unlock(&bus->lock);
+        thelper_signal_destroy(&consumer->thelper);
+        free(consumer);
+        return NULL;
+    }
+
+    LOC_LOGD("%s:%d] %s subscribed", __func__, __LINE__, name);
+    return consumer;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_bus_unsubscribe
+
+DESCRIPTION
+   Stops a consumer's thread, releases its data and frees it.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_bus_unsubscribe(loc_eng_nmea_bus_s_type* bus,
+                                  loc_eng_nmea_consumer_s_type* consumer)
+{
+    pthread_mutex_lock(&bus->lock);
+    for (loc_eng_nmea_consumer_s_type** pp = &bus->consumers; *pp != NULL;
+         pp = &(*pp)->next) {
+        if (*pp == consumer) {
+            *pp = consumer->next;
+            break;
+        }
+    }
+    loc_eng_dmn_conn_unblock_thelper(&consumer->thelper);
+    pthread_cond_broadcast(&bus->cond);
+    pthread_mutex_unlock(&bus->lock);
+
+    loc_eng_dmn_conn_join_thelper(&consumer->thelper);
+
+    LOC_LOGD("%s:%d] %s unsubscribed, %llu records dropped in total",
+             __func__, __LINE__, consumer->name,
+             (unsigned long long)consumer->dropped);
+
+    if (NULL != consumer->release) {
+        consumer->release(consumer->data);
+    }
+    free(consumer);
+}
+
+/*===========================================================================
+FUNCTION    nmea_tap_send
+
+DESCRIPTION
+   UNIX socket consumer: picks up newly connected clients, then sends the
+   record to every client as one packet. A client whose socket buffer is
+   full misses the record; one that went away is closed.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void nmea_tap_send(void* data, int64_t timestamp, const char* nmea, int length)
+{
+    nmea_tap_s_type* tap = (nmea_tap_s_type*)data;
+    int fd;
+
+    while ((fd = accept(tap->listen_fd, NULL, NULL)) >= 0) {
+        int i;
+        for (i = 0; i < NMEA_TAP_MAX_CLIENTS && tap->clients[i] >= 0; i++);
+        if (i == NMEA_TAP_MAX_CLIENTS) {
+            LOC_LOGW("%s:%d] too many clients", __func__, __LINE__);
+            close(fd);
+            continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        tap->clients[i] = fd;
+        LOC_LOGD("%s:%d] client %d connected", __func__, __LINE__, fd);
+    }
+
+    size_t size = strlen(nmea);
+    for (int i = 0; i < NMEA_TAP_MAX_CLIENTS; i++) {
+        if (tap->clients[i] < 0) {
+            continue;
+        }
+        if (send(tap->clients[i], nmea, size, MSG_DONTWAIT | MSG_NOSIGNAL) < 0 &&
+            errno != EAGAIN && errno != EWOULDBLOCK) {
+            LOC_LOGD("%s:%d] client %d gone: %s", __func__, __LINE__,
+                     tap->clients[i], strerror(errno));
+            close(tap->clients[i]);
+            tap->clients[i] = -1;
+        }
+    }
+}
+
+static void nmea_tap_release(void* data)
+{
+    nmea_tap_s_type* tap = (nmea_tap_s_type*)data;
+
+    for (int i = 0; i < NMEA_TAP_MAX_CLIENTS; i++) {
+        if (tap->clients[i] >= 0) {
+            close(tap->clients[i]);
+        }
+    }
+    close(tap->listen_fd);
+    unlink(tap->path);
+    free(tap);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_nmea_bus_add_socket
+
+DESCRIPTION
+   Adds a consumer that serves NMEA on a SOCK_SEQPACKET UNIX socket at
+   path, one sentence per packet, to up to NMEA_TAP_MAX_CLIENTS clients.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   the consumer, NULL on failure
+
+SIDE EFFECTS
+   Any existing file at path is removed.
+
+===========================================================================*/
+loc_eng_nmea_consumer_s_type* loc_eng_nmea_bus_add_socket(loc_eng_nmea_bus_s_type* bus,
+                                                          const char* path)
+{
+    struct sockaddr_un addr;
+    nmea_tap_s_type* tap = (nmea_tap_s_type*)calloc(1, sizeof(nmea_tap_s_type));
+    if (NULL == tap) {
+        LOC_LOGE("%s:%d] out of memory", __func__, __LINE__);
+        return NULL;
+    }
+    for (int i = 0; i < NMEA_TAP_MAX_CLIENTS; i++) {
+        tap->clients[i] = -1;
+    }
+    strlcpy(tap->path, path, sizeof(tap->path));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+
+    tap->listen_fd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (tap->listen_fd < 0) {
+        LOC_LOGE("%s:%d] socket failed: %s", __func__, __LINE__, strerror(errno));
+        free(tap);
+        return NULL;
+    }
+    fcntl(tap->listen_fd, F_SETFL, fcntl(tap->listen_fd, F_GETFL) | O_NONBLOCK);
+
+    unlink(path);
+    if (bind(tap->listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(tap->listen_fd, NMEA_TAP_MAX_CLIENTS) < 0) {
+        LOC_LOGE("%s:%d] %s: %s", __func__, __LINE__, path, strerror(errno));
+        close(tap->listen_fd);
+        free(tap);
+        return NULL;
+    }
+
+    loc_eng_nmea_consumer_s_type* consumer =
+        loc_eng_nmea_bus_subscribe(bus, "nmea_tap", nmea_tap_send, tap, nmea_tap_release);
+    if (NULL == consumer) {
+        nmea_tap_release(tap);
+    }
+    return consumer;
+}
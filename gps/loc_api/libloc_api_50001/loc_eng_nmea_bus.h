@@ -0,0 +1,72 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_NMEA_BUS_H
+#define LOC_ENG_NMEA_BUS_H
+
+#include <stdint.h>
+#include <loc_eng_dmn_conn_thread_helper.h>
+
+/* NMEA fan-out bus
+
+   The MsgTask thread publishes every NMEA report into one ring of
+   LOC_ENG_NMEA_BUS_SLOTS records. Each consumer reads the ring through
+   its own cursor on its own thread. A consumer that falls more than the
+   ring behind loses its oldest records; the publisher never waits. */
+
+#define LOC_ENG_NMEA_BUS_SLOTS 64  /* power of 2 */
+#define LOC_ENG_NMEA_BUS_RECORD_SIZE 256
+
+#ifdef _ANDROID_
+#define LOC_ENG_NMEA_TAP_PATH "/data/misc/gpsone_d/nmea_tap"
+#else
+#define LOC_ENG_NMEA_TAP_PATH "/tmp/nmea_tap"
+#endif
+
+typedef void (*loc_eng_nmea_consumer_cb)(void* data, int64_t timestamp,
+                                         const char* nmea, int length);
+
+typedef struct loc_eng_nmea_bus_s loc_eng_nmea_bus_s_type;
+typedef struct loc_eng_nmea_consumer_s loc_eng_nmea_consumer_s_type;
+
+loc_eng_nmea_bus_s_type* loc_eng_nmea_bus_create(thelper_create_thread create_thread_cb);
+void loc_eng_nmea_bus_destroy(loc_eng_nmea_bus_s_type* bus);
+void loc_eng_nmea_bus_publish(loc_eng_nmea_bus_s_type* bus, int64_t timestamp,
+                              const char* nmea, int size, int length);
+loc_eng_nmea_consumer_s_type* loc_eng_nmea_bus_subscribe(loc_eng_nmea_bus_s_type* bus,
+                                                         const char* name,
+                                                         loc_eng_nmea_consumer_cb cb,
+                                                         void* data,
+                                                         void (*release)(void* data));
+void loc_eng_nmea_bus_unsubscribe(loc_eng_nmea_bus_s_type* bus,
+                                  loc_eng_nmea_consumer_s_type* consumer);
+loc_eng_nmea_consumer_s_type* loc_eng_nmea_bus_add_socket(loc_eng_nmea_bus_s_type* bus,
+                                                          const char* path);
+
+#endif // LOC_ENG_NMEA_BUS_H
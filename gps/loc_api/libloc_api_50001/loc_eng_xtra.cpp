@@ -30,6 +30,14 @@
 #define LOG_NDDEBUG 0
 #define LOG_TAG "LocSvc_eng"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <loc_eng.h>
 #include <MsgTask.h>
 #include "log_util.h"
@@ -55,33 +63,222 @@ struct LocEngRequestXtraServer : public LocMsg {
     }
 };
 
-struct LocEngInjectXtraData : public LocMsg {
+// what LocEngInjectXtraPart hands the LocApi at a time; QMI takes
+// XTRA in parts of up to 1 KB
+#define XTRA_INJECT_PART_SIZE 1024
+
+static inline int64_t nowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Adler-32, as zlib has it, so an injected file can be checked with
+// any zlib based tool
+static uint32_t xtraAdler32(const char* data, int length) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint32_t a = 1, b = 0;
+    while (length > 0) {
+        // the most bytes b can take before it may overflow
+        int n = length < 5552 ? length : 5552;
+        length -= n;
+        while (n--) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void xtraFreeCopy(const char* data, int length, void* context) {
+    delete[] data;
+}
+
+static void xtraUnmap(const char* data, int length, void* context) {
+    munmap((void*)data, length);
+}
+
+// one injection, from its first part to its last; deleted by the last
+// LocEngInjectXtraPart that has it, and releases the data with whatever
+// gave it, even if no part is ever handled
+struct LocEngXtraInjection {
+    LocEngAdapter* const mAdapter;
+    loc_eng_xtra_data_s_type* const mXtra;
+    const char* const mData;
+    const int mLen;
+    const gps_xtra_release mRelease;
+    void* const mContext;
+    char* const mSource;
+    const uint32_t mChecksum;
+    const int64_t mQueuedNs;
+    int64_t mStartNs;
+    int mParts;
+    inline LocEngXtraInjection(LocEngAdapter* adapter,
+                               loc_eng_xtra_data_s_type* xtra,
+                               const char* data, int len,
+                               gps_xtra_release release, void* context,
+                               const char* source, uint32_t checksum,
+                               int64_t queuedNs):
+        mAdapter(adapter), mXtra(xtra),
+        mData(data), mLen(len), mRelease(release), mContext(context),
+        mSource(strdup(source)), mChecksum(checksum), mQueuedNs(queuedNs),
+        mStartNs(0),
+        mParts((len + XTRA_INJECT_PART_SIZE - 1) / XTRA_INJECT_PART_SIZE)
+    {
+    }
+    inline ~LocEngXtraInjection()
+    {
+        mRelease(mData, mLen, mContext);
+        __sync_fetch_and_sub(&mXtra->inject_pending, 1);
+        free(mSource);
+    }
+};
+
+// runs on the adapter's MsgTask, in line with every other LocApi call,
+// one part at a time. Each part queues the next behind whatever came in
+// meanwhile, so reports wait for a part at most, not for the whole data.
+struct LocEngInjectXtraPart : public LocMsg {
+    LocEngXtraInjection* const mInjection;
+    const int mPart;
+    mutable bool mHandedOff;
+    inline LocEngInjectXtraPart(LocEngXtraInjection* injection, int part):
+        LocMsg(), mInjection(injection), mPart(part), mHandedOff(false)
+    {
+        locallog();
+    }
+    inline ~LocEngInjectXtraPart()
+    {
+        if (!mHandedOff) {
+            delete mInjection;
+        }
+    }
+    inline virtual void proc() const {
+        LocEngXtraInjection* x = mInjection;
+        int offset = (mPart - 1) * XTRA_INJECT_PART_SIZE;
+        int length = x->mLen - offset < XTRA_INJECT_PART_SIZE ?
+            x->mLen - offset : XTRA_INJECT_PART_SIZE;
+        if (1 == mPart) {
+            x->mStartNs = nowNs();
+        }
+        enum loc_api_adapter_err err =
+            x->mAdapter->setXtraDataPart((char*)x->mData + offset, length,
+                                         mPart, x->mParts, x->mLen);
+        if (LOC_API_ADAPTER_ERR_UNSUPPORTED == err && 1 == mPart) {
+            // this LocApi takes the data whole only, in one call that
+            // holds up the MsgTask for all of it
+            x->mParts = 1;
+            err = x->mAdapter->setXtraData((char*)x->mData, x->mLen);
+        } else if (LOC_API_ADAPTER_ERR_SUCCESS == err && mPart < x->mParts) {
+            // from here the next part owns the injection; should the
+            // MsgTask refuse it, its destructor still ends the injection
+            mHandedOff = true;
+            if (!x->mAdapter->sendMsg(new LocEngInjectXtraPart(x, mPart + 1))) {
+                LOC_LOGE("%s:%d]: part %d of %d from %s dropped, adapter Q refused",
+                         __func__, __LINE__, mPart + 1, x->mParts, x->mSource);
+            }
+            return;
+        }
+        int64_t doneNs = nowNs();
+
+        x->mXtra->inject_count++;
+        LOC_LOGI("%s:%d]: #%u: %d bytes from %s, adler32 %08x, "
+                 "queued %lld ms, injected in %lld ms, part %d of %d, "
+                 "err %d, %d pending",
+                 __func__, __LINE__, x->mXtra->inject_count, x->mLen,
+                 x->mSource, x->mChecksum,
+                 (long long)((x->mStartNs - x->mQueuedNs) / 1000000),
+                 (long long)((doneNs - x->mStartNs) / 1000000),
+                 mPart, x->mParts, err, x->mXtra->inject_pending - 1);
+    }
+    inline  void locallog() const {
+        LOC_LOGV("part: %d\n  data: %p\n  source: %s",
+                 mPart, mInjection->mData, mInjection->mSource);
+    }
+    inline virtual void log() const {
+        locallog();
+    }
+};
+
+// runs on xtra_module_data.inject_task; reads the data through once, so
+// a mapped file is paged in before its parts go to the adapter's
+// MsgTask, then hands it on to LocEngInjectXtraPart. Releases the data
+// itself only if it never got that far.
+struct LocEngPrepXtraData : public LocMsg {
     LocEngAdapter* mAdapter;
-    char* mData;
+    loc_eng_xtra_data_s_type* mXtra;
+    const char* mData;
     const int mLen;
-    inline LocEngInjectXtraData(LocEngAdapter* adapter,
-                                char* data, int len):
-        LocMsg(), mAdapter(adapter),
-        mData(new char[len]), mLen(len)
+    const gps_xtra_release mRelease;
+    void* const mContext;
+    char* const mSource;
+    const int64_t mQueuedNs;
+    mutable bool mHandedOff;
+    inline LocEngPrepXtraData(LocEngAdapter* adapter,
+                              loc_eng_xtra_data_s_type* xtra,
+                              const char* data, int len,
+                              gps_xtra_release release, void* context,
+                              const char* source):
+        LocMsg(), mAdapter(adapter), mXtra(xtra),
+        mData(data), mLen(len), mRelease(release), mContext(context),
+        mSource(strdup(source)), mQueuedNs(nowNs()), mHandedOff(false)
     {
-        memcpy((void*)mData, (void*)data, len);
+        __sync_fetch_and_add(&mXtra->inject_pending, 1);
         locallog();
     }
-    inline ~LocEngInjectXtraData()
+    inline ~LocEngPrepXtraData()
     {
-        delete[] mData;
+        if (!mHandedOff) {
+            mRelease(mData, mLen, mContext);
+            __sync_fetch_and_sub(&mXtra->inject_pending, 1);
+        }
+        free(mSource);
     }
     inline virtual void proc() const {
-        mAdapter->setXtraData(mData, mLen);
+        uint32_t checksum = xtraAdler32(mData, mLen);
+        // from here the injection owns the data; should the adapter's
+        // MsgTask refuse its first part, that still releases it
+        mHandedOff = true;
+        if (!mAdapter->sendMsg(new LocEngInjectXtraPart(
+                new LocEngXtraInjection(mAdapter, mXtra, mData, mLen,
+                                        mRelease, mContext, mSource,
+                                        checksum, mQueuedNs), 1))) {
+            LOC_LOGE("%s:%d]: %d bytes from %s dropped, adapter Q refused",
+                     __func__, __LINE__, mLen, mSource);
+        }
     }
     inline  void locallog() const {
-        LOC_LOGV("length: %d\n  data: %p", mLen, mData);
+        LOC_LOGV("length: %d\n  data: %p\n  source: %s",
+                 mLen, mData, mSource);
     }
     inline virtual void log() const {
         locallog();
     }
 };
 
+static void loc_eng_xtra_send(loc_eng_data_s_type &loc_eng_data,
+                              const char* data, int length,
+                              gps_xtra_release release, void* context,
+                              const char* source)
+{
+    loc_eng_xtra_data_s_type* xtra = &loc_eng_data.xtra_module_data;
+    LocEngAdapter* adapter = loc_eng_data.adapter;
+    LocMsg* msg = new LocEngPrepXtraData(adapter, xtra, data, length,
+                                         release, context, source);
+    bool sent;
+
+    if (NULL != xtra->inject_task) {
+        sent = xtra->inject_task->sendMsg(msg);
+    } else {
+        sent = adapter->sendMsg(msg);
+    }
+    if (!sent) {
+        LOC_LOGE("%s:%d]: %d bytes from %s dropped, Q refused",
+                 __func__, __LINE__, length, source);
+    }
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_xtra_init
 
@@ -136,8 +333,101 @@ SIDE EFFECTS
 int loc_eng_xtra_inject_data(loc_eng_data_s_type &loc_eng_data,
                              char* data, int length)
 {
-    LocEngAdapter* adapter = loc_eng_data.adapter;
-    adapter->sendMsg(new LocEngInjectXtraData(adapter, data, length));
+    // data is only ours for the call
+    char* copy = new char[length];
+    memcpy((void*)copy, (void*)data, length);
+    loc_eng_xtra_send(loc_eng_data, copy, length, xtraFreeCopy, NULL, "copy");
+
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_inject_file
+
+DESCRIPTION
+   Maps an XTRA file read only and injects it from the mapping, without
+   reading it into a buffer first.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0: success
+   -1: the file could not be mapped
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_xtra_inject_file(loc_eng_data_s_type &loc_eng_data,
+                             const char* path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOC_LOGE("%s:%d]: open %s failed: %s", __func__, __LINE__,
+                 path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (0 != fstat(fd, &st)) {
+        LOC_LOGE("%s:%d]: fstat %s failed: %s", __func__, __LINE__,
+                 path, strerror(errno));
+    } else if (st.st_size <= 0 || st.st_size > INT_MAX) {
+        LOC_LOGE("%s:%d]: %s has a bad size %lld", __func__, __LINE__,
+                 path, (long long)st.st_size);
+    } else {
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == data) {
+            LOC_LOGE("%s:%d]: mmap %s failed: %s", __func__, __LINE__,
+                     path, strerror(errno));
+        }
+    }
+    // the mapping holds its own reference to the file
+    close(fd);
+    if (MAP_FAILED == data) {
+        return -1;
+    }
+
+    // start the page ins now rather than faulting them in one by one
+    // once the injection runs
+    madvise(data, st.st_size, MADV_WILLNEED);
+    loc_eng_xtra_send(loc_eng_data, (const char*)data, (int)st.st_size,
+                      xtraUnmap, NULL, path);
+
+    return 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_inject_buffer
+
+DESCRIPTION
+   Injects XTRA data in place. The data must stay valid until release is
+   called with it.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0: success
+   -1: bad data; release is not called
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int loc_eng_xtra_inject_buffer(loc_eng_data_s_type &loc_eng_data,
+                               const char* data, int length,
+                               gps_xtra_release release, void* context)
+{
+    if (NULL == data || length <= 0 || NULL == release) {
+        LOC_LOGE("%s:%d]: bad buffer %p, length %d", __func__, __LINE__,
+                 data, length);
+        return -1;
+    }
+
+    loc_eng_xtra_send(loc_eng_data, data, length, release, context, "buffer");
 
     return 0;
 }
@@ -165,3 +455,31 @@ int loc_eng_xtra_request_server(loc_eng_data_s_type &loc_eng_data)
     return 0;
 
 }
+
+/*===========================================================================
+FUNCTION    loc_eng_xtra_start_inject_task
+
+DESCRIPTION
+   Starts the thread XTRA data is read in on before it is injected on
+   the adapter's MsgTask. Until it is started it is read in there too.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_xtra_start_inject_task(loc_eng_data_s_type &loc_eng_data,
+                                    gps_create_thread create_thread_cb)
+{
+    loc_eng_xtra_data_s_type* xtra = &loc_eng_data.xtra_module_data;
+
+    if (NULL == xtra->inject_task) {
+        xtra->inject_task = new MsgTask((MsgTask::tCreate)create_thread_cb,
+                                        "Loc_xtra_inject");
+    }
+}
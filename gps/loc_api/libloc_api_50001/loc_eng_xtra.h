@@ -32,6 +32,10 @@
 
 #include <hardware/gps.h>
 
+namespace loc_core {
+    class MsgTask;
+}
+
 // Module data
 typedef struct
 {
@@ -42,6 +46,14 @@ typedef struct
    // XTRA data buffer
    char                          *xtra_data_for_injection;  // NULL if no pending data
    int                            xtra_data_len;
+
+   // XTRA data is read in here, so paging in a file never holds up the
+   // reports on the adapter's MsgTask; the injection itself still runs
+   // there, with the other LocApi calls, one part per msg. NULL until
+   // loc_eng_init
+   const loc_core::MsgTask       *inject_task;
+   volatile int32_t               inject_pending;
+   uint32_t                       inject_count;
 } loc_eng_xtra_data_s_type;
 
 #endif // LOC_ENG_XTRA_H
@@ -0,0 +1,189 @@
+ifneq ($(BUILD_TINY_ANDROID),true)
+ifeq ($(HOST_OS),linux)
+
+LOCAL_PATH := $(call my-dir)
+
+# Host tools and tests for the location stack. They link the static host
+# builds of libgps.utils, libloc_core and libloc_eng, with the cutils /
+# log / utils stand-ins below in place of the Android libraries. Each
+# one prints its results as JSON on stdout and exits non zero if a check
+# fails.
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    shim/loc_host_shim.cpp
+
+LOCAL_CFLAGS := \
+    -include $(LOCAL_PATH)/shim/loc_host_shim.h
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/shim
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := \
+    $(LOCAL_PATH)/shim
+
+LOCAL_MODULE := libloc_host_shim
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+
+LOC_HOST_TEST_STATIC_LIBRARIES := \
+    libloc_eng_host \
+    libloc_core_host \
+    libgps.utils_host \
+    libloc_host_shim
+
+LOC_HOST_TEST_CFLAGS := \
+    -fno-short-enums \
+    -D_ANDROID_ \
+    -include $(LOCAL_PATH)/shim/loc_host_shim.h
+
+LOC_HOST_TEST_C_INCLUDES := \
+    $(LOCAL_PATH)/shim \
+    $(LOCAL_PATH)/../utils \
+    $(LOCAL_PATH)/../utils/platform_lib_abstractions \
+    $(LOCAL_PATH)/../core \
+    $(LOCAL_PATH)/../loc_api/libloc_api_50001 \
+    hardware/libhardware/include
+
+LOC_HOST_TEST_LDLIBS := \
+    -lpthread \
+    -ldl \
+    -lrt
+
+# msg_q, MsgTask, loc_timer, NMEA and loc_read_conf
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_bench.cpp
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# msg_q under contention
+include $(CLEAR_VARS)
+LOCAL_MODULE := msg_q_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := msg_q_bench.c
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# LocApiTrace recording played back through LocApiReplay
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_replay_test
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_replay_test.cpp
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# loc_eng_dns against a stub resolver: cache latency, superseded lookups
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_eng_dns_test
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_eng_dns_test.cpp
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# 100k loc_timer arm / cancel, fire latency and thread count
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_timer_stress
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_timer_stress.c
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# linked_list malloc, pooled and intrusive flavours
+include $(CLEAR_VARS)
+LOCAL_MODULE := linked_list_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := linked_list_bench.c
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# NMEA against nmea_golden.txt, and sentences per second
+include $(CLEAR_VARS)
+LOCAL_MODULE := nmea_golden_test
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := nmea_golden_test.cpp
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# LocApiBase report dispatch to N adapters on a fake LocApi
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_api_dispatch_test
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_api_dispatch_test.cpp
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# LOC_LOGx cost filtered out, synchronous and deferred
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_dlog_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_dlog_bench.c
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# dmn_conn round trips over the FIFOs and the sockets
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_dmn_conn_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_dmn_conn_bench.cpp
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# dmn_conn ATL request storms on the FIFO and batched transports
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_dmn_conn_storm
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_dmn_conn_storm.cpp
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+# XTRA injected a part at a time between reports
+include $(CLEAR_VARS)
+LOCAL_MODULE := loc_eng_xtra_test
+LOCAL_MODULE_TAGS := optional
+LOCAL_SRC_FILES := loc_eng_xtra_test.cpp
+LOCAL_CFLAGS := $(LOC_HOST_TEST_CFLAGS)
+LOCAL_C_INCLUDES := $(LOC_HOST_TEST_C_INCLUDES)
+LOCAL_STATIC_LIBRARIES := $(LOC_HOST_TEST_STATIC_LIBRARIES)
+LOCAL_LDLIBS := $(LOC_HOST_TEST_LDLIBS)
+include $(BUILD_HOST_EXECUTABLE)
+
+endif # HOST_OS linux
+endif # not BUILD_TINY_ANDROID
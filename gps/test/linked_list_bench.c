@@ -0,0 +1,217 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Microbenchmark of the linked_list flavours: the malloc per element
+   list, the pooled one and the intrusive one. Times FIFO add / remove
+   at a steady queue depth, the msg_q pattern, and a search that removes
+   an element from the middle. Checks FIFO order on the way. Prints one
+   JSON object:
+
+     linked_list_bench [operations, default 1000000] */
+
+#define LOG_TAG "LocSvc_ll_bench"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <linked_list.h>
+#include <log_util.h>
+
+#define LL_BENCH_DEPTH 32
+#define LL_BENCH_SEARCH_LEN 64
+
+typedef struct {
+    long value;
+    linked_list_node link;
+} ll_bench_obj;
+
+static ll_bench_obj ll_bench_objs[LL_BENCH_SEARCH_LEN];
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool ll_bench_equal(void* data_0, void* data)
+{
+    return ((ll_bench_obj*)data)->value == (long)data_0;
+}
+
+static bool ll_bench_intr_equal(void* data_0, linked_list_node* node)
+{
+    return LINKED_LIST_ENTRY(node, ll_bench_obj, link)->value == (long)data_0;
+}
+
+/* add / remove through a list kept LL_BENCH_DEPTH deep; ns per pair,
+   -1 if an element came out of order */
+static double ll_bench_fifo(void* list, int ops)
+{
+    long next_in = 0, next_out = 0;
+    int64_t start;
+    void* data;
+    int i;
+
+    for (; next_in < LL_BENCH_DEPTH; next_in++) {
+        linked_list_add(list, &ll_bench_objs[next_in % LL_BENCH_SEARCH_LEN], NULL);
+    }
+    start = now_ns();
+    for (i = 0; i < ops; i++) {
+        linked_list_add(list, &ll_bench_objs[next_in++ % LL_BENCH_SEARCH_LEN], NULL);
+        linked_list_remove(list, &data);
+        if (data != &ll_bench_objs[next_out++ % LL_BENCH_SEARCH_LEN]) {
+            return -1;
+        }
+    }
+    return (double)(now_ns() - start) / ops;
+}
+
+static double ll_bench_intr_fifo(int ops)
+{
+    static ll_bench_obj objs[LL_BENCH_DEPTH + 1];
+    linked_list_intr list;
+    linked_list_node* node;
+    long next_in = 0, next_out = 0;
+    int64_t start;
+    int i;
+
+    linked_list_intr_init(&list);
+    for (; next_in < LL_BENCH_DEPTH; next_in++) {
+        objs[next_in].value = next_in;
+        linked_list_intr_add(&list, &objs[next_in].link);
+    }
+    start = now_ns();
+    for (i = 0; i < ops; i++) {
+        /* the removed node goes back in, the way a LocMsg would be reused */
+        ll_bench_obj* obj = &objs[next_in % (LL_BENCH_DEPTH + 1)];
+        obj->value = next_in++;
+        linked_list_intr_add(&list, &obj->link);
+        linked_list_intr_remove(&list, &node);
+        if (LINKED_LIST_ENTRY(node, ll_bench_obj, link)->value != next_out++) {
+            return -1;
+        }
+    }
+    return (double)(now_ns() - start) / ops;
+}
+
+/* finds, removes and re-adds the middle one of LL_BENCH_SEARCH_LEN */
+static double ll_bench_search(void* list, int ops)
+{
+    int64_t start;
+    void* data;
+    long i;
+
+    for (i = 0; i < LL_BENCH_SEARCH_LEN; i++) {
+        linked_list_add(list, &ll_bench_objs[i], NULL);
+    }
+    start = now_ns();
+    for (i = 0; i < ops; i++) {
+        long value = (i * 7 + LL_BENCH_SEARCH_LEN / 2) % LL_BENCH_SEARCH_LEN;
+        data = NULL;
+        linked_list_search(list, &data, ll_bench_equal, (void*)value, true);
+        if (NULL == data) {
+            return -1;
+        }
+        linked_list_add(list, data, NULL);
+    }
+    return (double)(now_ns() - start) / ops;
+}
+
+static double ll_bench_intr_search(int ops)
+{
+    static ll_bench_obj objs[LL_BENCH_SEARCH_LEN];
+    linked_list_intr list;
+    linked_list_node* node;
+    int64_t start;
+    long i;
+
+    linked_list_intr_init(&list);
+    for (i = 0; i < LL_BENCH_SEARCH_LEN; i++) {
+        objs[i].value = i;
+        linked_list_intr_add(&list, &objs[i].link);
+    }
+    start = now_ns();
+    for (i = 0; i < ops; i++) {
+        long value = (i * 7 + LL_BENCH_SEARCH_LEN / 2) % LL_BENCH_SEARCH_LEN;
+        node = linked_list_intr_search(&list, ll_bench_intr_equal, (void*)value,
+                                       true);
+        if (NULL == node) {
+            return -1;
+        }
+        linked_list_intr_add(&list, node);
+    }
+    return (double)(now_ns() - start) / ops;
+}
+
+int main(int argc, char** argv)
+{
+    int ops = argc > 1 ? atoi(argv[1]) : 1000000;
+    double fifo_malloc, fifo_pooled, fifo_intr;
+    double search_malloc, search_pooled, search_intr;
+    void* list;
+    long i;
+    int ok;
+
+    loc_logger.DEBUG_LEVEL = 2;
+    for (i = 0; i < LL_BENCH_SEARCH_LEN; i++) {
+        ll_bench_objs[i].value = i;
+    }
+
+    linked_list_init(&list);
+    fifo_malloc = ll_bench_fifo(list, ops);
+    linked_list_flush(list);
+    search_malloc = ll_bench_search(list, ops / 10);
+    linked_list_destroy(&list);
+
+    linked_list_init_pooled(&list, 0);
+    fifo_pooled = ll_bench_fifo(list, ops);
+    linked_list_flush(list);
+    search_pooled = ll_bench_search(list, ops / 10);
+    linked_list_destroy(&list);
+
+    fifo_intr = ll_bench_intr_fifo(ops);
+    search_intr = ll_bench_intr_search(ops / 10);
+
+    ok = fifo_malloc >= 0 && fifo_pooled >= 0 && fifo_intr >= 0 &&
+         search_malloc >= 0 && search_pooled >= 0 && search_intr >= 0;
+
+    printf("{\n");
+    printf("  \"ops\": %d,\n", ops);
+    printf("  \"depth\": %d,\n", LL_BENCH_DEPTH);
+    printf("  \"fifo_ns\": {\"malloc\": %.1f, \"pooled\": %.1f, \"intrusive\": %.1f},\n",
+           fifo_malloc, fifo_pooled, fifo_intr);
+    printf("  \"search_%d_ns\": {\"malloc\": %.1f, \"pooled\": %.1f, \"intrusive\": %.1f},\n",
+           LL_BENCH_SEARCH_LEN, search_malloc, search_pooled, search_intr);
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,341 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Drives LocApiBase report dispatch with a fake LocApi and up to
+   MAX_ADAPTERS adapters, each asking for a different mix of position,
+   SV, NMEA and status reports. Checks that every adapter gets every
+   report, whatever its mask, before and after adapters are removed
+   from the middle of the table, that the LocApi is reopened only when
+   the union of the masks changes, and closed with the last adapter.
+   Then times reportPosition to all the adapters. Prints one JSON
+   object:
+
+     loc_api_dispatch_test [adapters, default MAX_ADAPTERS] */
+
+#define LOG_TAG "LocSvc_dispatch_test"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <MsgTask.h>
+#include <ContextBase.h>
+#include <LocApiBase.h>
+#include <LocAdapterBase.h>
+#include <log_util.h>
+
+using namespace loc_core;
+
+#define DISPATCH_TEST_REPORTS 100
+#define DISPATCH_TEST_BENCH_REPORTS 1000000
+
+// records what LocOpenMsg / removeAdapter ask of the modem
+class DispatchTestLocApi : public LocApiBase {
+public:
+    int mOpens;
+    int mCloses;
+    LOC_API_ADAPTER_EVENT_MASK_T mOpenMask;
+    inline DispatchTestLocApi(const MsgTask* msgTask) :
+        LocApiBase(msgTask, 0), mOpens(0), mCloses(0), mOpenMask(0) {}
+    virtual enum loc_api_adapter_err
+        open(LOC_API_ADAPTER_EVENT_MASK_T mask) {
+        mOpens++;
+        mOpenMask = mask;
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    virtual enum loc_api_adapter_err
+        close() {
+        mCloses++;
+        mOpenMask = 0;
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+};
+
+// a context whose LocApi the test picks
+class DispatchTestContext : public ContextBase {
+public:
+    inline DispatchTestContext(const MsgTask* msgTask) :
+        ContextBase(msgTask, 0, "liblbs_core.so") {}
+    inline void setLocApi(LocApiBase* locApi) { mLocApi = locApi; }
+};
+
+// counts in place, on the thread that reports
+class DispatchTestAdapter : public LocAdapterBase {
+public:
+    uint32_t mPosition;
+    uint32_t mSv;
+    uint32_t mNmea;
+    uint32_t mStatus;
+    inline DispatchTestAdapter(ContextBase* context,
+                               LOC_API_ADAPTER_EVENT_MASK_T mask) :
+        LocAdapterBase(mask, context),
+        mPosition(0), mSv(0), mNmea(0), mStatus(0) {}
+    virtual void reportPosition(UlpLocation& location,
+                                GpsLocationExtended& locationExtended,
+                                void* locationExt,
+                                enum loc_sess_status status,
+                                LocPosTechMask techMask) {
+        mPosition++;
+    }
+    virtual void reportSv(GpsSvStatus& svStatus,
+                          GpsLocationExtended& locationExtended,
+                          void* svExt) {
+        mSv++;
+    }
+    virtual void reportNmea(const char* nmea, int length) {
+        mNmea++;
+    }
+    virtual void reportStatus(GpsStatusValue status) {
+        mStatus++;
+    }
+};
+
+struct DispatchTestSyncMsg : public LocMsg {
+    volatile bool* mDone;
+    inline DispatchTestSyncMsg(volatile bool* done) : LocMsg(), mDone(done) {}
+    inline virtual void proc() const {
+        *mDone = true;
+    }
+};
+
+// waits for the LocOpenMsgs sent so far
+static void sync(const MsgTask* task)
+{
+    volatile bool done = false;
+    task->sendMsg(new DispatchTestSyncMsg(&done));
+    while (!done) {
+        usleep(1000);
+    }
+}
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// a different mix for each k, including one with no report at all
+static LOC_API_ADAPTER_EVENT_MASK_T dispatchTestMask(int k)
+{
+    LOC_API_ADAPTER_EVENT_MASK_T mask = 0;
+    if (0 == k % 2) {
+        mask |= LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT;
+    }
+    if (0 == k % 3) {
+        mask |= LOC_API_ADAPTER_BIT_SATELLITE_REPORT;
+    }
+    if (1 == k % 4) {
+        mask |= LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT;
+    }
+    if (3 == k % 8) {
+        mask |= LOC_API_ADAPTER_BIT_NMEA_POSITION_REPORT;
+    }
+    if (0 == k % 5) {
+        mask |= LOC_API_ADAPTER_BIT_STATUS_REPORT;
+    }
+    return mask;
+}
+
+static void report(LocApiBase* locApi, int reports)
+{
+    UlpLocation location;
+    GpsLocationExtended extended;
+    GpsSvStatus sv;
+    memset(&location, 0, sizeof(location));
+    memset(&extended, 0, sizeof(extended));
+    memset(&sv, 0, sizeof(sv));
+
+    for (int i = 0; i < reports; i++) {
+        locApi->reportPosition(location, extended, NULL, LOC_SESS_SUCCESS);
+        locApi->reportSv(sv, extended, NULL);
+        locApi->reportNmea("$GPGGA,,,,,,0,,,,,,,,*66\r\n", 26);
+        locApi->reportStatus(GPS_STATUS_SESSION_BEGIN);
+    }
+}
+
+// every live adapter got reports more of each report since its counts
+// were cleared; the mask only decides what the LocApi is opened with
+static bool checkCounts(DispatchTestAdapter** adapters, int count,
+                        int reports, const char* when)
+{
+    bool ok = true;
+    for (int k = 0; k < count; k++) {
+        DispatchTestAdapter* adapter = adapters[k];
+        if (NULL == adapter) {
+            continue;
+        }
+        uint32_t expected = (uint32_t)reports;
+        if (adapter->mPosition != expected || adapter->mSv != expected ||
+            adapter->mNmea != expected || adapter->mStatus != expected) {
+            fprintf(stderr, "%s: adapter %d (mask %x) got %u/%u/%u/%u "
+                    "position/sv/nmea/status, not %u of each\n", when, k,
+                    (unsigned)adapter->getEvtMask(), adapter->mPosition,
+                    adapter->mSv, adapter->mNmea, adapter->mStatus, expected);
+            ok = false;
+        }
+        adapter->mPosition = adapter->mSv = adapter->mNmea = adapter->mStatus = 0;
+    }
+    return ok;
+}
+
+static LOC_API_ADAPTER_EVENT_MASK_T unionMask(DispatchTestAdapter** adapters,
+                                              int count)
+{
+    LOC_API_ADAPTER_EVENT_MASK_T mask = 0;
+    for (int k = 0; k < count; k++) {
+        if (NULL != adapters[k]) {
+            mask |= adapters[k]->getEvtMask();
+        }
+    }
+    return mask;
+}
+
+// ns per reportPosition with count adapters
+static double benchPosition(DispatchTestContext& context, int count)
+{
+    const MsgTask* task = context.getMsgTask();
+    DispatchTestLocApi* locApi = new DispatchTestLocApi(task);
+    context.setLocApi(locApi);
+    DispatchTestAdapter* adapters[MAX_ADAPTERS];
+    for (int k = 0; k < count; k++) {
+        adapters[k] = new DispatchTestAdapter(&context,
+            LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT);
+    }
+    sync(task);
+
+    UlpLocation location;
+    GpsLocationExtended extended;
+    memset(&location, 0, sizeof(location));
+    memset(&extended, 0, sizeof(extended));
+    int64_t start = nowNs();
+    for (int i = 0; i < DISPATCH_TEST_BENCH_REPORTS; i++) {
+        locApi->reportPosition(location, extended, NULL, LOC_SESS_SUCCESS);
+    }
+    int64_t elapsed = nowNs() - start;
+
+    for (int k = 0; k < count; k++) {
+        delete adapters[k];
+    }
+    sync(task);
+    delete locApi;
+    return (double)elapsed / DISPATCH_TEST_BENCH_REPORTS;
+}
+
+int main(int argc, char** argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : MAX_ADAPTERS;
+    if (count < 1 || count > MAX_ADAPTERS) {
+        fprintf(stderr, "1 to %d adapters\n", MAX_ADAPTERS);
+        return 2;
+    }
+    loc_logger.DEBUG_LEVEL = 2;
+
+    MsgTask* task = new MsgTask((MsgTask::tAssociate)NULL, "dispatch_test");
+    DispatchTestContext context(task);
+    // the context read /etc/gps.conf, which resets the level
+    loc_logger.DEBUG_LEVEL = 2;
+    DispatchTestLocApi* locApi = new DispatchTestLocApi(task);
+    context.setLocApi(locApi);
+
+    // opened for the first adapter, reopened whenever one adds events
+    DispatchTestAdapter* adapters[MAX_ADAPTERS];
+    int expectedOpens = 0;
+    for (int k = 0; k < count; k++) {
+        LOC_API_ADAPTER_EVENT_MASK_T before = unionMask(adapters, k);
+        adapters[k] = new DispatchTestAdapter(&context, dispatchTestMask(k));
+        if (0 == k || unionMask(adapters, k + 1) != before) {
+            expectedOpens++;
+        }
+    }
+    sync(task);
+    bool ok = true;
+    if (locApi->mOpens != expectedOpens ||
+        locApi->mOpenMask != unionMask(adapters, count)) {
+        fprintf(stderr, "added: %d opens with %x, not %d with %x\n",
+                locApi->mOpens, (unsigned)locApi->mOpenMask, expectedOpens,
+                (unsigned)unionMask(adapters, count));
+        ok = false;
+    }
+    report(locApi, DISPATCH_TEST_REPORTS);
+    ok = checkCounts(adapters, count, DISPATCH_TEST_REPORTS, "added") && ok;
+
+    // every other one from the front, so the last adapter keeps moving
+    // into the freed slots
+    int closes = locApi->mCloses;
+    for (int k = 0; k < count; k += 2) {
+        LOC_API_ADAPTER_EVENT_MASK_T before = unionMask(adapters, count);
+        delete adapters[k];
+        adapters[k] = NULL;
+        LOC_API_ADAPTER_EVENT_MASK_T after = unionMask(adapters, count);
+        if (0 != after && after != before) {
+            expectedOpens++;
+        }
+        report(locApi, DISPATCH_TEST_REPORTS);
+        ok = checkCounts(adapters, count, DISPATCH_TEST_REPORTS, "removed") && ok;
+    }
+    sync(task);
+    if (count > 1 && (locApi->mOpens != expectedOpens ||
+                      locApi->mOpenMask != unionMask(adapters, count))) {
+        fprintf(stderr, "removed: %d opens with %x, not %d with %x\n",
+                locApi->mOpens, (unsigned)locApi->mOpenMask, expectedOpens,
+                (unsigned)unionMask(adapters, count));
+        ok = false;
+    }
+
+    for (int k = 1; k < count; k += 2) {
+        if (locApi->mCloses != closes) {
+            fprintf(stderr, "closed with %d adapters left\n",
+                    (count - k + 1) / 2);
+            ok = false;
+        }
+        delete adapters[k];
+        adapters[k] = NULL;
+    }
+    sync(task);
+    if (locApi->mCloses != closes + 1) {
+        fprintf(stderr, "closed %d times with the last adapter, not once\n",
+                locApi->mCloses - closes);
+        ok = false;
+    }
+    report(locApi, DISPATCH_TEST_REPORTS);
+
+    double positionNs = benchPosition(context, count);
+
+    printf("{\n");
+    printf("  \"adapters\": %d,\n", count);
+    printf("  \"opens\": %d,\n", locApi->mOpens);
+    printf("  \"position_ns\": %.1f,\n", positionNs);
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+    // the MsgTask threads are never stopped
+    _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,349 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Host benchmark of the location stack building blocks. Prints one JSON
+   object on stdout, so runs can be kept and compared:
+
+     loc_bench [iterations scale, default 1] > results.json
+
+   Covers msg_q send / receive throughput, MsgTask
+   round trip latency, loc_timer arm / cancel cost, NMEA generation rate
+   and loc_read_conf parse time. Logs go to stderr. */
+
+#define LOG_TAG "LocSvc_bench"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include <msg_q.h>
+#include <loc_timer.h>
+#include <loc_cfg.h>
+#include <MsgTask.h>
+#include <loc_eng.h>
+#include <loc_eng_nmea.h>
+
+using namespace loc_core;
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// sorted copy of the samples, p in [0, 100]
+static int64_t percentile(std::vector<int64_t>& samples, int p)
+{
+    if (samples.empty()) {
+        return 0;
+    }
+    std::sort(samples.begin(), samples.end());
+    size_t i = (samples.size() - 1) * p / 100;
+    return samples[i];
+}
+
+/* ---------------------------------------------------------------- msg_q */
+
+struct QProducerArg {
+    void* q;
+    long count;
+};
+
+static void* qProducer(void* arg)
+{
+    QProducerArg* p = (QProducerArg*)arg;
+    for (long i = 1; i <= p->count; i++) {
+        msg_q_snd(p->q, (void*)i, NULL);
+    }
+    return NULL;
+}
+
+static double benchMsgQ(long count)
+{
+    void* q = (void*)msg_q_init2();
+    QProducerArg arg = { q, count };
+    pthread_t producer;
+    int64_t start = nowNs();
+    pthread_create(&producer, NULL, qProducer, &arg);
+    for (long i = 0; i < count; i++) {
+        void* msg;
+        msg_q_rcv(q, &msg);
+    }
+    int64_t elapsed = nowNs() - start;
+    pthread_join(producer, NULL);
+    msg_q_unblock(q);
+    msg_q_destroy(&q);
+    return count * 1e9 / elapsed;
+}
+
+/* -------------------------------------------------------------- MsgTask */
+
+struct PingSync {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool done;
+};
+
+struct LocBenchPing : public LocMsg {
+    PingSync* mSync;
+    inline LocBenchPing(PingSync* sync) :
+        LocMsg(), mSync(sync) {}
+    inline virtual void proc() const {
+        pthread_mutex_lock(&mSync->lock);
+        mSync->done = true;
+        pthread_cond_signal(&mSync->cond);
+        pthread_mutex_unlock(&mSync->lock);
+    }
+};
+
+static void benchMsgTask(int count, std::vector<int64_t>& rtt)
+{
+    MsgTask task((MsgTask::tAssociate)NULL, "loc_bench_task");
+    PingSync sync;
+    pthread_mutex_init(&sync.lock, NULL);
+    pthread_cond_init(&sync.cond, NULL);
+    for (int i = 0; i < count; i++) {
+        sync.done = false;
+        int64_t start = nowNs();
+        task.sendMsg(new LocBenchPing(&sync));
+        pthread_mutex_lock(&sync.lock);
+        while (!sync.done) {
+            pthread_cond_wait(&sync.cond, &sync.lock);
+        }
+        pthread_mutex_unlock(&sync.lock);
+        rtt.push_back(nowNs() - start);
+    }
+}
+
+/* ------------------------------------------------------------ loc_timer */
+
+static void benchTimerCb(void* user_data, int result)
+{
+    (void)user_data;
+    (void)result;
+}
+
+static void benchTimer(int count, double* armNs, double* cancelNs)
+{
+    std::vector<void*> handles(count);
+    int64_t start = nowNs();
+    for (int i = 0; i < count; i++) {
+        // far enough out that none fires during the run
+        handles[i] = loc_timer_start(3600000 + i, benchTimerCb, NULL);
+    }
+    int64_t armed = nowNs();
+    for (int i = 0; i < count; i++) {
+        loc_timer_stop(handles[i]);
+    }
+    int64_t cancelled = nowNs();
+    *armNs = (double)(armed - start) / count;
+    *cancelNs = (double)(cancelled - armed) / count;
+}
+
+/* ----------------------------------------------------------------- NMEA */
+
+static uint64_t benchNmeaSentences;
+
+static void benchNmeaCb(GpsUtcTime timestamp, const char* nmea, int length)
+{
+    (void)timestamp;
+    (void)nmea;
+    (void)length;
+    benchNmeaSentences++;
+}
+
+static void benchNmeaFill(int i, GpsSvStatus& sv, UlpLocation& location,
+                          GpsLocationExtended& extended)
+{
+    memset(&sv, 0, sizeof(sv));
+    memset(&location, 0, sizeof(location));
+    memset(&extended, 0, sizeof(extended));
+
+    // 12 GPS and 8 GLONASS SVs, 9 of them used
+    sv.num_svs = 20;
+    for (int k = 0; k < sv.num_svs; k++) {
+        sv.sv_list[k].prn = k < 12 ? k + 1 : 65 + k - 12;
+        sv.sv_list[k].snr = 20 + (k * 7 + i) % 25;
+        sv.sv_list[k].elevation = (k * 13) % 90;
+        sv.sv_list[k].azimuth = (k * 37 + i) % 360;
+    }
+    sv.used_in_fix_mask = 0x1ff;
+
+    extended.flags = GPS_LOCATION_EXTENDED_HAS_DOP |
+        GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL |
+        GPS_LOCATION_EXTENDED_HAS_MAG_DEV;
+    extended.pdop = 1.8;
+    extended.hdop = 0.9;
+    extended.vdop = 1.5;
+    extended.altitudeMeanSeaLevel = 87.4;
+    extended.magneticDeviation = 2.1;
+
+    location.size = sizeof(location);
+    location.gpsLocation.size = sizeof(GpsLocation);
+    location.gpsLocation.flags = GPS_LOCATION_HAS_LAT_LONG |
+        GPS_LOCATION_HAS_ALTITUDE | GPS_LOCATION_HAS_SPEED |
+        GPS_LOCATION_HAS_BEARING | GPS_LOCATION_HAS_ACCURACY;
+    location.gpsLocation.latitude = 37.4219983 + i * 1e-6;
+    location.gpsLocation.longitude = -122.084 - i * 1e-6;
+    location.gpsLocation.altitude = 120.5;
+    location.gpsLocation.speed = 12.25;
+    location.gpsLocation.bearing = 271.0;
+    location.gpsLocation.accuracy = 4.0;
+    // 10 Hz fixes, so the date fields change every 10th fix
+    location.gpsLocation.timestamp = 1412000000000LL + i * 100;
+}
+
+static double benchNmea(int count, uint64_t* sentences)
+{
+    loc_eng_data_s_type locEng;
+    memset(&locEng, 0, sizeof(locEng));
+    locEng.adapter = new LocEngAdapter((LOC_API_ADAPTER_EVENT_MASK_T)0,
+                                       &locEng, NULL);
+    // creating the context read /etc/gps.conf, which resets the level
+    loc_logger.DEBUG_LEVEL = 1;
+    locEng.nmea_cb = benchNmeaCb;
+    benchNmeaSentences = 0;
+
+    GpsSvStatus sv;
+    UlpLocation location;
+    GpsLocationExtended extended;
+    int64_t elapsed = 0;
+    for (int i = 0; i < count; i++) {
+        benchNmeaFill(i, sv, location, extended);
+        int64_t start = nowNs();
+        loc_eng_nmea_generate_sv(&locEng, sv, extended);
+        loc_eng_nmea_generate_pos(&locEng, location, extended, true);
+        elapsed += nowNs() - start;
+    }
+    *sentences = benchNmeaSentences;
+    return benchNmeaSentences * 1e9 / elapsed;
+}
+
+/* --------------------------------------------------------- loc_read_conf */
+
+static unsigned long benchConfNum[8];
+static char benchConfStr[LOC_MAX_PARAM_STRING];
+static loc_param_s_type benchConfTable[] =
+{
+    {"INTERMEDIATE_POS",   &benchConfNum[0], NULL, 'n', 0, 0},
+    {"ACCURACY_THRES",     &benchConfNum[1], NULL, 'n', 0, 0},
+    {"SUPL_VER",           &benchConfNum[2], NULL, 'n', 0, 0},
+    {"CAPABILITIES",       &benchConfNum[3], NULL, 'n', 0, 0},
+    {"NMEA_PROVIDER",      &benchConfNum[4], NULL, 'n', 0, 1},
+    {"GPS_LOCK",           &benchConfNum[5], NULL, 'n', 0, 3},
+    {"LPP_PROFILE",        &benchConfNum[6], NULL, 'n', 0, 0},
+    {"A_GLONASS_POS_PROTOCOL_SELECT", &benchConfNum[7], NULL, 'n', 0, 0},
+    {"XTRA_SERVER_1",      benchConfStr,     NULL, 's', 0, 0},
+};
+
+static void benchConf(int count, double* coldUs, double* cachedUs)
+{
+    char path[] = "/tmp/loc_bench_confXXXXXX";
+    int fd = mkstemp(path);
+    FILE* fp = fdopen(fd, "w");
+    // about the size of gps.conf: comments, the keys above and filler
+    for (int i = 0; i < 40; i++) {
+        fprintf(fp, "# comment line %d describing the setting below it\n", i);
+        fprintf(fp, "FILLER_PARAM_%d = %d\n", i, i);
+    }
+    fprintf(fp, "DEBUG_LEVEL = 1\nINTERMEDIATE_POS = 0\nACCURACY_THRES = 0\nSUPL_VER = 0x20000\n"
+                "CAPABILITIES = 0x37\nNMEA_PROVIDER = 0\nGPS_LOCK = 0\n"
+                "LPP_PROFILE = 0\nA_GLONASS_POS_PROTOCOL_SELECT = 0\n"
+                "XTRA_SERVER_1 = http://xtrapath1.izatcloud.net/xtra2.bin\n");
+    fclose(fp);
+
+    const uint32_t tableLength = sizeof(benchConfTable) / sizeof(benchConfTable[0]);
+    int64_t start = nowNs();
+    for (int i = 0; i < count; i++) {
+        loc_flush_conf(path);
+        loc_read_conf(path, benchConfTable, tableLength);
+    }
+    int64_t cold = nowNs();
+    for (int i = 0; i < count; i++) {
+        loc_read_conf(path, benchConfTable, tableLength);
+    }
+    int64_t cached = nowNs();
+    *coldUs = (cold - start) / 1e3 / count;
+    *cachedUs = (cached - cold) / 1e3 / count;
+
+    loc_flush_conf(path);
+    unlink(path);
+}
+
+int main(int argc, char** argv)
+{
+    int scale = argc > 1 ? atoi(argv[1]) : 1;
+    if (scale < 1) {
+        scale = 1;
+    }
+    // errors only, so the numbers are not mostly stderr; the conf file
+    // benchConf() writes keeps it that way
+    loc_logger.DEBUG_LEVEL = 1;
+
+    double msgQRate = benchMsgQ(200000L * scale);
+
+    std::vector<int64_t> rtt;
+    benchMsgTask(20000 * scale, rtt);
+    int64_t rttSum = 0;
+    for (size_t i = 0; i < rtt.size(); i++) {
+        rttSum += rtt[i];
+    }
+
+    double armNs, cancelNs;
+    benchTimer(20000 * scale, &armNs, &cancelNs);
+
+    uint64_t sentences;
+    double nmeaRate = benchNmea(20000 * scale, &sentences);
+
+    double confColdUs, confCachedUs;
+    benchConf(2000 * scale, &confColdUs, &confCachedUs);
+
+    printf("{\"bench\":\"loc_bench\",\"scale\":%d,"
+           "\"msg_q\":{\"msgs_per_s\":%.0f},"
+           "\"msg_task\":{\"count\":%u,\"rtt_mean_ns\":%lld,"
+           "\"rtt_p50_ns\":%lld,\"rtt_p99_ns\":%lld},"
+           "\"loc_timer\":{\"arm_ns\":%.0f,\"cancel_ns\":%.0f},"
+           "\"nmea\":{\"sentences\":%llu,\"sentences_per_s\":%.0f},"
+           "\"loc_read_conf\":{\"cold_us\":%.2f,\"cached_us\":%.2f}}\n",
+           scale, msgQRate,
+           (unsigned)rtt.size(), (long long)(rttSum / (int64_t)rtt.size()),
+           (long long)percentile(rtt, 50), (long long)percentile(rtt, 99),
+           armNs, cancelNs,
+           (unsigned long long)sentences, nmeaRate,
+           confColdUs, confCachedUs);
+    fflush(stdout);
+
+    // the adapter's MsgTask and the timer thread are left running
+    _exit(0);
+}
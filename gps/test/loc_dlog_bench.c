@@ -0,0 +1,194 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Hot path cost of LOC_LOGx: filtered out by DEBUG_LEVEL, formatted and
+   written on the calling thread, and taken into the deferred ring for
+   the flush thread. Also checks that the deferred path prints a set of
+   records exactly as the synchronous one does, and that bursts the
+   flush thread keeps up with lose nothing. Log output goes to a scratch file while it runs. Prints
+   one JSON object:
+
+     loc_dlog_bench [disabled and synchronous calls, default 200000] */
+
+#define LOG_TAG "LocSvc_dlog_bench"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <log_util.h>
+
+#define DLOG_BENCH_BURST 128
+#define DLOG_BENCH_BURSTS 100
+/* a few flush periods of loc_dlog.c */
+#define DLOG_BENCH_FLUSH_WAIT_US 100000
+#define DLOG_BENCH_LINE 1024
+
+static const char dlog_bench_prefix[] = "E/" LOG_TAG ": ";
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* every argument class loc_dlog.c knows */
+static void dlog_bench_formats(void)
+{
+    LOC_LOGD("%s:%d] plain %u %x %lX %lld %hhd %hu", __func__, 42,
+             3000000000u, 0xbeef, 0xabcdefUL, -5LL, (char)300,
+             (unsigned short)70000);
+    LOC_LOGD("%08.3f|%-10s|%.3s|%*d|%.*f|%c|%%|%e|%g", 3.14159, "left",
+             "truncate", 6, 77, 2, 2.71828, 'Z', 12345.678, 0.0001);
+    LOC_LOGD("%p %zu %s", (void*)0x1234, (size_t)99, "str");
+    LOC_LOGD("no args at all");
+    LOC_LOGD("%5.1f%% %+d % d %#x %#o", 99.5, 5, 7, 255, 8);
+    LOC_LOGI("%s: %d bytes from %s", __func__, 4096, "/data/misc/xtra.bin");
+}
+
+/* the lines this test logged to path; the first max of them into lines */
+static int dlog_bench_lines(const char* path, char (*lines)[DLOG_BENCH_LINE],
+                            int max)
+{
+    char line[DLOG_BENCH_LINE];
+    int count = 0;
+    FILE* fp = fopen(path, "r");
+
+    if (NULL == fp) {
+        return -1;
+    }
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        if (0 != strncmp(line, dlog_bench_prefix, sizeof(dlog_bench_prefix) - 1)) {
+            continue;
+        }
+        if (NULL != lines && count < max) {
+            strcpy(lines[count], line);
+        }
+        count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+int main(int argc, char** argv)
+{
+    int calls = argc > 1 ? atoi(argv[1]) : 200000;
+    static char lines[32][DLOG_BENCH_LINE];
+    char log_path[] = "/tmp/loc_dlog_benchXXXXXX";
+    int log_fd = mkstemp(log_path);
+    int saved_stderr = dup(2);
+    int sync_lines, mismatches = 0, emitted, ok;
+    int64_t start, deferred_ns = 0;
+    double disabled, sync_cost, deferred;
+    int i, b;
+
+    loc_logger.DEBUG_LEVEL = 4;
+    loc_logger.TIMESTAMP = 0;
+    loc_dlog_enable(0);
+    dup2(log_fd, 2);
+
+    /* the same records both ways */
+    dlog_bench_formats();
+    loc_dlog_enable(1);
+    dlog_bench_formats();
+    usleep(DLOG_BENCH_FLUSH_WAIT_US);
+    loc_dlog_enable(0);
+    sync_lines = dlog_bench_lines(log_path, lines, 32);
+    if (sync_lines < 2 || 0 != sync_lines % 2 || sync_lines > 32) {
+        mismatches = -1;
+    } else {
+        for (i = 0; i < sync_lines / 2; i++) {
+            if (0 != strcmp(lines[i], lines[i + sync_lines / 2])) {
+                fprintf(stdout, "sync     %s" "deferred %s",
+                        lines[i], lines[i + sync_lines / 2]);
+                mismatches++;
+            }
+        }
+    }
+    ftruncate(log_fd, 0);
+    lseek(log_fd, 0, SEEK_SET);
+
+    /* filtered out by DEBUG_LEVEL */
+    loc_logger.DEBUG_LEVEL = 2;
+    start = now_ns();
+    for (i = 0; i < calls; i++) {
+        LOC_LOGD("%s:%d] msg %p", __func__, i, (void*)&i);
+    }
+    disabled = (double)(now_ns() - start) / calls;
+
+    /* formatted and written here */
+    loc_logger.DEBUG_LEVEL = 4;
+    start = now_ns();
+    for (i = 0; i < calls; i++) {
+        LOC_LOGD("%s:%d] msg %p", __func__, i, (void*)&i);
+    }
+    sync_cost = (double)(now_ns() - start) / calls;
+    ftruncate(log_fd, 0);
+    lseek(log_fd, 0, SEEK_SET);
+
+    /* taken into the ring, in bursts the flush thread keeps up with */
+    loc_dlog_enable(1);
+    for (b = 0; b < DLOG_BENCH_BURSTS; b++) {
+        start = now_ns();
+        for (i = 0; i < DLOG_BENCH_BURST; i++) {
+            LOC_LOGD("%s:%d] msg %p", __func__, i, (void*)&i);
+        }
+        deferred_ns += now_ns() - start;
+        usleep(25000);
+    }
+    usleep(DLOG_BENCH_FLUSH_WAIT_US);
+    loc_dlog_enable(0);
+    deferred = (double)deferred_ns / (b * DLOG_BENCH_BURST);
+    emitted = dlog_bench_lines(log_path, NULL, 0);
+
+    dup2(saved_stderr, 2);
+    close(log_fd);
+    unlink(log_path);
+
+    ok = 0 == mismatches && emitted == b * DLOG_BENCH_BURST;
+
+    printf("{\n");
+    printf("  \"calls\": %d,\n", calls);
+    printf("  \"disabled_ns\": %.1f,\n", disabled);
+    printf("  \"sync_ns\": %.1f,\n", sync_cost);
+    printf("  \"deferred_ns\": %.1f,\n", deferred);
+    printf("  \"deferred_emitted\": %d,\n", emitted);
+    printf("  \"deferred_taken\": %d,\n", b * DLOG_BENCH_BURST);
+    printf("  \"format_records\": %d,\n", sync_lines / 2);
+    printf("  \"format_mismatches\": %d,\n", mismatches);
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+    /* the flush thread is never stopped */
+    _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,302 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Round trips of an IF_REQUEST from a stand-in gpsone_daemon to the
+   dmn_conn server and back, over the FIFO message queues and over the
+   UNIX datagram sockets. The request handler answers at once, so what
+   is timed is the transport and the server loop. Checks that every
+   response comes back, in order, with the result asked for. The host
+   library uses the device paths, so /data/misc/gpsone_d is made if it
+   is not there. Prints one JSON object:
+
+     loc_dmn_conn_bench [round trips, default 20000] */
+
+#define LOG_TAG "LocSvc_dmn_conn_bench"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <log_util.h>
+#include <gps_extended_c.h>
+#include "loc_eng_dmn_conn.h"
+#include "loc_eng_dmn_conn_handler.h"
+#include "loc_eng_dmn_conn_glue_msg.h"
+
+#define DMN_CONN_BENCH_DIR "/data/misc/gpsone_d"
+#define DMN_CONN_BENCH_WARMUP 100
+
+// stand-ins for loc_eng_dmn_conn_handler.cpp, which needs a loc_eng
+void* loc_api_handle = NULL;
+
+// echoes the request's result back, so responses can be told apart
+int loc_eng_dmn_conn_loc_api_server_if_request_handler(struct ctrl_msgbuf *pmsg, int)
+{
+    return loc_eng_dmn_conn_loc_api_server_data_conn(
+        LOC_ENG_IF_REQUEST_SENDER_ID_GPSONE_DAEMON, (int)pmsg->reserved2);
+}
+
+int loc_eng_dmn_conn_loc_api_server_if_release_handler(struct ctrl_msgbuf*, int)
+{
+    return 0;
+}
+
+struct DmnConnBenchResult {
+    double avgUs;
+    double p99Us;
+    double maxUs;
+    int bad;
+};
+
+// the server is launched once at a time
+static void (*serverStart)(void*);
+static void* serverArg;
+
+static void* serverThread(void*)
+{
+    serverStart(serverArg);
+    return NULL;
+}
+
+static pthread_t createThread(const char*, void (*start)(void*), void* arg)
+{
+    pthread_t thread;
+    serverStart = start;
+    serverArg = arg;
+    if (0 != pthread_create(&thread, NULL, serverThread, NULL)) {
+        return 0;
+    }
+    return thread;
+}
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compareNs(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*)a;
+    int64_t y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+// the daemon's end of one transport
+class DmnConnBenchClient {
+    loc_eng_dmn_conn_transport_e_type mTransport;
+    int mWriteFd;
+    int mReadFd;
+    struct sockaddr_un mServer;
+public:
+    inline DmnConnBenchClient(loc_eng_dmn_conn_transport_e_type transport) :
+        mTransport(transport), mWriteFd(-1), mReadFd(-1) {}
+    bool open() {
+        if (LOC_ENG_DMN_CONN_SOCKET != mTransport) {
+            // the server made both FIFOs before it started reading
+            mWriteFd = ::open(GPSONE_LOC_API_Q_PATH, O_WRONLY);
+            mReadFd = ::open(GPSONE_LOC_API_RESP_Q_PATH, O_RDONLY);
+            return mWriteFd >= 0 && mReadFd >= 0;
+        }
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strlcpy(addr.sun_path, GPSONE_LOC_API_RESP_SOCK_PATH, sizeof(addr.sun_path));
+        unlink(addr.sun_path);
+        mReadFd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (mReadFd < 0 || bind(mReadFd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            return false;
+        }
+        // a dropped response fails the round trip instead of hanging it
+        struct timeval timeout = { 1, 0 };
+        setsockopt(mReadFd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        memset(&mServer, 0, sizeof(mServer));
+        mServer.sun_family = AF_UNIX;
+        strlcpy(mServer.sun_path, GPSONE_LOC_API_SOCK_PATH, sizeof(mServer.sun_path));
+        return true;
+    }
+    void close() {
+        if (mWriteFd >= 0) {
+            ::close(mWriteFd);
+        }
+        if (mReadFd >= 0) {
+            ::close(mReadFd);
+        }
+        if (LOC_ENG_DMN_CONN_SOCKET == mTransport) {
+            unlink(GPSONE_LOC_API_RESP_SOCK_PATH);
+        }
+        mWriteFd = mReadFd = -1;
+    }
+    bool send(struct ctrl_msgbuf* msg) {
+        if (LOC_ENG_DMN_CONN_SOCKET != mTransport) {
+            return loc_eng_dmn_conn_glue_msgsnd(mWriteFd, msg, sizeof(*msg)) ==
+                (int)sizeof(*msg);
+        }
+        msg->msgsz = sizeof(*msg);
+        // the server's socket is up once launch returns, but not
+        // necessarily bound yet
+        for (int i = 0; i < 1000; i++) {
+            if (sendto(mReadFd, msg, sizeof(*msg), 0,
+                       (struct sockaddr*)&mServer, sizeof(mServer)) ==
+                (ssize_t)sizeof(*msg)) {
+                return true;
+            }
+            if (ENOENT != errno && ECONNREFUSED != errno) {
+                break;
+            }
+            usleep(1000);
+        }
+        return false;
+    }
+    bool receive(struct ctrl_msgbuf* msg) {
+        if (LOC_ENG_DMN_CONN_SOCKET != mTransport) {
+            return loc_eng_dmn_conn_glue_msgrcv(mReadFd, msg, sizeof(*msg)) ==
+                (int)sizeof(*msg);
+        }
+        return recv(mReadFd, msg, sizeof(*msg), 0) == (ssize_t)sizeof(*msg);
+    }
+};
+
+static bool roundTrips(loc_eng_dmn_conn_transport_e_type transport,
+                       int trips, int64_t* ns, DmnConnBenchResult* result)
+{
+    DmnConnBenchClient client(transport);
+    struct ctrl_msgbuf request;
+    struct ctrl_msgbuf response;
+    bool ok = true;
+
+    memset(result, 0, sizeof(*result));
+    // the socket transport binds in the server thread; bind ours first
+    // so the first response has somewhere to go
+    if (LOC_ENG_DMN_CONN_SOCKET == transport && !client.open()) {
+        fprintf(stderr, "socket %s: %s\n", GPSONE_LOC_API_RESP_SOCK_PATH,
+                strerror(errno));
+        return false;
+    }
+    if (0 != loc_eng_dmn_conn_loc_api_server_launch(createThread, NULL, NULL,
+                                                    NULL, transport)) {
+        fprintf(stderr, "transport %d: launch failed\n", transport);
+        client.close();
+        return false;
+    }
+    if (LOC_ENG_DMN_CONN_SOCKET != transport && !client.open()) {
+        fprintf(stderr, "fifo %s: %s\n", GPSONE_LOC_API_Q_PATH, strerror(errno));
+        ok = false;
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.ctrl_type = GPSONE_LOC_API_IF_REQUEST;
+    request.cmsg.cmsg_if_request.type = IF_REQUEST_TYPE_SUPL;
+    request.cmsg.cmsg_if_request.sender_id = IF_REQUEST_SENDER_ID_GPSONE_DAEMON;
+    for (int i = 0; ok && i < DMN_CONN_BENCH_WARMUP + trips; i++) {
+        request.reserved2 = i;
+        int64_t start = nowNs();
+        if (!client.send(&request) || !client.receive(&response)) {
+            fprintf(stderr, "transport %d: round trip %d failed: %s\n",
+                    transport, i, strerror(errno));
+            ok = false;
+            break;
+        }
+        int64_t elapsed = nowNs() - start;
+        if (GPSONE_LOC_API_RESPONSE != response.ctrl_type ||
+            (int)request.reserved2 != response.cmsg.cmsg_response.result) {
+            result->bad++;
+        }
+        if (i >= DMN_CONN_BENCH_WARMUP) {
+            ns[i - DMN_CONN_BENCH_WARMUP] = elapsed;
+        }
+    }
+
+    loc_eng_dmn_conn_loc_api_server_unblock();
+    loc_eng_dmn_conn_loc_api_server_join();
+    client.close();
+    if (!ok) {
+        return false;
+    }
+
+    int64_t sum = 0;
+    for (int i = 0; i < trips; i++) {
+        sum += ns[i];
+    }
+    qsort(ns, trips, sizeof(*ns), compareNs);
+    result->avgUs = (double)sum / trips / 1000;
+    result->p99Us = (double)ns[trips * 99 / 100] / 1000;
+    result->maxUs = (double)ns[trips - 1] / 1000;
+    return 0 == result->bad;
+}
+
+int main(int argc, char** argv)
+{
+    int trips = argc > 1 ? atoi(argv[1]) : 20000;
+    if (trips < 1) {
+        fprintf(stderr, "at least 1 round trip\n");
+        return 2;
+    }
+    loc_logger.DEBUG_LEVEL = 2;
+
+    if ((mkdir("/data", 0755) < 0 && EEXIST != errno) ||
+        (mkdir("/data/misc", 0755) < 0 && EEXIST != errno) ||
+        (mkdir(DMN_CONN_BENCH_DIR, 0770) < 0 && EEXIST != errno)) {
+        fprintf(stderr, "mkdir %s: %s\n", DMN_CONN_BENCH_DIR, strerror(errno));
+        return 1;
+    }
+
+    int64_t* ns = (int64_t*)malloc(trips * sizeof(*ns));
+    if (NULL == ns) {
+        return 1;
+    }
+    DmnConnBenchResult fifo;
+    DmnConnBenchResult sock;
+    bool ok = roundTrips(LOC_ENG_DMN_CONN_FIFO, trips, ns, &fifo);
+    ok = roundTrips(LOC_ENG_DMN_CONN_SOCKET, trips, ns, &sock) && ok;
+    free(ns);
+
+    printf("{\n");
+    printf("  \"round_trips\": %d,\n", trips);
+    printf("  \"fifo_avg_us\": %.1f,\n", fifo.avgUs);
+    printf("  \"fifo_p99_us\": %.1f,\n", fifo.p99Us);
+    printf("  \"fifo_max_us\": %.1f,\n", fifo.maxUs);
+    printf("  \"fifo_bad_responses\": %d,\n", fifo.bad);
+    printf("  \"socket_avg_us\": %.1f,\n", sock.avgUs);
+    printf("  \"socket_p99_us\": %.1f,\n", sock.p99Us);
+    printf("  \"socket_max_us\": %.1f,\n", sock.maxUs);
+    printf("  \"socket_bad_responses\": %d,\n", sock.bad);
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* ATL request storms, as gpsone_daemon sends on reconnect, against the
+   dmn_conn server on the FIFO transport and on the batched one. Each
+   storm is a run of IF_REQUESTs written one at a time; the last one
+   gets all of them answered at once between cork and uncork, as
+   AgpsStateMachine::notifySubscribers does when a data call comes up.
+   Counts the read and write syscalls and the context switches of the
+   server thread per storm, and checks that every response comes back
+   in order. On the batched transport a request split over two writes
+   is sent first, to check the framing of partial reads. The host library uses the device
+   paths, so /data/misc/gpsone_d is made if it is not there. Prints one
+   JSON object:
+
+     loc_dmn_conn_storm [requests per storm, default 32] [storms, default 1000] */
+
+#define LOG_TAG "LocSvc_dmn_conn_storm"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <log_util.h>
+#include <gps_extended_c.h>
+#include "loc_eng_dmn_conn.h"
+#include "loc_eng_dmn_conn_handler.h"
+#include "loc_eng_dmn_conn_glue_msg.h"
+
+#define DMN_CONN_STORM_DIR "/data/misc/gpsone_d"
+#define DMN_CONN_STORM_MAX 1024
+// in reserved1 of the request that ends a storm
+#define DMN_CONN_STORM_LAST 1
+
+// stand-ins for loc_eng_dmn_conn_handler.cpp, which needs a loc_eng
+void* loc_api_handle = NULL;
+
+// only touched by the server thread
+static int stormPending[DMN_CONN_STORM_MAX];
+static int stormPendingCount = 0;
+
+// holds requests until the last of the storm, then answers them all,
+// each with the number it came with
+int loc_eng_dmn_conn_loc_api_server_if_request_handler(struct ctrl_msgbuf *pmsg, int)
+{
+    if (stormPendingCount < DMN_CONN_STORM_MAX) {
+        stormPending[stormPendingCount++] = (int)pmsg->reserved2;
+    }
+    if (DMN_CONN_STORM_LAST == pmsg->reserved1) {
+        loc_eng_dmn_conn_loc_api_server_cork();
+        for (int i = 0; i < stormPendingCount; i++) {
+            loc_eng_dmn_conn_loc_api_server_data_conn(
+                LOC_ENG_IF_REQUEST_SENDER_ID_GPSONE_DAEMON, stormPending[i]);
+        }
+        stormPendingCount = 0;
+        loc_eng_dmn_conn_loc_api_server_uncork();
+    }
+    return 0;
+}
+
+int loc_eng_dmn_conn_loc_api_server_if_release_handler(struct ctrl_msgbuf*, int)
+{
+    return 0;
+}
+
+struct DmnConnStormCounts {
+    long syscalls;
+    long switches;
+};
+
+struct DmnConnStormResult {
+    double stormUs;
+    double syscallsPerStorm;
+    double switchesPerStorm;
+    int bad;
+};
+
+// the server is launched once at a time
+static void (*serverStart)(void*);
+static void* serverArg;
+static volatile pid_t serverTid = 0;
+
+static void* serverThread(void*)
+{
+    serverTid = (pid_t)syscall(SYS_gettid);
+    serverStart(serverArg);
+    return NULL;
+}
+
+static pthread_t createThread(const char*, void (*start)(void*), void* arg)
+{
+    pthread_t thread;
+    serverStart = start;
+    serverArg = arg;
+    serverTid = 0;
+    if (0 != pthread_create(&thread, NULL, serverThread, NULL)) {
+        return 0;
+    }
+    return thread;
+}
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// sums the values of the lines starting with any of keys
+static long sumProcFields(const char* path, const char* const* keys, int count)
+{
+    char line[128];
+    long sum = 0;
+    FILE* file = fopen(path, "r");
+    if (NULL == file) {
+        return -1;
+    }
+    while (NULL != fgets(line, sizeof(line), file)) {
+        for (int k = 0; k < count; k++) {
+            size_t len = strlen(keys[k]);
+            if (0 == strncmp(line, keys[k], len)) {
+                sum += atol(line + len);
+            }
+        }
+    }
+    fclose(file);
+    return sum;
+}
+
+static void serverCounts(DmnConnStormCounts* counts)
+{
+    static const char* const io[] = { "syscr:", "syscw:" };
+    static const char* const status[] = { "voluntary_ctxt_switches:",
+                                          "nonvoluntary_ctxt_switches:" };
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/task/%d/io", (int)serverTid);
+    counts->syscalls = sumProcFields(path, io, 2);
+    snprintf(path, sizeof(path), "/proc/self/task/%d/status", (int)serverTid);
+    counts->switches = sumProcFields(path, status, 2);
+}
+
+static bool receive(int readFd, int expected, DmnConnStormResult* result)
+{
+    struct ctrl_msgbuf response;
+    struct pollfd pfd = { readFd, POLLIN, 0 };
+    // a response held back fails the storm instead of hanging it
+    if (poll(&pfd, 1, 1000) <= 0) {
+        fprintf(stderr, "response %d: not in 1 s\n", expected);
+        return false;
+    }
+    if (loc_eng_dmn_conn_glue_msgrcv(readFd, &response, sizeof(response)) !=
+        (int)sizeof(response)) {
+        fprintf(stderr, "response %d: %s\n", expected, strerror(errno));
+        return false;
+    }
+    if (GPSONE_LOC_API_RESPONSE != response.ctrl_type ||
+        expected != response.cmsg.cmsg_response.result) {
+        result->bad++;
+    }
+    return true;
+}
+
+static bool storms(loc_eng_dmn_conn_transport_e_type transport, int size,
+                   int count, DmnConnStormResult* result)
+{
+    struct ctrl_msgbuf request;
+    DmnConnStormCounts before;
+    DmnConnStormCounts after;
+    int writeFd = -1;
+    int readFd = -1;
+    bool ok = true;
+
+    memset(result, 0, sizeof(*result));
+    if (0 != loc_eng_dmn_conn_loc_api_server_launch(createThread, NULL, NULL,
+                                                    NULL, transport)) {
+        fprintf(stderr, "transport %d: launch failed\n", transport);
+        return false;
+    }
+    // the server made both FIFOs before it started reading
+    writeFd = open(GPSONE_LOC_API_Q_PATH, O_WRONLY);
+    readFd = open(GPSONE_LOC_API_RESP_Q_PATH, O_RDONLY);
+    if (writeFd < 0 || readFd < 0) {
+        fprintf(stderr, "fifo %s: %s\n", GPSONE_LOC_API_Q_PATH, strerror(errno));
+        ok = false;
+    }
+
+    memset(&request, 0, sizeof(request));
+    request.ctrl_type = GPSONE_LOC_API_IF_REQUEST;
+    request.cmsg.cmsg_if_request.type = IF_REQUEST_TYPE_SUPL;
+    request.cmsg.cmsg_if_request.sender_id = IF_REQUEST_SENDER_ID_GPSONE_DAEMON;
+    request.msgsz = sizeof(request);
+
+    // half a request, and the rest once the server has read the half;
+    // only the batched transport reassembles messages
+    if (ok && LOC_ENG_DMN_CONN_FIFO_BATCHED == transport) {
+        size_t half = sizeof(request) / 2;
+        request.reserved1 = DMN_CONN_STORM_LAST;
+        request.reserved2 = 0;
+        ok = write(writeFd, &request, half) == (ssize_t)half;
+        usleep(20000);
+        ok = ok && write(writeFd, (char*)&request + half, sizeof(request) - half) ==
+            (ssize_t)(sizeof(request) - half);
+        ok = ok && receive(readFd, 0, result);
+        if (!ok) {
+            fprintf(stderr, "transport %d: split request failed\n", transport);
+        }
+    }
+
+    serverCounts(&before);
+    int64_t start = nowNs();
+    for (int s = 0; ok && s < count; s++) {
+        for (int i = 0; ok && i < size; i++) {
+            request.reserved1 = (size - 1 == i) ? DMN_CONN_STORM_LAST : 0;
+            request.reserved2 = s * size + i;
+            ok = loc_eng_dmn_conn_glue_msgsnd(writeFd, &request, sizeof(request)) ==
+                (int)sizeof(request);
+        }
+        for (int i = 0; ok && i < size; i++) {
+            ok = receive(readFd, s * size + i, result);
+        }
+    }
+    int64_t elapsed = nowNs() - start;
+    serverCounts(&after);
+
+    loc_eng_dmn_conn_loc_api_server_unblock();
+    loc_eng_dmn_conn_loc_api_server_join();
+    if (writeFd >= 0) {
+        close(writeFd);
+    }
+    if (readFd >= 0) {
+        close(readFd);
+    }
+    if (!ok) {
+        return false;
+    }
+
+    result->stormUs = (double)elapsed / count / 1000;
+    result->syscallsPerStorm = (double)(after.syscalls - before.syscalls) / count;
+    result->switchesPerStorm = (double)(after.switches - before.switches) / count;
+    return 0 == result->bad;
+}
+
+int main(int argc, char** argv)
+{
+    int size = argc > 1 ? atoi(argv[1]) : 32;
+    int count = argc > 2 ? atoi(argv[2]) : 1000;
+    if (size < 1 || size > DMN_CONN_STORM_MAX || count < 1) {
+        fprintf(stderr, "1 to %d requests per storm, at least 1 storm\n",
+                DMN_CONN_STORM_MAX);
+        return 2;
+    }
+    loc_logger.DEBUG_LEVEL = 2;
+
+    if ((mkdir("/data", 0755) < 0 && EEXIST != errno) ||
+        (mkdir("/data/misc", 0755) < 0 && EEXIST != errno) ||
+        (mkdir(DMN_CONN_STORM_DIR, 0770) < 0 && EEXIST != errno)) {
+        fprintf(stderr, "mkdir %s: %s\n", DMN_CONN_STORM_DIR, strerror(errno));
+        return 1;
+    }
+
+    DmnConnStormResult fifo;
+    DmnConnStormResult batched;
+    bool ok = storms(LOC_ENG_DMN_CONN_FIFO, size, count, &fifo);
+    ok = storms(LOC_ENG_DMN_CONN_FIFO_BATCHED, size, count, &batched) && ok;
+
+    printf("{\n");
+    printf("  \"requests_per_storm\": %d,\n", size);
+    printf("  \"storms\": %d,\n", count);
+    printf("  \"fifo_storm_us\": %.1f,\n", fifo.stormUs);
+    printf("  \"fifo_server_syscalls_per_storm\": %.1f,\n", fifo.syscallsPerStorm);
+    printf("  \"fifo_server_switches_per_storm\": %.1f,\n", fifo.switchesPerStorm);
+    printf("  \"fifo_bad_responses\": %d,\n", fifo.bad);
+    printf("  \"batched_storm_us\": %.1f,\n", batched.stormUs);
+    printf("  \"batched_server_syscalls_per_storm\": %.1f,\n", batched.syscallsPerStorm);
+    printf("  \"batched_server_switches_per_storm\": %.1f,\n", batched.switchesPerStorm);
+    printf("  \"batched_bad_responses\": %d,\n", batched.bad);
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    return ok ? 0 : 1;
+}
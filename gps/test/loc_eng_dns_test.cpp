@@ -0,0 +1,358 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Drives loc_eng_dns and loc_eng_set_server_proxy against a stub
+   getaddrinfo that takes DNS_TEST_LATENCY_MS per lookup and hands out a
+   new address every time. Measures what a caller waits on a cache miss
+   and on a hit, and checks that a lookup which finishes after the server
+   was set again never overwrites the newer server, whether it was a
+   first lookup or the refresh of an expired entry. Prints one JSON
+   object:
+
+     loc_eng_dns_test */
+
+#define LOG_TAG "LocSvc_dns_test"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <MsgTask.h>
+#include <LocApiBase.h>
+#include <loc_eng.h>
+#include <loc_eng_dns.h>
+
+using namespace loc_core;
+
+#define DNS_TEST_LATENCY_MS 200
+#define DNS_TEST_HITS 10000
+#define DNS_TEST_MAX_SERVERS 64
+
+/* ------------------------------------------------------- stub resolver */
+
+static volatile int dnsTestLookups = 0;
+static volatile int dnsTestLookupsDone = 0;
+
+// takes the place of the libc one; every name but bad.example gets
+// 10.0.<lookup #>.1
+extern "C" int getaddrinfo(const char* node, const char* service,
+                           const struct addrinfo* hints,
+                           struct addrinfo** res)
+{
+    int n = __sync_add_and_fetch(&dnsTestLookups, 1);
+    usleep(DNS_TEST_LATENCY_MS * 1000);
+    if (0 == strcmp(node, "bad.example")) {
+        __sync_add_and_fetch(&dnsTestLookupsDone, 1);
+        return EAI_NONAME;
+    }
+
+    struct addrinfo* ai = (struct addrinfo*)calloc(1, sizeof(*ai));
+    struct sockaddr_in* sa = (struct sockaddr_in*)calloc(1, sizeof(*sa));
+    sa->sin_family = AF_INET;
+    sa->sin_addr.s_addr = htonl(0x0a000001 | ((n & 0xff) << 8));
+    ai->ai_family = AF_INET;
+    ai->ai_addrlen = sizeof(*sa);
+    ai->ai_addr = (struct sockaddr*)sa;
+    *res = ai;
+    __sync_add_and_fetch(&dnsTestLookupsDone, 1);
+    return 0;
+}
+
+extern "C" void freeaddrinfo(struct addrinfo* res)
+{
+    while (NULL != res) {
+        struct addrinfo* next = res->ai_next;
+        free(res->ai_addr);
+        free(res);
+        res = next;
+    }
+}
+
+/* ---------------------------------------------------- fake LocApi side */
+
+struct DnsTestServer {
+    unsigned int ip;
+    int port;
+    LocServerType type;
+};
+
+// keeps every server the adapter's MsgTask sets
+class DnsTestLocApi : public LocApiBase {
+public:
+    DnsTestServer mServers[DNS_TEST_MAX_SERVERS];
+    volatile int mNumServers;
+    inline DnsTestLocApi(const MsgTask* msgTask) :
+        LocApiBase(msgTask, 0), mNumServers(0) {}
+    virtual enum loc_api_adapter_err
+        setServer(unsigned int ip, int port, LocServerType type) {
+        if (mNumServers < DNS_TEST_MAX_SERVERS) {
+            DnsTestServer* server = &mServers[mNumServers];
+            server->ip = ip;
+            server->port = port;
+            server->type = type;
+            mNumServers++;
+        }
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+};
+
+// a LocEngAdapter whose LocApi the test picks
+class DnsTestAdapter : public LocEngAdapter {
+public:
+    inline DnsTestAdapter(void* owner) :
+        LocEngAdapter((LOC_API_ADAPTER_EVENT_MASK_T)0, owner, NULL) {}
+    inline void setLocApi(LocApiBase* locApi) { mLocApi = locApi; }
+    inline const MsgTask* getMsgTask() const { return mMsgTask; }
+};
+
+struct DnsTestSyncMsg : public LocMsg {
+    volatile bool* mDone;
+    inline DnsTestSyncMsg(volatile bool* done) : LocMsg(), mDone(done) {}
+    inline virtual void proc() const {
+        *mDone = true;
+    }
+};
+
+/* ------------------------------------------------------------- helpers */
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+struct DnsTestThreadArg {
+    void (*start)(void*);
+    void* arg;
+};
+
+static void* dnsTestThread(void* p)
+{
+    DnsTestThreadArg arg = *(DnsTestThreadArg*)p;
+    delete (DnsTestThreadArg*)p;
+    arg.start(arg.arg);
+    return NULL;
+}
+
+static pthread_t dnsTestCreateThread(const char* name, void (*start)(void*),
+                                     void* arg)
+{
+    pthread_t thread;
+    DnsTestThreadArg* threadArg = new DnsTestThreadArg;
+    threadArg->start = start;
+    threadArg->arg = arg;
+    pthread_create(&thread, NULL, dnsTestThread, threadArg);
+    return thread;
+}
+
+// lets the first `lookups` lookups finish, then everything they sent
+// through the adapter's MsgTask
+static void settle(DnsTestAdapter* adapter, int lookups)
+{
+    while (dnsTestLookupsDone < lookups) {
+        usleep(1000);
+    }
+    // the callback runs right after getaddrinfo returns
+    usleep(50000);
+    volatile bool done = false;
+    adapter->sendMsg(new DnsTestSyncMsg(&done));
+    while (!done) {
+        usleep(1000);
+    }
+}
+
+// the last server of type set on the LocApi, if it is ip:port
+static bool lastServerIs(DnsTestLocApi* locApi, LocServerType type,
+                         unsigned int ip, int port)
+{
+    for (int i = locApi->mNumServers - 1; i >= 0; i--) {
+        if (locApi->mServers[i].type == type) {
+            return locApi->mServers[i].ip == ip &&
+                   locApi->mServers[i].port == port;
+        }
+    }
+    return false;
+}
+
+static volatile int dnsTestCallbacks = 0;
+
+static void dnsTestCb(void* data, const char* host,
+                      const loc_eng_dns_addr_s_type* addr)
+{
+    *(int64_t*)data = nowNs();
+    __sync_add_and_fetch(&dnsTestCallbacks, 1);
+}
+
+/* --------------------------------------------------------------- tests */
+
+// what a caller waits for a name that is not cached, and for one that is
+static bool testLatency(loc_eng_dns_s_type* dns, double* missUs,
+                        double* missCbMs, double* hitUs)
+{
+    loc_eng_dns_addr_s_type addr;
+    int64_t cbNs = 0;
+
+    int64_t start = nowNs();
+    int ret = loc_eng_dns_resolve(dns, "miss.example", AF_INET, &addr,
+                                  dnsTestCb, &cbNs);
+    *missUs = (nowNs() - start) / 1e3;
+    if (LOC_ENG_DNS_PENDING != ret) {
+        fprintf(stderr, "miss returned %d\n", ret);
+        return false;
+    }
+    while (0 == dnsTestCallbacks) {
+        usleep(1000);
+    }
+    *missCbMs = (cbNs - start) / 1e6;
+
+    int lookups = dnsTestLookups;
+    start = nowNs();
+    for (int i = 0; i < DNS_TEST_HITS; i++) {
+        ret = loc_eng_dns_resolve(dns, "miss.example", AF_INET, &addr,
+                                  dnsTestCb, &cbNs);
+        if (LOC_ENG_DNS_DONE != ret) {
+            fprintf(stderr, "hit %d returned %d\n", i, ret);
+            return false;
+        }
+    }
+    *hitUs = (nowNs() - start) / 1e3 / DNS_TEST_HITS;
+    if (lookups != dnsTestLookups) {
+        fprintf(stderr, "hits did %d lookups\n", dnsTestLookups - lookups);
+        return false;
+    }
+    return true;
+}
+
+// a first lookup still in flight when a numeric server is set
+static bool testPendingSuperseded(loc_eng_data_s_type& locEng,
+                                  DnsTestAdapter* adapter,
+                                  DnsTestLocApi* locApi)
+{
+    unsigned int newer = ntohl(inet_addr("10.9.8.7"));
+    int lookups = dnsTestLookupsDone;
+    loc_eng_set_server_proxy(locEng, LOC_AGPS_CDMA_PDE_SERVER,
+                             "pending.example", 4911);
+    loc_eng_set_server_proxy(locEng, LOC_AGPS_CDMA_PDE_SERVER,
+                             "10.9.8.7", 4912);
+    settle(adapter, lookups + 1);
+    if (!lastServerIs(locApi, LOC_AGPS_CDMA_PDE_SERVER, newer, 4912)) {
+        fprintf(stderr, "a pending lookup overwrote the newer PDE server\n");
+        return false;
+    }
+    return true;
+}
+
+// the refresh of an expired entry, with and without a newer server set
+// while it runs
+static bool testStaleRefresh(loc_eng_data_s_type& locEng,
+                             DnsTestAdapter* adapter,
+                             DnsTestLocApi* locApi)
+{
+    // cached for a second
+    int lookups = dnsTestLookupsDone;
+    loc_eng_set_server_proxy(locEng, LOC_AGPS_MPC_SERVER,
+                             "stale.example", 4913);
+    settle(adapter, lookups + 1);
+    sleep(2);
+
+    // the expired address goes out at once, the refresh follows
+    int servers = locApi->mNumServers;
+    loc_eng_set_server_proxy(locEng, LOC_AGPS_MPC_SERVER,
+                             "stale.example", 4914);
+    settle(adapter, lookups + 2);
+    if (locApi->mNumServers != servers + 2) {
+        fprintf(stderr, "an expired entry set %d servers, not 2\n",
+                locApi->mNumServers - servers);
+        return false;
+    }
+    unsigned int refreshed = locApi->mServers[locApi->mNumServers - 1].ip;
+    if (refreshed == locApi->mServers[servers].ip) {
+        fprintf(stderr, "the refresh did not set the new address\n");
+        return false;
+    }
+    sleep(2);
+
+    unsigned int newer = ntohl(inet_addr("10.9.8.6"));
+    loc_eng_set_server_proxy(locEng, LOC_AGPS_MPC_SERVER,
+                             "stale.example", 4915);
+    loc_eng_set_server_proxy(locEng, LOC_AGPS_MPC_SERVER,
+                             "10.9.8.6", 4916);
+    settle(adapter, lookups + 3);
+    if (!lastServerIs(locApi, LOC_AGPS_MPC_SERVER, newer, 4916)) {
+        fprintf(stderr, "a refresh overwrote the newer MPC server\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    loc_logger.DEBUG_LEVEL = 2;
+
+    char cachePath[] = "/tmp/loc_eng_dns_testXXXXXX";
+    close(mkstemp(cachePath));
+    unlink(cachePath);
+
+    loc_eng_data_s_type locEng;
+    memset(&locEng, 0, sizeof(locEng));
+    DnsTestAdapter* adapter = new DnsTestAdapter(&locEng);
+    // creating the context read /etc/gps.conf, which resets the level
+    loc_logger.DEBUG_LEVEL = 2;
+    DnsTestLocApi* locApi = new DnsTestLocApi(adapter->getMsgTask());
+    adapter->setLocApi(locApi);
+    locEng.adapter = adapter;
+    locEng.dns = loc_eng_dns_create(dnsTestCreateThread, cachePath, 1);
+
+    double missUs = 0, missCbMs = 0, hitUs = 0;
+    bool latencyOk = testLatency(locEng.dns, &missUs, &missCbMs, &hitUs);
+    bool pendingOk = testPendingSuperseded(locEng, adapter, locApi);
+    bool staleOk = testStaleRefresh(locEng, adapter, locApi);
+    bool ok = latencyOk && pendingOk && staleOk;
+    unlink(cachePath);
+
+    printf("{\n");
+    printf("  \"stub_latency_ms\": %d,\n", DNS_TEST_LATENCY_MS);
+    printf("  \"miss_return_us\": %.1f,\n", missUs);
+    printf("  \"miss_callback_ms\": %.1f,\n", missCbMs);
+    printf("  \"hit_us\": %.3f,\n", hitUs);
+    printf("  \"lookups\": %d,\n", dnsTestLookups);
+    printf("  \"servers_set\": %d,\n", (int)locApi->mNumServers);
+    printf("  \"pending_superseded_ok\": %s,\n", pendingOk ? "true" : "false");
+    printf("  \"stale_refresh_ok\": %s,\n", staleOk ? "true" : "false");
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+    // the MsgTask threads are never stopped
+    _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,234 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Injects XTRA_TEST_SIZE bytes through loc_eng_xtra_inject_buffer into
+   a fake LocApi that takes a microsecond a byte, once one that takes the
+   data in parts and once one that only takes it whole. Meanwhile sends
+   a report lane msg to the adapter's MsgTask every millisecond, and
+   measures how long the longest of them waited. Checks that the LocApi
+   got the data intact, in order, and that it was released once. Prints
+   one JSON object:
+
+     loc_eng_xtra_test */
+
+#define LOG_TAG "LocSvc_xtra_test"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <MsgTask.h>
+#include <LocApiBase.h>
+#include <loc_eng.h>
+
+using namespace loc_core;
+
+#define XTRA_TEST_SIZE (128 * 1024)
+// what a report may wait behind one part of the data, at most
+#define XTRA_TEST_MAX_WAIT_MS 20
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// reassembles what it is given, taking as long as a slow modem would
+class XtraTestLocApi : public LocApiBase {
+public:
+    const bool mTakesParts;
+    char* mData;
+    int mReceived;
+    int mParts;
+    bool mInOrder;
+    inline XtraTestLocApi(const MsgTask* msgTask, bool takesParts) :
+        LocApiBase(msgTask, 0), mTakesParts(takesParts),
+        mData(new char[XTRA_TEST_SIZE]), mReceived(0), mParts(0),
+        mInOrder(true) {}
+    virtual enum loc_api_adapter_err
+        setXtraData(char* data, int length) {
+        if (0 != mReceived || length != XTRA_TEST_SIZE) {
+            mInOrder = false;
+            return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+        }
+        memcpy(mData, data, length);
+        mReceived = length;
+        mParts = 1;
+        usleep(length);
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    virtual enum loc_api_adapter_err
+        setXtraDataPart(char* data, int length, int partNum,
+                        int totalParts, int totalLength) {
+        if (!mTakesParts) {
+            return LOC_API_ADAPTER_ERR_UNSUPPORTED;
+        }
+        if (partNum != mParts + 1 || partNum > totalParts ||
+            totalLength != XTRA_TEST_SIZE ||
+            mReceived + length > XTRA_TEST_SIZE) {
+            mInOrder = false;
+            return LOC_API_ADAPTER_ERR_INVALID_PARAMETER;
+        }
+        memcpy(mData + mReceived, data, length);
+        mReceived += length;
+        mParts++;
+        usleep(length);
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+};
+
+// a LocEngAdapter whose LocApi the test picks
+class XtraTestAdapter : public LocEngAdapter {
+public:
+    inline XtraTestAdapter(void* owner) :
+        LocEngAdapter((LOC_API_ADAPTER_EVENT_MASK_T)0, owner, NULL) {}
+    inline void setLocApi(LocApiBase* locApi) { mLocApi = locApi; }
+    inline const MsgTask* getMsgTask() const { return mMsgTask; }
+};
+
+// stands in for a position report; keeps the longest wait seen
+struct XtraTestReportMsg : public LocMsg {
+    const int64_t mSentNs;
+    volatile int64_t* mMaxWaitNs;
+    inline XtraTestReportMsg(volatile int64_t* maxWaitNs) :
+        LocMsg(LocMsg::LANE_REPORT), mSentNs(nowNs()), mMaxWaitNs(maxWaitNs) {}
+    inline virtual void proc() const {
+        int64_t wait = nowNs() - mSentNs;
+        if (wait > *mMaxWaitNs) {
+            *mMaxWaitNs = wait;
+        }
+    }
+};
+
+static volatile int xtraTestReleases = 0;
+
+static void xtraTestRelease(const char* data, int length, void* context)
+{
+    __sync_add_and_fetch(&xtraTestReleases, 1);
+}
+
+struct XtraTestThreadArg {
+    void (*start)(void*);
+    void* arg;
+};
+
+static void* xtraTestThread(void* p)
+{
+    XtraTestThreadArg arg = *(XtraTestThreadArg*)p;
+    delete (XtraTestThreadArg*)p;
+    arg.start(arg.arg);
+    return NULL;
+}
+
+static pthread_t xtraTestCreateThread(const char* name, void (*start)(void*),
+                                      void* arg)
+{
+    pthread_t thread;
+    XtraTestThreadArg* threadArg = new XtraTestThreadArg;
+    threadArg->start = start;
+    threadArg->arg = arg;
+    pthread_create(&thread, NULL, xtraTestThread, threadArg);
+    return thread;
+}
+
+// injects data through a LocApi that takes parts or not; returns the
+// longest a report waited, in ms, or -1 if the data did not get through
+static double inject(const char* data, bool takesParts, int* parts)
+{
+    loc_eng_data_s_type* locEng = new loc_eng_data_s_type;
+    memset(locEng, 0, sizeof(*locEng));
+    XtraTestAdapter* adapter = new XtraTestAdapter(locEng);
+    // creating the context read /etc/gps.conf, which resets the level
+    loc_logger.DEBUG_LEVEL = 2;
+    XtraTestLocApi* locApi = new XtraTestLocApi(adapter->getMsgTask(),
+                                                takesParts);
+    adapter->setLocApi(locApi);
+    locEng->adapter = adapter;
+    loc_eng_xtra_start_inject_task(*locEng, xtraTestCreateThread);
+    int releases = xtraTestReleases;
+
+    volatile int64_t maxWaitNs = 0;
+    loc_eng_xtra_inject_buffer(*locEng, data, XTRA_TEST_SIZE,
+                               xtraTestRelease, NULL);
+    while (xtraTestReleases == releases) {
+        adapter->sendMsg(new XtraTestReportMsg(&maxWaitNs));
+        usleep(1000);
+    }
+    // the last report sent may still be queued
+    usleep(XTRA_TEST_MAX_WAIT_MS * 1000);
+
+    *parts = locApi->mParts;
+    bool ok = locApi->mInOrder && XTRA_TEST_SIZE == locApi->mReceived &&
+        0 == memcmp(data, locApi->mData, XTRA_TEST_SIZE) &&
+        releases + 1 == xtraTestReleases &&
+        0 == locEng->xtra_module_data.inject_pending;
+    if (!ok) {
+        fprintf(stderr, "%s: %d of %d bytes in %d parts, in order %d, "
+                "%d releases, %d pending\n",
+                takesParts ? "parts" : "whole", locApi->mReceived,
+                XTRA_TEST_SIZE, locApi->mParts, locApi->mInOrder,
+                xtraTestReleases - releases,
+                (int)locEng->xtra_module_data.inject_pending);
+        return -1;
+    }
+    // the MsgTasks are never stopped, so neither is freed
+    return (double)maxWaitNs / 1000000;
+}
+
+int main(int argc, char** argv)
+{
+    loc_logger.DEBUG_LEVEL = 2;
+
+    char* data = new char[XTRA_TEST_SIZE];
+    for (int i = 0; i < XTRA_TEST_SIZE; i++) {
+        data[i] = (char)(i * 31 + i / 251);
+    }
+
+    int partsParts = 0;
+    int wholeParts = 0;
+    double partsWaitMs = inject(data, true, &partsParts);
+    double wholeWaitMs = inject(data, false, &wholeParts);
+
+    bool ok = partsWaitMs >= 0 && wholeWaitMs >= 0 && partsParts > 1 &&
+        1 == wholeParts && partsWaitMs < XTRA_TEST_MAX_WAIT_MS;
+
+    printf("{\n");
+    printf("  \"bytes\": %d,\n", XTRA_TEST_SIZE);
+    printf("  \"parts\": %d,\n", partsParts);
+    printf("  \"report_max_wait_ms_parts\": %.1f,\n", partsWaitMs);
+    printf("  \"report_max_wait_ms_whole\": %.1f,\n", wholeWaitMs);
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+    // the MsgTask threads are never stopped
+    _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,404 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Records a synthetic LocApi session with LocApiTrace, then plays it back
+   with LocApiReplay, once as fast as possible and once at the recorded
+   pace, into an adapter that hands every event to the MsgTask like
+   LocEngAdapter does. Checks that every event and the final results
+   line arrive, and that a fast replay never lets the MsgTask backlog run
+   away. Then plays it back once more, fast, into a real LocEngAdapter
+   made by loc_eng_init with stub HAL callbacks, and checks what reaches
+   the callbacks. Prints the replay results lines inside one JSON object:
+
+     loc_replay_test [fixes, default 20000] */
+
+#define LOG_TAG "LocSvc_replay_test"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <MsgTask.h>
+#include <ContextBase.h>
+#include <LocApiBase.h>
+#include <LocApiTrace.h>
+#include <LocApiReplay.h>
+#include <LocAdapterBase.h>
+#include <loc_eng.h>
+#include <log_util.h>
+
+using namespace loc_core;
+
+// a little above LOC_API_REPLAY_MAX_PENDING, for the msgs of the event
+// that was in flight when the replay checked
+#define REPLAY_TEST_MAX_PENDING 300
+#define REPLAY_TEST_TIMEOUT_S 60
+
+struct ReplayTestCounts {
+    uint32_t position;
+    uint32_t sv;
+    uint32_t nmea;
+    uint32_t status;
+    uint32_t atl;
+    uint32_t maxPending;
+};
+
+// LocApiBase keeps its constructor for subclasses
+class ReplayTestLocApi : public LocApiBase {
+public:
+    inline ReplayTestLocApi(const MsgTask* msgTask) :
+        LocApiBase(msgTask, 0) {}
+};
+
+// a context whose LocApi the test picks
+class ReplayTestContext : public ContextBase {
+public:
+    inline ReplayTestContext(const MsgTask* msgTask) :
+        ContextBase(msgTask, 0, "liblbs_core.so") {}
+    inline void setLocApi(LocApiBase* locApi) { mLocApi = locApi; }
+};
+
+// counts on the MsgTask thread, with a bit of work to make it the
+// slower end of the pipeline
+struct ReplayTestCountMsg : public LocMsg {
+    const MsgTask* mTask;
+    uint32_t* mCount;
+    uint32_t* mMaxPending;
+    inline ReplayTestCountMsg(const MsgTask* task, uint32_t* count,
+                              uint32_t* maxPending) :
+        LocMsg(), mTask(task), mCount(count), mMaxPending(maxPending) {}
+    inline virtual void proc() const {
+        volatile uint32_t spin = 0;
+        for (int i = 0; i < 2000; i++) {
+            spin += i;
+        }
+        (*mCount)++;
+        uint32_t pending = mTask->getPendingMsgs();
+        if (pending > *mMaxPending) {
+            *mMaxPending = pending;
+        }
+    }
+};
+
+class ReplayTestAdapter : public LocAdapterBase {
+    ReplayTestCounts* mCounts;
+    inline void count(uint32_t* counter) {
+        sendMsg(new ReplayTestCountMsg(mMsgTask, counter, &mCounts->maxPending));
+    }
+public:
+    inline ReplayTestAdapter(ContextBase* context, ReplayTestCounts* counts) :
+        LocAdapterBase(LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+                       LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+                       LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT |
+                       LOC_API_ADAPTER_BIT_STATUS_REPORT |
+                       LOC_API_ADAPTER_BIT_LOCATION_SERVER_REQUEST,
+                       context),
+        mCounts(counts) {}
+    virtual void reportPosition(UlpLocation& location,
+                                GpsLocationExtended& locationExtended,
+                                void* locationExt,
+                                enum loc_sess_status status,
+                                LocPosTechMask techMask) {
+        count(&mCounts->position);
+    }
+    virtual void reportSv(GpsSvStatus& svStatus,
+                          GpsLocationExtended& locationExtended,
+                          void* svExt) {
+        count(&mCounts->sv);
+    }
+    virtual void reportNmea(const char* nmea, int length) {
+        count(&mCounts->nmea);
+    }
+    virtual void reportStatus(GpsStatusValue status) {
+        count(&mCounts->status);
+    }
+    virtual bool requestATL(int connHandle, AGpsType agpsType) {
+        count(&mCounts->atl);
+        return true;
+    }
+};
+
+static void record(LocApiBase* locApi, int fixes)
+{
+    static const char nmea[] =
+        "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+    UlpLocation location;
+    GpsLocationExtended extended;
+    GpsSvStatus sv;
+    memset(&location, 0, sizeof(location));
+    memset(&extended, 0, sizeof(extended));
+    memset(&sv, 0, sizeof(sv));
+    sv.size = sizeof(sv);
+    sv.num_svs = 12;
+    for (int k = 0; k < sv.num_svs; k++) {
+        sv.sv_list[k].prn = k + 1;
+        sv.sv_list[k].snr = 30;
+    }
+
+    locApi->reportStatus(GPS_STATUS_SESSION_BEGIN);
+    for (int i = 0; i < fixes; i++) {
+        location.gpsLocation.flags = GPS_LOCATION_HAS_LAT_LONG;
+        location.gpsLocation.latitude = 48.1 + i * 1e-6;
+        location.gpsLocation.longitude = 11.5;
+        locApi->reportPosition(location, extended, NULL, LOC_SESS_SUCCESS,
+                               LOC_POS_TECH_MASK_SATELLITE);
+        locApi->reportSv(sv, extended, NULL);
+        locApi->reportNmea(nmea, sizeof(nmea) - 1);
+    }
+    locApi->requestATL(1, AGPS_TYPE_SUPL);
+    locApi->reportStatus(GPS_STATUS_SESSION_END);
+}
+
+// the results line LocApiReplay appends once the MsgTask is through;
+// false on timeout
+static bool waitForResults(const char* path, char* line, int size)
+{
+    for (int i = 0; i < REPLAY_TEST_TIMEOUT_S * 100; i++) {
+        FILE* fp = fopen(path, "r");
+        if (NULL != fp) {
+            bool found = NULL != fgets(line, size, fp);
+            fclose(fp);
+            if (found) {
+                line[strcspn(line, "\n")] = '\0';
+                return true;
+            }
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+static bool replay(ReplayTestContext& context, const char* tracePath,
+                   bool realTime, int fixes, char* line, int size,
+                   uint32_t* maxPending)
+{
+    const MsgTask* task = context.getMsgTask();
+    char resultsPath[] = "/tmp/loc_replay_test_resultsXXXXXX";
+    close(mkstemp(resultsPath));
+
+    ReplayTestCounts counts;
+    memset(&counts, 0, sizeof(counts));
+    LocApiReplay* locApi = LocApiReplay::create(task, 0, tracePath, realTime,
+                                                resultsPath);
+    if (NULL == locApi) {
+        unlink(resultsPath);
+        return false;
+    }
+    context.setLocApi(locApi);
+    ReplayTestAdapter adapter(&context, &counts);
+    LocPosMode posMode;
+    locApi->startFix(posMode);
+
+    bool ok = waitForResults(resultsPath, line, size);
+    unlink(resultsPath);
+    if (!ok) {
+        fprintf(stderr, "no results from the %s replay\n",
+                realTime ? "real time" : "fast");
+        return false;
+    }
+    if (counts.position != (uint32_t)fixes || counts.sv != (uint32_t)fixes ||
+        counts.nmea != (uint32_t)fixes || counts.status != 2 || counts.atl != 1) {
+        fprintf(stderr, "%s replay delivered %u positions, %u sv, %u nmea, "
+                "%u status, %u atl\n", realTime ? "real time" : "fast",
+                counts.position, counts.sv, counts.nmea, counts.status,
+                counts.atl);
+        ok = false;
+    }
+    *maxPending = counts.maxPending;
+    return ok;
+}
+
+// the stub HAL callbacks of the loc_eng replay. Positions, SVs and
+// status come on the MsgTask, NMEA on the thread of the NMEA bus.
+static volatile uint32_t replayTestLocations = 0;
+static volatile uint32_t replayTestSvs = 0;
+static volatile uint32_t replayTestNmeas = 0;
+static volatile GpsStatusValue replayTestLastStatus = GPS_STATUS_NONE;
+
+static void replayTestLocationCb(UlpLocation* location, void* locExt)
+{
+    replayTestLocations++;
+}
+
+static void replayTestStatusCb(GpsStatus* status)
+{
+    replayTestLastStatus = status->status;
+}
+
+static void replayTestSvStatusCb(GpsSvStatus* svStatus, void* svExt)
+{
+    replayTestSvs++;
+}
+
+static void replayTestNmeaCb(GpsUtcTime timestamp, const char* nmea, int length)
+{
+    __sync_add_and_fetch(&replayTestNmeas, 1);
+}
+
+static void replayTestWakelockCb()
+{
+}
+
+struct ReplayTestThreadArg {
+    void (*start)(void*);
+    void* arg;
+};
+
+static void* replayTestThread(void* p)
+{
+    ReplayTestThreadArg arg = *(ReplayTestThreadArg*)p;
+    delete (ReplayTestThreadArg*)p;
+    arg.start(arg.arg);
+    return NULL;
+}
+
+static pthread_t replayTestCreateThread(const char* name, void (*start)(void*),
+                                        void* arg)
+{
+    pthread_t thread;
+    ReplayTestThreadArg* threadArg = new ReplayTestThreadArg;
+    threadArg->start = start;
+    threadArg->arg = arg;
+    pthread_create(&thread, NULL, replayTestThread, threadArg);
+    return thread;
+}
+
+// plays the trace back, fast, into the LocEngAdapter of loc_eng_init.
+// No session is started, so loc_eng reports the session end but not its
+// begin, and the ATL request goes unhandled with AGPS not set up.
+static bool replayLocEng(const char* tracePath, int fixes, char* line,
+                         int size)
+{
+    static loc_eng_data_s_type locEng;
+    LocCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    callbacks.location_cb = replayTestLocationCb;
+    callbacks.status_cb = replayTestStatusCb;
+    callbacks.sv_status_cb = replayTestSvStatusCb;
+    callbacks.nmea_cb = replayTestNmeaCb;
+    callbacks.acquire_wakelock_cb = replayTestWakelockCb;
+    callbacks.release_wakelock_cb = replayTestWakelockCb;
+    callbacks.create_thread_cb = replayTestCreateThread;
+    if (0 != loc_eng_init(locEng, &callbacks,
+                          LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+                          LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+                          LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT |
+                          LOC_API_ADAPTER_BIT_STATUS_REPORT)) {
+        fprintf(stderr, "loc_eng_init failed\n");
+        return false;
+    }
+    // creating the context read /etc/gps.conf, which resets the level
+    loc_logger.DEBUG_LEVEL = 2;
+
+    char resultsPath[] = "/tmp/loc_replay_test_resultsXXXXXX";
+    close(mkstemp(resultsPath));
+    LocApiReplay* locApi = LocApiReplay::create(locEng.adapter->getMsgTask(),
+                                                0, tracePath, false,
+                                                resultsPath);
+    if (NULL == locApi) {
+        unlink(resultsPath);
+        return false;
+    }
+    // the adapter stays on the LocApi of its context too, which never
+    // reports anything on the host
+    locApi->addAdapter(locEng.adapter);
+    LocPosMode posMode;
+    locApi->startFix(posMode);
+
+    bool ok = waitForResults(resultsPath, line, size);
+    unlink(resultsPath);
+    if (!ok) {
+        fprintf(stderr, "no results from the loc_eng replay\n");
+        return false;
+    }
+    // with NMEA_PROVIDER at its default, AP, loc_eng adds the sentences
+    // it generates from each fix and SV report to the replayed ones, and
+    // the NMEA bus drops the oldest when nmea_cb falls a ring behind; so
+    // there is no exact count to check, only that they arrive
+    usleep(100000);
+    if (replayTestLocations != (uint32_t)fixes ||
+        replayTestSvs != (uint32_t)fixes || 0 == replayTestNmeas ||
+        GPS_STATUS_SESSION_END != replayTestLastStatus) {
+        fprintf(stderr, "loc_eng replay delivered %u locations, %u sv, "
+                "%u nmea, last status %d\n", replayTestLocations,
+                replayTestSvs, replayTestNmeas, (int)replayTestLastStatus);
+        ok = false;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    int fixes = argc > 1 ? atoi(argv[1]) : 20000;
+    loc_logger.DEBUG_LEVEL = 2;
+
+    MsgTask* task = new MsgTask((MsgTask::tAssociate)NULL, "replay_test");
+    ReplayTestContext context(task);
+    // the context read /etc/gps.conf, which resets the level
+    loc_logger.DEBUG_LEVEL = 2;
+
+    char tracePath[] = "/tmp/loc_replay_test_traceXXXXXX";
+    close(mkstemp(tracePath));
+    unlink(tracePath);
+    ReplayTestLocApi* recorder = new ReplayTestLocApi(task);
+    recorder->setTrace(LocApiTrace::create(tracePath));
+    record(recorder, fixes);
+
+    char fast[1024], realTime[1024], locEng[1024];
+    uint32_t fastPending = 0, realTimePending = 0;
+    bool ok = replay(context, tracePath, false, fixes, fast, sizeof(fast),
+                     &fastPending) &&
+              replay(context, tracePath, true, fixes, realTime, sizeof(realTime),
+                     &realTimePending) &&
+              replayLocEng(tracePath, fixes, locEng, sizeof(locEng));
+    unlink(tracePath);
+    if (ok && fastPending > REPLAY_TEST_MAX_PENDING) {
+        fprintf(stderr, "fast replay left %u msgs pending\n", fastPending);
+        ok = false;
+    }
+
+    if (ok) {
+        printf("{\"test\":\"loc_replay_test\",\"fixes\":%d,"
+               "\"fast\":%s,\"fast_max_pending\":%u,"
+               "\"realtime\":%s,\"realtime_max_pending\":%u,"
+               "\"loc_eng\":%s,\"loc_eng_nmea\":%u,\"ok\":true}\n",
+               fixes, fast, fastPending, realTime, realTimePending,
+               locEng, replayTestNmeas);
+    } else {
+        printf("{\"test\":\"loc_replay_test\",\"fixes\":%d,\"ok\":false}\n",
+               fixes);
+    }
+    fflush(stdout);
+
+    // the adapters are on the stack of replay(), and the MsgTask threads
+    // are left running
+    _exit(ok ? 0 : 1);
+}
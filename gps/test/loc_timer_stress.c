@@ -0,0 +1,176 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Stress test of loc_timer. Arms and cancels 100k timers, then lets a
+   batch of timers fire and measures how late each callback runs. Checks
+   that no cancelled timer fires, that every armed one does, and that
+   the process gains at most the one shared timer thread. Prints one
+   JSON object:
+
+     loc_timer_stress [timers, default 100000] */
+
+#define LOG_TAG "LocSvc_timer_stress"
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <loc_timer.h>
+
+#define TIMER_STRESS_FIRED 2000
+#define TIMER_STRESS_TIMEOUT_S 30
+
+typedef struct {
+    int64_t due_ns;
+    int64_t late_ns;
+} timer_stress_fire_s;
+
+static volatile int timer_stress_fired = 0;
+static volatile int timer_stress_cancelled_fired = 0;
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int thread_count(void)
+{
+    int count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    struct dirent* entry;
+
+    if (NULL == dir) {
+        return -1;
+    }
+    while (NULL != (entry = readdir(dir))) {
+        if ('.' != entry->d_name[0]) {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static void timer_stress_cancelled_cb(void* user_data, int result)
+{
+    __sync_fetch_and_add(&timer_stress_cancelled_fired, 1);
+}
+
+static void timer_stress_fire_cb(void* user_data, int result)
+{
+    timer_stress_fire_s* fire = (timer_stress_fire_s*)user_data;
+    fire->late_ns = now_ns() - fire->due_ns;
+    __sync_fetch_and_add(&timer_stress_fired, 1);
+}
+
+static int cmp_int64(const void* a, const void* b)
+{
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char** argv)
+{
+    int timers = argc > 1 ? atoi(argv[1]) : 100000;
+    static timer_stress_fire_s fires[TIMER_STRESS_FIRED];
+    static int64_t late[TIMER_STRESS_FIRED];
+    int threads_before, threads_armed, threads_after;
+    int failed_arms = 0, stop_late = 0;
+    int64_t start, cancel_ns, wait_until;
+    int i, ok;
+
+    loc_logger.DEBUG_LEVEL = 2;
+    threads_before = thread_count();
+
+    /* arm and cancel, the AGPS / NI pattern */
+    start = now_ns();
+    for (i = 0; i < timers; i++) {
+        void* handle = loc_timer_start(50 + i % 500, timer_stress_cancelled_cb,
+                                       NULL);
+        if (NULL == handle) {
+            failed_arms++;
+        } else if (0 != loc_timer_stop(handle)) {
+            stop_late++;
+        }
+    }
+    cancel_ns = now_ns() - start;
+
+    /* arm a batch spread over 200 ms and let it fire */
+    for (i = 0; i < TIMER_STRESS_FIRED; i++) {
+        unsigned int delay_ms = 10 + i % 200;
+        fires[i].due_ns = now_ns() + delay_ms * 1000000LL;
+        if (NULL == loc_timer_start(delay_ms, timer_stress_fire_cb, &fires[i])) {
+            failed_arms++;
+        }
+    }
+    threads_armed = thread_count();
+    wait_until = now_ns() + TIMER_STRESS_TIMEOUT_S * 1000000000LL;
+    while (timer_stress_fired < TIMER_STRESS_FIRED - failed_arms &&
+           now_ns() < wait_until) {
+        usleep(1000);
+    }
+    /* past the longest delay of the cancelled timers */
+    usleep(600000);
+    threads_after = thread_count();
+
+    for (i = 0; i < TIMER_STRESS_FIRED; i++) {
+        late[i] = fires[i].late_ns;
+    }
+    qsort(late, TIMER_STRESS_FIRED, sizeof(late[0]), cmp_int64);
+
+    ok = 0 == failed_arms && 0 == stop_late &&
+         0 == timer_stress_cancelled_fired &&
+         TIMER_STRESS_FIRED == timer_stress_fired &&
+         threads_armed <= threads_before + 1 &&
+         threads_after <= threads_before + 1;
+
+    printf("{\n");
+    printf("  \"timers\": %d,\n", timers);
+    printf("  \"arm_cancel_ns\": %.1f,\n", (double)cancel_ns / timers);
+    printf("  \"failed_arms\": %d,\n", failed_arms);
+    printf("  \"cancelled_fired\": %d,\n", timer_stress_cancelled_fired);
+    printf("  \"fired\": %d,\n", timer_stress_fired);
+    printf("  \"late_p50_us\": %.1f,\n", late[TIMER_STRESS_FIRED / 2] / 1e3);
+    printf("  \"late_p99_us\": %.1f,\n",
+           late[TIMER_STRESS_FIRED * 99 / 100] / 1e3);
+    printf("  \"late_max_us\": %.1f,\n", late[TIMER_STRESS_FIRED - 1] / 1e3);
+    printf("  \"threads_before\": %d,\n", threads_before);
+    printf("  \"threads_armed\": %d,\n", threads_armed);
+    printf("  \"threads_after\": %d,\n", threads_after);
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+    /* the timer thread is never stopped */
+    _exit(ok ? 0 : 1);
+}
@@ -0,0 +1,151 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* msg_q under contention: 1, 2, 4 and 8 senders feeding one receiver.
+   Prints one JSON object on stdout:
+
+     msg_q_bench [messages per run, default 1000000]
+
+   Per run it reports messages per second and the mean msg_q_snd cost
+   seen by the senders. It also checks that every sender's messages
+   arrive complete and in order. */
+
+#define LOG_TAG "LocSvc_msg_q_bench"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <msg_q.h>
+#include <log_util.h>
+
+#define MAX_SENDERS 8
+
+typedef struct {
+    void* q;
+    long id;
+    long count;
+    long long send_ns;
+} sender_arg;
+
+static long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void* sender(void* arg)
+{
+    sender_arg* s = (sender_arg*)arg;
+    long long start = now_ns();
+    long i;
+
+    for (i = 1; i <= s->count; i++) {
+        /* sender id in the top bits, sequence number below */
+        void* msg = (void*)((s->id << 40) | i);
+        msg_q_snd(s->q, msg, NULL);
+    }
+    s->send_ns = now_ns() - start;
+    return NULL;
+}
+
+/* returns 0 if all messages arrived in order per sender */
+static int run(int senders, long total, int first)
+{
+    sender_arg args[MAX_SENDERS];
+    pthread_t threads[MAX_SENDERS];
+    long last[MAX_SENDERS];
+    long per_sender = total / senders;
+    long received;
+    long long start, elapsed, send_ns = 0;
+    void* q = (void*)msg_q_init2();
+    int i, bad = 0;
+
+    for (i = 0; i < senders; i++) {
+        args[i].q = q;
+        args[i].id = i;
+        args[i].count = per_sender;
+        args[i].send_ns = 0;
+        last[i] = 0;
+    }
+
+    start = now_ns();
+    for (i = 0; i < senders; i++) {
+        pthread_create(&threads[i], NULL, sender, &args[i]);
+    }
+    for (received = 0; received < per_sender * senders; received++) {
+        void* msg;
+        long v, id, seq;
+        if (eMSG_Q_SUCCESS != msg_q_rcv(q, &msg)) {
+            bad = 1;
+            break;
+        }
+        v = (long)msg;
+        id = v >> 40;
+        seq = v & ((1L << 40) - 1);
+        if (id >= senders || seq != last[id] + 1) {
+            bad = 1;
+        } else {
+            last[id] = seq;
+        }
+    }
+    elapsed = now_ns() - start;
+    for (i = 0; i < senders; i++) {
+        pthread_join(threads[i], NULL);
+        send_ns += args[i].send_ns;
+    }
+    msg_q_unblock(q);
+    msg_q_destroy(&q);
+
+    printf("%s{\"senders\":%d,\"messages\":%ld,"
+           "\"msgs_per_s\":%.0f,\"snd_ns\":%.1f,\"ok\":%s}",
+           first ? "" : ",", senders, received,
+           received * 1e9 / elapsed,
+           (double)send_ns / (per_sender * senders),
+           bad ? "false" : "true");
+    return bad;
+}
+
+int main(int argc, char** argv)
+{
+    static const int sender_counts[] = { 1, 2, 4, 8 };
+    long total = argc > 1 ? atol(argv[1]) : 1000000L;
+    int i, failed = 0;
+
+    /* msg_q_snd and msg_q_rcv log every message at debug level */
+    loc_logger.DEBUG_LEVEL = 0;
+
+    printf("{\"bench\":\"msg_q_bench\",\"runs\":[");
+    for (i = 0; i < (int)(sizeof(sender_counts) / sizeof(sender_counts[0])); i++) {
+        failed |= run(sender_counts[i], total, 0 == i);
+    }
+    printf("]}\n");
+    return failed;
+}
@@ -0,0 +1,261 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Golden output test and benchmark of the NMEA generator. Feeds a fixed
+   series of SV reports and fixes through loc_eng_nmea_generate_sv and
+   loc_eng_nmea_generate_pos and compares every sentence with
+   nmea_golden.txt, which the snprintf based generator this one replaced
+   wrote from the same inputs. Then times the same series over and over
+   for a sentences per second figure. Prints one JSON object:
+
+     nmea_golden_test [golden file, default nmea_golden.txt] [rounds]
+
+   The inputs cover fixes with and without each optional field, both
+   hemispheres, minutes that round up to 60, GPS and GLONASS SVs past
+   what one GSV holds, reports with no SV used, standalone and assisted
+   modes, sentences with generate_nmea off, and UTC midnight and year
+   ends. */
+
+#define LOG_TAG "LocSvc_nmea_golden"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include <loc_eng.h>
+#include <loc_eng_nmea.h>
+
+using namespace loc_core;
+
+#define NMEA_GOLDEN_FIXES 64
+#define NMEA_GOLDEN_ROUNDS 2000
+
+static std::vector<std::string>* nmeaGoldenOut = NULL;
+static uint64_t nmeaGoldenSentences = 0;
+
+static void nmeaGoldenCb(GpsUtcTime timestamp, const char* nmea, int length)
+{
+    nmeaGoldenSentences++;
+    if (NULL != nmeaGoldenOut) {
+        std::string sentence(nmea, length);
+        while (!sentence.empty() && ('\n' == sentence[sentence.size() - 1] ||
+                                     '\r' == sentence[sentence.size() - 1])) {
+            sentence.erase(sentence.size() - 1);
+        }
+        nmeaGoldenOut->push_back(sentence);
+    }
+}
+
+static uint32_t nmeaGoldenRand(uint32_t* state)
+{
+    *state = *state * 1103515245 + 12345;
+    return (*state >> 8) & 0xffffff;
+}
+
+// in [lo, hi), in 1/4096ths of the range
+static double nmeaGoldenRange(uint32_t* state, double lo, double hi)
+{
+    return lo + (hi - lo) * (nmeaGoldenRand(state) % 4096) / 4096.0;
+}
+
+// the inputs of fix i; the same on every call for the same i
+static void nmeaGoldenFill(int i, GpsSvStatus& sv, UlpLocation& location,
+                           GpsLocationExtended& extended,
+                           LocPositionMode* mode, unsigned char* generate)
+{
+    static const GpsUtcTime times[] = {
+        1412000000000LL,    // 2014-09-29 14:13:20
+        1419983999500LL,    // just before 2015-01-01 00:00:00
+        1425167999900LL,    // just before 2015-03-01, after a 28 day Feb
+        1456790399950LL,    // just before 2016-03-01, after a 29 day Feb
+    };
+    uint32_t state = 0x9e3779b9u ^ (uint32_t)i;
+
+    memset(&sv, 0, sizeof(sv));
+    memset(&location, 0, sizeof(location));
+    memset(&extended, 0, sizeof(extended));
+
+    sv.size = sizeof(sv);
+    sv.num_svs = nmeaGoldenRand(&state) % (GPS_MAX_SVS + 1);
+    for (int k = 0; k < sv.num_svs; k++) {
+        switch (nmeaGoldenRand(&state) % 3) {
+        case 0:
+            sv.sv_list[k].prn = 1 + nmeaGoldenRand(&state) % 32;
+            break;
+        case 1:
+            sv.sv_list[k].prn = 65 + nmeaGoldenRand(&state) % 32;
+            break;
+        default:
+            // neither GPS nor GLONASS
+            sv.sv_list[k].prn = 120 + nmeaGoldenRand(&state) % 40;
+            break;
+        }
+        sv.sv_list[k].snr = nmeaGoldenRand(&state) % 4 ?
+            nmeaGoldenRange(&state, 0, 50) : 0;
+        sv.sv_list[k].elevation = nmeaGoldenRange(&state, -5, 90);
+        sv.sv_list[k].azimuth = nmeaGoldenRange(&state, 0, 360);
+    }
+    sv.used_in_fix_mask = nmeaGoldenRand(&state) % 5 ?
+        nmeaGoldenRand(&state) ^ (nmeaGoldenRand(&state) << 16) : 0;
+
+    extended.size = sizeof(extended);
+    extended.flags = nmeaGoldenRand(&state) &
+        (GPS_LOCATION_EXTENDED_HAS_DOP |
+         GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL |
+         GPS_LOCATION_EXTENDED_HAS_MAG_DEV);
+    extended.pdop = (nmeaGoldenRand(&state) % 40) / 4.0;
+    extended.hdop = (nmeaGoldenRand(&state) % 40) / 20.0;
+    extended.vdop = nmeaGoldenRange(&state, 0, 10);
+    extended.altitudeMeanSeaLevel = nmeaGoldenRange(&state, -100, 9000);
+    extended.magneticDeviation = nmeaGoldenRange(&state, -30, 30);
+
+    location.size = sizeof(location);
+    location.position_source = ULP_LOCATION_IS_FROM_GNSS;
+    location.gpsLocation.size = sizeof(GpsLocation);
+    location.gpsLocation.flags = nmeaGoldenRand(&state) &
+        (GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ALTITUDE |
+         GPS_LOCATION_HAS_SPEED | GPS_LOCATION_HAS_BEARING |
+         GPS_LOCATION_HAS_ACCURACY);
+    location.gpsLocation.latitude = nmeaGoldenRange(&state, -90, 90);
+    location.gpsLocation.longitude = nmeaGoldenRange(&state, -180, 180);
+    if (0 == i % 9) {
+        // 59.99999 minutes, which prints as 60.0000 unless carried
+        location.gpsLocation.latitude = 37 + 59.99999 / 60;
+        location.gpsLocation.longitude = -(122 + 59.99999 / 60);
+    }
+    location.gpsLocation.altitude = nmeaGoldenRange(&state, -100, 9000);
+    location.gpsLocation.speed = 0 == i % 5 ?
+        (nmeaGoldenRand(&state) % 100) * 0.25 : nmeaGoldenRange(&state, 0, 80);
+    location.gpsLocation.bearing = 0 == i % 7 ?
+        (nmeaGoldenRand(&state) % 1000) * 0.05 : nmeaGoldenRange(&state, 0, 360);
+    location.gpsLocation.accuracy = nmeaGoldenRange(&state, 1, 100);
+    // a few fixes a second, across each of the boundaries
+    location.gpsLocation.timestamp = times[i % 4] + (i / 4) * 150;
+
+    *mode = (LocPositionMode)(nmeaGoldenRand(&state) % 3);
+    *generate = nmeaGoldenRand(&state) % 4 ? 1 : 0;
+}
+
+static void nmeaGoldenRun(loc_eng_data_s_type& locEng)
+{
+    GpsSvStatus sv;
+    UlpLocation location;
+    GpsLocationExtended extended;
+    LocPositionMode mode;
+    unsigned char generate;
+
+    for (int i = 0; i < NMEA_GOLDEN_FIXES; i++) {
+        nmeaGoldenFill(i, sv, location, extended, &mode, &generate);
+        LocPosMode posMode(mode, GPS_POSITION_RECURRENCE_PERIODIC, 1000, 0,
+                           0, NULL, NULL);
+        locEng.adapter->setPositionMode(&posMode);
+        loc_eng_nmea_generate_sv(&locEng, sv, extended);
+        loc_eng_nmea_generate_pos(&locEng, location, extended, generate);
+    }
+}
+
+static bool nmeaGoldenRead(const char* path, std::vector<std::string>& lines)
+{
+    FILE* fp = fopen(path, "r");
+    if (NULL == fp) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    char line[NMEA_SENTENCE_MAX_LENGTH + 2];
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        lines.push_back(line);
+    }
+    fclose(fp);
+    return true;
+}
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char** argv)
+{
+    const char* goldenPath = argc > 1 ? argv[1] : "nmea_golden.txt";
+    int rounds = argc > 2 ? atoi(argv[2]) : NMEA_GOLDEN_ROUNDS;
+    loc_logger.DEBUG_LEVEL = 2;
+
+    loc_eng_data_s_type locEng;
+    memset(&locEng, 0, sizeof(locEng));
+    locEng.adapter = new LocEngAdapter((LOC_API_ADAPTER_EVENT_MASK_T)0,
+                                       &locEng, NULL);
+    // creating the context read /etc/gps.conf, which resets the level
+    loc_logger.DEBUG_LEVEL = 2;
+    locEng.nmea_cb = nmeaGoldenCb;
+
+    std::vector<std::string> golden, out;
+    bool ok = nmeaGoldenRead(goldenPath, golden);
+    nmeaGoldenOut = &out;
+    nmeaGoldenRun(locEng);
+    nmeaGoldenOut = NULL;
+
+    int mismatches = 0;
+    size_t lines = golden.size() > out.size() ? golden.size() : out.size();
+    for (size_t i = 0; ok && i < lines; i++) {
+        const char* want = i < golden.size() ? golden[i].c_str() : "(none)";
+        const char* got = i < out.size() ? out[i].c_str() : "(none)";
+        if (0 != strcmp(want, got)) {
+            if (mismatches++ < 10) {
+                fprintf(stderr, "line %u\n  want %s\n  got  %s\n",
+                        (unsigned)i + 1, want, got);
+            }
+        }
+    }
+    ok = ok && 0 == mismatches;
+
+    nmeaGoldenSentences = 0;
+    int64_t start = nowNs();
+    for (int r = 0; r < rounds; r++) {
+        nmeaGoldenRun(locEng);
+    }
+    int64_t elapsed = nowNs() - start;
+
+    printf("{\n");
+    printf("  \"golden_sentences\": %u,\n", (unsigned)golden.size());
+    printf("  \"sentences\": %u,\n", (unsigned)out.size());
+    printf("  \"mismatches\": %d,\n", mismatches);
+    printf("  \"sentences_per_s\": %.0f,\n",
+           elapsed > 0 ? nmeaGoldenSentences * 1e9 / elapsed : 0.0);
+    printf("  \"ok\": %s\n", ok ? "true" : "false");
+    printf("}\n");
+    fflush(stdout);
+    // the MsgTask threads are never stopped
+    _exit(ok ? 0 : 1);
+}
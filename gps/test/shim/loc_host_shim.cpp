@@ -0,0 +1,122 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation, nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* The pieces of libcutils, liblog and libutils that the gps libraries
+   call, for linking them into host tools and tests. */
+
+#include "loc_host_shim.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <cutils/log.h>
+#include <cutils/properties.h>
+#include <cutils/sched_policy.h>
+#include <utils/SystemClock.h>
+
+static char loc_host_prio_char(int prio)
+{
+    switch (prio) {
+    case ANDROID_LOG_VERBOSE: return 'V';
+    case ANDROID_LOG_DEBUG:   return 'D';
+    case ANDROID_LOG_INFO:    return 'I';
+    case ANDROID_LOG_WARN:    return 'W';
+    default:                  return 'E';
+    }
+}
+
+extern "C" int __android_log_write(int prio, const char* tag, const char* text)
+{
+    return fprintf(stderr, "%c/%s: %s\n", loc_host_prio_char(prio),
+                   tag ? tag : "", text);
+}
+
+extern "C" int __android_log_print(int prio, const char* tag, const char* fmt, ...)
+{
+    char buf[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    return __android_log_write(prio, tag, buf);
+}
+
+extern "C" int property_get(const char* key, char* value, const char* default_value)
+{
+    int len = 0;
+    (void)key;
+    if (NULL != default_value) {
+        len = strlen(default_value);
+        if (len >= PROPERTY_VALUE_MAX) {
+            len = PROPERTY_VALUE_MAX - 1;
+        }
+        memcpy(value, default_value, len);
+    }
+    value[len] = '\0';
+    return len;
+}
+
+extern "C" int set_sched_policy(int tid, SchedPolicy policy)
+{
+    (void)tid;
+    (void)policy;
+    return 0;
+}
+
+/* glibc has no strl* before 2.38; weak so a libc that has them wins */
+extern "C" __attribute__((weak)) size_t strlcpy(char* dst, const char* src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+extern "C" __attribute__((weak)) size_t strlcat(char* dst, const char* src, size_t size)
+{
+    size_t dlen = strnlen(dst, size);
+    if (dlen == size) {
+        return size + strlen(src);
+    }
+    return dlen + strlcpy(dst + dlen, src, size - dlen);
+}
+
+namespace android {
+
+int64_t elapsedRealtime()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+} // namespace android
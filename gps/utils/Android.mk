@@ -13,6 +13,7 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES += \
     loc_log.cpp \
+    loc_dlog.c \
     loc_cfg.cpp \
     msg_q.c \
     linked_list.c \
@@ -28,6 +29,12 @@ ifeq ($(TARGET_BUILD_VARIANT),user)
    LOCAL_CFLAGS += -DTARGET_BUILD_VARIANT_USER
 endif
 
+# highest LOC_LOGx level built in, 1 (E) to 5 (V), see log_util.h
+LOC_LOG_LEVEL := $(or $(TARGET_LOC_LOG_LEVEL_UTILS),$(TARGET_LOC_LOG_LEVEL))
+ifneq ($(LOC_LOG_LEVEL),)
+   LOCAL_CFLAGS += -DLOC_LOG_COMPILED_LEVEL=$(LOC_LOG_LEVEL)
+endif
+
 LOCAL_LDFLAGS += -Wl,--export-dynamic
 
 ## Includes
@@ -54,4 +61,38 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_PRELINK_MODULE := false
 
 include $(BUILD_SHARED_LIBRARY)
+
+# Static host build of the same sources, so that msg_q, loc_timer and
+# loc_cfg can be linked into the tools and tests under gps/test and run
+# on a Linux dev box. cutils, log and utils come from the stand-ins in
+# gps/test/shim rather than the host libcutils and liblog.
+ifeq ($(HOST_OS),linux)
+GPS_UTILS_SRC_FILES := $(LOCAL_SRC_FILES)
+GPS_UTILS_CFLAGS := $(LOCAL_CFLAGS)
+
+include $(CLEAR_VARS)
+
+LOCAL_STATIC_LIBRARIES := \
+    libloc_host_shim
+
+LOCAL_SRC_FILES := $(GPS_UTILS_SRC_FILES)
+
+LOCAL_CFLAGS := $(GPS_UTILS_CFLAGS) \
+    -include $(LOCAL_PATH)/../test/shim/loc_host_shim.h
+
+LOCAL_C_INCLUDES:= \
+    $(LOCAL_PATH)/../test/shim \
+    $(LOCAL_PATH)/platform_lib_abstractions \
+    hardware/libhardware/include
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/platform_lib_abstractions
+
+LOCAL_MODULE := libgps.utils_host
+
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+endif # HOST_OS linux
 endif # not BUILD_TINY_ANDROID
@@ -43,11 +43,96 @@ typedef struct list_element {
    void (*dealloc_func)(void*);
 }list_element;
 
+#define LIST_DEFAULT_SLAB_ELEMS 32
+
+typedef struct list_slab {
+   struct list_slab* next;
+   list_element elems[1];           /* slab_elems entries */
+}list_slab;
+
 typedef struct list_state {
    list_element* p_head;
    list_element* p_tail;
+   list_element* p_free;            /* Recycled elements, pooled lists only */
+   list_slab* p_slabs;              /* Slabs owned by a pooled list */
+   unsigned int slab_elems;         /* 0 if elements are malloc'ed one by one */
 } list_state;
 
+/*===========================================================================
+FUNCTION    list_element_alloc
+
+DESCRIPTION
+   Gets a list element, from the free list of a pooled list if possible.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The element; NULL if out of memory
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static list_element* list_element_alloc(list_state* p_list)
+{
+   if( p_list->slab_elems == 0 )
+   {
+      return (list_element*)malloc(sizeof(list_element));
+   }
+
+   if( p_list->p_free == NULL )
+   {
+      unsigned int i;
+      list_slab* slab = (list_slab*)malloc(sizeof(list_slab) +
+                                           (p_list->slab_elems - 1) * sizeof(list_element));
+      if( slab == NULL )
+      {
+         return NULL;
+      }
+      slab->next = p_list->p_slabs;
+      p_list->p_slabs = slab;
+      for( i = 0; i < p_list->slab_elems; i++ )
+      {
+         slab->elems[i].next = p_list->p_free;
+         p_list->p_free = &slab->elems[i];
+      }
+   }
+
+   list_element* elem = p_list->p_free;
+   p_list->p_free = elem->next;
+   return elem;
+}
+
+/*===========================================================================
+FUNCTION    list_element_free
+
+DESCRIPTION
+   Releases a list element, onto the free list of a pooled list.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void list_element_free(list_state* p_list, list_element* elem)
+{
+   if( p_list->slab_elems == 0 )
+   {
+      free(elem);
+   }
+   else
+   {
+      elem->next = p_list->p_free;
+      p_list->p_free = elem;
+   }
+}
+
 /* ----------------------- END INTERNAL FUNCTIONS ---------------------------------------- */
 
 /*===========================================================================
@@ -79,6 +164,24 @@ linked_list_err_type linked_list_init(void** list_data)
    return eLINKED_LIST_SUCCESS;
 }
 
+/*===========================================================================
+
+  FUNCTION:   linked_list_init_pooled
+
+  ===========================================================================*/
+linked_list_err_type linked_list_init_pooled(void** list_data, unsigned int slab_elems)
+{
+   linked_list_err_type rv = linked_list_init(list_data);
+
+   if( rv == eLINKED_LIST_SUCCESS )
+   {
+      ((list_state*)*list_data)->slab_elems =
+         (slab_elems != 0) ? slab_elems : LIST_DEFAULT_SLAB_ELEMS;
+   }
+
+   return rv;
+}
+
 /*===========================================================================
 
   FUNCTION:   linked_list_destroy
@@ -96,6 +199,13 @@ linked_list_err_type linked_list_destroy(void** list_data)
 
    linked_list_flush(p_list);
 
+   while( p_list->p_slabs != NULL )
+   {
+      list_slab* tmp = p_list->p_slabs->next;
+      free(p_list->p_slabs);
+      p_list->p_slabs = tmp;
+   }
+
    free(*list_data);
    *list_data = NULL;
 
@@ -123,7 +233,7 @@ linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dea
    }
 
    list_state* p_list = (list_state*)list_data;
-   list_element* elem = (list_element*)malloc(sizeof(list_element));
+   list_element* elem = list_element_alloc(p_list);
    if( elem == NULL )
    {
       LOC_LOGE("%s: Memory allocation failed\n", __FUNCTION__);
@@ -198,7 +308,7 @@ linked_list_err_type linked_list_remove(void* list_data, void **data_obj)
    *data_obj = tmp->data_ptr;
 
    /* Free allocated list element */
-   free(tmp);
+   list_element_free(p_list, tmp);
 
    return eLINKED_LIST_SUCCESS;
 }
@@ -249,7 +359,7 @@ linked_list_err_type linked_list_flush(void* list_data)
       }
 
       /* Free list element */
-      free(p_list->p_head);
+      list_element_free(p_list, p_list->p_head);
 
       p_list->p_head = tmp;
    }
@@ -314,7 +424,7 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
          if (NULL == data_p && NULL != tmp->dealloc_func) {
              tmp->dealloc_func(tmp->data_ptr);
          }
-         free(tmp);
+         list_element_free(p_list, tmp);
        }
 
        tmp = NULL;
@@ -326,3 +436,145 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
    return eLINKED_LIST_SUCCESS;
 }
 
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_init
+
+  ===========================================================================*/
+void linked_list_intr_init(linked_list_intr* list)
+{
+   list->next = list;
+   list->prev = list;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_add
+
+  ===========================================================================*/
+linked_list_err_type linked_list_intr_add(linked_list_intr* list, linked_list_node* node)
+{
+   if( list == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   if( node == NULL )
+   {
+      LOC_LOGE("%s: Invalid input parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_PARAMETER;
+   }
+
+   node->prev = list;
+   node->next = list->next;
+   list->next->prev = node;
+   list->next = node;
+
+   return eLINKED_LIST_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_remove
+
+  ===========================================================================*/
+linked_list_err_type linked_list_intr_remove(linked_list_intr* list, linked_list_node** node)
+{
+   if( list == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   if( node == NULL )
+   {
+      LOC_LOGE("%s: Invalid input parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_PARAMETER;
+   }
+
+   if( list->prev == list )
+   {
+      return eLINKED_LIST_UNAVAILABLE_RESOURCE;
+   }
+
+   *node = list->prev;
+   linked_list_intr_unlink(*node);
+
+   return eLINKED_LIST_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_unlink
+
+  ===========================================================================*/
+void linked_list_intr_unlink(linked_list_node* node)
+{
+   node->prev->next = node->next;
+   node->next->prev = node->prev;
+   node->next = node->prev = NULL;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_empty
+
+  ===========================================================================*/
+int linked_list_intr_empty(const linked_list_intr* list)
+{
+   return list->next == list ? 1 : 0;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_splice
+
+  ===========================================================================*/
+void linked_list_intr_splice(linked_list_intr* dst, linked_list_intr* src)
+{
+   if( src->next == src )
+   {
+      return;
+   }
+
+   src->next->prev = dst;
+   src->prev->next = dst->next;
+   dst->next->prev = src->prev;
+   dst->next = src->next;
+
+   linked_list_intr_init(src);
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_intr_search
+
+  ===========================================================================*/
+linked_list_node* linked_list_intr_search(linked_list_intr* list,
+                                          bool (*equal)(void* data_0, linked_list_node* node),
+                                          void* data_0, bool rm_if_found)
+{
+   linked_list_node* tmp;
+
+   if( list == NULL || NULL == equal )
+   {
+      LOC_LOGE("%s: Invalid list parameter! list %p equal %p\n",
+               __FUNCTION__, list, equal);
+      return NULL;
+   }
+
+   for( tmp = list->next; tmp != list; tmp = tmp->next )
+   {
+      if( (*equal)(data_0, tmp) )
+      {
+         if( rm_if_found )
+         {
+            linked_list_intr_unlink(tmp);
+         }
+         return tmp;
+      }
+   }
+
+   return NULL;
+}
@@ -34,6 +34,7 @@ extern "C" {
 
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stddef.h>
 
 /** Linked List Return Codes */
 typedef enum
@@ -52,6 +53,20 @@ typedef enum
      /**< Failed because an the supplied buffer was too small. */
 }linked_list_err_type;
 
+/** Link for intrusive lists; embed it in the object to be listed. */
+typedef struct linked_list_node
+{
+  struct linked_list_node* next;
+  struct linked_list_node* prev;
+}linked_list_node;
+
+/** Intrusive list head; next is the head element, prev the tail. */
+typedef linked_list_node linked_list_intr;
+
+/** Gets the object a linked_list_node is embedded in. */
+#define LINKED_LIST_ENTRY(node_ptr, type, member) \
+  ((type*)((char*)(node_ptr) - offsetof(type, member)))
+
 /*===========================================================================
 FUNCTION    linked_list_init
 
@@ -72,6 +87,31 @@ SIDE EFFECTS
 ===========================================================================*/
 linked_list_err_type linked_list_init(void** list_data);
 
+/*===========================================================================
+FUNCTION    linked_list_init_pooled
+
+DESCRIPTION
+   Initializes internal structures for linked list whose elements are
+   carved out of slabs and recycled through a free list. Once the list has
+   grown to its working size, add and remove do no heap operations. Slabs
+   are only released by linked_list_destroy.
+
+   list_data:  State of list to be initialized.
+   slab_elems: Number of list elements allocated at a time; 0 selects a
+               default.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_init_pooled(void** list_data, unsigned int slab_elems);
+
 /*===========================================================================
 FUNCTION    linked_list_destroy
 
@@ -210,6 +250,161 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
                                         bool (*equal)(void* data_0, void* data),
                                         void* data_0, bool rm_if_found);
 
+/*===========================================================================
+FUNCTION    linked_list_intr_init
+
+DESCRIPTION
+   Initializes an intrusive list to empty. Intrusive lists never allocate;
+   the caller owns both the list head and the nodes, and a node can be on
+   at most one list at a time.
+
+   list:  List to be initialized.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void linked_list_intr_init(linked_list_intr* list);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_add
+
+DESCRIPTION
+   Adds a node to the head of the intrusive list.
+
+   list:  List to add the node to the head of.
+   node:  Node embedded in the object being added.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_intr_add(linked_list_intr* list, linked_list_node* node);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_remove
+
+DESCRIPTION
+   Unlinks and returns the tail node of the intrusive list, i.e. the node
+   added the earliest by linked_list_intr_add.
+
+   list:  List to remove the tail from.
+   node:  Pointer to node removed from list
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_intr_remove(linked_list_intr* list, linked_list_node** node);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_unlink
+
+DESCRIPTION
+   Unlinks the given node from whatever intrusive list it is on, in O(1).
+
+   node:  Node to unlink.
+
+DEPENDENCIES
+   node must be on a list.
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void linked_list_intr_unlink(linked_list_node* node);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_empty
+
+DESCRIPTION
+   Tells whether the intrusive list currently contains any nodes
+
+   list:  List to check if empty.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0/FALSE : List contains nodes
+   1/TRUE  : List is Empty
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+int linked_list_intr_empty(const linked_list_intr* list);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_splice
+
+DESCRIPTION
+   Moves all nodes of src to the head of dst, keeping their order, and
+   leaves src empty. O(1).
+
+   dst:  List to receive the nodes.
+   src:  List to take the nodes from.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void linked_list_intr_splice(linked_list_intr* dst, linked_list_intr* src);
+
+/*===========================================================================
+FUNCTION    linked_list_intr_search
+
+DESCRIPTION
+   Searches for a node in the intrusive list, from head to tail, without
+   allocating.
+
+   list:         List to search.
+   equal:        Function ptr takes in a node, and returns
+                 indication if this the one looking for.
+   data_0:       The data being compared against.
+   rm_if_found:  Should the node be unlinked if found?
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The node found; NULL if no match.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_node* linked_list_intr_search(linked_list_intr* list,
+                                          bool (*equal)(void* data_0, linked_list_node* node),
+                                          void* data_0, bool rm_if_found);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -35,8 +35,11 @@
 #include <pthread.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <time.h>
+#include <sys/stat.h>
 #include <loc_cfg.h>
 #include <log_util.h>
 #ifdef USE_GLIB
@@ -51,16 +54,18 @@
  *============================================================================*/
 
 /* Parameter data */
-static uint8_t DEBUG_LEVEL = 0xff;
-static uint8_t TIMESTAMP = 0;
+static uint32_t DEBUG_LEVEL = 0xff;
+static uint32_t TIMESTAMP = 0;
+static uint32_t LOG_DEFERRED = 0;
 
 /* Parameter spec table */
 static loc_param_s_type loc_parameter_table[] =
 {
-  {"DEBUG_LEVEL",                    &DEBUG_LEVEL, NULL,                   'n'},
-  {"TIMESTAMP",                      &TIMESTAMP,   NULL,                   'n'},
+  {"DEBUG_LEVEL",                    &DEBUG_LEVEL, NULL,                   'n', 0, 0},
+  {"TIMESTAMP",                      &TIMESTAMP,   NULL,                   'n', 0, 1},
+  {"LOG_DEFERRED",                   &LOG_DEFERRED, NULL,                  'n', 0, 1},
 };
-int loc_param_num = sizeof(loc_parameter_table) / sizeof(loc_param_s_type);
+uint32_t loc_param_num = sizeof(loc_parameter_table) / sizeof(loc_param_s_type);
 
 /*===========================================================================
 FUNCTION trim_space
@@ -113,19 +118,68 @@ typedef struct loc_param_v_type
    char* param_str_value;
    int param_int_value;
    double param_double_value;
+   int param_num_valid;    /* which of the numbers above str_value parsed into */
+   int param_line;
 }loc_param_v_type;
 
+#define LOC_PARAM_INT_VALID     0x1
+#define LOC_PARAM_DOUBLE_VALID  0x2
+
+/* A configuration file parsed once and kept for later reads. Its values
+   are sorted by name, and a name given more than once keeps only its last
+   value, as if every line had been applied in turn. The file is parsed
+   again only when its inode, size or modification time changes. */
+typedef struct loc_cfg_file_s
+{
+   struct loc_cfg_file_s* next;
+   char* file_name;
+   dev_t dev;
+   ino_t ino;
+   off_t size;
+   time_t mtime;
+   loc_param_v_type* values;
+   uint32_t num_values;
+} loc_cfg_file_s_type;
+
+static loc_cfg_file_s_type* loc_cfg_files = NULL;
+static pthread_mutex_t loc_cfg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*===========================================================================
+FUNCTION loc_param_in_range
+
+DESCRIPTION
+   Checks a number against the range of a configuration table entry
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if the entry has no range or the value is inside it, 0 otherwise
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_param_in_range(const loc_param_s_type* config_entry, double value)
+{
+   if (config_entry->param_min == 0 && config_entry->param_max == 0)
+   {
+      return 1;
+   }
+   return value >= config_entry->param_min && value <= config_entry->param_max;
+}
+
 /*===========================================================================
 FUNCTION loc_set_config_entry
 
 DESCRIPTION
-   Potentially sets a given configuration table entry based on the passed in
-   configuration value. This is done by using a string comparison of the
-   parameter names and those found in the configuration file.
+   Sets a given configuration table entry from the value found for its
+   name in the configuration file. Numbers that do not parse as the
+   entry's type, or fall outside its range, are rejected and the entry
+   keeps its current value.
 
 PARAMETERS:
-   config_entry: configuration entry in the table to possibly set
-   config_value: value to store in the entry if the parameter names match
+   config_entry: configuration entry in the table to set
+   config_value: value parsed from the configuration file for the entry
 
 DEPENDENCIES
    N/A
@@ -144,51 +198,356 @@ void loc_set_config_entry(loc_param_s_type* config_entry, loc_param_v_type* conf
       return;
    }
 
-   if (strcmp(config_entry->param_name, config_value->param_name) == 0 &&
-               config_entry->param_ptr)
+   if (NULL == config_entry->param_ptr)
+   {
+      return;
+   }
+
+   switch (config_entry->param_type)
    {
-      switch (config_entry->param_type)
+   case 's':
+      if (strcmp(config_value->param_str_value, "NULL") == 0)
       {
-      case 's':
-         if (strcmp(config_value->param_str_value, "NULL") == 0)
+         *((char*)config_entry->param_ptr) = '\0';
+      }
+      else {
+         if (strlen(config_value->param_str_value) > LOC_MAX_PARAM_STRING)
          {
-            *((char*)config_entry->param_ptr) = '\0';
-         }
-         else {
-            strlcpy((char*) config_entry->param_ptr,
-                  config_value->param_str_value,
-                  LOC_MAX_PARAM_STRING + 1);
+            LOC_LOGW("%s: PARAM %s truncated to %d characters", __FUNCTION__,
+                     config_entry->param_name, LOC_MAX_PARAM_STRING);
          }
-         /* Log INI values */
-         LOC_LOGD("%s: PARAM %s = %s", __FUNCTION__, config_entry->param_name, (char*)config_entry->param_ptr);
+         strlcpy((char*) config_entry->param_ptr,
+               config_value->param_str_value,
+               LOC_MAX_PARAM_STRING + 1);
+      }
+      /* Log INI values */
+      LOC_LOGD("%s: PARAM %s = %s", __FUNCTION__, config_entry->param_name, (char*)config_entry->param_ptr);
 
-         if(NULL != config_entry->param_set)
-         {
-            *(config_entry->param_set) = 1;
-         }
+      if(NULL != config_entry->param_set)
+      {
+         *(config_entry->param_set) = 1;
+      }
+      break;
+   case 'n':
+      if (!(config_value->param_num_valid & LOC_PARAM_INT_VALID))
+      {
+         LOC_LOGE("%s: PARAM %s = %s is not an integer, ignored", __FUNCTION__,
+                  config_entry->param_name, config_value->param_str_value);
+         break;
+      }
+      if (!loc_param_in_range(config_entry, config_value->param_int_value))
+      {
+         LOC_LOGE("%s: PARAM %s = %d is outside [%g, %g], ignored", __FUNCTION__,
+                  config_entry->param_name, config_value->param_int_value,
+                  config_entry->param_min, config_entry->param_max);
          break;
-      case 'n':
-         *((int *)config_entry->param_ptr) = config_value->param_int_value;
-         /* Log INI values */
-         LOC_LOGD("%s: PARAM %s = %d", __FUNCTION__, config_entry->param_name, config_value->param_int_value);
+      }
+      *((int *)config_entry->param_ptr) = config_value->param_int_value;
+      /* Log INI values */
+      LOC_LOGD("%s: PARAM %s = %d", __FUNCTION__, config_entry->param_name, config_value->param_int_value);
 
-         if(NULL != config_entry->param_set)
-         {
-            *(config_entry->param_set) = 1;
-         }
+      if(NULL != config_entry->param_set)
+      {
+         *(config_entry->param_set) = 1;
+      }
+      break;
+   case 'f':
+      if (!(config_value->param_num_valid & LOC_PARAM_DOUBLE_VALID))
+      {
+         LOC_LOGE("%s: PARAM %s = %s is not a number, ignored", __FUNCTION__,
+                  config_entry->param_name, config_value->param_str_value);
          break;
-      case 'f':
-         *((double *)config_entry->param_ptr) = config_value->param_double_value;
-         /* Log INI values */
-         LOC_LOGD("%s: PARAM %s = %f", __FUNCTION__, config_entry->param_name, config_value->param_double_value);
+      }
+      if (!loc_param_in_range(config_entry, config_value->param_double_value))
+      {
+         LOC_LOGE("%s: PARAM %s = %f is outside [%g, %g], ignored", __FUNCTION__,
+                  config_entry->param_name, config_value->param_double_value,
+                  config_entry->param_min, config_entry->param_max);
+         break;
+      }
+      *((double *)config_entry->param_ptr) = config_value->param_double_value;
+      /* Log INI values */
+      LOC_LOGD("%s: PARAM %s = %f", __FUNCTION__, config_entry->param_name, config_value->param_double_value);
+
+      if(NULL != config_entry->param_set)
+      {
+         *(config_entry->param_set) = 1;
+      }
+      break;
+   default:
+      LOC_LOGE("%s: PARAM %s parameter type must be n, f, or s", __FUNCTION__, config_entry->param_name);
+   }
+}
+
+/*===========================================================================
+FUNCTION loc_parse_config_value
+
+DESCRIPTION
+   Parses the numbers a configuration value can be read as. Hex values
+   (0x...) are integers only; other values are an integer and/or a float
+   when the whole string parses as one.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_parse_config_value(loc_param_v_type* config_value)
+{
+   const char* str = config_value->param_str_value;
+   char* end;
+
+   config_value->param_num_valid = 0;
+
+   if (str[0] == '0' && tolower(str[1]) == 'x')
+   {
+      /* hex, kept as a bit pattern */
+      errno = 0;
+      unsigned long hex = strtoul(&str[2], &end, 16);
+      if (end != &str[2] && *end == '\0' && errno == 0 && hex <= UINT_MAX)
+      {
+         config_value->param_int_value = (int) hex;
+         config_value->param_num_valid |= LOC_PARAM_INT_VALID;
+      }
+      return;
+   }
+
+   /* dec */
+   errno = 0;
+   long dec = strtol(str, &end, 10);
+   if (end != str && *end == '\0' && errno == 0 && dec >= INT_MIN && dec <= INT_MAX)
+   {
+      config_value->param_int_value = (int) dec;
+      config_value->param_num_valid |= LOC_PARAM_INT_VALID;
+   }
+
+   /* float */
+   errno = 0;
+   double flt = strtod(str, &end);
+   if (end != str && *end == '\0' && errno == 0)
+   {
+      config_value->param_double_value = flt;
+      config_value->param_num_valid |= LOC_PARAM_DOUBLE_VALID;
+   }
+}
+
+static int loc_cfg_value_cmp(const void* a, const void* b)
+{
+   const loc_param_v_type* va = (const loc_param_v_type*) a;
+   const loc_param_v_type* vb = (const loc_param_v_type*) b;
+   int cmp = strcmp(va->param_name, vb->param_name);
+   return cmp ? cmp : va->param_line - vb->param_line;
+}
+
+static int loc_cfg_key_cmp(const void* key, const void* value)
+{
+   return strcmp((const char*) key, ((const loc_param_v_type*) value)->param_name);
+}
+
+static void loc_cfg_free_values(loc_cfg_file_s_type* file)
+{
+   for (uint32_t i = 0; i < file->num_values; i++)
+   {
+      /* name and value share one allocation */
+      free(file->values[i].param_name);
+   }
+   free(file->values);
+   file->values = NULL;
+   file->num_values = 0;
+}
+
+/*===========================================================================
+FUNCTION loc_cfg_parse
+
+DESCRIPTION
+   Reads every name = value line of a configuration file into the file's
+   sorted value table, replacing what it held before.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_cfg_parse(loc_cfg_file_s_type* file, FILE* conf_fp)
+{
+   char input_buf[LOC_MAX_PARAM_LINE];  /* declare a char array */
+   char *lasts, *name, *value;
+   loc_param_v_type* values = NULL;
+   uint32_t num_values = 0, max_values = 0, i, j;
+
+   loc_cfg_free_values(file);
+
+   while(fgets(input_buf, LOC_MAX_PARAM_LINE, conf_fp) != NULL)
+   {
+      /* Separate variable and value */
+      name = strtok_r(input_buf, "=", &lasts);
+      if (name == NULL) continue;       /* skip lines that do not contain "=" */
+      value = strtok_r(NULL, "=", &lasts);
+      if (value == NULL) continue;      /* skip lines that do not contain two operands */
+
+      /* Trim leading and trailing spaces */
+      trim_space(name);
+      trim_space(value);
 
-         if(NULL != config_entry->param_set)
+      if (num_values == max_values)
+      {
+         uint32_t grow = max_values ? max_values * 2 : 32;
+         loc_param_v_type* more =
+            (loc_param_v_type*) realloc(values, grow * sizeof(loc_param_v_type));
+         if (NULL == more)
          {
-            *(config_entry->param_set) = 1;
+            LOC_LOGE("%s: out of memory after %u values", __FUNCTION__, num_values);
+            break;
          }
+         values = more;
+         max_values = grow;
+      }
+
+      size_t name_len = strlen(name);
+      char* text = (char*) malloc(name_len + strlen(value) + 2);
+      if (NULL == text)
+      {
+         LOC_LOGE("%s: out of memory after %u values", __FUNCTION__, num_values);
          break;
-      default:
-         LOC_LOGE("%s: PARAM %s parameter type must be n, f, or s", __FUNCTION__, config_entry->param_name);
+      }
+
+      loc_param_v_type* config_value = &values[num_values];
+      memset(config_value, 0, sizeof(*config_value));
+      config_value->param_name = text;
+      config_value->param_str_value = text + name_len + 1;
+      strcpy(config_value->param_name, name);
+      strcpy(config_value->param_str_value, value);
+      config_value->param_line = num_values++;
+      loc_parse_config_value(config_value);
+   }
+
+   /* sort by name, then line; keep only the last line of each name */
+   qsort(values, num_values, sizeof(loc_param_v_type), loc_cfg_value_cmp);
+   for (i = 0, j = 0; i < num_values; i++)
+   {
+      if (i + 1 < num_values &&
+          strcmp(values[i].param_name, values[i + 1].param_name) == 0)
+      {
+         free(values[i].param_name);
+      }
+      else
+      {
+         values[j++] = values[i];
+      }
+   }
+
+   file->values = values;
+   file->num_values = j;
+}
+
+/*===========================================================================
+FUNCTION loc_cfg_get_file
+
+DESCRIPTION
+   Finds the parsed contents of a configuration file, parsing it when it
+   was not seen before or has changed since. Called with loc_cfg_lock held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   the parsed file, NULL if it cannot be opened
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static loc_cfg_file_s_type* loc_cfg_get_file(const char* conf_file_name)
+{
+   loc_cfg_file_s_type* file;
+   struct stat st;
+   FILE* conf_fp;
+
+   for (file = loc_cfg_files; NULL != file; file = file->next)
+   {
+      if (strcmp(file->file_name, conf_file_name) == 0)
+      {
+         break;
+      }
+   }
+
+   if (NULL != file && stat(conf_file_name, &st) == 0 &&
+       st.st_dev == file->dev && st.st_ino == file->ino &&
+       st.st_size == file->size && st.st_mtime == file->mtime)
+   {
+      LOC_LOGV("%s: %s unchanged, %u values cached", __FUNCTION__,
+               conf_file_name, file->num_values);
+      return file;
+   }
+
+   if ((conf_fp = fopen(conf_file_name, "r")) == NULL)
+   {
+      return NULL;
+   }
+
+   if (NULL == file)
+   {
+      file = (loc_cfg_file_s_type*) calloc(1, sizeof(loc_cfg_file_s_type));
+      if (NULL == file || NULL == (file->file_name = strdup(conf_file_name)))
+      {
+         LOC_LOGE("%s: out of memory", __FUNCTION__);
+         free(file);
+         fclose(conf_fp);
+         return NULL;
+      }
+      file->next = loc_cfg_files;
+      loc_cfg_files = file;
+   }
+
+   if (fstat(fileno(conf_fp), &st) == 0)
+   {
+      file->dev = st.st_dev;
+      file->ino = st.st_ino;
+      file->size = st.st_size;
+      file->mtime = st.st_mtime;
+   }
+   loc_cfg_parse(file, conf_fp);
+   fclose(conf_fp);
+
+   return file;
+}
+
+/*===========================================================================
+FUNCTION loc_cfg_apply
+
+DESCRIPTION
+   Sets every entry of a configuration table that the parsed file has a
+   value for.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_cfg_apply(loc_cfg_file_s_type* file,
+                          loc_param_s_type* config_table, uint32_t table_length)
+{
+   uint32_t i;
+
+   for(i = 0; NULL != config_table && i < table_length; i++)
+   {
+      loc_param_v_type* config_value = (loc_param_v_type*)
+         bsearch(config_table[i].param_name, file->values, file->num_values,
+                 sizeof(loc_param_v_type), loc_cfg_key_cmp);
+      if (NULL != config_value)
+      {
+         loc_set_config_entry(&config_table[i], config_value);
       }
    }
 }
@@ -199,7 +558,9 @@ FUNCTION loc_read_conf
 DESCRIPTION
    Reads the specified configuration file and sets defined values based on
    the passed in configuration table. This table maps strings to values to
-   set along with the type of each of these values.
+   set along with the type of each of these values. The file is parsed
+   once and cached; later reads of an unchanged file only look the table
+   up in the cached values.
 
 PARAMETERS:
    conf_file_name: configuration file to read
@@ -217,20 +578,21 @@ SIDE EFFECTS
 ===========================================================================*/
 void loc_read_conf(const char* conf_file_name, loc_param_s_type* config_table, uint32_t table_length)
 {
-   FILE *gps_conf_fp = NULL;
-   char input_buf[LOC_MAX_PARAM_LINE];  /* declare a char array */
-   char *lasts;
-   loc_param_v_type config_value;
+   loc_cfg_file_s_type* file;
    uint32_t i;
 
-   if((gps_conf_fp = fopen(conf_file_name, "r")) != NULL)
+   pthread_mutex_lock(&loc_cfg_lock);
+
+   if((file = loc_cfg_get_file(conf_file_name)) != NULL)
    {
       LOC_LOGD("%s: using %s", __FUNCTION__, conf_file_name);
    }
    else
    {
+      pthread_mutex_unlock(&loc_cfg_lock);
       LOC_LOGW("%s: no %s file found", __FUNCTION__, conf_file_name);
       loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+      loc_dlog_enable(LOG_DEFERRED);
       return; /* no parameter file */
    }
 
@@ -243,44 +605,49 @@ void loc_read_conf(const char* conf_file_name, loc_param_s_type* config_table, u
       }
    }
 
-   while(fgets(input_buf, LOC_MAX_PARAM_LINE, gps_conf_fp) != NULL)
-   {
-      memset(&config_value, 0, sizeof(config_value));
+   loc_cfg_apply(file, config_table, table_length);
+   loc_cfg_apply(file, loc_parameter_table, loc_param_num);
 
-      /* Separate variable and value */
-      config_value.param_name = strtok_r(input_buf, "=", &lasts);
-      if (config_value.param_name == NULL) continue;       /* skip lines that do not contain "=" */
-      config_value.param_str_value = strtok_r(NULL, "=", &lasts);
-      if (config_value.param_str_value == NULL) continue;  /* skip lines that do not contain two operands */
+   pthread_mutex_unlock(&loc_cfg_lock);
 
-      /* Trim leading and trailing spaces */
-      trim_space(config_value.param_name);
-      trim_space(config_value.param_str_value);
+   /* Initialize logging mechanism with parsed data */
+   loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+   loc_dlog_enable(LOG_DEFERRED);
+}
 
-      /* Parse numerical value */
-      if (config_value.param_str_value[0] == '0' && tolower(config_value.param_str_value[1]) == 'x')
-      {
-         /* hex */
-         config_value.param_int_value = (int) strtol(&config_value.param_str_value[2], (char**) NULL, 16);
-      }
-      else {
-         config_value.param_double_value = (double) atof(config_value.param_str_value); /* float */
-         config_value.param_int_value = atoi(config_value.param_str_value); /* dec */
-      }
+/*===========================================================================
+FUNCTION loc_flush_conf
 
-      for(i = 0; NULL != config_table && i < table_length; i++)
-      {
-         loc_set_config_entry(&config_table[i], &config_value);
-      }
+DESCRIPTION
+   Drops the cached contents of a configuration file, so that the next
+   loc_read_conf() of it parses the file again even when its size and
+   modification time look unchanged.
+
+PARAMETERS:
+   conf_file_name: configuration file to forget
 
-      for(i = 0; i < loc_param_num; i++)
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+void loc_flush_conf(const char* conf_file_name)
+{
+   loc_cfg_file_s_type* file;
+
+   pthread_mutex_lock(&loc_cfg_lock);
+   for (file = loc_cfg_files; NULL != file; file = file->next)
+   {
+      if (strcmp(file->file_name, conf_file_name) == 0)
       {
-         loc_set_config_entry(&loc_parameter_table[i], &config_value);
+         /* no file has a negative size, the next read parses again */
+         file->size = -1;
+         break;
       }
    }
-
-   fclose(gps_conf_fp);
-
-   /* Initialize logging mechanism with parsed data */
-   loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+   pthread_mutex_unlock(&loc_cfg_lock);
 }
@@ -55,6 +55,9 @@ typedef struct
   char                           param_type;  /* 'n' for number,
                                                  's' for string,
                                                  'f' for float */
+  double                         param_min;   /* 'n' and 'f' values outside */
+  double                         param_max;   /* [min, max] are rejected,
+                                                 0, 0 for no range */
 } loc_param_s_type;
 
 /*=============================================================================
@@ -75,6 +78,7 @@ extern "C" {
 extern void loc_read_conf(const char* conf_file_name,
                           loc_param_s_type* config_table,
                           uint32_t table_length);
+extern void loc_flush_conf(const char* conf_file_name);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,681 @@
+/* Copyright (c) 2011, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Deferred logging
+
+   With LOG_DEFERRED set, LOC_LOGx call sites do not format. They copy
+   the format string pointer, a timestamp and the raw arguments (strings
+   by value) into a ring owned by the calling thread. One flush thread
+   drains all rings every LOC_DLOG_FLUSH_MSEC, formats the records and
+   hands them to the Android log. A full ring drops new records and counts
+   them; the caller never waits. */
+
+#define LOG_TAG "LocSvc_utils_dlog"
+#include "log_util.h"
+#include "platform_lib_includes.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define LOC_DLOG_RING_SIZE   (16 * 1024)   /* bytes per thread, power of 2 */
+#define LOC_DLOG_MAX_RECORD  1024
+#define LOC_DLOG_MAX_STR     128
+#define LOC_DLOG_MAX_LINE    1024
+#define LOC_DLOG_FLUSH_MSEC  20
+#define LOC_DLOG_PAD         0x8000        /* size flag: skip to ring start */
+
+#define LOC_DLOG_ALIGN(n)    (((n) + 7) & ~7)
+
+/* argument classes, as taken off the va_list */
+typedef enum
+{
+   LOC_DLOG_ARG_NONE = 0,
+   LOC_DLOG_ARG_INT,       /* int64_t slot */
+   LOC_DLOG_ARG_UINT,      /* int64_t slot */
+   LOC_DLOG_ARG_CHAR,      /* int64_t slot */
+   LOC_DLOG_ARG_DOUBLE,    /* double slot */
+   LOC_DLOG_ARG_PTR,       /* int64_t slot */
+   LOC_DLOG_ARG_STR,       /* length slot, then the bytes */
+   LOC_DLOG_ARG_SKIP,      /* %n: taken, not stored */
+   LOC_DLOG_ARG_BAD        /* unknown conversion */
+} loc_dlog_arg_type;
+
+/* one conversion specification */
+typedef struct
+{
+   const char* start;      /* the '%' */
+   const char* flags;      /* first flag character */
+   int flags_len;
+   const char* width;      /* digits, or NULL if none or '*' */
+   int width_len;
+   int width_star;
+   const char* prec;       /* digits after '.', or NULL */
+   int prec_len;
+   int prec_star;
+   int has_prec;
+   char length[3];         /* "", "h", "hh", "l", "ll", "L", "j", "z", "t" */
+   char conv;
+   const char* end;        /* one past the conversion character */
+   loc_dlog_arg_type type;
+} loc_dlog_spec;
+
+typedef struct
+{
+   uint16_t size;          /* of the whole record, LOC_DLOG_PAD for a pad */
+   uint8_t  prio;
+   uint8_t  nargs;         /* conversions captured */
+   uint32_t reserved;
+   const char* tag;
+   const char* fmt;
+   int64_t  time_usec;
+} loc_dlog_header;
+
+typedef struct loc_dlog_ring
+{
+   struct loc_dlog_ring* next;
+   pid_t tid;
+   volatile int dead;             /* owner thread is gone */
+   volatile uint32_t head;        /* written by the owner thread */
+   volatile uint32_t tail;        /* written by the flush thread */
+   volatile uint32_t dropped;     /* written by the owner thread */
+   uint32_t dropped_reported;     /* flush thread only */
+   uint8_t buf[LOC_DLOG_RING_SIZE];
+} loc_dlog_ring;
+
+static pthread_once_t loc_dlog_once = PTHREAD_ONCE_INIT;
+static pthread_key_t loc_dlog_key;
+static pthread_mutex_t loc_dlog_mutex = PTHREAD_MUTEX_INITIALIZER;
+static loc_dlog_ring* loc_dlog_rings = NULL;
+static int loc_dlog_running = 0;
+
+/*===========================================================================
+FUNCTION    loc_dlog_parse
+
+DESCRIPTION
+   Parses the conversion specification at p, which points at a '%'.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   the argument class of the conversion
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static loc_dlog_arg_type loc_dlog_parse(const char* p, loc_dlog_spec* spec)
+{
+   memset(spec, 0, sizeof(*spec));
+   spec->start = p++;
+
+   spec->flags = p;
+   while( *p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' ) p++;
+   spec->flags_len = p - spec->flags;
+
+   if( *p == '*' ) {
+      spec->width_star = 1;
+      p++;
+   } else {
+      spec->width = p;
+      while( *p >= '0' && *p <= '9' ) p++;
+      spec->width_len = p - spec->width;
+   }
+
+   if( *p == '.' ) {
+      spec->has_prec = 1;
+      p++;
+      if( *p == '*' ) {
+         spec->prec_star = 1;
+         p++;
+      } else {
+         spec->prec = p;
+         while( *p >= '0' && *p <= '9' ) p++;
+         spec->prec_len = p - spec->prec;
+      }
+   }
+
+   if( (p[0] == 'h' && p[1] == 'h') || (p[0] == 'l' && p[1] == 'l') ) {
+      spec->length[0] = *p++;
+      spec->length[1] = *p++;
+   } else if( *p == 'h' || *p == 'l' || *p == 'L' || *p == 'j' ||
+              *p == 'z' || *p == 't' ) {
+      spec->length[0] = *p++;
+   } else if( *p == 'q' ) {
+      spec->length[0] = spec->length[1] = 'l';
+      p++;
+   }
+
+   spec->conv = *p;
+   spec->end = (*p != '\0') ? p + 1 : p;
+
+   switch( spec->conv )
+   {
+   case 'd': case 'i':
+      spec->type = LOC_DLOG_ARG_INT; break;
+   case 'u': case 'o': case 'x': case 'X':
+      spec->type = LOC_DLOG_ARG_UINT; break;
+   case 'c':
+      spec->type = LOC_DLOG_ARG_CHAR; break;
+   case 'e': case 'E': case 'f': case 'F':
+   case 'g': case 'G': case 'a': case 'A':
+      spec->type = LOC_DLOG_ARG_DOUBLE; break;
+   case 'p':
+      spec->type = LOC_DLOG_ARG_PTR; break;
+   case 's':
+      spec->type = LOC_DLOG_ARG_STR; break;
+   case 'n':
+      spec->type = LOC_DLOG_ARG_SKIP; break;
+   case '%':
+      spec->type = LOC_DLOG_ARG_NONE; break;
+   default:
+      spec->type = LOC_DLOG_ARG_BAD; break;
+   }
+   return spec->type;
+}
+
+/* takes an integer off the va_list, as printf would read it */
+static int64_t loc_dlog_va_int(const loc_dlog_spec* spec, va_list* ap)
+{
+   int sign = (spec->type == LOC_DLOG_ARG_INT);
+   switch( spec->length[0] )
+   {
+   case 'h':
+      if( spec->length[1] == 'h' ) {
+         int v = va_arg(*ap, int);
+         return sign ? (int64_t)(signed char)v : (int64_t)(unsigned char)v;
+      } else {
+         int v = va_arg(*ap, int);
+         return sign ? (int64_t)(short)v : (int64_t)(unsigned short)v;
+      }
+   case 'l':
+      if( spec->length[1] == 'l' ) {
+         return (int64_t)va_arg(*ap, long long);
+      } else {
+         long v = va_arg(*ap, long);
+         return sign ? (int64_t)v : (int64_t)(unsigned long)v;
+      }
+   case 'j':
+      return (int64_t)va_arg(*ap, intmax_t);
+   case 'z':
+      {
+         size_t v = va_arg(*ap, size_t);
+         return sign ? (int64_t)(ssize_t)v : (int64_t)v;
+      }
+   case 't':
+      return (int64_t)va_arg(*ap, ptrdiff_t);
+   default:
+      {
+         int v = va_arg(*ap, int);
+         return sign ? (int64_t)v : (int64_t)(unsigned int)v;
+      }
+   }
+}
+
+/*===========================================================================
+FUNCTION    loc_dlog_pack
+
+DESCRIPTION
+   Copies the arguments fmt refers to off ap into out. Every value takes
+   an 8 byte slot; a string takes a length slot followed by its bytes
+   padded to 8, cut at LOC_DLOG_MAX_STR or its precision.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   bytes used in out; *nargs is set to the number of conversions taken
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_dlog_pack(const char* fmt, va_list ap, uint8_t* out, int size, int* nargs)
+{
+   loc_dlog_spec spec;
+   va_list args;
+   int used = 0;
+   const char* p = fmt;
+
+   va_copy(args, ap);
+   *nargs = 0;
+   while( (p = strchr(p, '%')) != NULL && *nargs < 255 )
+   {
+      loc_dlog_arg_type type = loc_dlog_parse(p, &spec);
+      if( type == LOC_DLOG_ARG_BAD ) break;
+      p = spec.end;
+      if( type == LOC_DLOG_ARG_NONE ) continue;
+
+      /* star width and precision come first, worst case needs 3 slots
+         plus a string */
+      if( used + 3 * 8 + LOC_DLOG_ALIGN(LOC_DLOG_MAX_STR + 1) > size ) break;
+      if( spec.width_star ) {
+         *(int64_t*)(out + used) = va_arg(args, int);
+         used += 8;
+      }
+      if( spec.prec_star ) {
+         *(int64_t*)(out + used) = va_arg(args, int);
+         used += 8;
+      }
+
+      switch( type )
+      {
+      case LOC_DLOG_ARG_INT:
+      case LOC_DLOG_ARG_UINT:
+         *(int64_t*)(out + used) = loc_dlog_va_int(&spec, &args);
+         break;
+      case LOC_DLOG_ARG_CHAR:
+         *(int64_t*)(out + used) = va_arg(args, int);
+         break;
+      case LOC_DLOG_ARG_DOUBLE:
+         if( spec.length[0] == 'L' )
+            *(double*)(out + used) = (double)va_arg(args, long double);
+         else
+            *(double*)(out + used) = va_arg(args, double);
+         break;
+      case LOC_DLOG_ARG_PTR:
+         *(int64_t*)(out + used) = (int64_t)(uintptr_t)va_arg(args, void*);
+         break;
+      case LOC_DLOG_ARG_SKIP:
+         (void)va_arg(args, void*);
+         used -= 8;
+         break;
+      case LOC_DLOG_ARG_STR:
+         {
+            const char* s = va_arg(args, const char*);
+            int max = LOC_DLOG_MAX_STR;
+            int len = 0;
+            if( s == NULL ) s = "(null)";
+            if( spec.has_prec && !spec.prec_star ) {
+               int prec = spec.prec_len > 0 ? atoi(spec.prec) : 0;
+               if( prec < max ) max = prec;
+            }
+            while( len < max && s[len] != '\0' ) len++;
+            *(int64_t*)(out + used) = len;
+            memcpy(out + used + 8, s, len);
+            out[used + 8 + len] = '\0';
+            used += LOC_DLOG_ALIGN(len + 1);
+         }
+         break;
+      default:
+         break;
+      }
+      used += 8;
+      (*nargs)++;
+   }
+   va_end(args);
+   return used;
+}
+
+/*===========================================================================
+FUNCTION    loc_dlog_format
+
+DESCRIPTION
+   Formats a record back into text, one conversion at a time. Integers
+   are printed through "ll" so that they read back from their slots.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_dlog_format(const loc_dlog_header* hdr, char* line, int size)
+{
+   const uint8_t* arg = (const uint8_t*)(hdr + 1);
+   const char* p = hdr->fmt;
+   loc_dlog_spec spec;
+   char cspec[48];
+   int n = 0;
+   int i = 0;
+
+   while( *p != '\0' && n < size - 1 )
+   {
+      const char* pct = strchr(p, '%');
+      int lit = pct ? pct - p : (int)strlen(p);
+      if( lit > size - 1 - n ) lit = size - 1 - n;
+      memcpy(line + n, p, lit);
+      n += lit;
+      if( pct == NULL || n >= size - 1 ) break;
+
+      loc_dlog_arg_type type = loc_dlog_parse(pct, &spec);
+      if( type == LOC_DLOG_ARG_NONE ) {
+         line[n++] = '%';
+         p = spec.end;
+         continue;
+      }
+      if( type == LOC_DLOG_ARG_BAD || i >= hdr->nargs ) {
+         /* print the rest as it is */
+         p = pct;
+         lit = strlen(p);
+         if( lit > size - 1 - n ) lit = size - 1 - n;
+         memcpy(line + n, p, lit);
+         n += lit;
+         break;
+      }
+      p = spec.end;
+      i++;
+
+      int c = 0;
+      cspec[c++] = '%';
+      memcpy(cspec + c, spec.flags, spec.flags_len);
+      c += spec.flags_len;
+      if( spec.width_star ) {
+         c += snprintf(cspec + c, sizeof(cspec) - c, "%d", (int)*(const int64_t*)arg);
+         arg += 8;
+      } else if( spec.width_len > 0 && spec.width_len < 8 ) {
+         memcpy(cspec + c, spec.width, spec.width_len);
+         c += spec.width_len;
+      }
+      if( spec.has_prec ) {
+         cspec[c++] = '.';
+         if( spec.prec_star ) {
+            c += snprintf(cspec + c, sizeof(cspec) - c, "%d", (int)*(const int64_t*)arg);
+            arg += 8;
+         } else if( spec.prec_len > 0 && spec.prec_len < 8 ) {
+            memcpy(cspec + c, spec.prec, spec.prec_len);
+            c += spec.prec_len;
+         }
+      }
+      if( type == LOC_DLOG_ARG_INT || type == LOC_DLOG_ARG_UINT ) {
+         cspec[c++] = 'l';
+         cspec[c++] = 'l';
+      }
+      cspec[c++] = spec.conv;
+      cspec[c] = '\0';
+
+      int w = 0;
+      switch( type )
+      {
+      case LOC_DLOG_ARG_INT:
+      case LOC_DLOG_ARG_UINT:
+         w = snprintf(line + n, size - n, cspec, (long long)*(const int64_t*)arg);
+         arg += 8;
+         break;
+      case LOC_DLOG_ARG_CHAR:
+         w = snprintf(line + n, size - n, cspec, (int)*(const int64_t*)arg);
+         arg += 8;
+         break;
+      case LOC_DLOG_ARG_DOUBLE:
+         w = snprintf(line + n, size - n, cspec, *(const double*)arg);
+         arg += 8;
+         break;
+      case LOC_DLOG_ARG_PTR:
+         w = snprintf(line + n, size - n, cspec, (void*)(uintptr_t)*(const int64_t*)arg);
+         arg += 8;
+         break;
+      case LOC_DLOG_ARG_STR:
+         w = snprintf(line + n, size - n, cspec, (const char*)(arg + 8));
+         arg += 8 + LOC_DLOG_ALIGN(*(const int64_t*)arg + 1);
+         break;
+      default:
+         break;
+      }
+      if( w > 0 ) n += w;
+      if( n > size - 1 ) n = size - 1;
+   }
+   line[n] = '\0';
+}
+
+static void loc_dlog_emit(int prio, const char* tag, const char* line)
+{
+#ifndef USE_GLIB
+   __android_log_write(prio, tag ? tag : "LocSvc", line);
+#else
+   printf("%d/%s (%d): %s\n", prio, tag ? tag : "LocSvc", getpid(), line);
+#endif
+}
+
+/*===========================================================================
+FUNCTION    loc_dlog_drain
+
+DESCRIPTION
+   Formats and emits everything in one ring.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_dlog_drain(loc_dlog_ring* ring)
+{
+   char line[LOC_DLOG_MAX_LINE];
+   char ts[32];
+   uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+   uint32_t tail = ring->tail;
+   uint32_t dropped = ring->dropped;
+
+   while( tail != head )
+   {
+      const loc_dlog_header* hdr =
+         (const loc_dlog_header*)&ring->buf[tail & (LOC_DLOG_RING_SIZE - 1)];
+      if( hdr->size & LOC_DLOG_PAD ) {
+         tail += hdr->size & ~LOC_DLOG_PAD;
+         continue;
+      }
+
+      int n = 0;
+      if( loc_logger.TIMESTAMP ) {
+         time_t sec = (time_t)(hdr->time_usec / 1000000);
+         struct tm tm;
+         localtime_r(&sec, &tm);
+         strftime(ts, sizeof(ts), "%H:%M:%S", &tm);
+         n = snprintf(line, sizeof(line), "[%s.%06d] ", ts,
+                      (int)(hdr->time_usec % 1000000));
+      }
+      loc_dlog_format(hdr, line + n, sizeof(line) - n);
+      loc_dlog_emit(hdr->prio, hdr->tag, line);
+      tail += hdr->size;
+   }
+   __atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+   if( dropped != ring->dropped_reported ) {
+      snprintf(line, sizeof(line), "W/thread %d dropped %u log records",
+               ring->tid, dropped - ring->dropped_reported);
+      loc_dlog_emit(ANDROID_LOG_WARN, LOG_TAG, line);
+      ring->dropped_reported = dropped;
+   }
+}
+
+/*===========================================================================
+FUNCTION    loc_dlog_flush_thread
+
+DESCRIPTION
+   Drains all rings every LOC_DLOG_FLUSH_MSEC, and frees the rings of
+   threads that have exited once they are empty.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void* loc_dlog_flush_thread(void* arg)
+{
+   (void)arg;
+   for( ;; )
+   {
+      usleep(LOC_DLOG_FLUSH_MSEC * 1000);
+
+      pthread_mutex_lock(&loc_dlog_mutex);
+      loc_dlog_ring** pp = &loc_dlog_rings;
+      while( *pp != NULL )
+      {
+         loc_dlog_ring* ring = *pp;
+         int dead = __atomic_load_n(&ring->dead, __ATOMIC_ACQUIRE);
+         loc_dlog_drain(ring);
+         if( dead && ring->tail == ring->head ) {
+            *pp = ring->next;
+            free(ring);
+         } else {
+            pp = &ring->next;
+         }
+      }
+      pthread_mutex_unlock(&loc_dlog_mutex);
+   }
+   return NULL;
+}
+
+static void loc_dlog_thread_exit(void* data)
+{
+   loc_dlog_ring* ring = (loc_dlog_ring*)data;
+   __atomic_store_n(&ring->dead, 1, __ATOMIC_RELEASE);
+}
+
+static void loc_dlog_init(void)
+{
+   pthread_t thread;
+   pthread_key_create(&loc_dlog_key, loc_dlog_thread_exit);
+   if( pthread_create(&thread, NULL, loc_dlog_flush_thread, NULL) == 0 ) {
+      pthread_detach(thread);
+      loc_dlog_running = 1;
+   } else {
+      ALOGE("E/%s: no flush thread, deferred logging stays off", __func__);
+   }
+}
+
+/*===========================================================================
+FUNCTION    loc_dlog_enable
+
+DESCRIPTION
+   Turns deferred logging on or off. The flush thread is started the first
+   time it is turned on and then stays; records already taken are still
+   emitted after it is turned off.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_dlog_enable(unsigned long deferred)
+{
+   if( deferred ) {
+      pthread_once(&loc_dlog_once, loc_dlog_init);
+   }
+   loc_logger.DEFERRED = (deferred && loc_dlog_running) ? 1 : 0;
+}
+
+/*===========================================================================
+FUNCTION    loc_dlog_record
+
+DESCRIPTION
+   Takes a log record into the calling thread's ring, for the flush thread
+   to format later. fmt and tag must be string literals, or at least stay
+   valid for the life of the process.
+
+DEPENDENCIES
+   loc_dlog_enable(1)
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   The record is dropped and counted if the ring is full.
+
+===========================================================================*/
+void loc_dlog_record(int prio, const char* tag, const char* fmt, ...)
+{
+   uint8_t rec[LOC_DLOG_MAX_RECORD];
+   loc_dlog_header* hdr = (loc_dlog_header*)rec;
+   loc_dlog_ring* ring;
+   struct timespec now;
+   va_list ap;
+   int nargs;
+
+   ring = (loc_dlog_ring*)pthread_getspecific(loc_dlog_key);
+   if( ring == NULL ) {
+      ring = (loc_dlog_ring*)calloc(1, sizeof(loc_dlog_ring));
+      if( ring == NULL ) return;
+      ring->tid = syscall(SYS_gettid);
+      pthread_setspecific(loc_dlog_key, ring);
+      pthread_mutex_lock(&loc_dlog_mutex);
+      ring->next = loc_dlog_rings;
+      loc_dlog_rings = ring;
+      pthread_mutex_unlock(&loc_dlog_mutex);
+   }
+
+   clock_gettime(CLOCK_REALTIME, &now);
+
+   va_start(ap, fmt);
+   int size = sizeof(loc_dlog_header) +
+      loc_dlog_pack(fmt, ap, rec + sizeof(loc_dlog_header),
+                    sizeof(rec) - sizeof(loc_dlog_header), &nargs);
+   va_end(ap);
+
+   hdr->size = LOC_DLOG_ALIGN(size);
+   hdr->prio = prio;
+   hdr->nargs = nargs;
+   hdr->tag = tag;
+   hdr->fmt = fmt;
+   hdr->time_usec = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+
+   uint32_t head = ring->head;
+   uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+   uint32_t offset = head & (LOC_DLOG_RING_SIZE - 1);
+   uint32_t pad = 0;
+   if( offset + hdr->size > LOC_DLOG_RING_SIZE ) {
+      pad = LOC_DLOG_RING_SIZE - offset;
+   }
+   if( head + pad + hdr->size - tail > LOC_DLOG_RING_SIZE ) {
+      ring->dropped++;
+      return;
+   }
+
+   if( pad ) {
+      ((loc_dlog_header*)&ring->buf[offset])->size = pad | LOC_DLOG_PAD;
+      head += pad;
+      offset = 0;
+   }
+   memcpy(&ring->buf[offset], rec, size);
+   __atomic_store_n(&ring->head, head + hdr->size, __ATOMIC_RELEASE);
+}
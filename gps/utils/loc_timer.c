@@ -27,12 +27,31 @@
  *
  */
 
+/* for pthread_setname_np() on glibc hosts */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include<stdio.h>
 #include<stdlib.h>
-#include<sys/time.h>
-#include "loc_timer.h"
+#include<stdint.h>
+#include<string.h>
+#include<unistd.h>
 #include<time.h>
 #include<errno.h>
+#include<sys/timerfd.h>
+#include "loc_timer.h"
+
+/*
+  All timers are served by one thread. Armed timers sit in a min-heap
+  ordered by their CLOCK_MONOTONIC expiry, and a timerfd is always armed
+  for the heap top, so the thread only wakes up when something expires.
+  loc_timer_stop() just marks the timer ABORT under the lock; the thread
+  reclaims aborted entries when they reach the heap top, or in one sweep
+  once they make up half of the heap.
+*/
+
+#define TIMER_HEAP_INIT_SIZE 16
 
 enum timer_state {
     READY = 100,
@@ -41,104 +60,218 @@ enum timer_state {
     ABORT
 };
 
-typedef struct {
+typedef struct timer_data {
+    struct timer_data* next;
     loc_timer_callback callback_func;
     void *user_data;
-    unsigned int time_msec;
-    pthread_cond_t timer_cond;
-    pthread_mutex_t timer_mutex;
+    uint64_t expiry_nsec;
     enum timer_state state;
 }timer_data;
 
-static void *timer_thread(void *thread_data)
+typedef struct {
+    pthread_mutex_t lock;
+    int fd;
+    timer_data** heap;
+    unsigned int heap_size;
+    unsigned int heap_cap;
+    unsigned int aborted;
+    uint64_t armed_nsec;
+}timer_service;
+
+static timer_service svc = {
+    PTHREAD_MUTEX_INITIALIZER, -1, NULL, 0, 0, 0, 0
+};
+static pthread_once_t svc_once = PTHREAD_ONCE_INIT;
+
+static uint64_t now_nsec()
 {
-    int ret = -ETIMEDOUT;
     struct timespec ts;
-    struct timeval tv;
-    timer_data* t = (timer_data*)thread_data;
-
-    LOC_LOGD("%s:%d]: Enter. Delay = %d\n", __func__, __LINE__, t->time_msec);
-
-    gettimeofday(&tv, NULL);
-    clock_gettime(CLOCK_REALTIME, &ts);
-    if(t->time_msec >= 1000) {
-        ts.tv_sec += t->time_msec/1000;
-        t->time_msec = t->time_msec % 1000;
-    }
-    if(t->time_msec)
-        ts.tv_nsec += t->time_msec * 1000000;
-    if(ts.tv_nsec > 999999999) {
-        LOC_LOGD("%s:%d]: Large nanosecs\n", __func__, __LINE__);
-        ts.tv_sec += 1;
-        ts.tv_nsec -= 1000000000;
-    }
-    LOC_LOGD("%s:%d]: ts.tv_sec:%d; ts.tv_nsec:%d\n"
-             "\t Current time: %d sec; %d nsec",
-             __func__, __LINE__, (int)ts.tv_sec, (int)ts.tv_nsec,
-             (int)tv.tv_sec, (int)tv.tv_usec*1000);
-
-    pthread_mutex_lock(&(t->timer_mutex));
-    if (READY == t->state) {
-        t->state = WAITING;
-        ret = pthread_cond_timedwait(&t->timer_cond, &t->timer_mutex, &ts);
-        t->state = DONE;
-    }
-    pthread_mutex_unlock(&(t->timer_mutex));
-
-    switch (ret) {
-    case ETIMEDOUT:
-        LOC_LOGV("%s:%d]: loc_timer timed out",  __func__, __LINE__);
-        break;
-    case 0:
-        LOC_LOGV("%s:%d]: loc_timer stopped",  __func__, __LINE__);
-        break;
-    case -ETIMEDOUT:
-        LOC_LOGV("%s:%d]: loc_timer cancelled",  __func__, __LINE__);
-        break;
-    default:
-        LOC_LOGE("%s:%d]: Call to pthread timedwait failed; ret=%d\n",
-                 __func__, __LINE__, ret);
-        break;
-    }
-
-    if(ETIMEDOUT == ret)
-        t->callback_func(t->user_data, ret);
-
-    // A (should be rare) race condition is that, when the loc_time_stop is called
-    // and acquired mutex, we reach here.  pthread_mutex_destroy will fail with
-    // error code EBUSY.  We give it 6 tries in 5 seconds.  Should be eanough time
-    // for loc_timer_stop to complete.  With the 7th try, we also perform unlock
-    // prior to destroy.
-    {
-        int i;
-        for (i = 0; EBUSY == pthread_mutex_destroy(&t->timer_mutex) && i <= 5; i++) {
-            if (i < 5) {
-                sleep(1);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void heap_swap(unsigned int a, unsigned int b)
+{
+    timer_data* t = svc.heap[a];
+    svc.heap[a] = svc.heap[b];
+    svc.heap[b] = t;
+}
+
+static void heap_up(unsigned int i)
+{
+    while (i > 0) {
+        unsigned int parent = (i - 1) / 2;
+        if (svc.heap[parent]->expiry_nsec <= svc.heap[i]->expiry_nsec) {
+            break;
+        }
+        heap_swap(i, parent);
+        i = parent;
+    }
+}
+
+static void heap_down(unsigned int i)
+{
+    while (1) {
+        unsigned int min = i, l = 2 * i + 1, r = l + 1;
+        if (l < svc.heap_size &&
+            svc.heap[l]->expiry_nsec < svc.heap[min]->expiry_nsec) {
+            min = l;
+        }
+        if (r < svc.heap_size &&
+            svc.heap[r]->expiry_nsec < svc.heap[min]->expiry_nsec) {
+            min = r;
+        }
+        if (min == i) {
+            break;
+        }
+        heap_swap(i, min);
+        i = min;
+    }
+}
+
+static timer_data* heap_pop()
+{
+    timer_data* t = svc.heap[0];
+    svc.heap[0] = svc.heap[--svc.heap_size];
+    if (svc.heap_size > 0) {
+        heap_down(0);
+    }
+    return t;
+}
+
+// drops all aborted timers from the heap in one pass. Called with lock held.
+static void heap_sweep()
+{
+    unsigned int i, n = 0;
+    for (i = 0; i < svc.heap_size; i++) {
+        if (ABORT == svc.heap[i]->state) {
+            free(svc.heap[i]);
+        } else {
+            svc.heap[n++] = svc.heap[i];
+        }
+    }
+    svc.heap_size = n;
+    svc.aborted = 0;
+    for (i = n / 2; i-- > 0; ) {
+        heap_down(i);
+    }
+}
+
+// points the timerfd at the current heap top. Called with lock held.
+static void rearm()
+{
+    struct itimerspec its;
+    uint64_t expiry = svc.heap_size ? svc.heap[0]->expiry_nsec : 0;
+
+    if (expiry == svc.armed_nsec) {
+        return;
+    }
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = expiry / 1000000000ULL;
+    its.it_value.tv_nsec = expiry % 1000000000ULL;
+    // a zero it_value disarms the timerfd
+    if (timerfd_settime(svc.fd, TFD_TIMER_ABSTIME, &its, NULL)) {
+        LOC_LOGE("%s:%d]: timerfd_settime failed; errno=%d\n",
+                 __func__, __LINE__, errno);
+    }
+    svc.armed_nsec = expiry;
+}
+
+static void *timer_thread(void *arg)
+{
+    uint64_t ticks;
+
+    LOC_LOGD("%s:%d]: Enter\n", __func__, __LINE__);
+
+    while (1) {
+        timer_data* expired = NULL;
+
+        if (read(svc.fd, &ticks, sizeof(ticks)) < 0 && EINTR != errno &&
+            EAGAIN != errno) {
+            LOC_LOGE("%s:%d]: read timerfd failed; errno=%d\n",
+                     __func__, __LINE__, errno);
+        }
+
+        pthread_mutex_lock(&svc.lock);
+        // the timerfd is now disarmed, whatever we had set
+        svc.armed_nsec = 0;
+        uint64_t now = now_nsec();
+        while (svc.heap_size > 0 && svc.heap[0]->expiry_nsec <= now) {
+            timer_data* t = heap_pop();
+            if (ABORT == t->state) {
+                svc.aborted--;
+                free(t);
             } else {
-                // nah, forget it, something is seriously wrong.  Mutex has been
-                // held too long.  Unlock the mutext here.
-                pthread_mutex_unlock(&t->timer_mutex);
+                t->state = DONE;
+                t->next = expired;
+                expired = t;
             }
         }
+        rearm();
+        pthread_mutex_unlock(&svc.lock);
+
+        // run the callbacks without the lock, so they can start / stop
+        // timers of their own
+        while (NULL != expired) {
+            timer_data* t = expired;
+            expired = t->next;
+            LOC_LOGV("%s:%d]: loc_timer timed out",  __func__, __LINE__);
+            t->callback_func(t->user_data, ETIMEDOUT);
+            free(t);
+        }
     }
-    pthread_cond_destroy(&t->timer_cond);
 
-    free(t);
-    LOC_LOGD("%s:%d]: Exit\n", __func__, __LINE__);
     return NULL;
 }
 
+static void timer_service_init()
+{
+    pthread_attr_t tattr;
+    pthread_t id;
+
+    svc.fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (svc.fd < 0) {
+        LOC_LOGE("%s:%d]: timerfd_create failed; errno=%d\n",
+                 __func__, __LINE__, errno);
+        return;
+    }
+
+    if (pthread_attr_init(&tattr)) {
+        LOC_LOGE("%s:%d]: Pthread attr init failed\n", __func__, __LINE__);
+        goto fd_err;
+    }
+    pthread_attr_setdetachstate(&tattr, PTHREAD_CREATE_DETACHED);
+
+    if (pthread_create(&id, &tattr, timer_thread, NULL)) {
+        LOC_LOGE("%s:%d]: Could not create thread\n", __func__, __LINE__);
+        pthread_attr_destroy(&tattr);
+        goto fd_err;
+    }
+    pthread_attr_destroy(&tattr);
+    pthread_setname_np(id, "loc_timer");
+    return;
+
+fd_err:
+    close(svc.fd);
+    svc.fd = -1;
+}
+
 void* loc_timer_start(unsigned int msec, loc_timer_callback cb_func,
                       void* caller_data)
 {
     timer_data *t=NULL;
-    pthread_attr_t tattr;
-    pthread_t id;
     LOC_LOGD("%s:%d]: Enter\n", __func__, __LINE__);
     if(cb_func == NULL || msec == 0) {
         LOC_LOGE("%s:%d]: Error: Wrong parameters\n", __func__, __LINE__);
         goto _err;
     }
+
+    pthread_once(&svc_once, timer_service_init);
+    if (svc.fd < 0) {
+        LOC_LOGE("%s:%d]: Timer service not available\n", __func__, __LINE__);
+        goto _err;
+    }
+
     t = (timer_data *)calloc(1, sizeof(timer_data));
     if(t == NULL) {
         LOC_LOGE("%s:%d]: Could not allocate memory. Failing.\n",
@@ -146,57 +279,54 @@ void* loc_timer_start(unsigned int msec, loc_timer_callback cb_func,
         goto _err;
     }
 
-    if(pthread_cond_init(&(t->timer_cond), NULL)) {
-        LOC_LOGE("%s:%d]: Pthread cond init failed\n", __func__, __LINE__);
-        goto t_err;
-    }
-    if(pthread_mutex_init(&(t->timer_mutex), NULL)) {
-        LOC_LOGE("%s:%d]: Pthread mutex init failed\n", __func__, __LINE__);
-        goto cond_err;
-    }
-
     t->callback_func = cb_func;
     t->user_data = caller_data;
-    t->time_msec = msec;
-    t->state = READY;
-
-    if (pthread_attr_init(&tattr)) {
-        LOC_LOGE("%s:%d]: Pthread mutex init failed\n", __func__, __LINE__);
-        goto mutex_err;
-    }
-    pthread_attr_setdetachstate(&tattr, PTHREAD_CREATE_DETACHED);
+    t->expiry_nsec = now_nsec() + (uint64_t)msec * 1000000ULL;
+    t->state = WAITING;
 
-    if(pthread_create(&(id), &tattr, timer_thread, (void *)t)) {
-        LOC_LOGE("%s:%d]: Could not create thread\n", __func__, __LINE__);
-        goto attr_err;
+    pthread_mutex_lock(&svc.lock);
+    if (svc.heap_size == svc.heap_cap) {
+        unsigned int cap = svc.heap_cap ? svc.heap_cap * 2 : TIMER_HEAP_INIT_SIZE;
+        timer_data** heap = (timer_data**)realloc(svc.heap, cap * sizeof(timer_data*));
+        if (heap == NULL) {
+            pthread_mutex_unlock(&svc.lock);
+            LOC_LOGE("%s:%d]: Could not grow timer heap. Failing.\n",
+                     __func__, __LINE__);
+            free(t);
+            t = NULL;
+            goto _err;
+        }
+        svc.heap = heap;
+        svc.heap_cap = cap;
     }
+    svc.heap[svc.heap_size++] = t;
+    heap_up(svc.heap_size - 1);
+    rearm();
+    pthread_mutex_unlock(&svc.lock);
 
-    LOC_LOGD("%s:%d]: Created thread with id: %d\n",
-             __func__, __LINE__, (int)id);
-    goto _err;
-
-attr_err:
-    pthread_attr_destroy(&tattr);
-mutex_err:
-    pthread_mutex_destroy(&t->timer_mutex);
-cond_err:
-    pthread_cond_destroy(&t->timer_cond);
-t_err:
-    free(t);
 _err:
     LOC_LOGD("%s:%d]: Exit\n", __func__, __LINE__);
     return t;
 }
 
-void loc_timer_stop(void* handle) {
+int loc_timer_stop(void* handle) {
     timer_data* t = (timer_data*)handle;
+    int ret = 0;
 
-    if (NULL != t && (READY == t->state || WAITING == t->state) &&
-        pthread_mutex_lock(&(t->timer_mutex)) == 0) {
-        if (READY == t->state || WAITING == t->state) {
-            pthread_cond_signal(&t->timer_cond);
+    if (NULL != t) {
+        pthread_mutex_lock(&svc.lock);
+        ret = (WAITING != t->state);
+        if (WAITING == t->state) {
             t->state = ABORT;
+            // the entry is freed once it reaches the heap top; sweep
+            // early if aborted entries start to dominate the heap
+            if (++svc.aborted > svc.heap_size / 2) {
+                heap_sweep();
+                rearm();
+            }
+            LOC_LOGV("%s:%d]: loc_timer cancelled",  __func__, __LINE__);
         }
-        pthread_mutex_unlock(&(t->timer_mutex));
+        pthread_mutex_unlock(&svc.lock);
     }
+    return ret;
 }
@@ -45,16 +45,21 @@ typedef void(*loc_timer_callback)(void *user_data, int result);
 
 
 /*
-  Returns the handle, which can be used to stop the timer
+  Returns the handle, which can be used to stop the timer; NULL on failure.
+  All callbacks run on one shared timer thread and must not block.
 */
 void* loc_timer_start(unsigned int delay_msec,
                       loc_timer_callback,
                       void* user_data);
 
 /*
-  handle becomes invalid upon the return of the callback
+  handle becomes invalid upon the return of the callback.
+  Stopping never blocks; the callback is not invoked afterwards unless it
+  has already started.
+  Returns 0 if the callback will not run, non zero if it has started, in
+  which case handle stays valid until it returns.
 */
-void loc_timer_stop(void* handle);
+int loc_timer_stop(void* handle);
 
 #ifdef __cplusplus
 }
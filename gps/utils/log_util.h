@@ -45,6 +45,12 @@
 
 #endif  // LOG_TAG
 
+#define ANDROID_LOG_VERBOSE 2
+#define ANDROID_LOG_DEBUG   3
+#define ANDROID_LOG_INFO    4
+#define ANDROID_LOG_WARN    5
+#define ANDROID_LOG_ERROR   6
+
 #endif /* USE_GLIB */
 
 #ifdef __cplusplus
@@ -61,6 +67,7 @@ typedef struct loc_logger_s
 {
   unsigned long  DEBUG_LEVEL;
   unsigned long  TIMESTAMP;
+  unsigned long  DEFERRED;
 } loc_logger_s_type;
 
 /*=============================================================================
@@ -88,33 +95,79 @@ extern const char ENTRY_TAG[];
  *============================================================================*/
 extern void loc_logger_init(unsigned long debug, unsigned long timestamp);
 extern char* get_timestamp(char* str, unsigned long buf_size);
+extern void loc_dlog_enable(unsigned long deferred);
+extern void loc_dlog_record(int prio, const char* tag, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4)));
 
 #ifndef DEBUG_DMN_LOC_API
 
 /* LOGGING MACROS */
+/* LOC_LOG_COMPILED_LEVEL is the highest level built in: 1 E, 2 W, 3 I,
+   4 D, 5 V. A call above it keeps only a dead if (0) around its ALOG so
+   the format is still checked, and its arguments are never evaluated.
+   DEBUG_LEVEL from gps.conf filters at run time below it. Modules pick
+   it up from TARGET_LOC_LOG_LEVEL in their Android.mk; user builds clamp
+   DEBUG_LEVEL to 2 in loc_logger_init, so they default to 2 here too. */
+#ifndef LOC_LOG_COMPILED_LEVEL
+#ifdef TARGET_BUILD_VARIANT_USER
+#define LOC_LOG_COMPILED_LEVEL 2
+#else
+#define LOC_LOG_COMPILED_LEVEL 5
+#endif
+#endif
+
+#define LOC_LOG_NONE(...) if (0) { ALOGE(__VA_ARGS__); }
+
+/* With LOG_DEFERRED set in gps.conf, records go to the calling thread's
+   ring and are formatted later on the flush thread, see loc_dlog.c.
+   ALOGV is left alone, it compiles out unless LOG_NDEBUG is 0. */
+#define LOC_LOG_OUT(ALOG, PRIO, ...) \
+if (loc_logger.DEFERRED) { loc_dlog_record(PRIO, LOG_TAG, __VA_ARGS__); } \
+else { ALOG(__VA_ARGS__); }
+
 /*loc_logger.DEBUG_LEVEL is initialized to 0xff in loc_cfg.cpp
   if that value remains unchanged, it means gps.conf did not
   provide a value and we default to the initial value to use
   Android's logging levels*/
+#if LOC_LOG_COMPILED_LEVEL >= 1
 #define LOC_LOGE(...) \
-if ((loc_logger.DEBUG_LEVEL >= 1) && (loc_logger.DEBUG_LEVEL <= 5)) { ALOGE("W/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGE("W/" __VA_ARGS__); }
+if ((loc_logger.DEBUG_LEVEL >= 1) && (loc_logger.DEBUG_LEVEL <= 5)) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "W/" __VA_ARGS__); } \
+else if (loc_logger.DEBUG_LEVEL == 0xff) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "W/" __VA_ARGS__); }
+#else
+#define LOC_LOGE(...) LOC_LOG_NONE("W/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_COMPILED_LEVEL >= 2
 #define LOC_LOGW(...) \
-if ((loc_logger.DEBUG_LEVEL >= 2) && (loc_logger.DEBUG_LEVEL <= 5)) { ALOGE("W/" __VA_ARGS__); }  \
-else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGW("W/" __VA_ARGS__); }
+if ((loc_logger.DEBUG_LEVEL >= 2) && (loc_logger.DEBUG_LEVEL <= 5)) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "W/" __VA_ARGS__); }  \
+else if (loc_logger.DEBUG_LEVEL == 0xff) { LOC_LOG_OUT(ALOGW, ANDROID_LOG_WARN, "W/" __VA_ARGS__); }
+#else
+#define LOC_LOGW(...) LOC_LOG_NONE("W/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_COMPILED_LEVEL >= 3
 #define LOC_LOGI(...) \
-if ((loc_logger.DEBUG_LEVEL >= 3) && (loc_logger.DEBUG_LEVEL <= 5)) { ALOGE("I/" __VA_ARGS__); }   \
-else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGI("I/" __VA_ARGS__); }
+if ((loc_logger.DEBUG_LEVEL >= 3) && (loc_logger.DEBUG_LEVEL <= 5)) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "I/" __VA_ARGS__); }   \
+else if (loc_logger.DEBUG_LEVEL == 0xff) { LOC_LOG_OUT(ALOGI, ANDROID_LOG_INFO, "I/" __VA_ARGS__); }
+#else
+#define LOC_LOGI(...) LOC_LOG_NONE("I/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_COMPILED_LEVEL >= 4
 #define LOC_LOGD(...) \
-if ((loc_logger.DEBUG_LEVEL >= 4) && (loc_logger.DEBUG_LEVEL <= 5)) { ALOGE("D/" __VA_ARGS__); }   \
-else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGD("D/" __VA_ARGS__); }
+if ((loc_logger.DEBUG_LEVEL >= 4) && (loc_logger.DEBUG_LEVEL <= 5)) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "D/" __VA_ARGS__); }   \
+else if (loc_logger.DEBUG_LEVEL == 0xff) { LOC_LOG_OUT(ALOGD, ANDROID_LOG_DEBUG, "D/" __VA_ARGS__); }
+#else
+#define LOC_LOGD(...) LOC_LOG_NONE("D/" __VA_ARGS__)
+#endif
 
+#if LOC_LOG_COMPILED_LEVEL >= 5
 #define LOC_LOGV(...) \
-if ((loc_logger.DEBUG_LEVEL >= 5) && (loc_logger.DEBUG_LEVEL <= 5)) { ALOGE("V/" __VA_ARGS__); }   \
+if ((loc_logger.DEBUG_LEVEL >= 5) && (loc_logger.DEBUG_LEVEL <= 5)) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "V/" __VA_ARGS__); }   \
 else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGV("V/" __VA_ARGS__); }
+#else
+#define LOC_LOGV(...) LOC_LOG_NONE("V/" __VA_ARGS__)
+#endif
 
 #else /* DEBUG_DMN_LOC_API */
 
@@ -137,7 +190,7 @@ else if (loc_logger.DEBUG_LEVEL == 0xff) { ALOGV("V/" __VA_ARGS__); }
  *============================================================================*/
 #define LOG_(LOC_LOG, ID, WHAT, SPEC, VAL)                                    \
     do {                                                                      \
-        if (loc_logger.TIMESTAMP) {                                           \
+        if (loc_logger.TIMESTAMP && !loc_logger.DEFERRED) {                   \
             char ts[32];                                                      \
             LOC_LOG("[%s] %s %s line %d " #SPEC,                              \
                      get_timestamp(ts, sizeof(ts)), ID, WHAT, __LINE__, VAL); \
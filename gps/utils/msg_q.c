@@ -105,7 +105,7 @@ msq_q_err_type msg_q_init(void** msg_q_data)
       return eMSG_Q_FAILURE_GENERAL;
    }
 
-   if( linked_list_init(&tmp_msg_q->msg_list) != 0 )
+   if( linked_list_init_pooled(&tmp_msg_q->msg_list, 0) != 0 )
    {
       LOC_LOGE("%s: Unable to initialize storage list!\n", __FUNCTION__);
       free(tmp_msg_q);
@@ -268,6 +268,75 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
    return rv;
 }
 
+/*===========================================================================
+
+  FUNCTION:   msg_q_rcv_batch
+
+  ===========================================================================*/
+msq_q_err_type msg_q_rcv_batch(void* msg_q_data, void** msg_objs,
+                               unsigned int max_cnt, unsigned int* cnt,
+                               int wait)
+{
+   msq_q_err_type rv = eMSG_Q_SUCCESS;
+   unsigned int n = 0;
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   if( msg_objs == NULL || cnt == NULL || max_cnt == 0 )
+   {
+      LOC_LOGE("%s: Invalid msg_objs / cnt / max_cnt parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   *cnt = 0;
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+
+   if( p_msg_q->unblocked )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      pthread_mutex_unlock(&p_msg_q->list_mutex);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   /* Wait for data in the message queue */
+   while( wait && linked_list_empty(p_msg_q->msg_list) && !p_msg_q->unblocked )
+   {
+      pthread_cond_wait(&p_msg_q->list_cond, &p_msg_q->list_mutex);
+   }
+
+   if( p_msg_q->unblocked )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      rv = eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+   else
+   {
+      /* Take everything pending, up to max_cnt, under this one lock */
+      while( n < max_cnt && !linked_list_empty(p_msg_q->msg_list) )
+      {
+         rv = convert_linked_list_err_type(linked_list_remove(p_msg_q->msg_list,
+                                                              &msg_objs[n]));
+         if( rv != eMSG_Q_SUCCESS )
+         {
+            break;
+         }
+         n++;
+      }
+   }
+
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   *cnt = n;
+   /* whatever made it into msg_objs is the caller's now */
+   return (n > 0) ? eMSG_Q_SUCCESS : rv;
+}
+
 /*===========================================================================
 
   FUNCTION:   msg_q_flush
@@ -157,6 +157,37 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj);
 
+/*===========================================================================
+FUNCTION    msg_q_rcv_batch
+
+DESCRIPTION
+   Retrieves up to max_cnt of the oldest messages from the message queue in
+   one go, oldest first. The Q lock is taken once for the whole batch
+   rather than once per message.
+
+   msg_q_data: Message Queue to copy data from.
+   msg_objs:   Array of at least max_cnt pointers to copy msg_q contents to.
+   max_cnt:    Most messages to take.
+   cnt:        Number of messages actually taken.
+   wait:       Non-zero to block until at least one message is available;
+               zero to return right away, with *cnt of 0 if the Q is empty.
+
+   Same threading rules as msg_q_rcv.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_rcv_batch(void* msg_q_data, void** msg_objs,
+                               unsigned int max_cnt, unsigned int* cnt,
+                               int wait);
+
 /*===========================================================================
 FUNCTION    msg_q_flush
 
@@ -30,6 +30,7 @@
 #define __PLATFORM_LIB_MACROS_H__
 
 #include <sys/time.h>
+#include <sys/types.h>
 
 #define TS_PRINTF(format, x...)                                \
 {                                                              \
@@ -29,6 +29,8 @@
 #ifndef _PLATFORM_LIB_TIME_H_
 #define _PLATFORM_LIB_TIME_H_
 
+#include <stdint.h>
+
 int64_t systemTime(int clock);
 int64_t elapsedMillisSinceBoot();
 